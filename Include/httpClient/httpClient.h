@@ -123,6 +123,91 @@ HCGlobalCleanup() HC_NOEXCEPT;
 HC_API HC_RESULT HC_CALLING_CONV
 HCGlobalGetLibVersion(_Outptr_ PCSTR* version) HC_NOEXCEPT;
 
+/// <summary>
+/// Sets the size of the in-memory HTTP response cache.  The cache is off by default.
+///
+/// When enabled, successful GET responses are cached according to their Cache-Control max-age,
+/// ETag and Last-Modified headers.  A call for a URL with a fresh cached response completes
+/// without a network request.  A stale response is revalidated with If-None-Match or
+/// If-Modified-Since, and if the server replies 304 the call completes with the cached response.
+/// Responses are evicted least recently used first once the cache is full.
+/// Calls with a "Cache-Control: no-store" request header bypass the cache.
+/// </summary>
+/// <param name="maxCacheSizeInBytes">The maximum number of bytes held by the cache.  Pass 0 to disable and empty the cache</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetResponseCacheSize(
+    _In_ uint64_t maxCacheSizeInBytes
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the size of the in-memory HTTP response cache
+/// </summary>
+/// <param name="maxCacheSizeInBytes">The maximum number of bytes held by the cache, 0 if the cache is disabled</param>
+/// <param name="usedCacheSizeInBytes">The number of bytes currently held by the cache</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetResponseCacheSize(
+    _Out_ uint64_t* maxCacheSizeInBytes,
+    _Out_ uint64_t* usedCacheSizeInBytes
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets how long HCHttpConnectAddresses() waits for a connection attempt before starting an attempt
+/// to the next address in parallel.  Defaults to 250 milliseconds, as recommended by RFC 8305.
+/// </summary>
+/// <param name="delayInMilliseconds">The connection attempt delay.  Values below 10 milliseconds are raised to 10</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetConnectionAttemptDelay(
+    _In_ uint32_t delayInMilliseconds
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets how long the connection pools of HCHttp2CallPerform() and HCHttpPipelinedCallPerform()
+/// keep a connection open with no calls on it, including one opened by HCHttpPrewarmConnection().
+/// Defaults to 60 seconds.  Applies to connections opened after the call.
+/// </summary>
+/// <param name="idleTimeoutInSeconds">The idle timeout.  Pass 0 to keep idle connections open until the server closes them</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetConnectionIdleTimeout(
+    _In_ uint32_t idleTimeoutInSeconds
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets how many HTTP calls can be in flight to one host at a time.  Defaults to 0, no limit.
+///
+/// Calls performed while a host is at the limit wait, in the order they were performed, until
+/// a call to that host completes.  Calls served by a mock or the response cache don't count.
+/// See HCGlobalGetHostCallStats() for the number of calls in flight and waiting.
+/// </summary>
+/// <param name="maxCallsPerHost">The limit per host name.  Pass 0 to remove the limit</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetMaxCallsPerHost(
+    _In_ uint32_t maxCallsPerHost
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Persists the HTTP response cache to a file so cached responses survive restarts.
+///
+/// Responses stored in the cache are also written to the file, and a call that misses the in-memory
+/// cache is looked up in the file before going to the network.  The file is created at its maximum
+/// size and memory mapped.  If the process exits part way through a write, the damaged entry is
+/// discarded the next time the file is opened.  Once the file is full, the least recently used
+/// responses are evicted.  This works independently of HCGlobalSetResponseCacheSize(), so the
+/// in-memory cache can be disabled to keep responses on disk only.
+/// </summary>
+/// <param name="filePath">UTF-8 path of the cache file, created if it doesn't exist.  Pass nullptr to stop using the file</param>
+/// <param name="maxFileSizeInBytes">The size of the cache file.  Must be at least 4096 bytes</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetResponseCacheFile(
+    _In_opt_z_ PCSTR filePath,
+    _In_ uint64_t maxFileSizeInBytes
+    ) HC_NOEXCEPT;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////
 // Logging APIs
@@ -242,7 +327,8 @@ typedef void(* HCHttpCallPerformCompletionRoutine)(
 /// When the HC_CALL_HANDLE is no longer needed, call HCHttpCallCloseHandle() to free the 
 /// memory associated with the HC_CALL_HANDLE
 ///
-/// HCHttpCallPerform can only be called once.  Create new HC_CALL_HANDLE to repeat the call.
+/// HCHttpCallPerform can only be called once.  Create new HC_CALL_HANDLE to repeat the call, 
+/// or use HCHttpCallReset() or HCHttpCallClone() to reuse a prepared request.
 /// </summary>
 /// <param name="call">The handle of the HTTP call</param>
 /// <param name="taskHandle">The task handle returned by the operation. If the API fails, HC_TASK_HANDLE will be 0</param>
@@ -273,6 +359,61 @@ HCHttpCallPerform(
     _In_opt_ HCHttpCallPerformCompletionRoutine completionRoutine
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Perform several HTTP calls as one unit.
+///
+/// Each call is performed as if passed to HCHttpCallPerform(), with the same subsystem, task group
+/// and completion routine, but the tasks are all queued at once.  Calls to the same origin are
+/// queued next to each other so they are sent on the same connections.  Completions still arrive
+/// per call, in whatever order the calls finish.
+/// </summary>
+/// <param name="calls">
+/// The handles of the HTTP calls.  Each call can be listed once, and none can have been performed
+/// already.  If any can't be performed, none are.
+/// </param>
+/// <param name="callCount">The number of calls</param>
+/// <param name="taskHandles">
+/// Optional array of callCount task handles, filled in the same order as calls.
+/// If the API fails, no task is created and the array is left unchanged.
+/// </param>
+/// <param name="taskSubsystemId">The task subsystem ID to assign to the tasks.  See HCHttpCallPerform()</param>
+/// <param name="taskGroupId">The task group ID to assign to the tasks.  See HCHttpCallPerform()</param>
+/// <param name="completionRoutineContext">The context to pass in to the completionRoutine callback</param>
+/// <param name="completionRoutine">A callback that's called as each HTTP call completes</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_PERFORMALREADYCALLED, HC_E_OUTOFMEMORY, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallBatchPerform(
+    _In_reads_(callCount) const HC_CALL_HANDLE* calls,
+    _In_ uint32_t callCount,
+    _Out_writes_opt_(callCount) HC_TASK_HANDLE* taskHandles,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCHttpCallPerformCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Connects to a URL's origin ahead of the first call to it, e.g. while the user is still
+/// choosing what to do, so the call doesn't wait for the connection to be set up.
+///
+/// With HCHttp2CallPerform() or HCHttpPipelinedCallPerform() as the perform function, the
+/// connection for an http URL is resolved and opened in the background and kept in the pool
+/// until it has been idle for the time set with HCGlobalSetConnectionIdleTimeout().  Otherwise
+/// the platform opens its own connections when a call is performed, so no connection can be
+/// opened ahead of time and HC_E_NOTSUPPORTED is returned without doing anything.
+/// </summary>
+/// <param name="url">A URL on the origin to connect to.  The path is ignored</param>
+/// <param name="connectionCount">
+/// The number of connections wanted.  The HTTP/2 and pipelined pools carry every call to an
+/// origin on one connection, so they open at most one.
+/// </param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, HC_E_NOTSUPPORTED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpPrewarmConnection(
+    _In_z_ PCSTR url,
+    _In_ uint32_t connectionCount
+    ) HC_NOEXCEPT;
+
 /// <summary>
 /// Increments the reference count on the call object.
 /// </summary>
@@ -294,6 +435,40 @@ HCHttpCallCloseHandle(
     _In_ HC_CALL_HANDLE call
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Clears the response state of a HTTP call so the same HC_CALL_HANDLE can be performed again.
+/// The request URL, method, headers, body and settings are kept and can still be changed with
+/// HCHttpCallRequestSet*().  Memory already held by the call is reused by the next request.
+///
+/// Fails with HC_E_PERFORMALREADYCALLED while a HCHttpCallPerform() on the call is still in
+/// progress, that is until the call's task is completed.
+/// Pointers previously returned by HCHttpCallResponseGet*() are no longer valid after this call.
+/// </summary>
+/// <param name="call">The handle of the HTTP call</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_PERFORMALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallReset(
+    _In_ HC_CALL_HANDLE call
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Creates a new HTTP call handle with a copy of the request state of an existing call.
+/// The URL, method, headers, body and per-call settings are copied; response state is not.
+/// This is a cheap way to stamp out many calls from a prepared request template.
+/// The template call can be in any state, including after HCHttpCallPerform().
+///
+/// When the new HC_CALL_HANDLE is no longer needed, call HCHttpCallCloseHandle() to free the 
+/// memory associated with the HC_CALL_HANDLE
+/// </summary>
+/// <param name="templateCall">The handle of the HTTP call to copy the request from</param>
+/// <param name="call">The handle of the new HTTP call</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallClone(
+    _In_ HC_CALL_HANDLE templateCall,
+    _Out_ HC_CALL_HANDLE* call
+    ) HC_NOEXCEPT;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////
 // HttpCallRequest Set APIs
@@ -444,6 +619,61 @@ HCHttpCallRequestSetTimeoutWindow(
     _In_ uint32_t timeoutWindowInSeconds
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Sets if gzip and deflate compressed responses are decompressed for this HTTP call.
+/// When enabled, the request advertises "Accept-Encoding: gzip, deflate" and a response with a
+/// matching Content-Encoding is decompressed as it arrives so HCHttpCallResponseGetResponseString()
+/// returns the decoded body.  The Content-Encoding and Content-Length response headers are then
+/// removed, and a body that decompresses to more than 64 MB fails the call with a network error of
+/// HC_E_BUFFERTOOSMALL.  Setting an Accept-Encoding request header with HCHttpCallRequestSetHeader()
+/// leaves the response body untouched.
+/// Defaults to true.
+/// This must be called prior to calling HCHttpCallPerform.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to set the default for future calls</param>
+/// <param name="enabled">If compressed responses are decompressed for this HTTP call</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetResponseDecompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ bool enabled
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets the gzip compression level for the request body of this HTTP call.
+/// When the call is performed the body is compressed and a "Content-Encoding: gzip" header is added.
+/// Bodies under 1KB, bodies that don't get smaller, and calls that already have a Content-Encoding
+/// header are sent as is.  Only use this with services that accept gzip encoded requests.
+/// Defaults to HC_COMPRESSION_LEVEL_NONE.
+/// This must be called prior to calling HCHttpCallPerform.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to set the default for future calls</param>
+/// <param name="level">The compression level for the request body</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetCompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ HC_COMPRESSION_LEVEL level
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets if this HTTP call may share a single network request with identical calls.
+/// When enabled, a GET or HEAD call without a body that is performed while another enabled call
+/// with the same method, URL and request headers is in flight is not sent.  Instead it completes
+/// when that call's results are written, with the same status code, response headers and response
+/// body.  The body is shared between the calls rather than copied.
+/// Defaults to false.
+/// This must be called prior to calling HCHttpCallPerform.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to set the default for future calls</param>
+/// <param name="enabled">If this HTTP call may be coalesced with identical calls</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetCoalescing(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ bool enabled
+    ) HC_NOEXCEPT;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////
 // HttpCallResponse Get APIs
@@ -598,6 +828,106 @@ HCWebSocketSetHeader(
     _In_z_ PCSTR headerValue
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Sets if the WebSocket offers the permessage-deflate extension (RFC 7692) when it connects.
+/// If the server accepts it, messages are compressed as they are sent and decompressed as they
+/// arrive, which suits repetitive text such as JSON.  With context takeover each message can refer
+/// back to the ones before it, which compresses better but keeps a window per direction for the
+/// life of the connection.  Only the native WebSocket implementation used on Win32 negotiates it.
+/// Defaults to HC_COMPRESSION_LEVEL_NONE, which doesn't offer the extension.
+/// This must be called prior to calling HCWebsocketConnect.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="level">The compression level for messages sent</param>
+/// <param name="maxWindowBits">The largest window to use in each direction, 2^maxWindowBits bytes, from 8 to 15</param>
+/// <param name="contextTakeover">If messages can refer back to the messages before them</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_CONNECTALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetCompression(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_COMPRESSION_LEVEL level,
+    _In_ uint32_t maxWindowBits,
+    _In_ bool contextTakeover
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sets the most memory the compression state of the WebSocket may use, so many connections can
+/// be compressed within a budget.  Smaller windows than set with HCWebSocketSetCompression() are
+/// offered to stay under it, and the extension isn't offered if even the smallest doesn't fit.
+/// Defaults to 0, which is no limit.
+/// This must be called prior to calling HCWebsocketConnect.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="memoryLimitInBytes">The limit in bytes, or 0 for no limit</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_CONNECTALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetCompressionMemoryLimit(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t memoryLimitInBytes
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets if permessage-deflate was negotiated and the message bytes before and after compression in
+/// each direction, so the compression ratio is compressed / uncompressed.  Messages sent or received
+/// without compression add the same amount to both counts.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="negotiated">If the server accepted permessage-deflate</param>
+/// <param name="uncompressedBytesSent">The size of the messages sent</param>
+/// <param name="compressedBytesSent">The size of the messages sent as they went over the network</param>
+/// <param name="uncompressedBytesReceived">The size of the messages received</param>
+/// <param name="compressedBytesReceived">The size of the messages received as they came over the network</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetCompressionStats(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ bool* negotiated,
+    _Out_ uint64_t* uncompressedBytesSent,
+    _Out_ uint64_t* compressedBytesSent,
+    _Out_ uint64_t* uncompressedBytesReceived,
+    _Out_ uint64_t* compressedBytesReceived
+    ) HC_NOEXCEPT;
+
+
+/// <summary>
+/// Sets how often the WebSocket pings the server once it is connected, and how long it waits for
+/// an answer.  Pings keep idle connections open through NATs and proxies and measure the round
+/// trip time reported by HCWebSocketGetRoundTripTime().  If nothing at all is received from the
+/// server for pongTimeoutInSeconds after a ping, the peer is treated as gone and the WebSocket is
+/// closed with HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE rather than lingering until the OS gives up on it.
+/// Only the native WebSocket implementation used on Win32 sends pings.
+/// Defaults to 0 and 0, which sends no pings.
+/// This must be called prior to calling HCWebsocketConnect.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="pingIntervalInSeconds">The time between pings, or 0 to send none</param>
+/// <param name="pongTimeoutInSeconds">How long to wait for the server after a ping, or 0 to never close the WebSocket for not answering</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_CONNECTALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetKeepAlive(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t pingIntervalInSeconds,
+    _In_ uint32_t pongTimeoutInSeconds
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the round trip times the WebSocket measured with its keepalive pings, for example to pick
+/// the closest of several servers.  The smoothed time weights recent pings the way TCP does
+/// (RFC 6298), and the minimum leaves out time spent queued behind other traffic.
+/// Every time is 0 until the first pong arrives.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="roundTripTimeInMilliseconds">The round trip time of the last ping</param>
+/// <param name="smoothedRoundTripTimeInMilliseconds">The smoothed round trip time</param>
+/// <param name="minRoundTripTimeInMilliseconds">The shortest round trip time so far</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetRoundTripTime(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ uint32_t* roundTripTimeInMilliseconds,
+    _Out_ uint32_t* smoothedRoundTripTimeInMilliseconds,
+    _Out_ uint32_t* minRoundTripTimeInMilliseconds
+    ) HC_NOEXCEPT;
 
 /// <summary>
 /// A callback invoked every time a WebSocket receives an incoming message
@@ -610,6 +940,19 @@ typedef void
     _In_z_ PCSTR incomingBodyString
     );
 
+/// <summary>
+/// A callback invoked every time a WebSocket receives an incoming binary message
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket that this message was sent to</param>
+/// <param name="payloadBytes">The bytes of the message, which are only valid until the callback returns</param>
+/// <param name="payloadSize">The size of the message in bytes</param>
+typedef void
+(HC_CALLING_CONV* HC_WEBSOCKET_BINARY_MESSAGE_FUNC)(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    );
+
 /// <summary>
 /// A callback invoked when a WebSocket is closed
 /// </summary>
@@ -632,6 +975,182 @@ HCWebSocketSetFunctions(
     _In_opt_ HC_WEBSOCKET_CLOSE_EVENT_FUNC closeFunc
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Sets the function called with incoming binary messages.  Until one is set, binary messages are
+/// passed to the message function set with HCWebSocketSetFunctions() as a string, which ends at the
+/// first NUL byte.
+/// </summary>
+/// <param name="binaryMessageFunc">A pointer to the binary message handling callback to use, or a null pointer to remove.</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, or HC_E_NOTINITIALISED.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetBinaryMessageFunction(
+    _In_opt_ HC_WEBSOCKET_BINARY_MESSAGE_FUNC binaryMessageFunc
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// A callback set with HCWebSocketSetHandleFunctions() invoked every time that WebSocket receives an incoming message
+/// </summary>
+/// <param name="context">The context passed to HCWebSocketSetHandleFunctions()</param>
+/// <param name="websocket">Handle to the WebSocket that this message was sent to</param>
+/// <param name="incomingBodyString">Body of the incoming message, which ends with a NUL and is only valid until the callback returns</param>
+/// <param name="incomingBodySize">The size of the message in bytes, not counting the NUL</param>
+typedef void
+(HC_CALLING_CONV* HC_WEBSOCKET_HANDLE_MESSAGE_FUNC)(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR incomingBodyString,
+    _In_ uint32_t incomingBodySize
+    );
+
+/// <summary>
+/// A callback set with HCWebSocketSetHandleFunctions() invoked every time that WebSocket receives an incoming binary message
+/// </summary>
+/// <param name="context">The context passed to HCWebSocketSetHandleFunctions()</param>
+/// <param name="websocket">Handle to the WebSocket that this message was sent to</param>
+/// <param name="payloadBytes">The bytes of the message, which are only valid until the callback returns</param>
+/// <param name="payloadSize">The size of the message in bytes</param>
+typedef void
+(HC_CALLING_CONV* HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC)(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    );
+
+/// <summary>
+/// A callback set with HCWebSocketSetHandleFunctions() invoked when that WebSocket is closed
+/// </summary>
+/// <param name="context">The context passed to HCWebSocketSetHandleFunctions()</param>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="closeStatus">The status of why the WebSocket was closed</param>
+typedef void
+(HC_CALLING_CONV* HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC)(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    );
+
+/// <summary>
+/// Sets the functions called with the messages and close event of one WebSocket, and the context
+/// passed to them, so each part of a title can own its WebSockets without sharing the functions
+/// set with HCWebSocketSetFunctions().  If the WebSocket has a message or binary message function,
+/// all of its messages go to them: binary messages go to the message function when there is no
+/// binary message function.  If it has a close function, its close event goes to it.  Anything
+/// else goes to the global functions.
+/// This must be called prior to calling HCWebsocketConnect.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="messageFunc">A pointer to the message handling callback to use, or a null pointer for none.</param>
+/// <param name="binaryMessageFunc">A pointer to the binary message handling callback to use, or a null pointer for none.</param>
+/// <param name="closeFunc">A pointer to the close callback to use, or a null pointer for none.</param>
+/// <param name="context">The context passed to the callbacks</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_CONNECTALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetHandleFunctions(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_opt_ HC_WEBSOCKET_HANDLE_MESSAGE_FUNC messageFunc,
+    _In_opt_ HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC binaryMessageFunc,
+    _In_opt_ HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC closeFunc,
+    _In_opt_ void* context
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Keeps the message being passed to a message function valid after the function returns, so it
+/// can be handed off without copying it.  Messages are received into pooled buffers, and this
+/// takes a reference on the current one; the WebSocket goes on with another buffer from its pool.
+/// Only call this from a message or binary message function, for the WebSocket it was called for.
+/// Call HCWebSocketReleaseMessageBuffer() when done with the message, which returns the buffer to
+/// the pool.  A buffer can be released after its WebSocket handle is closed.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket passed to the message function</param>
+/// <param name="buffer">The buffer holding the message, which ends with a NUL after its last byte</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL if no message is being passed to a message function.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketRetainMessageBuffer(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ HC_WEBSOCKET_BUFFER_HANDLE* buffer
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the message held by a buffer from HCWebSocketRetainMessageBuffer().  These are the same
+/// bytes that were passed to the message function.
+/// </summary>
+/// <param name="buffer">The buffer</param>
+/// <param name="payloadBytes">The bytes of the message, which are valid until the buffer is released</param>
+/// <param name="payloadSize">The size of the message in bytes, not counting the NUL after it</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetMessageBufferBytes(
+    _In_ HC_WEBSOCKET_BUFFER_HANDLE buffer,
+    _Outptr_ const uint8_t** payloadBytes,
+    _Out_ uint32_t* payloadSize
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Releases a buffer from HCWebSocketRetainMessageBuffer().  It can be called from any thread.
+/// </summary>
+/// <param name="buffer">The buffer</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketReleaseMessageBuffer(
+    _In_ HC_WEBSOCKET_BUFFER_HANDLE buffer
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// A callback set with HCWebSocketSetReconnectPolicy() invoked as that WebSocket reconnects
+/// </summary>
+/// <param name="context">The context passed to HCWebSocketSetReconnectPolicy()</param>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="reconnectEvent">If an attempt was scheduled or succeeded</param>
+/// <param name="attempt">The attempt, counting from 1 after each drop</param>
+/// <param name="delayInMilliseconds">How long until a scheduled attempt starts</param>
+typedef void
+(HC_CALLING_CONV* HC_WEBSOCKET_RECONNECT_EVENT_FUNC)(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_RECONNECT_EVENT reconnectEvent,
+    _In_ uint32_t attempt,
+    _In_ uint32_t delayInMilliseconds
+    );
+
+/// <summary>
+/// Sets the WebSocket to reconnect by itself when the connection drops, rather than raising its
+/// close event.  Drops are closes with HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE, HC_WEBSOCKET_CLOSE_GOING_AWAY,
+/// HC_WEBSOCKET_CLOSE_SERVER_TERMINATE, or the server's 1012 (restarting) and 1013 (try again later).
+/// Each attempt waits a random time of up to initialDelayInMilliseconds, doubled for every attempt
+/// before it and capped at maxDelayInMilliseconds, so clients that dropped together spread their
+/// reconnects out instead of all arriving at once.  Reconnects use the same URI, sub protocol,
+/// headers and proxy as the first connect.  The close event is raised with the status of the drop
+/// only once maxAttempts in a row have failed.
+///
+/// With replayUnsentMessages, messages that hadn't been written when the connection dropped, and
+/// messages sent while reconnecting, are sent once the WebSocket is connected again, and their
+/// completion routines are called then.  Otherwise they fail.  Messages that were written are not
+/// sent again, since WebSockets have no acknowledgements.
+///
+/// Only the native WebSocket implementation used on Win32 reconnects.  Defaults to a maxAttempts of 0,
+/// which never reconnects.
+/// This must be called prior to calling HCWebsocketConnect.
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="maxAttempts">The attempts to make after each drop, or 0 to never reconnect</param>
+/// <param name="initialDelayInMilliseconds">The longest delay before the first attempt</param>
+/// <param name="maxDelayInMilliseconds">The longest delay before any attempt</param>
+/// <param name="replayUnsentMessages">If messages not yet written are sent on the new connection</param>
+/// <param name="reconnectFunc">A pointer to the reconnect event callback to use, or a null pointer for none.</param>
+/// <param name="context">The context passed to the callback</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_CONNECTALREADYCALLED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetReconnectPolicy(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t maxAttempts,
+    _In_ uint32_t initialDelayInMilliseconds,
+    _In_ uint32_t maxDelayInMilliseconds,
+    _In_ bool replayUnsentMessages,
+    _In_opt_ HC_WEBSOCKET_RECONNECT_EVENT_FUNC reconnectFunc,
+    _In_opt_ void* context
+    ) HC_NOEXCEPT;
+
 /// <summary>
 /// Callback definition for the WebSocket completion routine used by HCWebSocketConnect() and HCWebSocketSendMessage()
 /// </summary>
@@ -680,6 +1199,54 @@ HCWebSocketSendMessage(
     _In_opt_ HCWebSocketCompletionRoutine completionRoutine
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Send a binary message to the WebSocket.  The bytes are copied, so the buffer can be reused as soon
+/// as this returns.
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="payloadBytes">The bytes to send</param>
+/// <param name="payloadSize">The number of bytes to send</param>
+/// <param name="taskSubsystemId">The task's subsystem ID</param>
+/// <param name="taskGroupId">The task's group ID</param>
+/// <param name="completionRoutineContext">The context to pass in to the completion routine</param>
+/// <param name="completionRoutine">A callback called once the message is sent or has failed</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Sends the same binary message to many WebSockets, such as every client of a relay.  The message
+/// is framed once and all the connections write it from one shared buffer, rather than each taking
+/// a copy as HCWebSocketSendBinaryMessage() does.
+///
+/// Only open WebSockets connected through the native WebSocket implementation used on Win32 are
+/// sent the message; the rest are skipped.  The message is sent uncompressed even where
+/// permessage-deflate was negotiated, there is no completion routine, and it isn't replayed after
+/// a reconnect.
+/// </summary>
+/// <param name="websockets">The handles of the WebSockets to send to</param>
+/// <param name="websocketCount">The number of handles</param>
+/// <param name="payloadBytes">The message to send</param>
+/// <param name="payloadSize">The size of the message in bytes</param>
+/// <param name="queuedCount">Optional, set to the number of WebSockets the message was queued on</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketBroadcast(
+    _In_reads_(websocketCount) const HC_WEBSOCKET_HANDLE* websockets,
+    _In_ uint32_t websocketCount,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _Out_opt_ uint32_t* queuedCount
+    ) HC_NOEXCEPT;
+
 /// <summary>
 /// Disconnects / closes the WebSocket
 /// </summary>
@@ -48,6 +48,173 @@ HCGlobalGetHttpCallPerformFunction(
     _Out_ HC_HTTP_CALL_PERFORM_FUNC* performFunc
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// An HC_HTTP_CALL_PERFORM_FUNC that sends http:// calls over HTTP/2 (RFC 7540) with prior knowledge,
+/// for servers known to accept cleartext HTTP/2.  Pass it to HCGlobalSetHttpCallPerformFunction().
+/// Calls to the same host and port share one connection and are sent as concurrent streams, so
+/// many small requests don't each wait for a connection or for the request before them.
+/// Request headers are compressed with HPACK, so repeated headers cost a byte or two after the
+/// first request.  Calls to other schemes, including https://, use the default implementation.
+/// </summary>
+/// <param name="call">The handle of the HTTP call</param>
+/// <param name="taskHandle">The handle to the task</param>
+HC_API void HC_CALLING_CONV
+HCHttp2CallPerform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// An HC_HTTP_CALL_PERFORM_FUNC that pipelines http:// calls over persistent HTTP/1.1 connections,
+/// for servers that can't speak HTTP/2.  Pass it to HCGlobalSetHttpCallPerformFunction().
+/// Calls to the same host and port share one connection.  Idempotent requests (GET, HEAD, PUT,
+/// DELETE, OPTIONS) are written up to 8 deep without waiting for the responses before them.
+/// Other requests wait for the pipeline to drain and are never sent twice.  If the server
+/// closes the connection, idempotent requests it hadn't answered are sent again once on a new one.
+/// Calls to other schemes, including https://, use the default implementation.
+/// </summary>
+/// <param name="call">The handle of the HTTP call</param>
+/// <param name="taskHandle">The handle to the task</param>
+HC_API void HC_CALLING_CONV
+HCHttpPipelinedCallPerform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// The callback definition used by HCHttpResolveHost().
+/// </summary>
+/// <param name="context">The context passed to HCHttpResolveHost()</param>
+/// <param name="result">HC_OK if the host was resolved, otherwise HC_E_FAIL</param>
+/// <param name="addressCount">The number of addresses</param>
+/// <param name="addresses">The numeric IPv4 and IPv6 addresses of the host.  Only valid for the duration of the callback</param>
+typedef void
+(HC_CALLING_CONV* HC_DNS_RESOLVE_COMPLETION_FUNC)(
+    _In_opt_ void* context,
+    _In_ HC_RESULT result,
+    _In_ uint32_t addressCount,
+    _In_reads_(addressCount) PCSTR* addresses
+    );
+
+/// <summary>
+/// Resolves a host name without blocking, for use by an HC_HTTP_CALL_PERFORM_FUNC that opens its own connections.
+/// Lookups run on the library's resolver threads and their results are cached, successful lookups for
+/// 60 seconds and failed ones for 10 seconds.  A host that is resolved repeatedly is looked up again
+/// in the background before its cached result expires.
+/// If the result is cached, completionRoutine is called before this function returns.  Otherwise
+/// it is called on a resolver thread and should return quickly.
+/// </summary>
+/// <param name="hostName">The host name to resolve</param>
+/// <param name="context">Context passed to completionRoutine</param>
+/// <param name="completionRoutine">Called with the result of the lookup</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpResolveHost(
+    _In_z_ PCSTR hostName,
+    _In_opt_ void* context,
+    _In_ HC_DNS_RESOLVE_COMPLETION_FUNC completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Opens a TCP connection to a host, for use by an HC_HTTP_CALL_PERFORM_FUNC that opens its own connections.
+/// Connection attempts are raced using Happy Eyeballs (RFC 8305): the addresses are reordered to
+/// alternate between IPv6 and IPv4, starting with the family of the first address, and a new
+/// attempt is started every connection attempt delay, or as soon as the previous attempt fails,
+/// while earlier attempts are still in progress.  The first attempt to connect is returned and
+/// the others are abandoned, so an unreachable address family costs one attempt delay instead of
+/// a full connect timeout.  See HCGlobalSetConnectionAttemptDelay().
+/// This function blocks the calling thread until a connection is made or the timeout elapses.
+/// </summary>
+/// <param name="addresses">Numeric IPv4 or IPv6 addresses in order of preference, as returned by HCHttpResolveHost()</param>
+/// <param name="addressCount">The number of addresses</param>
+/// <param name="port">The port to connect to</param>
+/// <param name="timeoutInMilliseconds">The maximum time to wait for a connection</param>
+/// <param name="socket">The connected socket, in blocking mode.  This is a SOCKET on Windows and a file
+/// descriptor elsewhere, and the caller is responsible for closing it</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpConnectAddresses(
+    _In_reads_(addressCount) const PCSTR* addresses,
+    _In_ uint32_t addressCount,
+    _In_ uint16_t port,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Out_ uint64_t* socket
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Stores a TLS session for an origin, for use by an HC_HTTP_CALL_PERFORM_FUNC that does its own TLS.
+/// Store the session ticket or session state after every handshake, and take it with
+/// HCHttpGetTlsSession() before the next connection to the same origin so the connection can
+/// resume the session instead of doing a full handshake.  Each session is handed out once.
+/// Up to 4 sessions are kept for each of the 64 most recently used origins.
+///
+/// The cache is an optional helper and the library's own HTTP implementations never use it:
+/// WinHTTP resumes its own sessions, and HCHttpCallPerformHttp1() and HCHttpCallPerformHttp2()
+/// only send http:// calls.  It is created the first time a provider calls HCHttpSetTlsSession(),
+/// HCHttpGetTlsSession() or HCGlobalGetTlsSessionCacheStats().
+/// </summary>
+/// <param name="origin">The origin the session belongs to, e.g. "example.com:443"</param>
+/// <param name="sessionData">The serialized session, as produced by the TLS library</param>
+/// <param name="sessionDataSize">The size of sessionData in bytes.  Sessions larger than 16KB are not stored</param>
+/// <param name="lifetimeInSeconds">How long the session may be resumed, e.g. the ticket lifetime.  Pass 0 for 5 minutes</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpSetTlsSession(
+    _In_z_ PCSTR origin,
+    _In_reads_bytes_(sessionDataSize) const uint8_t* sessionData,
+    _In_ uint32_t sessionDataSize,
+    _In_ uint32_t lifetimeInSeconds
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Takes the newest unexpired TLS session stored for an origin with HCHttpSetTlsSession().
+/// The session is removed from the cache.  If there is no session, sessionDataSize is set to 0.
+/// If buffer is too small, the session is kept and HC_E_BUFFERTOOSMALL is returned with
+/// sessionDataSize set to the size needed.
+/// </summary>
+/// <param name="origin">The origin to resume, e.g. "example.com:443"</param>
+/// <param name="bufferSize">The size of buffer in bytes</param>
+/// <param name="buffer">Receives the serialized session.  May be nullptr to query the size</param>
+/// <param name="sessionDataSize">The size of the session in bytes, or 0 if there is none</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_BUFFERTOOSMALL, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpGetTlsSession(
+    _In_z_ PCSTR origin,
+    _In_ uint32_t bufferSize,
+    _Out_writes_bytes_to_opt_(bufferSize, *sessionDataSize) uint8_t* buffer,
+    _Out_ uint32_t* sessionDataSize
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the TLS session cache hit and miss counts, so the resumption rate is hits / (hits + misses).
+/// A call to HCHttpGetTlsSession() that returns a session is a hit and one that finds no session is a miss.
+/// </summary>
+/// <param name="hits">The number of sessions handed out</param>
+/// <param name="misses">The number of lookups that found no session</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetTlsSessionCacheStats(
+    _Out_ uint64_t* hits,
+    _Out_ uint64_t* misses
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the per host call limit set with HCGlobalSetMaxCallsPerHost() and how many calls are
+/// in flight and waiting for a slot, either for one host or for all hosts together.
+/// </summary>
+/// <param name="host">The host name, e.g. "example.com", or nullptr for every host</param>
+/// <param name="maxCallsPerHost">The limit per host, 0 if there is no limit</param>
+/// <param name="inFlight">The number of calls that have been handed to the perform function and not yet completed</param>
+/// <param name="queued">The number of calls waiting for a call to the same host to complete</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetHostCallStats(
+    _In_opt_z_ PCSTR host,
+    _Out_ uint32_t* maxCallsPerHost,
+    _Out_ uint32_t* inFlight,
+    _Out_ uint32_t* queued
+    ) HC_NOEXCEPT;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////
 // HttpCallRequest Get APIs
@@ -236,6 +403,49 @@ HCHttpCallRequestGetAssertsForThrottling(
     _Out_ bool* enableAssertsForThrottling
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Gets if gzip and deflate compressed responses are decompressed for this HTTP call.
+/// Defaults to true.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to get the default for future calls</param>
+/// <param name="enabled">If compressed responses are decompressed for this HTTP call</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetResponseDecompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ bool* enabled
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the gzip compression level for the request body of this HTTP call.
+/// By the time the HC_HTTP_CALL_PERFORM_FUNC is invoked, the body returned by
+/// HCHttpCallRequestGetRequestBodyBytes() has already been compressed.
+/// Defaults to HC_COMPRESSION_LEVEL_NONE.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to get the default for future calls</param>
+/// <param name="level">The compression level for the request body</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetCompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ HC_COMPRESSION_LEVEL* level
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets if this HTTP call may share a single network request with identical calls.
+/// Coalesced calls are completed by the library, so the HC_HTTP_CALL_PERFORM_FUNC is only
+/// invoked for the first of a set of identical calls.
+/// Defaults to false.
+/// </summary>
+/// <param name="call">The handle of the HTTP call.  Pass nullptr to get the default for future calls</param>
+/// <param name="enabled">If this HTTP call may be coalesced with identical calls</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetCoalescing(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ bool* enabled
+    ) HC_NOEXCEPT;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////
 // HttpCallResponse Set APIs
@@ -253,6 +463,27 @@ HCHttpCallResponseSetResponseString(
     _In_z_ PCSTR responseString
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Appends a chunk of the response body as it is received from the network.
+/// Set the response headers before appending the body.  If the response has a gzip or deflate
+/// Content-Encoding and response decompression is enabled for the call, the chunk is decompressed
+/// onto the response string, otherwise it is appended as is.  Chunks may split the compressed
+/// data at any byte.  Once decompression starts the Content-Encoding and Content-Length response
+/// headers are removed, since they no longer describe the response string.
+/// </summary>
+/// <param name="call">The handle of the HTTP call</param>
+/// <param name="bodyBytes">The next chunk of the response body</param>
+/// <param name="bodySize">The size in bytes of the chunk</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_OUTOFMEMORY, HC_E_BUFFERTOOSMALL, or HC_E_FAIL.
+/// HC_E_FAIL is returned if the compressed data is corrupt, and HC_E_BUFFERTOOSMALL if it decompresses to more than 64 MB.
+/// Either also becomes the call's network error.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallResponseAppendResponseBodyBytes(
+    _In_ HC_CALL_HANDLE call,
+    _In_reads_bytes_(bodySize) const BYTE* bodyBytes,
+    _In_ uint32_t bodySize
+    ) HC_NOEXCEPT;
+
 /// <summary>
 /// Set the HTTP status code of the HTTP call response
 /// </summary>
@@ -332,6 +563,24 @@ typedef HC_RESULT
     _In_opt_ HCWebSocketCompletionRoutine completionRoutine
     );
 
+/// <summary>
+/// Send a binary message to the WebSocket
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="payloadBytes">The bytes to send, which must be copied if they are needed after this returns</param>
+/// <param name="payloadSize">The number of bytes to send</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+typedef HC_RESULT
+(HC_CALLING_CONV* HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC)(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    );
+
 /// <summary>
 /// Closes the WebSocket
 /// </summary>
@@ -377,6 +626,114 @@ HCGlobalGetWebSocketFunctions(
     _Out_ HC_WEBSOCKET_DISCONNECT_FUNC* websocketDisconnectFunc
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Optionally allows the caller to implement sending binary WebSocket messages, alongside the
+/// functions set with HCGlobalSetWebSocketFunctions().
+/// </summary>
+/// <param name="websocketSendBinaryMessageFunc">A callback that implements WebSocket send binary message function as desired. 
+/// Pass in nullptr to use the default implementation based on the current platform</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetWebSocketSendBinaryMessageFunction(
+    _In_opt_ HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC websocketSendBinaryMessageFunc
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the function that implements sending binary WebSocket messages.
+/// </summary>
+/// <param name="websocketSendBinaryMessageFunc">The callback that implements WebSocket send binary message function</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetWebSocketSendBinaryMessageFunction(
+    _Out_ HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC* websocketSendBinaryMessageFunc
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// An HC_WEBSOCKET_CONNECT_FUNC that connects ws:// WebSockets with the library's own RFC 6455
+/// implementation on plain sockets, for platforms without a WebSocket stack of their own.  Pass it,
+/// HCWebSocketNativeSendMessage() and HCWebSocketNativeDisconnect() to HCGlobalSetWebSocketFunctions().
+/// The proxy URI, if set, is used as an HTTP proxy that the connection is tunnelled through.
+/// All native WebSockets are read and written by a single background thread, which also calls the
+/// message and close event functions.  Other schemes, including wss://, use the default implementation.
+/// On Win32 the default implementation is this one, so wss:// isn't supported there.
+/// </summary>
+/// <param name="uri">The URI to connect to</param>
+/// <param name="subProtocol">A comma separated list of the subprotocols to offer, or an empty string</param>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="taskSubsystemId">The task's subsystem ID</param>
+/// <param name="taskGroupId">The task's group ID</param>
+/// <param name="completionRoutineContext">The context to pass in to the completion routine</param>
+/// <param name="completionRoutine">A callback called once the WebSocket is open or has failed to connect</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeConnect(
+    _In_z_ PCSTR uri,
+    _In_z_ PCSTR subProtocol,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// An HC_WEBSOCKET_SEND_MESSAGE_FUNC for WebSockets connected with HCWebSocketNativeConnect().
+/// The message is sent as a single text frame, and the completion routine is called once it has
+/// been written to the socket.
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="message">The UTF-8 message to send</param>
+/// <param name="taskSubsystemId">The task's subsystem ID</param>
+/// <param name="taskGroupId">The task's group ID</param>
+/// <param name="completionRoutineContext">The context to pass in to the completion routine</param>
+/// <param name="completionRoutine">A callback called once the message is sent or has failed</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeSendMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR message,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// An HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC for WebSockets connected with HCWebSocketNativeConnect().
+/// The message is sent as a single binary frame.
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="payloadBytes">The bytes to send</param>
+/// <param name="payloadSize">The number of bytes to send</param>
+/// <param name="taskSubsystemId">The task's subsystem ID</param>
+/// <param name="taskGroupId">The task's group ID</param>
+/// <param name="completionRoutineContext">The context to pass in to the completion routine</param>
+/// <param name="completionRoutine">A callback called once the message is sent or has failed</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// An HC_WEBSOCKET_DISCONNECT_FUNC for WebSockets connected with HCWebSocketNativeConnect().
+/// Sends a close frame with the status and waits up to 5 seconds for the server to answer it.
+/// </summary>
+/// <param name="websocket">Handle to the WebSocket</param>
+/// <param name="closeStatus">The status to close with</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, HC_E_NOTINITIALISED, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeDisconnect(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    ) HC_NOEXCEPT;
+
 /// <summary>
 /// Get the proxy URI for the WebSocket
 /// </summary>
@@ -443,6 +800,34 @@ HCWebSocketGetFunctions(
     _Out_opt_ HC_WEBSOCKET_CLOSE_EVENT_FUNC* closeFunc
     ) HC_NOEXCEPT;
 
+/// <summary>
+/// Gets the function set with HCWebSocketSetBinaryMessageFunction().
+/// </summary>
+/// <param name="binaryMessageFunc">The binary message handling callback, or a null pointer if there isn't one.</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_NOTINITIALISED.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetBinaryMessageFunction(
+    _Out_ HC_WEBSOCKET_BINARY_MESSAGE_FUNC* binaryMessageFunc
+    ) HC_NOEXCEPT;
+
+/// <summary>
+/// Gets the functions and context set on a WebSocket with HCWebSocketSetHandleFunctions().
+/// </summary>
+/// <param name="websocket">The handle of the WebSocket</param>
+/// <param name="messageFunc">The message handling callback, or a null pointer if there isn't one.</param>
+/// <param name="binaryMessageFunc">The binary message handling callback, or a null pointer if there isn't one.</param>
+/// <param name="closeFunc">The close callback, or a null pointer if there isn't one.</param>
+/// <param name="context">The context passed to the callbacks</param>
+/// <returns>Result code for this API operation.  Possible values are HC_OK, HC_E_INVALIDARG, or HC_E_FAIL.</returns>
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetHandleFunctions(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_MESSAGE_FUNC* messageFunc,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC* binaryMessageFunc,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC* closeFunc,
+    _Out_opt_ void** context
+    ) HC_NOEXCEPT;
+
 
 
 #if defined(__cplusplus)
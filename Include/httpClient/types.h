@@ -84,6 +84,7 @@ extern "C" {
 #define HC_CALLING_CONV __cdecl
 typedef uint32_t HC_MEMORY_TYPE;
 typedef struct HC_WEBSOCKET* HC_WEBSOCKET_HANDLE;
+typedef struct HC_WEBSOCKET_BUFFER* HC_WEBSOCKET_BUFFER_HANDLE;
 typedef struct HC_CALL* HC_CALL_HANDLE;
 typedef struct HC_CALL* HC_MOCK_CALL_HANDLE;
 typedef uint64_t HC_TASK_HANDLE;
@@ -102,6 +103,7 @@ typedef enum HC_RESULT
     HC_E_PERFORMALREADYCALLED = -8,
     HC_E_ALREADYINITIALISED = -9,
     HC_E_CONNECTALREADYCALLED = -10,
+    HC_E_NOTSUPPORTED = -11,
 } HC_RESULT;
 
 // Error codes from https://www.iana.org/assignments/websocket/websocket.xml#close-code-number
@@ -120,6 +122,22 @@ typedef enum HC_WEBSOCKET_CLOSE_STATUS
     HC_WEBSOCKET_CLOSE_UNKNOWN_ERROR = 4000
 } HC_WEBSOCKET_CLOSE_STATUS;
 
+// What a WebSocket with a reconnect policy is doing, see HCWebSocketSetReconnectPolicy
+typedef enum HC_WEBSOCKET_RECONNECT_EVENT
+{
+    HC_WEBSOCKET_RECONNECT_SCHEDULED = 0, // The connection dropped, or a reconnect failed, and the next attempt starts after a delay
+    HC_WEBSOCKET_RECONNECT_SUCCEEDED = 1 // The WebSocket is connected again
+} HC_WEBSOCKET_RECONNECT_EVENT;
+
+// Compression applied to request bodies, see HCHttpCallRequestSetCompression
+typedef enum HC_COMPRESSION_LEVEL
+{
+    HC_COMPRESSION_LEVEL_NONE = 0,
+    HC_COMPRESSION_LEVEL_LOW = 1, // Fastest, for bodies built on a hot path
+    HC_COMPRESSION_LEVEL_MEDIUM = 2,
+    HC_COMPRESSION_LEVEL_HIGH = 3 // Smallest output, for large uploads such as saves
+} HC_COMPRESSION_LEVEL;
+
 typedef enum HC_SUBSYSTEM_ID
 {
     HC_SUBSYSTEM_ID_GAME_MIN = 0, // Start of the range of subsystem IDs available to titles.
@@ -17,6 +17,9 @@
 #endif
 #define NOMINMAX
 
+// Winsock must come before windows.h, which otherwise pulls in the older winsock.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
 //#include <winapifamily.h>
 #else
@@ -30,11 +33,14 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <random>
 #include <string>
 #include <thread>
 #include <unordered_map>
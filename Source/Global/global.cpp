@@ -5,13 +5,18 @@
 #include "../http/httpcall.h"
 #include "buildver.h"
 #include "global.h"
-#include "../WebSocket/hcwebsocket.h"
+#include "../http/tls_session_cache.h"
+#include "../WebSocket/Native/websocket_connection.h"
 
 using namespace xbox::httpclient;
 
 static const uint32_t DEFAULT_TIMEOUT_WINDOW_IN_SECONDS = 20;
 static const uint32_t DEFAULT_HTTP_TIMEOUT_IN_SECONDS = 30;
 static const uint32_t DEFAULT_RETRY_DELAY_IN_SECONDS = 2;
+static const size_t DEFAULT_CALL_ARENA_SIZE = 2 * 1024;
+static const uint32_t DEFAULT_CONNECTION_ATTEMPT_DELAY_IN_MILLISECONDS = 250;
+static const size_t MIN_CALL_ARENA_SIZE = 512;
+static const size_t MAX_CALL_ARENA_SIZE = 64 * 1024;
 
 static std::shared_ptr<http_singleton> g_httpSingleton_atomicReadsOnly;
 
@@ -23,11 +28,14 @@ http_singleton::http_singleton()
     m_performFunc = Internal_HCHttpCallPerform;
 
     m_websocketMessageFunc = nullptr;
+    m_websocketBinaryMessageFunc = nullptr;
     m_websocketCloseEventFunc = nullptr;
 
     m_websocketConnectFunc = Internal_HCWebSocketConnect;
     m_websocketSendMessageFunc = Internal_HCWebSocketSendMessage;
+    m_websocketSendBinaryMessageFunc = Internal_HCWebSocketSendBinaryMessage;
     m_websocketDisconnectFunc = Internal_HCWebSocketDisconnect;
+    m_websocketReactor = http_allocate_shared<websocket_reactor>();
 
     m_timeoutWindowInSeconds = DEFAULT_TIMEOUT_WINDOW_IN_SECONDS;
     m_retryDelayInSeconds = DEFAULT_RETRY_DELAY_IN_SECONDS;
@@ -35,6 +43,18 @@ http_singleton::http_singleton()
     m_lastMatchingMock = nullptr;
     m_retryAllowed = true;
     m_timeoutInSeconds = DEFAULT_HTTP_TIMEOUT_IN_SECONDS;
+    m_responseDecompressionEnabled = true;
+    m_compressionLevel = HC_COMPRESSION_LEVEL_NONE;
+    m_responseCache = http_allocate_shared<http_response_cache>();
+    m_coalescingEnabled = false;
+    m_requestCoalescer = http_allocate_shared<http_request_coalescer>();
+    m_hostLimiter = http_allocate_shared<http_host_limiter>();
+    m_dnsResolver = http_allocate_shared<http_dns_resolver>();
+    m_connectionAttemptDelayInMilliseconds = DEFAULT_CONNECTION_ATTEMPT_DELAY_IN_MILLISECONDS;
+    m_socketsStarted = false;
+    m_http1Client = http_allocate_shared<http1_client>(m_dnsResolver);
+    m_http2Client = http_allocate_shared<http2_client>(m_dnsResolver);
+    m_callArenaSize = DEFAULT_CALL_ARENA_SIZE;
     m_pendingReadyHandle.set(CreateEvent(nullptr, false, false, nullptr));
 }
 
@@ -46,6 +66,48 @@ http_singleton::~http_singleton()
         HCHttpCallCloseHandle(mockCall);
     }
     m_mocks.clear();
+
+    // These close their connections, so they must go before the socket library is cleaned up
+    m_http1Client.reset();
+    m_http2Client.reset();
+    m_websocketReactor.reset();
+
+    // Joins the lookup threads, which also use the socket library
+    m_dnsResolver.reset();
+
+    if (m_socketsStarted)
+    {
+        http_socket_cleanup();
+    }
+}
+
+bool http_singleton::start_sockets()
+{
+    // Start the socket library once for the lifetime of the singleton.  The startup is reference
+    // counted, so a thread that loses the race just releases its own reference.
+    if (!m_socketsStarted)
+    {
+        if (!http_socket_startup())
+        {
+            return false;
+        }
+        bool expected = false;
+        if (!m_socketsStarted.compare_exchange_strong(expected, true))
+        {
+            http_socket_cleanup();
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<http_tls_session_cache> http_singleton::tls_session_cache()
+{
+    std::lock_guard<std::mutex> lock(m_singletonLock);
+    if (m_tlsSessionCache == nullptr)
+    {
+        m_tlsSessionCache = http_allocate_shared<http_tls_session_cache>();
+    }
+    return m_tlsSessionCache;
 }
 
 std::shared_ptr<http_singleton> get_http_singleton(bool assertIfNull)
@@ -137,6 +199,23 @@ std::shared_ptr<http_task_completed_queue> http_singleton::get_task_completed_qu
     return taskQueue;
 }
 
+void http_singleton::record_call_arena_usage(_In_ size_t bytesUsed)
+{
+    // Exponential moving average weighted 1/8 towards the newest call.  Racing updates
+    // may drop a sample which is harmless for a sizing hint.
+    size_t average = m_callArenaSize;
+    average = average - (average / 8) + (bytesUsed / 8);
+    if (average < MIN_CALL_ARENA_SIZE)
+    {
+        average = MIN_CALL_ARENA_SIZE;
+    }
+    else if (average > MAX_CALL_ARENA_SIZE)
+    {
+        average = MAX_CALL_ARENA_SIZE;
+    }
+    m_callArenaSize = average;
+}
+
 #if HC_USE_HANDLES
 HANDLE http_singleton::get_pending_ready_handle()
 {
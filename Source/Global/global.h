@@ -10,6 +10,15 @@ namespace log
     class logger;
 }
 
+class http_response_cache;
+class http_request_coalescer;
+class http_host_limiter;
+class http_dns_resolver;
+class http_tls_session_cache;
+class http1_client;
+class http2_client;
+class websocket_reactor;
+
 class http_task_completed_queue
 {
 public:
@@ -63,14 +72,35 @@ struct http_singleton
     uint32_t m_timeoutInSeconds;
     uint32_t m_timeoutWindowInSeconds;
     uint32_t m_retryDelayInSeconds;
+    bool m_responseDecompressionEnabled;
+    HC_COMPRESSION_LEVEL m_compressionLevel;
+    std::shared_ptr<http_response_cache> m_responseCache;
+    bool m_coalescingEnabled;
+    std::shared_ptr<http_request_coalescer> m_requestCoalescer;
+    std::shared_ptr<http_host_limiter> m_hostLimiter;
+    std::shared_ptr<http_dns_resolver> m_dnsResolver;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    std::atomic<bool> m_socketsStarted;
+    bool start_sockets();
+    std::shared_ptr<http_tls_session_cache> tls_session_cache(); // made on first use, since only providers doing their own TLS need it
+    std::shared_ptr<http_tls_session_cache> m_tlsSessionCache;
+    std::shared_ptr<http1_client> m_http1Client;
+    std::shared_ptr<http2_client> m_http2Client;
+
+    // Running average of the arena bytes used by closed calls, used to size new call arenas
+    std::atomic<size_t> m_callArenaSize;
+    void record_call_arena_usage(_In_ size_t bytesUsed);
 
     // WebSocket state
     HC_WEBSOCKET_MESSAGE_FUNC m_websocketMessageFunc;
+    HC_WEBSOCKET_BINARY_MESSAGE_FUNC m_websocketBinaryMessageFunc;
     HC_WEBSOCKET_CLOSE_EVENT_FUNC m_websocketCloseEventFunc;
 
     HC_WEBSOCKET_CONNECT_FUNC m_websocketConnectFunc;
     HC_WEBSOCKET_SEND_MESSAGE_FUNC m_websocketSendMessageFunc;
+    HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC m_websocketSendBinaryMessageFunc;
     HC_WEBSOCKET_DISCONNECT_FUNC m_websocketDisconnectFunc;
+    std::shared_ptr<websocket_reactor> m_websocketReactor;
 
     // Mock state
     std::mutex m_mocksLock;
@@ -3,8 +3,10 @@
 
 #include "pch.h"
 #include "../http/httpcall.h"
+#include "../http/tls_session_cache.h"
 #include "buildver.h"
 #include "global.h"
+#include "uri.h"
 
 using namespace xbox::httpclient;
 
@@ -72,3 +74,407 @@ try
 }
 CATCH_RETURN()
 
+HC_API void HC_CALLING_CONV
+HCHttp2CallPerform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr)
+    {
+        return;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+    {
+        return;
+    }
+
+    // Only cleartext HTTP is carried over HTTP/2 here.  TLS needs ALPN, so https goes to the platform.
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url != nullptr ? url : "");
+    if (!uri.IsValid() || uri.Scheme() != "http")
+    {
+        Internal_HCHttpCallPerform(call, taskHandle);
+        return;
+    }
+
+    if (!httpSingleton->start_sockets())
+    {
+        HCHttpCallResponseSetNetworkErrorCode(call, HC_E_FAIL, static_cast<uint32_t>(HC_E_FAIL));
+        HCTaskSetCompleted(taskHandle);
+        return;
+    }
+
+    httpSingleton->m_http2Client->perform(call, taskHandle, httpSingleton->m_connectionAttemptDelayInMilliseconds);
+}
+CATCH_RETURN_WITH(;)
+
+HC_API void HC_CALLING_CONV
+HCHttpPipelinedCallPerform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr)
+    {
+        return;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+    {
+        return;
+    }
+
+    // There's no TLS stack here, so https goes to the platform
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url != nullptr ? url : "");
+    if (!uri.IsValid() || uri.Scheme() != "http")
+    {
+        Internal_HCHttpCallPerform(call, taskHandle);
+        return;
+    }
+
+    if (!httpSingleton->start_sockets())
+    {
+        HCHttpCallResponseSetNetworkErrorCode(call, HC_E_FAIL, static_cast<uint32_t>(HC_E_FAIL));
+        HCTaskSetCompleted(taskHandle);
+        return;
+    }
+
+    httpSingleton->m_http1Client->perform(call, taskHandle, httpSingleton->m_connectionAttemptDelayInMilliseconds);
+}
+CATCH_RETURN_WITH(;)
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpPrewarmConnection(
+    _In_z_ PCSTR url,
+    _In_ uint32_t connectionCount
+    ) HC_NOEXCEPT
+try
+{
+    if (url == nullptr || connectionCount == 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    Uri uri(url);
+    if (!uri.IsValid() || uri.Host().empty())
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpPrewarmConnection: %s", url);
+
+    // The HTTP/2 and pipelined transports own their connections, one per origin
+    HC_HTTP_CALL_PERFORM_FUNC performFunc = httpSingleton->m_performFunc;
+    bool http2 = performFunc == HCHttp2CallPerform;
+    bool pipelined = performFunc == HCHttpPipelinedCallPerform;
+    if ((http2 || pipelined) && uri.Scheme() == "http")
+    {
+        if (!httpSingleton->start_sockets())
+        {
+            return HC_E_FAIL;
+        }
+
+        uint16_t port = uri.IsPortDefault() ? 80 : uri.Port();
+        if (http2)
+        {
+            httpSingleton->m_http2Client->prewarm(uri.Host(), port, httpSingleton->m_connectionAttemptDelayInMilliseconds);
+        }
+        else
+        {
+            httpSingleton->m_http1Client->prewarm(uri.Host(), port, httpSingleton->m_connectionAttemptDelayInMilliseconds);
+        }
+        return HC_OK;
+    }
+
+    // The platform opens its own connections and does its own lookups when a call is performed
+    return HC_E_NOTSUPPORTED;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpResolveHost(
+    _In_z_ PCSTR hostName,
+    _In_opt_ void* context,
+    _In_ HC_DNS_RESOLVE_COMPLETION_FUNC completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (hostName == nullptr || *hostName == 0 || completionRoutine == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    if (!httpSingleton->start_sockets())
+    {
+        return HC_E_FAIL;
+    }
+
+    return httpSingleton->m_dnsResolver->resolve(hostName, context, completionRoutine);
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpConnectAddresses(
+    _In_reads_(addressCount) const PCSTR* addresses,
+    _In_ uint32_t addressCount,
+    _In_ uint16_t port,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Out_ uint64_t* socket
+    ) HC_NOEXCEPT
+try
+{
+    if (addresses == nullptr || addressCount == 0 || socket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+    for (uint32_t i = 0; i < addressCount; i++)
+    {
+        if (addresses[i] == nullptr)
+        {
+            return HC_E_INVALIDARG;
+        }
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    if (!httpSingleton->start_sockets())
+    {
+        return HC_E_FAIL;
+    }
+
+    http_socket connectedSocket;
+    HC_RESULT result = http_connect_race(
+        addresses,
+        addressCount,
+        port,
+        httpSingleton->m_connectionAttemptDelayInMilliseconds,
+        timeoutInMilliseconds,
+        &connectedSocket);
+    *socket = (result == HC_OK) ? static_cast<uint64_t>(connectedSocket) : 0;
+    return result;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpSetTlsSession(
+    _In_z_ PCSTR origin,
+    _In_reads_bytes_(sessionDataSize) const uint8_t* sessionData,
+    _In_ uint32_t sessionDataSize,
+    _In_ uint32_t lifetimeInSeconds
+    ) HC_NOEXCEPT
+try
+{
+    if (origin == nullptr || *origin == 0 || sessionData == nullptr || sessionDataSize == 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->tls_session_cache()->store(origin, sessionData, sessionDataSize, lifetimeInSeconds);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpGetTlsSession(
+    _In_z_ PCSTR origin,
+    _In_ uint32_t bufferSize,
+    _Out_writes_bytes_to_opt_(bufferSize, *sessionDataSize) uint8_t* buffer,
+    _Out_ uint32_t* sessionDataSize
+    ) HC_NOEXCEPT
+try
+{
+    if (origin == nullptr || *origin == 0 || sessionDataSize == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    return httpSingleton->tls_session_cache()->take(origin, bufferSize, buffer, sessionDataSize);
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetTlsSessionCacheStats(
+    _Out_ uint64_t* hits,
+    _Out_ uint64_t* misses
+    ) HC_NOEXCEPT
+try
+{
+    if (hits == nullptr || misses == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->tls_session_cache()->get_stats(hits, misses);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetMaxCallsPerHost(
+    _In_ uint32_t maxCallsPerHost
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    http_internal_vector<http_host_waiter> admitted;
+    httpSingleton->m_hostLimiter->set_max_calls_per_host(maxCallsPerHost, admitted);
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCGlobalSetMaxCallsPerHost: %u", maxCallsPerHost);
+
+    for (const auto& waiter : admitted)
+    {
+        http_call_perform_admitted(waiter.call, waiter.taskHandle);
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetHostCallStats(
+    _In_opt_z_ PCSTR host,
+    _Out_ uint32_t* maxCallsPerHost,
+    _Out_ uint32_t* inFlight,
+    _Out_ uint32_t* queued
+    ) HC_NOEXCEPT
+try
+{
+    if (maxCallsPerHost == nullptr || inFlight == nullptr || queued == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    *maxCallsPerHost = httpSingleton->m_hostLimiter->max_calls_per_host();
+    httpSingleton->m_hostLimiter->get_stats(host, inFlight, queued);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetConnectionAttemptDelay(
+    _In_ uint32_t delayInMilliseconds
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    if (delayInMilliseconds < 10)
+    {
+        delayInMilliseconds = 10;
+    }
+    httpSingleton->m_connectionAttemptDelayInMilliseconds = delayInMilliseconds;
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCGlobalSetConnectionAttemptDelay: %u", delayInMilliseconds);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetConnectionIdleTimeout(
+    _In_ uint32_t idleTimeoutInSeconds
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->m_http1Client->set_idle_timeout(idleTimeoutInSeconds);
+    httpSingleton->m_http2Client->set_idle_timeout(idleTimeoutInSeconds);
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCGlobalSetConnectionIdleTimeout: %u", idleTimeoutInSeconds);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetResponseCacheSize(
+    _In_ uint64_t maxCacheSizeInBytes
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->m_responseCache->set_max_size(static_cast<size_t>(MIN(maxCacheSizeInBytes, static_cast<uint64_t>(SIZE_MAX))));
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCGlobalSetResponseCacheSize: %llu", maxCacheSizeInBytes);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetResponseCacheSize(
+    _Out_ uint64_t* maxCacheSizeInBytes,
+    _Out_ uint64_t* usedCacheSizeInBytes
+    ) HC_NOEXCEPT
+try
+{
+    if (maxCacheSizeInBytes == nullptr || usedCacheSizeInBytes == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    *maxCacheSizeInBytes = httpSingleton->m_responseCache->max_size();
+    *usedCacheSizeInBytes = httpSingleton->m_responseCache->size();
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetResponseCacheFile(
+    _In_opt_z_ PCSTR filePath,
+    _In_ uint64_t maxFileSizeInBytes
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCGlobalSetResponseCacheFile: %s %llu", filePath != nullptr ? filePath : "", maxFileSizeInBytes);
+    return httpSingleton->m_responseCache->set_file(filePath, maxFileSizeInBytes);
+}
+CATCH_RETURN()
@@ -97,5 +97,127 @@ void http_memory::mem_free(
     }
 }
 
+http_arena::http_arena(_In_ size_t initialCapacity) :
+    m_current(nullptr),
+    m_nextCapacity(initialCapacity),
+    m_bytesUsed(0)
+{
+    for (auto& freeList : m_freeLists)
+    {
+        freeList = nullptr;
+    }
+}
+
+http_arena::~http_arena()
+{
+    while (m_current != nullptr)
+    {
+        block* pNext = m_current->next;
+        http_memory::mem_free(m_current);
+        m_current = pNext;
+    }
+}
+
+size_t http_arena::size_class(_In_ size_t size)
+{
+    size_t sizeClass = 0;
+    for (size_t classSize = min_size_class; classSize < size; classSize <<= 1)
+    {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+uint8_t* http_arena::block_data(_In_ block* pBlock)
+{
+    return reinterpret_cast<uint8_t*>(pBlock + 1);
+}
+
+bool http_arena::add_block(_In_ size_t minCapacity)
+{
+    size_t capacity = max(m_nextCapacity, minCapacity);
+    block* pBlock = static_cast<block*>(http_memory::mem_alloc(sizeof(block) + capacity));
+    if (pBlock == nullptr)
+    {
+        return false;
+    }
+
+    pBlock->next = m_current;
+    pBlock->capacity = capacity;
+    pBlock->offset = 0;
+    m_current = pBlock;
+    m_nextCapacity = capacity * 2;
+    return true;
+}
+
+_Ret_maybenull_ _Post_writable_byte_size_(size)
+void* http_arena::allocate(
+    _In_ size_t size,
+    _In_ size_t alignment
+    )
+{
+    UNREFERENCED_PARAMETER(alignment);
+    HC_ASSERT(alignment <= min_size_class);
+    if (size > max_block_allocation)
+    {
+        return http_memory::mem_alloc(size);
+    }
+
+    size_t sizeClass = size_class(size);
+    if (m_freeLists[sizeClass] != nullptr)
+    {
+        free_node* pNode = m_freeLists[sizeClass];
+        m_freeLists[sizeClass] = pNode->next;
+        return pNode;
+    }
+
+    size_t classSize = min_size_class << sizeClass;
+    for (;;)
+    {
+        if (m_current != nullptr)
+        {
+            // Every size class is a multiple of min_size_class so keeping the offset
+            // aligned to it satisfies any fundamental alignment
+            uintptr_t base = reinterpret_cast<uintptr_t>(block_data(m_current));
+            uintptr_t aligned = (base + m_current->offset + min_size_class - 1) & ~static_cast<uintptr_t>(min_size_class - 1);
+            size_t end = static_cast<size_t>(aligned - base) + classSize;
+            if (end <= m_current->capacity)
+            {
+                m_current->offset = end;
+                m_bytesUsed += classSize;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+
+        if (!add_block(classSize + min_size_class))
+        {
+            return nullptr;
+        }
+    }
+}
+
+void http_arena::deallocate(
+    _In_opt_ void* pAddress,
+    _In_ size_t size
+    )
+{
+    if (pAddress == nullptr)
+    {
+        return;
+    }
+
+    if (size > max_block_allocation)
+    {
+        http_memory::mem_free(pAddress);
+        return;
+    }
+
+    // The block memory itself is only released when the arena is destroyed
+    size_t sizeClass = size_class(size);
+    free_node* pNode = static_cast<free_node*>(pAddress);
+    pNode->next = m_freeLists[sizeClass];
+    m_freeLists[sizeClass] = pNode;
+}
+
 NAMESPACE_XBOX_HTTP_CLIENT_END
 
@@ -5,6 +5,7 @@
 #include <new>
 #include <stddef.h>
 #include <sstream>
+#include <scoped_allocator>
 
 NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
 
@@ -47,6 +48,64 @@ private:
     void* m_pBuffer;
 };
 
+// Bump allocator owned by a single HC_CALL.  Small allocations are carved out of
+// blocks obtained from http_memory and the blocks are only returned when the arena is
+// destroyed, so a call's strings, maps and buffers cost a handful of mem_alloc calls.
+// Freed allocations go on power of two size class free lists so a call that is reset
+// and performed again reuses its memory instead of growing the arena.
+// Allocations larger than max_block_allocation go straight to http_memory so that a
+// growing response body doesn't leave stale copies behind in the arena.
+// Not thread safe; it follows the threading rules of the call that owns it.
+class http_arena
+{
+public:
+    static const size_t max_block_allocation = 16 * 1024;
+
+    http_arena(_In_ size_t initialCapacity);
+    ~http_arena();
+
+    _Ret_maybenull_ _Post_writable_byte_size_(size) void* allocate(
+        _In_ size_t size,
+        _In_ size_t alignment
+        );
+
+    void deallocate(
+        _In_opt_ void* pAddress,
+        _In_ size_t size
+        );
+
+    // Bytes carved out of arena blocks over the lifetime of the arena
+    size_t bytes_used() const { return m_bytesUsed; }
+
+    http_arena(const http_arena&) = delete;
+    http_arena& operator=(const http_arena&) = delete;
+
+private:
+    static const size_t min_size_class = 16;
+    static const size_t size_class_count = 11; // 16 bytes .. max_block_allocation
+
+    struct block
+    {
+        block* next;
+        size_t capacity;
+        size_t offset;
+    };
+
+    struct free_node
+    {
+        free_node* next;
+    };
+
+    static size_t size_class(_In_ size_t size);
+    static uint8_t* block_data(_In_ block* pBlock);
+    bool add_block(_In_ size_t minCapacity);
+
+    block* m_current;
+    free_node* m_freeLists[size_class_count];
+    size_t m_nextCapacity;
+    size_t m_bytesUsed;
+};
+
 NAMESPACE_XBOX_HTTP_CLIENT_END
 
 template<typename T>
@@ -74,6 +133,60 @@ public:
     }
 };
 
+// Stateful allocator that draws from an http_arena.  A default constructed allocator
+// has no arena and falls back to http_memory like http_stl_allocator.
+template<typename T>
+class http_arena_allocator
+{
+public:
+    typedef T value_type;
+
+    http_arena_allocator() : m_arena(nullptr) {}
+    http_arena_allocator(_In_opt_ xbox::httpclient::http_arena* arena) : m_arena(arena) {}
+    template<class U> http_arena_allocator(http_arena_allocator<U> const& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t n)
+    {
+        void* p = (m_arena != nullptr) ?
+            m_arena->allocate(n * sizeof(T), alignof(T)) :
+            xbox::httpclient::http_memory::mem_alloc(n * sizeof(T));
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(_In_opt_ T* p, size_t n)
+    {
+        if (m_arena != nullptr)
+        {
+            m_arena->deallocate(p, n * sizeof(T));
+        }
+        else
+        {
+            xbox::httpclient::http_memory::mem_free(p);
+        }
+    }
+
+    xbox::httpclient::http_arena* arena() const { return m_arena; }
+
+private:
+    xbox::httpclient::http_arena* m_arena;
+};
+
+template<typename T1, typename T2>
+inline bool operator==(const http_arena_allocator<T1>& lhs, const http_arena_allocator<T2>& rhs)
+{
+    return lhs.arena() == rhs.arena();
+}
+
+template<typename T1, typename T2>
+inline bool operator!=(const http_arena_allocator<T1>& lhs, const http_arena_allocator<T2>& rhs)
+{
+    return lhs.arena() != rhs.arena();
+}
+
 template<typename T>
 struct http_alloc_deleter
 {
@@ -146,3 +259,15 @@ using http_internal_dequeue = std::deque<T, http_stl_allocator<T>>;
 template<class T>
 using http_internal_queue = std::queue<T, http_internal_dequeue<T>>;
 
+template<class T>
+using http_internal_list = std::list<T, http_stl_allocator<T>>;
+
+using http_arena_string = std::basic_string<char, std::char_traits<char>, http_arena_allocator<char>>;
+
+template<class T>
+using http_arena_vector = std::vector<T, http_arena_allocator<T>>;
+
+// The scoped adaptor hands the arena down to the keys and values stored in the map
+template<class K, class V, class LESS = std::less<K>>
+using http_arena_map = std::map<K, V, LESS, std::scoped_allocator_adaptor<http_arena_allocator<std::pair<K const, V>>>>;
+
@@ -0,0 +1,1040 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "../httpcall.h"
+#include "uri.h"
+#include "http1_connection.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Deep enough to hide a round trip behind a burst of small requests, shallow enough that a
+// dropped connection doesn't have many requests to replay
+const size_t HTTP1_MAX_PIPELINE_DEPTH = 8;
+
+const size_t HTTP1_MAX_HEADER_SIZE = 64 * 1024;
+const size_t HTTP1_MAX_CHUNK_LINE_SIZE = 1024;
+const uint32_t HTTP1_READ_POLL_INTERVAL_IN_MILLISECONDS = 1000;
+const uint32_t HTTP1_DEFAULT_TIMEOUT_IN_SECONDS = 30;
+
+static const char HTTP1_LINE_END[] = "\r\n";
+static const char HTTP1_HEADERS_END[] = "\r\n\r\n";
+
+// Returns the offset of pattern in data, or size if it isn't there
+static size_t find_sequence(_In_reads_(size) const char* data, _In_ size_t size, _In_z_ const char* pattern)
+{
+    size_t patternSize = strlen(pattern);
+    for (size_t i = 0; i + patternSize <= size; i++)
+    {
+        if (memcmp(data + i, pattern, patternSize) == 0)
+        {
+            return i;
+        }
+    }
+    return size;
+}
+
+static http_internal_string trim(_In_ const http_internal_string& value)
+{
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == http_internal_string::npos)
+    {
+        return http_internal_string();
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+static http_internal_string to_lower(_In_ const http_internal_string& value)
+{
+    http_internal_string lower;
+    for (char c : value)
+    {
+        lower.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c);
+    }
+    return lower;
+}
+
+static bool has_token(_In_ const http_internal_string& lowerValue, _In_z_ const char* token)
+{
+    size_t start = 0;
+    while (start <= lowerValue.size())
+    {
+        size_t end = lowerValue.find(',', start);
+        if (end == http_internal_string::npos)
+        {
+            end = lowerValue.size();
+        }
+        if (trim(lowerValue.substr(start, end - start)) == token)
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// RFC 7231 4.2.2
+static bool is_idempotent(_In_ http_method_id method, _In_z_ PCSTR methodName)
+{
+    switch (method)
+    {
+        case http_method_id::get:
+        case http_method_id::head:
+        case http_method_id::put:
+        case http_method_id::delete_:
+        case http_method_id::options:
+            return true;
+
+        default:
+            return strcmp(methodName, "TRACE") == 0;
+    }
+}
+
+http1_connection::http1_connection(
+    _In_ http1_client* client,
+    _In_ std::shared_ptr<http_dns_resolver> resolver,
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds,
+    _In_ uint32_t idleTimeoutInSeconds
+    ) :
+    m_client(client),
+    m_connector(std::move(resolver)),
+    m_host(host),
+    m_port(port),
+    m_connectionAttemptDelayInMilliseconds(connectionAttemptDelayInMilliseconds),
+    m_idleTimeoutInSeconds(idleTimeoutInSeconds),
+    m_socket(HTTP_INVALID_SOCKET),
+    m_open(false),
+    m_wasOpen(false),
+    m_accepting(true),
+    m_stopping(false),
+    m_finished(false),
+    m_lastActive(std::chrono::steady_clock::now()),
+    m_bodyState(body_state::headers),
+    m_bodyRemaining(0),
+    m_responseStarted(false),
+    m_keepAlive(true)
+{
+    bool ipv6 = m_host.find(':') != http_internal_string::npos;
+    m_authority = ipv6 ? "[" + m_host + "]" : m_host;
+    if (m_port != 80)
+    {
+        char port[8];
+        snprintf(port, sizeof(port), ":%u", m_port);
+        m_authority += port;
+    }
+}
+
+http1_connection::~http1_connection()
+{
+    close();
+}
+
+void http1_connection::start()
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+bool http1_connection::is_finished()
+{
+    return m_finished;
+}
+
+bool http1_connection::is_accepting()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_accepting;
+}
+
+void http1_connection::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        m_accepting = false;
+        if (m_open)
+        {
+            http_socket_shutdown(m_socket);
+        }
+    }
+
+    m_connector.cancel();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool http1_connection::submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried)
+{
+    uint32_t timeoutInSeconds = 0;
+    HCHttpCallRequestGetTimeout(call, &timeoutInSeconds);
+
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_accepting)
+        {
+            return false;
+        }
+        m_lastActive = std::chrono::steady_clock::now();
+
+        // Keep the call alive until its task is completed, even if the caller closes it first
+        pending_call pending;
+        pending.call = HCHttpCallDuplicateHandle(call);
+        pending.taskHandle = taskHandle;
+        pending.deadline = (timeoutInSeconds == 0) ?
+            (std::chrono::steady_clock::time_point::max)() :
+            std::chrono::steady_clock::now() + std::chrono::seconds(timeoutInSeconds);
+        pending.retried = retried;
+        pending.idempotent = is_idempotent(call->methodId, method);
+        pending.head = call->methodId == http_method_id::head;
+        m_queued.push_back(pending);
+        send_requests();
+    }
+
+    flush();
+    return true;
+}
+
+bool http1_connection::connect(_In_ uint32_t timeoutInSeconds)
+{
+    http_socket socket;
+    if (m_connector.connect(m_host, m_port, m_connectionAttemptDelayInMilliseconds, timeoutInSeconds * 1000, &socket) != HC_OK)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_stopping)
+        {
+            http_socket_close(socket);
+            return false;
+        }
+        m_socket = socket;
+        m_open = true;
+        m_wasOpen = true;
+        send_requests();
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http1_connection: connected to %s", m_authority.c_str());
+    flush();
+    return true;
+}
+
+void http1_connection::run()
+{
+    uint32_t timeoutInSeconds = HTTP1_DEFAULT_TIMEOUT_IN_SECONDS;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_queued.empty())
+        {
+            HCHttpCallRequestGetTimeout(m_queued.front().call, &timeoutInSeconds);
+        }
+    }
+
+    if (connect(timeoutInSeconds != 0 ? timeoutInSeconds : HTTP1_DEFAULT_TIMEOUT_IN_SECONDS))
+    {
+        read_responses();
+    }
+
+    finish();
+    m_finished = true;
+}
+
+void http1_connection::read_responses()
+{
+    uint8_t chunk[16 * 1024];
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_stopping || !check_deadlines() || close_if_idle())
+            {
+                break;
+            }
+        }
+        complete_calls();
+
+        int ready = http_socket_wait_readable(m_socket, HTTP1_READ_POLL_INTERVAL_IN_MILLISECONDS);
+        if (ready == 0)
+        {
+            continue;
+        }
+
+        int received = (ready > 0) ? http_socket_receive(m_socket, chunk, sizeof(chunk)) : -1;
+        if (received <= 0)
+        {
+            // A body without a length ends when the server closes the connection
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (received == 0 && m_bodyState == body_state::until_close && !m_inFlight.empty())
+            {
+                complete_response();
+            }
+            HC_TRACE_INFORMATION(HTTPCLIENT, "http1_connection: connection to %s closed", m_authority.c_str());
+            break;
+        }
+
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_readBuffer.insert(m_readBuffer.end(), chunk, chunk + received);
+            ok = parse_responses();
+        }
+
+        flush();
+        complete_calls();
+        if (!ok)
+        {
+            break;
+        }
+    }
+}
+
+void http1_connection::finish()
+{
+    {
+        // Take the write lock so no other thread is sending when the socket is closed
+        std::lock_guard<std::mutex> writeLock(m_writeLock);
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_open = false;
+        m_accepting = false;
+        m_outgoing.clear();
+        if (m_socket != HTTP_INVALID_SOCKET)
+        {
+            http_socket_close(m_socket);
+            m_socket = HTTP_INVALID_SOCKET;
+        }
+
+        // Servers may close a persistent connection at any time (RFC 7230 6.3.1), so requests
+        // they hadn't started answering are sent again if that's safe
+        for (const auto& pending : m_inFlight)
+        {
+            bool answered = m_responseStarted && &pending == &m_inFlight.front();
+            if (!answered && pending.idempotent && !m_stopping)
+            {
+                retry_call(pending);
+            }
+            else
+            {
+                fail_call(pending, HC_E_FAIL);
+            }
+        }
+        m_inFlight.clear();
+
+        // Calls that were never sent can go to a new connection, unless this one never
+        // connected, in which case the next would most likely fail the same way
+        for (const auto& pending : m_queued)
+        {
+            if (m_wasOpen && !m_stopping)
+            {
+                retry_call(pending);
+            }
+            else
+            {
+                fail_call(pending, HC_E_FAIL);
+            }
+        }
+        m_queued.clear();
+    }
+
+    complete_calls();
+}
+
+bool http1_connection::close_if_idle()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!m_queued.empty() || !m_inFlight.empty())
+    {
+        m_lastActive = now;
+        return false;
+    }
+
+    if (m_idleTimeoutInSeconds == 0 || now - m_lastActive < std::chrono::seconds(m_idleTimeoutInSeconds))
+    {
+        return false;
+    }
+
+    // The pool opens a new connection for the next call
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http1_connection: closing idle connection to %s", m_authority.c_str());
+    m_accepting = false;
+    return true;
+}
+
+bool http1_connection::check_deadlines()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_queued.begin(); it != m_queued.end();)
+    {
+        if (now >= it->deadline)
+        {
+            fail_call(*it, HC_E_FAIL);
+            it = m_queued.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    bool expired = false;
+    for (const auto& pending : m_inFlight)
+    {
+        expired |= now >= pending.deadline;
+    }
+    if (!expired)
+    {
+        return true;
+    }
+
+    // Responses come back in order, so one request can't be abandoned without the connection.
+    // Fail the requests that timed out and leave the rest for finish() to send again.
+    for (auto it = m_inFlight.begin(); it != m_inFlight.end();)
+    {
+        if (now >= it->deadline)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: pipelined request timed out", it->call->id);
+            if (it == m_inFlight.begin())
+            {
+                m_responseStarted = false;
+            }
+            fail_call(*it, HC_E_FAIL);
+            it = m_inFlight.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    m_accepting = false;
+    return false;
+}
+
+void http1_connection::send_requests()
+{
+    while (m_open && m_accepting && !m_queued.empty() && m_inFlight.size() < HTTP1_MAX_PIPELINE_DEPTH)
+    {
+        // Never pipeline after, or behind, a request that isn't safe to replay
+        const pending_call& next = m_queued.front();
+        if (!m_inFlight.empty() && (!next.idempotent || !m_inFlight.back().idempotent))
+        {
+            break;
+        }
+
+        write_request(next);
+        m_inFlight.push_back(next);
+        m_queued.pop_front();
+    }
+}
+
+void http1_connection::write_request(_In_ const pending_call& pending)
+{
+    HC_CALL_HANDLE call = pending.call;
+
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url);
+    http_internal_string path = uri.Resource();
+
+    const BYTE* body = nullptr;
+    uint32_t bodySize = 0;
+    HCHttpCallRequestGetRequestBodyBytes(call, &body, &bodySize);
+
+    http_internal_string request;
+    request.reserve(256 + call->requestHeaders.size() * 64);
+    request += method;
+    request += " ";
+    request += path.empty() ? "/" : path;
+    request += " HTTP/1.1\r\n";
+
+    http_internal_string host = m_authority;
+    http_internal_string headers;
+    bool foundUserAgent = false;
+    bool foundAcceptEncoding = false;
+    for (const auto& header : call->requestHeaders)
+    {
+        switch (header.second.id)
+        {
+            case http_header_id::host:
+                host.assign(header.second.value.data(), header.second.value.size());
+                continue;
+
+            case http_header_id::connection:
+            case http_header_id::content_length:
+                continue;
+
+            case http_header_id::user_agent:
+                foundUserAgent = true;
+                break;
+
+            case http_header_id::accept_encoding:
+                foundAcceptEncoding = true;
+                break;
+
+            case http_header_id::unknown:
+            {
+                // Framing is ours to decide
+                http_internal_string name = to_lower(http_internal_string(header.first.data(), header.first.size()));
+                if (name == "transfer-encoding" || name == "keep-alive" || name == "upgrade" || name == "proxy-connection")
+                {
+                    continue;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        headers.append(header.first.data(), header.first.size());
+        headers += ": ";
+        headers.append(header.second.value.data(), header.second.value.size());
+        headers += HTTP1_LINE_END;
+    }
+
+    request += "Host: " + host + HTTP1_LINE_END;
+    request += headers;
+    if (!foundUserAgent)
+    {
+        request += "User-Agent: libHttpClient/1.0.0.0\r\n";
+    }
+
+    // Advertise only the codings HCHttpCallResponseAppendResponseBodyBytes can decode
+    if (!foundAcceptEncoding && call->responseDecompressionEnabled)
+    {
+        request += "Accept-Encoding: gzip, deflate\r\n";
+    }
+
+    if (bodySize > 0 || call->methodId == http_method_id::post || call->methodId == http_method_id::put || call->methodId == http_method_id::patch)
+    {
+        char contentLength[32];
+        snprintf(contentLength, sizeof(contentLength), "Content-Length: %u\r\n", bodySize);
+        request += contentLength;
+    }
+    request += HTTP1_LINE_END;
+
+    m_outgoing.insert(m_outgoing.end(), request.begin(), request.end());
+    if (bodySize > 0)
+    {
+        m_outgoing.insert(m_outgoing.end(), body, body + bodySize);
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: pipelined to %s, %zu in flight",
+        call->id, m_authority.c_str(), m_inFlight.size() + 1);
+}
+
+bool http1_connection::parse_responses()
+{
+    size_t offset = 0;
+    bool ok = true;
+    bool needMore = false;
+    while (ok && !needMore && m_accepting)
+    {
+        const char* data = reinterpret_cast<const char*>(m_readBuffer.data()) + offset;
+        size_t available = m_readBuffer.size() - offset;
+        if (m_inFlight.empty())
+        {
+            if (available > 0)
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "http1_connection: unexpected data from %s", m_authority.c_str());
+                ok = false;
+            }
+            break;
+        }
+
+        switch (m_bodyState)
+        {
+            case body_state::headers:
+            {
+                size_t end = find_sequence(data, available, HTTP1_HEADERS_END);
+                if (end == available)
+                {
+                    ok = available <= HTTP1_MAX_HEADER_SIZE;
+                    needMore = true;
+                    break;
+                }
+
+                bool informational = false;
+                ok = parse_headers(data, end, &informational);
+                offset += end + strlen(HTTP1_HEADERS_END);
+                break;
+            }
+
+            case body_state::fixed:
+            case body_state::chunk_data:
+            {
+                size_t size = static_cast<size_t>(MIN(static_cast<uint64_t>(available), m_bodyRemaining));
+                if (size == 0)
+                {
+                    needMore = true;
+                    break;
+                }
+
+                ok = append_body(reinterpret_cast<const uint8_t*>(data), size);
+                offset += size;
+                m_bodyRemaining -= size;
+                if (m_bodyRemaining == 0)
+                {
+                    if (m_bodyState == body_state::fixed)
+                    {
+                        complete_response();
+                    }
+                    else
+                    {
+                        m_bodyState = body_state::chunk_end;
+                    }
+                }
+                break;
+            }
+
+            case body_state::chunk_size:
+            {
+                size_t end = find_sequence(data, available, HTTP1_LINE_END);
+                if (end == available)
+                {
+                    ok = available <= HTTP1_MAX_CHUNK_LINE_SIZE;
+                    needMore = true;
+                    break;
+                }
+
+                // Chunk extensions after ';' are ignored
+                uint64_t size = 0;
+                size_t digits = 0;
+                for (; digits < end && isxdigit(static_cast<unsigned char>(data[digits])); digits++)
+                {
+                    char c = data[digits];
+                    uint64_t digit = (c <= '9') ? c - '0' : ((c | 0x20) - 'a' + 10);
+                    size = (size << 4) | digit;
+                }
+                if (digits == 0 || digits > 15 || (digits < end && data[digits] != ';' && data[digits] != ' ' && data[digits] != '\t'))
+                {
+                    ok = false;
+                    break;
+                }
+
+                offset += end + strlen(HTTP1_LINE_END);
+                m_bodyRemaining = size;
+                m_bodyState = (size == 0) ? body_state::trailers : body_state::chunk_data;
+                break;
+            }
+
+            case body_state::chunk_end:
+            {
+                if (available < 2)
+                {
+                    needMore = true;
+                    break;
+                }
+                ok = data[0] == '\r' && data[1] == '\n';
+                offset += 2;
+                m_bodyState = body_state::chunk_size;
+                break;
+            }
+
+            case body_state::trailers:
+            {
+                // Trailers are ignored
+                size_t end = find_sequence(data, available, HTTP1_LINE_END);
+                if (end == available)
+                {
+                    ok = available <= HTTP1_MAX_HEADER_SIZE;
+                    needMore = true;
+                    break;
+                }
+
+                offset += end + strlen(HTTP1_LINE_END);
+                if (end == 0)
+                {
+                    complete_response();
+                }
+                break;
+            }
+
+            case body_state::until_close:
+            {
+                ok = append_body(reinterpret_cast<const uint8_t*>(data), available);
+                offset += available;
+                needMore = true;
+                break;
+            }
+        }
+    }
+
+    if (!ok)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http1_connection: malformed response from %s", m_authority.c_str());
+    }
+
+    m_readBuffer.erase(m_readBuffer.begin(), m_readBuffer.begin() + MIN(offset, m_readBuffer.size()));
+    send_requests();
+    return ok && m_accepting;
+}
+
+bool http1_connection::parse_headers(_In_ const char* data, _In_ size_t size, _Out_ bool* informational)
+{
+    *informational = false;
+
+    size_t lineEnd = find_sequence(data, size, HTTP1_LINE_END);
+    http_internal_string statusLine(data, lineEnd);
+
+    // HTTP/1.x SP 3DIGIT SP reason
+    if (statusLine.size() < 12 || statusLine.compare(0, 7, "HTTP/1.") != 0 || statusLine[8] != ' ' ||
+        !isdigit(static_cast<unsigned char>(statusLine[9])) ||
+        !isdigit(static_cast<unsigned char>(statusLine[10])) ||
+        !isdigit(static_cast<unsigned char>(statusLine[11])))
+    {
+        return false;
+    }
+    bool http10 = statusLine[7] == '0';
+    uint32_t statusCode = static_cast<uint32_t>(atoi(statusLine.c_str() + 9));
+
+    if (statusCode < 200)
+    {
+        // Informational responses come ahead of the final one.  We never ask to switch protocols.
+        *informational = true;
+        return statusCode >= 100 && statusCode != 101;
+    }
+
+    // Repeated fields are combined as RFC 7230 3.2.2 allows, keeping the first spelling
+    http_internal_map<http_internal_string, std::pair<http_internal_string, http_internal_string>> combined;
+    size_t position = (lineEnd == size) ? size : lineEnd + strlen(HTTP1_LINE_END);
+    while (position < size)
+    {
+        size_t end = position + find_sequence(data + position, size - position, HTTP1_LINE_END);
+        http_internal_string line(data + position, end - position);
+        position = (end == size) ? size : end + strlen(HTTP1_LINE_END);
+
+        size_t colon = line.find(':');
+        if (colon == 0 || colon == http_internal_string::npos || line[0] == ' ' || line[0] == '\t')
+        {
+            // Obsolete line folding and other malformed fields (RFC 7230 3.2.4)
+            return false;
+        }
+
+        http_internal_string name = line.substr(0, colon);
+        http_internal_string value = trim(line.substr(colon + 1));
+        auto existing = combined.find(to_lower(name));
+        if (existing == combined.end())
+        {
+            combined.emplace(to_lower(name), std::make_pair(name, value));
+        }
+        else
+        {
+            existing->second.second += ", ";
+            existing->second.second += value;
+        }
+    }
+
+    auto find = [&combined](_In_z_ const char* name) -> const http_internal_string*
+    {
+        auto it = combined.find(name);
+        return (it == combined.end()) ? nullptr : &it->second.second;
+    };
+
+    const http_internal_string* connection = find("connection");
+    http_internal_string connectionTokens = (connection != nullptr) ? to_lower(*connection) : http_internal_string();
+    m_keepAlive = http10 ? has_token(connectionTokens, "keep-alive") : !has_token(connectionTokens, "close");
+
+    // RFC 7230 3.3.3
+    const pending_call& pending = m_inFlight.front();
+    const http_internal_string* transferEncoding = find("transfer-encoding");
+    const http_internal_string* contentLength = find("content-length");
+    bool noBody = pending.head || statusCode == 204 || statusCode == 304;
+    if (noBody)
+    {
+        m_bodyState = body_state::headers;
+    }
+    else if (transferEncoding != nullptr)
+    {
+        http_internal_string codings = to_lower(*transferEncoding);
+        size_t lastComma = codings.rfind(',');
+        bool chunked = trim(lastComma == http_internal_string::npos ? codings : codings.substr(lastComma + 1)) == "chunked";
+        m_bodyState = chunked ? body_state::chunk_size : body_state::until_close;
+    }
+    else if (contentLength != nullptr)
+    {
+        // A repeated Content-Length was combined above, and fails here unless it's a single number
+        if (contentLength->empty() || contentLength->size() > 18 ||
+            contentLength->find_first_not_of("0123456789") != http_internal_string::npos)
+        {
+            return false;
+        }
+        m_bodyRemaining = strtoull(contentLength->c_str(), nullptr, 10);
+        m_bodyState = body_state::fixed;
+    }
+    else
+    {
+        m_bodyState = body_state::until_close;
+    }
+
+    if (m_bodyState == body_state::until_close)
+    {
+        m_keepAlive = false;
+    }
+
+    HCHttpCallResponseSetStatusCode(pending.call, statusCode);
+    for (const auto& header : combined)
+    {
+        HCHttpCallResponseSetHeader(pending.call, header.second.first.c_str(), header.second.second.c_str());
+    }
+    m_responseStarted = true;
+
+    if (noBody || (m_bodyState == body_state::fixed && m_bodyRemaining == 0))
+    {
+        complete_response();
+    }
+    return true;
+}
+
+bool http1_connection::append_body(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    if (size == 0)
+    {
+        return true;
+    }
+    return HCHttpCallResponseAppendResponseBodyBytes(m_inFlight.front().call, data, static_cast<uint32_t>(size)) == HC_OK;
+}
+
+void http1_connection::complete_response()
+{
+    m_completed.push_back(m_inFlight.front());
+    m_inFlight.pop_front();
+    m_bodyState = body_state::headers;
+    m_bodyRemaining = 0;
+    m_responseStarted = false;
+
+    if (!m_keepAlive)
+    {
+        // Anything sent after this request will never be answered
+        m_accepting = false;
+    }
+}
+
+void http1_connection::fail_call(_In_ const pending_call& pending, _In_ HC_RESULT result)
+{
+    HCHttpCallResponseSetNetworkErrorCode(pending.call, result, static_cast<uint32_t>(result));
+    m_completed.push_back(pending);
+}
+
+void http1_connection::retry_call(_In_ const pending_call& pending)
+{
+    if (pending.retried)
+    {
+        fail_call(pending, HC_E_FAIL);
+    }
+    else
+    {
+        m_unprocessed.push_back(pending);
+    }
+}
+
+void http1_connection::flush()
+{
+    std::lock_guard<std::mutex> writeLock(m_writeLock);
+    http_internal_vector<uint8_t> outgoing;
+    http_socket socket;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_open || m_outgoing.empty())
+        {
+            return;
+        }
+        outgoing.swap(m_outgoing);
+        socket = m_socket;
+    }
+
+    if (!http_socket_send_all(socket, outgoing.data(), outgoing.size()))
+    {
+        // Wake the reader so it tears the connection down
+        HC_TRACE_ERROR(HTTPCLIENT, "http1_connection: send to %s failed", m_authority.c_str());
+        http_socket_shutdown(socket);
+    }
+}
+
+void http1_connection::complete_calls()
+{
+    http_internal_vector<pending_call> completed;
+    http_internal_vector<pending_call> unprocessed;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        completed.swap(m_completed);
+        unprocessed.swap(m_unprocessed);
+    }
+
+    for (const auto& pending : completed)
+    {
+        HCTaskSetCompleted(pending.taskHandle);
+        HCHttpCallCloseHandle(pending.call);
+    }
+
+    for (const auto& pending : unprocessed)
+    {
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: retrying on a new connection", pending.call->id);
+        m_client->resubmit(pending.call, pending.taskHandle);
+        HCHttpCallCloseHandle(pending.call);
+    }
+}
+
+http1_client::http1_client(_In_ std::shared_ptr<http_dns_resolver> resolver) :
+    m_resolver(std::move(resolver)),
+    m_connectionAttemptDelayInMilliseconds(0),
+    m_idleTimeoutInSeconds(DEFAULT_CONNECTION_IDLE_TIMEOUT_IN_SECONDS),
+    m_stopping(false)
+{
+}
+
+http1_client::~http1_client()
+{
+    http_internal_vector<std::shared_ptr<http1_connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        for (auto& entry : m_connections)
+        {
+            connections.push_back(entry.second);
+        }
+        m_connections.clear();
+        connections.insert(connections.end(), m_retired.begin(), m_retired.end());
+        m_retired.clear();
+    }
+
+    for (auto& connection : connections)
+    {
+        connection->close();
+    }
+}
+
+void http1_client::perform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds
+    )
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_connectionAttemptDelayInMilliseconds = connectionAttemptDelayInMilliseconds;
+    }
+    submit(call, taskHandle, false);
+}
+
+void http1_client::resubmit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle)
+{
+    submit(call, taskHandle, true);
+}
+
+void http1_client::prewarm(
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds
+    )
+{
+    http_internal_string lowerHost = to_lower(host);
+    char origin[8];
+    snprintf(origin, sizeof(origin), ":%u", port);
+    http_internal_string key = lowerHost + origin;
+
+    http_internal_vector<std::shared_ptr<http1_connection>> finished;
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_stopping)
+    {
+        m_connectionAttemptDelayInMilliseconds = connectionAttemptDelayInMilliseconds;
+        get_connection(key, lowerHost, port, finished);
+    }
+}
+
+void http1_client::set_idle_timeout(_In_ uint32_t idleTimeoutInSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_idleTimeoutInSeconds = idleTimeoutInSeconds;
+}
+
+std::shared_ptr<http1_connection> http1_client::get_connection(
+    _In_ const http_internal_string& key,
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _Inout_ http_internal_vector<std::shared_ptr<http1_connection>>& finished
+    )
+{
+    // Connections that have shut down have no thread left to wait for
+    for (auto it = m_retired.begin(); it != m_retired.end();)
+    {
+        if ((*it)->is_finished())
+        {
+            finished.push_back(*it);
+            it = m_retired.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    auto it = m_connections.find(key);
+    if (it != m_connections.end())
+    {
+        if (it->second->is_accepting())
+        {
+            return it->second;
+        }
+        m_retired.push_back(it->second);
+        m_connections.erase(it);
+    }
+
+    auto connection = http_allocate_shared<http1_connection>(this, m_resolver, host, port, m_connectionAttemptDelayInMilliseconds, m_idleTimeoutInSeconds);
+    connection->start();
+    m_connections.emplace(key, connection);
+    return connection;
+}
+
+void http1_client::submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried)
+{
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url);
+
+    http_internal_string host = to_lower(uri.Host());
+    uint16_t port = uri.IsPortDefault() ? 80 : uri.Port();
+
+    if (uri.IsValid() && !host.empty())
+    {
+        char origin[8];
+        snprintf(origin, sizeof(origin), ":%u", port);
+        http_internal_string key = host + origin;
+
+        // A connection that stops taking calls after it is looked up is replaced next time.  The
+        // pool lock is released before submitting, since writing the request can block on the
+        // socket and would stall every other origin's calls.
+        http_internal_vector<std::shared_ptr<http1_connection>> finished;
+        for (uint32_t attempt = 0; attempt < 2; attempt++)
+        {
+            std::shared_ptr<http1_connection> connection;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_stopping)
+                {
+                    break;
+                }
+                connection = get_connection(key, host, port, finished);
+            }
+
+            if (connection->submit(call, taskHandle, retried))
+            {
+                return;
+            }
+        }
+    }
+
+    HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: can't pipeline the call", call->id);
+    HCHttpCallResponseSetNetworkErrorCode(call, HC_E_FAIL, static_cast<uint32_t>(HC_E_FAIL));
+    HCTaskSetCompleted(taskHandle);
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "../http_socket.h"
+#include "../http_connector.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+class http_dns_resolver;
+class http1_client;
+
+// One persistent HTTP/1.1 connection to an origin that pipelines requests (RFC 7230 6.3.2).
+//
+// Idempotent requests are written back to back, up to the pipeline depth, without waiting for
+// the responses before them, which arrive in the same order.  A request that isn't idempotent
+// is only sent once every earlier response is in, and nothing is sent after it until its own
+// response is, so it is never replayed.  If the server closes the connection, requests it hadn't
+// started answering are sent again on a new connection, once.
+//
+// Like http2_connection, requests are built under m_lock and written by whichever thread calls
+// flush() under m_writeLock, and the connection's own thread reads and parses responses.
+class http1_connection
+{
+public:
+    http1_connection(
+        _In_ http1_client* client,
+        _In_ std::shared_ptr<http_dns_resolver> resolver,
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds,
+        _In_ uint32_t idleTimeoutInSeconds
+        );
+    ~http1_connection();
+
+    void start();
+
+    // Returns false if the connection is closing, in which case the caller should open another
+    // connection for the call.  A retried call isn't retried again.
+    bool submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried);
+
+    // True once the connection thread has exited
+    bool is_finished();
+
+    // False once the connection has stopped taking calls
+    bool is_accepting();
+
+    // Fails every outstanding call and waits for the connection thread to exit
+    void close();
+
+private:
+    struct pending_call
+    {
+        HC_CALL_HANDLE call;
+        HC_TASK_HANDLE taskHandle;
+        std::chrono::steady_clock::time_point deadline;
+        bool retried;
+        bool idempotent;
+        bool head;
+    };
+
+    enum class body_state
+    {
+        headers,
+        fixed,
+        chunk_size,
+        chunk_data,
+        chunk_end,
+        trailers,
+        until_close
+    };
+
+    void run();
+    bool connect(_In_ uint32_t timeoutInSeconds);
+    void read_responses();
+    void finish();
+
+    // Called with m_lock held
+    bool parse_responses();
+    bool parse_headers(_In_ const char* data, _In_ size_t size, _Out_ bool* informational);
+    bool append_body(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+    void complete_response();
+    bool check_deadlines();
+    bool close_if_idle();
+    void send_requests();
+    void write_request(_In_ const pending_call& pending);
+    void fail_call(_In_ const pending_call& pending, _In_ HC_RESULT result);
+    void retry_call(_In_ const pending_call& pending);
+
+    void flush();
+    void complete_calls();
+
+    http1_client* m_client;
+    http_connector m_connector;
+    http_internal_string m_host;
+    http_internal_string m_authority;
+    uint16_t m_port;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    uint32_t m_idleTimeoutInSeconds;
+
+    std::mutex m_lock;
+    std::mutex m_writeLock;
+    std::thread m_thread;
+    http_socket m_socket;
+    bool m_open;
+    bool m_wasOpen;
+    bool m_accepting;
+    bool m_stopping;
+    std::atomic<bool> m_finished;
+    std::chrono::steady_clock::time_point m_lastActive;  // when a call was last outstanding
+
+    http_internal_dequeue<pending_call> m_queued;     // not yet sent
+    http_internal_dequeue<pending_call> m_inFlight;   // sent, oldest first
+    http_internal_vector<pending_call> m_completed;   // to complete once m_lock is released
+    http_internal_vector<pending_call> m_unprocessed; // to retry on a new connection
+    http_internal_vector<uint8_t> m_outgoing;
+
+    // Parsing the response to m_inFlight.front()
+    http_internal_vector<uint8_t> m_readBuffer;
+    body_state m_bodyState;
+    uint64_t m_bodyRemaining;
+    bool m_responseStarted;
+    bool m_keepAlive;
+};
+
+// Pool of pipelined HTTP/1.1 connections, one per origin
+class http1_client
+{
+public:
+    http1_client(_In_ std::shared_ptr<http_dns_resolver> resolver);
+    ~http1_client();
+
+    void perform(
+        _In_ HC_CALL_HANDLE call,
+        _In_ HC_TASK_HANDLE taskHandle,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds
+        );
+
+    // Opens the origin's connection ahead of the first call, if it isn't open already
+    void prewarm(
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds
+        );
+
+    void set_idle_timeout(_In_ uint32_t idleTimeoutInSeconds);
+
+    // Called by a connection for calls the server closed the connection on without answering
+    void resubmit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle);
+
+private:
+    void submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried);
+
+    // Called with m_lock held.  Returns the origin's connection, opening a new one if there is
+    // none or it has stopped taking calls.
+    std::shared_ptr<http1_connection> get_connection(
+        _In_ const http_internal_string& key,
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _Inout_ http_internal_vector<std::shared_ptr<http1_connection>>& finished
+        );
+
+    std::shared_ptr<http_dns_resolver> m_resolver;
+    std::mutex m_lock;
+    http_internal_map<http_internal_string, std::shared_ptr<http1_connection>> m_connections;
+    http_internal_vector<std::shared_ptr<http1_connection>> m_retired;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    uint32_t m_idleTimeoutInSeconds;
+    bool m_stopping;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,623 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "hpack.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+struct hpack_static_entry
+{
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 Appendix A
+static const hpack_static_entry HPACK_STATIC_TABLE[] =
+{
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+const uint32_t HPACK_STATIC_TABLE_SIZE = sizeof(HPACK_STATIC_TABLE) / sizeof(HPACK_STATIC_TABLE[0]);
+
+struct hpack_huffman_code
+{
+    uint32_t code;
+    uint8_t length;
+};
+
+// RFC 7541 Appendix B.  Symbol 256 is EOS.
+static const hpack_huffman_code HPACK_HUFFMAN_CODES[] =
+{
+    { 0x00001ff8, 13 }, { 0x007fffd8, 23 }, { 0x0fffffe2, 28 }, { 0x0fffffe3, 28 },
+    { 0x0fffffe4, 28 }, { 0x0fffffe5, 28 }, { 0x0fffffe6, 28 }, { 0x0fffffe7, 28 },
+    { 0x0fffffe8, 28 }, { 0x00ffffea, 24 }, { 0x3ffffffc, 30 }, { 0x0fffffe9, 28 },
+    { 0x0fffffea, 28 }, { 0x3ffffffd, 30 }, { 0x0fffffeb, 28 }, { 0x0fffffec, 28 },
+    { 0x0fffffed, 28 }, { 0x0fffffee, 28 }, { 0x0fffffef, 28 }, { 0x0ffffff0, 28 },
+    { 0x0ffffff1, 28 }, { 0x0ffffff2, 28 }, { 0x3ffffffe, 30 }, { 0x0ffffff3, 28 },
+    { 0x0ffffff4, 28 }, { 0x0ffffff5, 28 }, { 0x0ffffff6, 28 }, { 0x0ffffff7, 28 },
+    { 0x0ffffff8, 28 }, { 0x0ffffff9, 28 }, { 0x0ffffffa, 28 }, { 0x0ffffffb, 28 },
+    { 0x00000014,  6 }, { 0x000003f8, 10 }, { 0x000003f9, 10 }, { 0x00000ffa, 12 },
+    { 0x00001ff9, 13 }, { 0x00000015,  6 }, { 0x000000f8,  8 }, { 0x000007fa, 11 },
+    { 0x000003fa, 10 }, { 0x000003fb, 10 }, { 0x000000f9,  8 }, { 0x000007fb, 11 },
+    { 0x000000fa,  8 }, { 0x00000016,  6 }, { 0x00000017,  6 }, { 0x00000018,  6 },
+    { 0x00000000,  5 }, { 0x00000001,  5 }, { 0x00000002,  5 }, { 0x00000019,  6 },
+    { 0x0000001a,  6 }, { 0x0000001b,  6 }, { 0x0000001c,  6 }, { 0x0000001d,  6 },
+    { 0x0000001e,  6 }, { 0x0000001f,  6 }, { 0x0000005c,  7 }, { 0x000000fb,  8 },
+    { 0x00007ffc, 15 }, { 0x00000020,  6 }, { 0x00000ffb, 12 }, { 0x000003fc, 10 },
+    { 0x00001ffa, 13 }, { 0x00000021,  6 }, { 0x0000005d,  7 }, { 0x0000005e,  7 },
+    { 0x0000005f,  7 }, { 0x00000060,  7 }, { 0x00000061,  7 }, { 0x00000062,  7 },
+    { 0x00000063,  7 }, { 0x00000064,  7 }, { 0x00000065,  7 }, { 0x00000066,  7 },
+    { 0x00000067,  7 }, { 0x00000068,  7 }, { 0x00000069,  7 }, { 0x0000006a,  7 },
+    { 0x0000006b,  7 }, { 0x0000006c,  7 }, { 0x0000006d,  7 }, { 0x0000006e,  7 },
+    { 0x0000006f,  7 }, { 0x00000070,  7 }, { 0x00000071,  7 }, { 0x00000072,  7 },
+    { 0x000000fc,  8 }, { 0x00000073,  7 }, { 0x000000fd,  8 }, { 0x00001ffb, 13 },
+    { 0x0007fff0, 19 }, { 0x00001ffc, 13 }, { 0x00003ffc, 14 }, { 0x00000022,  6 },
+    { 0x00007ffd, 15 }, { 0x00000003,  5 }, { 0x00000023,  6 }, { 0x00000004,  5 },
+    { 0x00000024,  6 }, { 0x00000005,  5 }, { 0x00000025,  6 }, { 0x00000026,  6 },
+    { 0x00000027,  6 }, { 0x00000006,  5 }, { 0x00000074,  7 }, { 0x00000075,  7 },
+    { 0x00000028,  6 }, { 0x00000029,  6 }, { 0x0000002a,  6 }, { 0x00000007,  5 },
+    { 0x0000002b,  6 }, { 0x00000076,  7 }, { 0x0000002c,  6 }, { 0x00000008,  5 },
+    { 0x00000009,  5 }, { 0x0000002d,  6 }, { 0x00000077,  7 }, { 0x00000078,  7 },
+    { 0x00000079,  7 }, { 0x0000007a,  7 }, { 0x0000007b,  7 }, { 0x00007ffe, 15 },
+    { 0x000007fc, 11 }, { 0x00003ffd, 14 }, { 0x00001ffd, 13 }, { 0x0ffffffc, 28 },
+    { 0x000fffe6, 20 }, { 0x003fffd2, 22 }, { 0x000fffe7, 20 }, { 0x000fffe8, 20 },
+    { 0x003fffd3, 22 }, { 0x003fffd4, 22 }, { 0x003fffd5, 22 }, { 0x007fffd9, 23 },
+    { 0x003fffd6, 22 }, { 0x007fffda, 23 }, { 0x007fffdb, 23 }, { 0x007fffdc, 23 },
+    { 0x007fffdd, 23 }, { 0x007fffde, 23 }, { 0x00ffffeb, 24 }, { 0x007fffdf, 23 },
+    { 0x00ffffec, 24 }, { 0x00ffffed, 24 }, { 0x003fffd7, 22 }, { 0x007fffe0, 23 },
+    { 0x00ffffee, 24 }, { 0x007fffe1, 23 }, { 0x007fffe2, 23 }, { 0x007fffe3, 23 },
+    { 0x007fffe4, 23 }, { 0x001fffdc, 21 }, { 0x003fffd8, 22 }, { 0x007fffe5, 23 },
+    { 0x003fffd9, 22 }, { 0x007fffe6, 23 }, { 0x007fffe7, 23 }, { 0x00ffffef, 24 },
+    { 0x003fffda, 22 }, { 0x001fffdd, 21 }, { 0x000fffe9, 20 }, { 0x003fffdb, 22 },
+    { 0x003fffdc, 22 }, { 0x007fffe8, 23 }, { 0x007fffe9, 23 }, { 0x001fffde, 21 },
+    { 0x007fffea, 23 }, { 0x003fffdd, 22 }, { 0x003fffde, 22 }, { 0x00fffff0, 24 },
+    { 0x001fffdf, 21 }, { 0x003fffdf, 22 }, { 0x007fffeb, 23 }, { 0x007fffec, 23 },
+    { 0x001fffe0, 21 }, { 0x001fffe1, 21 }, { 0x003fffe0, 22 }, { 0x001fffe2, 21 },
+    { 0x007fffed, 23 }, { 0x003fffe1, 22 }, { 0x007fffee, 23 }, { 0x007fffef, 23 },
+    { 0x000fffea, 20 }, { 0x003fffe2, 22 }, { 0x003fffe3, 22 }, { 0x003fffe4, 22 },
+    { 0x007ffff0, 23 }, { 0x003fffe5, 22 }, { 0x003fffe6, 22 }, { 0x007ffff1, 23 },
+    { 0x03ffffe0, 26 }, { 0x03ffffe1, 26 }, { 0x000fffeb, 20 }, { 0x0007fff1, 19 },
+    { 0x003fffe7, 22 }, { 0x007ffff2, 23 }, { 0x003fffe8, 22 }, { 0x01ffffec, 25 },
+    { 0x03ffffe2, 26 }, { 0x03ffffe3, 26 }, { 0x03ffffe4, 26 }, { 0x07ffffde, 27 },
+    { 0x07ffffdf, 27 }, { 0x03ffffe5, 26 }, { 0x00fffff1, 24 }, { 0x01ffffed, 25 },
+    { 0x0007fff2, 19 }, { 0x001fffe3, 21 }, { 0x03ffffe6, 26 }, { 0x07ffffe0, 27 },
+    { 0x07ffffe1, 27 }, { 0x03ffffe7, 26 }, { 0x07ffffe2, 27 }, { 0x00fffff2, 24 },
+    { 0x001fffe4, 21 }, { 0x001fffe5, 21 }, { 0x03ffffe8, 26 }, { 0x03ffffe9, 26 },
+    { 0x0ffffffd, 28 }, { 0x07ffffe3, 27 }, { 0x07ffffe4, 27 }, { 0x07ffffe5, 27 },
+    { 0x000fffec, 20 }, { 0x00fffff3, 24 }, { 0x000fffed, 20 }, { 0x001fffe6, 21 },
+    { 0x003fffe9, 22 }, { 0x001fffe7, 21 }, { 0x001fffe8, 21 }, { 0x007ffff3, 23 },
+    { 0x003fffea, 22 }, { 0x003fffeb, 22 }, { 0x01ffffee, 25 }, { 0x01ffffef, 25 },
+    { 0x00fffff4, 24 }, { 0x00fffff5, 24 }, { 0x03ffffea, 26 }, { 0x007ffff4, 23 },
+    { 0x03ffffeb, 26 }, { 0x07ffffe6, 27 }, { 0x03ffffec, 26 }, { 0x03ffffed, 26 },
+    { 0x07ffffe7, 27 }, { 0x07ffffe8, 27 }, { 0x07ffffe9, 27 }, { 0x07ffffea, 27 },
+    { 0x07ffffeb, 27 }, { 0x0ffffffe, 28 }, { 0x07ffffec, 27 }, { 0x07ffffed, 27 },
+    { 0x07ffffee, 27 }, { 0x07ffffef, 27 }, { 0x07fffff0, 27 }, { 0x03ffffee, 26 },
+    { 0x3fffffff, 30 },
+};
+const uint32_t HPACK_HUFFMAN_EOS = 256;
+const uint8_t HPACK_HUFFMAN_MAX_LENGTH = 30;
+
+// Each header block is decoded in full before it is handed on, so cap what a peer can make us hold
+const size_t HPACK_MAX_DECODED_BLOCK_SIZE = 256 * 1024;
+
+// The code is canonical: codes of the same length are consecutive and ordered by symbol.  So a
+// code of a given length can be decoded from the first code of that length and the symbols
+// sorted by length, without building a tree.
+class hpack_huffman_decoder
+{
+public:
+    hpack_huffman_decoder()
+    {
+        uint32_t symbolCount = 0;
+        for (uint8_t length = 1; length <= HPACK_HUFFMAN_MAX_LENGTH; length++)
+        {
+            m_firstIndex[length] = symbolCount;
+            m_count[length] = 0;
+            for (uint32_t symbol = 0; symbol <= HPACK_HUFFMAN_EOS; symbol++)
+            {
+                if (HPACK_HUFFMAN_CODES[symbol].length == length)
+                {
+                    if (m_count[length] == 0)
+                    {
+                        m_firstCode[length] = HPACK_HUFFMAN_CODES[symbol].code;
+                    }
+                    m_symbols[symbolCount++] = static_cast<uint16_t>(symbol);
+                    m_count[length]++;
+                }
+            }
+        }
+    }
+
+    bool decode(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size, _Inout_ http_internal_string& value) const
+    {
+        uint32_t code = 0;
+        uint8_t length = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            for (int bit = 7; bit >= 0; bit--)
+            {
+                code = (code << 1) | ((data[i] >> bit) & 1);
+                length++;
+                if (m_count[length] != 0 && code - m_firstCode[length] < m_count[length])
+                {
+                    uint16_t symbol = m_symbols[m_firstIndex[length] + code - m_firstCode[length]];
+                    if (symbol == HPACK_HUFFMAN_EOS)
+                    {
+                        return false;
+                    }
+                    value.push_back(static_cast<char>(symbol));
+                    code = 0;
+                    length = 0;
+                }
+                else if (length == HPACK_HUFFMAN_MAX_LENGTH)
+                {
+                    return false;
+                }
+            }
+        }
+
+        // The last byte is padded with the most significant bits of EOS, which are all ones
+        return length < 8 && code == (1u << length) - 1;
+    }
+
+private:
+    uint32_t m_firstCode[HPACK_HUFFMAN_MAX_LENGTH + 1];
+    uint32_t m_firstIndex[HPACK_HUFFMAN_MAX_LENGTH + 1];
+    uint32_t m_count[HPACK_HUFFMAN_MAX_LENGTH + 1];
+    uint16_t m_symbols[HPACK_HUFFMAN_EOS + 1];
+};
+
+static size_t huffman_encoded_size(_In_ const http_internal_string& value)
+{
+    size_t bits = 0;
+    for (char c : value)
+    {
+        bits += HPACK_HUFFMAN_CODES[static_cast<uint8_t>(c)].length;
+    }
+    return (bits + 7) / 8;
+}
+
+void hpack_encode_integer(
+    _In_ uint32_t value,
+    _In_ uint8_t prefixBits,
+    _In_ uint8_t flags,
+    _Inout_ http_internal_vector<uint8_t>& out
+    )
+{
+    uint32_t prefixMax = (1u << prefixBits) - 1;
+    if (value < prefixMax)
+    {
+        out.push_back(static_cast<uint8_t>(flags | value));
+        return;
+    }
+
+    out.push_back(static_cast<uint8_t>(flags | prefixMax));
+    value -= prefixMax;
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool hpack_decode_integer(
+    _Inout_ const uint8_t** position,
+    _In_ const uint8_t* end,
+    _In_ uint8_t prefixBits,
+    _Out_ uint32_t* value
+    )
+{
+    *value = 0;
+    const uint8_t* p = *position;
+    if (p == end)
+    {
+        return false;
+    }
+
+    uint32_t prefixMax = (1u << prefixBits) - 1;
+    uint64_t result = *p++ & prefixMax;
+    if (result == prefixMax)
+    {
+        uint32_t shift = 0;
+        while (true)
+        {
+            // Nothing we decode needs more than 32 bits
+            if (p == end || shift > 28)
+            {
+                return false;
+            }
+            uint8_t b = *p++;
+            result += static_cast<uint64_t>(b & 0x7f) << shift;
+            shift += 7;
+            if ((b & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        if (result > UINT32_MAX)
+        {
+            return false;
+        }
+    }
+
+    *position = p;
+    *value = static_cast<uint32_t>(result);
+    return true;
+}
+
+void hpack_encode_string(_In_ const http_internal_string& value, _Inout_ http_internal_vector<uint8_t>& out)
+{
+    size_t huffmanSize = huffman_encoded_size(value);
+    if (huffmanSize >= value.size())
+    {
+        hpack_encode_integer(static_cast<uint32_t>(value.size()), 7, 0x00, out);
+        out.insert(out.end(), value.begin(), value.end());
+        return;
+    }
+
+    hpack_encode_integer(static_cast<uint32_t>(huffmanSize), 7, 0x80, out);
+    uint64_t bits = 0;
+    uint32_t bitCount = 0;
+    for (char c : value)
+    {
+        const hpack_huffman_code& code = HPACK_HUFFMAN_CODES[static_cast<uint8_t>(c)];
+        bits = (bits << code.length) | code.code;
+        bitCount += code.length;
+        while (bitCount >= 8)
+        {
+            bitCount -= 8;
+            out.push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    if (bitCount > 0)
+    {
+        // Pad with the start of EOS
+        out.push_back(static_cast<uint8_t>((bits << (8 - bitCount)) | (0xff >> bitCount)));
+    }
+}
+
+bool hpack_decode_string(
+    _Inout_ const uint8_t** position,
+    _In_ const uint8_t* end,
+    _Inout_ http_internal_string& value
+    )
+{
+    static const hpack_huffman_decoder huffmanDecoder;
+
+    value.clear();
+    if (*position == end)
+    {
+        return false;
+    }
+    bool huffman = (**position & 0x80) != 0;
+    uint32_t length = 0;
+    if (!hpack_decode_integer(position, end, 7, &length) ||
+        length > static_cast<size_t>(end - *position) ||
+        length > HPACK_MAX_DECODED_BLOCK_SIZE)
+    {
+        return false;
+    }
+
+    const uint8_t* data = *position;
+    *position += length;
+    if (huffman)
+    {
+        return huffmanDecoder.decode(data, length, value);
+    }
+    value.assign(reinterpret_cast<const char*>(data), length);
+    return true;
+}
+
+hpack_dynamic_table::hpack_dynamic_table() :
+    m_size(0),
+    m_maxSize(HPACK_DEFAULT_TABLE_SIZE)
+{
+}
+
+uint32_t hpack_dynamic_table::entry_size(_In_ const http_internal_string& name, _In_ const http_internal_string& value)
+{
+    // RFC 7541 4.1: 32 bytes of overhead per entry
+    return static_cast<uint32_t>(name.size() + value.size() + 32);
+}
+
+const hpack_header* hpack_dynamic_table::get(_In_ size_t index) const
+{
+    return index < m_entries.size() ? &m_entries[index] : nullptr;
+}
+
+void hpack_dynamic_table::evict(_In_ uint32_t maxSize)
+{
+    while (m_size > maxSize && !m_entries.empty())
+    {
+        m_size -= entry_size(m_entries.back().name, m_entries.back().value);
+        m_entries.pop_back();
+    }
+}
+
+void hpack_dynamic_table::add(_In_ const http_internal_string& name, _In_ const http_internal_string& value)
+{
+    uint32_t size = entry_size(name, value);
+    if (size > m_maxSize)
+    {
+        // An entry larger than the table empties it and isn't added
+        evict(0);
+        return;
+    }
+
+    evict(m_maxSize - size);
+    hpack_header entry;
+    entry.name = name;
+    entry.value = value;
+    m_entries.push_front(std::move(entry));
+    m_size += size;
+}
+
+void hpack_dynamic_table::set_max_size(_In_ uint32_t maxSize)
+{
+    m_maxSize = maxSize;
+    evict(maxSize);
+}
+
+void hpack_encoder::set_max_table_size(_In_ uint32_t maxSize)
+{
+    maxSize = MIN(maxSize, HPACK_DEFAULT_TABLE_SIZE);
+    if (maxSize != m_table.max_size() || !m_pendingSizeUpdates.empty())
+    {
+        m_pendingSizeUpdates.push_back(maxSize);
+    }
+}
+
+bool hpack_encoder::is_sensitive(_In_ const hpack_header& header)
+{
+    // RFC 7541 7.1.3: credentials, and cookies short enough to be guessed
+    return header.name == "authorization" ||
+        header.name == "proxy-authorization" ||
+        (header.name == "cookie" && header.value.size() < 20);
+}
+
+void hpack_encoder::encode(
+    _In_ const http_internal_vector<hpack_header>& headers,
+    _Inout_ http_internal_vector<uint8_t>& out
+    )
+{
+    // Size changes are signalled at the start of the next block.  If the size went down and back
+    // up, the decoder must see the smallest size so it evicts the same entries we did.
+    if (!m_pendingSizeUpdates.empty())
+    {
+        uint32_t smallest = m_pendingSizeUpdates[0];
+        for (uint32_t size : m_pendingSizeUpdates)
+        {
+            smallest = MIN(smallest, size);
+        }
+        uint32_t finalSize = m_pendingSizeUpdates.back();
+        if (smallest != finalSize)
+        {
+            m_table.set_max_size(smallest);
+            hpack_encode_integer(smallest, 5, 0x20, out);
+        }
+        m_table.set_max_size(finalSize);
+        hpack_encode_integer(finalSize, 5, 0x20, out);
+        m_pendingSizeUpdates.clear();
+    }
+
+    for (const auto& header : headers)
+    {
+        uint32_t nameIndex = 0;
+        uint32_t fullIndex = 0;
+        for (uint32_t i = 0; i < HPACK_STATIC_TABLE_SIZE && fullIndex == 0; i++)
+        {
+            if (header.name == HPACK_STATIC_TABLE[i].name)
+            {
+                if (nameIndex == 0)
+                {
+                    nameIndex = i + 1;
+                }
+                if (header.value == HPACK_STATIC_TABLE[i].value)
+                {
+                    fullIndex = i + 1;
+                }
+            }
+        }
+        for (size_t i = 0; i < m_table.count() && fullIndex == 0; i++)
+        {
+            const hpack_header* entry = m_table.get(i);
+            if (header.name == entry->name)
+            {
+                if (nameIndex == 0)
+                {
+                    nameIndex = static_cast<uint32_t>(HPACK_STATIC_TABLE_SIZE + 1 + i);
+                }
+                if (header.value == entry->value)
+                {
+                    fullIndex = static_cast<uint32_t>(HPACK_STATIC_TABLE_SIZE + 1 + i);
+                }
+            }
+        }
+
+        bool sensitive = is_sensitive(header);
+        if (fullIndex != 0 && !sensitive)
+        {
+            hpack_encode_integer(fullIndex, 7, 0x80, out);
+            continue;
+        }
+
+        if (sensitive)
+        {
+            // Literal never indexed
+            hpack_encode_integer(nameIndex, 4, 0x10, out);
+        }
+        else
+        {
+            // Literal with incremental indexing
+            hpack_encode_integer(nameIndex, 6, 0x40, out);
+        }
+        if (nameIndex == 0)
+        {
+            hpack_encode_string(header.name, out);
+        }
+        hpack_encode_string(header.value, out);
+
+        if (!sensitive)
+        {
+            m_table.add(header.name, header.value);
+        }
+    }
+}
+
+bool hpack_decoder::decode(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Inout_ http_internal_vector<hpack_header>& headers
+    )
+{
+    const uint8_t* position = data;
+    const uint8_t* end = data + size;
+    size_t decodedSize = 0;
+    bool headerSeen = false;
+
+    while (position < end)
+    {
+        uint8_t first = *position;
+        hpack_header header;
+
+        if ((first & 0xe0) == 0x20)
+        {
+            // Dynamic table size update, only allowed before the first header
+            uint32_t maxSize = 0;
+            if (headerSeen || !hpack_decode_integer(&position, end, 5, &maxSize) || maxSize > HPACK_DEFAULT_TABLE_SIZE)
+            {
+                return false;
+            }
+            m_table.set_max_size(maxSize);
+            continue;
+        }
+        headerSeen = true;
+
+        uint32_t index = 0;
+        bool addToTable = false;
+        if ((first & 0x80) != 0)
+        {
+            // Indexed header field
+            if (!hpack_decode_integer(&position, end, 7, &index) || index == 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Literal with incremental indexing, without indexing, or never indexed
+            addToTable = (first & 0x40) != 0;
+            if (!hpack_decode_integer(&position, end, addToTable ? 6 : 4, &index))
+            {
+                return false;
+            }
+        }
+
+        if (index != 0)
+        {
+            if (index <= HPACK_STATIC_TABLE_SIZE)
+            {
+                header.name = HPACK_STATIC_TABLE[index - 1].name;
+                header.value = HPACK_STATIC_TABLE[index - 1].value;
+            }
+            else
+            {
+                const hpack_header* entry = m_table.get(index - HPACK_STATIC_TABLE_SIZE - 1);
+                if (entry == nullptr)
+                {
+                    return false;
+                }
+                header.name = entry->name;
+                header.value = entry->value;
+            }
+        }
+        else if (!hpack_decode_string(&position, end, header.name))
+        {
+            return false;
+        }
+
+        if ((first & 0x80) == 0)
+        {
+            if (!hpack_decode_string(&position, end, header.value))
+            {
+                return false;
+            }
+            if (addToTable)
+            {
+                m_table.add(header.name, header.value);
+            }
+        }
+
+        decodedSize += header.name.size() + header.value.size() + 32;
+        if (decodedSize > HPACK_MAX_DECODED_BLOCK_SIZE)
+        {
+            return false;
+        }
+        headers.push_back(std::move(header));
+    }
+
+    return true;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
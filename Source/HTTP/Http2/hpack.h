@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// HPACK header compression for HTTP/2 (RFC 7541).
+//
+// Both sides keep a dynamic table of recently sent headers, so a header repeated on later
+// requests to the same connection, such as a user agent or authorization token, is sent as a
+// one or two byte index.  The encoder and decoder each track one direction of a connection and
+// must see header blocks in the order they go over the wire.
+
+const uint32_t HPACK_DEFAULT_TABLE_SIZE = 4096;
+
+struct hpack_header
+{
+    http_internal_string name;
+    http_internal_string value;
+};
+
+class hpack_dynamic_table
+{
+public:
+    hpack_dynamic_table();
+
+    const hpack_header* get(_In_ size_t index) const;  // 0 is the newest entry
+    size_t count() const { return m_entries.size(); }
+    void add(_In_ const http_internal_string& name, _In_ const http_internal_string& value);
+    void set_max_size(_In_ uint32_t maxSize);
+    uint32_t max_size() const { return m_maxSize; }
+
+    static uint32_t entry_size(_In_ const http_internal_string& name, _In_ const http_internal_string& value);
+
+private:
+    void evict(_In_ uint32_t maxSize);
+
+    http_internal_dequeue<hpack_header> m_entries;  // newest first
+    uint32_t m_size;
+    uint32_t m_maxSize;
+};
+
+class hpack_encoder
+{
+public:
+    // Called with the peer's SETTINGS_HEADER_TABLE_SIZE.  The table never grows past 4096 bytes.
+    void set_max_table_size(_In_ uint32_t maxSize);
+
+    // Encodes a header block.  Names must be lower case.  Sensitive headers are never added to
+    // either side's dynamic table so they can't be recovered by compression attacks.
+    void encode(
+        _In_ const http_internal_vector<hpack_header>& headers,
+        _Inout_ http_internal_vector<uint8_t>& out
+        );
+
+private:
+    static bool is_sensitive(_In_ const hpack_header& header);
+
+    hpack_dynamic_table m_table;
+    http_internal_vector<uint32_t> m_pendingSizeUpdates;
+};
+
+class hpack_decoder
+{
+public:
+    // Decodes a complete header block.  Returns false if it is malformed, which is a connection error.
+    bool decode(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _Inout_ http_internal_vector<hpack_header>& headers
+        );
+
+private:
+    hpack_dynamic_table m_table;
+};
+
+void hpack_encode_integer(
+    _In_ uint32_t value,
+    _In_ uint8_t prefixBits,
+    _In_ uint8_t flags,
+    _Inout_ http_internal_vector<uint8_t>& out
+    );
+
+bool hpack_decode_integer(
+    _Inout_ const uint8_t** position,
+    _In_ const uint8_t* end,
+    _In_ uint8_t prefixBits,
+    _Out_ uint32_t* value
+    );
+
+void hpack_encode_string(_In_ const http_internal_string& value, _Inout_ http_internal_vector<uint8_t>& out);
+
+bool hpack_decode_string(
+    _Inout_ const uint8_t** position,
+    _In_ const uint8_t* end,
+    _Inout_ http_internal_string& value
+    );
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,1309 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "../httpcall.h"
+#include "uri.h"
+#include "http2_connection.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// RFC 7540 6: frame types
+const uint8_t HTTP2_FRAME_DATA = 0x0;
+const uint8_t HTTP2_FRAME_HEADERS = 0x1;
+const uint8_t HTTP2_FRAME_PRIORITY = 0x2;
+const uint8_t HTTP2_FRAME_RST_STREAM = 0x3;
+const uint8_t HTTP2_FRAME_SETTINGS = 0x4;
+const uint8_t HTTP2_FRAME_PUSH_PROMISE = 0x5;
+const uint8_t HTTP2_FRAME_PING = 0x6;
+const uint8_t HTTP2_FRAME_GOAWAY = 0x7;
+const uint8_t HTTP2_FRAME_WINDOW_UPDATE = 0x8;
+const uint8_t HTTP2_FRAME_CONTINUATION = 0x9;
+
+const uint8_t HTTP2_FLAG_END_STREAM = 0x1;
+const uint8_t HTTP2_FLAG_ACK = 0x1;
+const uint8_t HTTP2_FLAG_END_HEADERS = 0x4;
+const uint8_t HTTP2_FLAG_PADDED = 0x8;
+const uint8_t HTTP2_FLAG_PRIORITY = 0x20;
+
+const uint16_t HTTP2_SETTINGS_HEADER_TABLE_SIZE = 0x1;
+const uint16_t HTTP2_SETTINGS_ENABLE_PUSH = 0x2;
+const uint16_t HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+const uint16_t HTTP2_SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+const uint16_t HTTP2_SETTINGS_MAX_FRAME_SIZE = 0x5;
+
+// RFC 7540 7: error codes
+const uint32_t HTTP2_NO_ERROR = 0x0;
+const uint32_t HTTP2_PROTOCOL_ERROR = 0x1;
+const uint32_t HTTP2_FLOW_CONTROL_ERROR = 0x3;
+const uint32_t HTTP2_FRAME_SIZE_ERROR = 0x6;
+const uint32_t HTTP2_REFUSED_STREAM = 0x7;
+const uint32_t HTTP2_CANCEL = 0x8;
+const uint32_t HTTP2_COMPRESSION_ERROR = 0x9;
+
+const uint32_t HTTP2_FRAME_HEADER_SIZE = 9;
+const uint32_t HTTP2_DEFAULT_MAX_FRAME_SIZE = 16384;
+const uint32_t HTTP2_MAX_ALLOWED_FRAME_SIZE = 16777215;
+const int64_t HTTP2_DEFAULT_WINDOW_SIZE = 65535;
+const int64_t HTTP2_MAX_WINDOW_SIZE = 0x7fffffff;
+const uint32_t HTTP2_MAX_STREAM_ID = 0x7fffffff;
+
+// Until the server's SETTINGS arrive, RFC 7540 6.5.2 suggests assuming at least 100 streams
+const uint32_t HTTP2_DEFAULT_MAX_CONCURRENT_STREAMS = 100;
+
+// Large receive windows so a fast server isn't held up waiting for WINDOW_UPDATE
+const uint32_t HTTP2_STREAM_WINDOW_SIZE = 1024 * 1024;
+const uint32_t HTTP2_CONNECTION_WINDOW_SIZE = 16 * 1024 * 1024;
+
+const size_t HTTP2_MAX_HEADER_BLOCK_SIZE = 256 * 1024;
+const uint32_t HTTP2_READ_POLL_INTERVAL_IN_MILLISECONDS = 1000;
+const uint32_t HTTP2_DEFAULT_TIMEOUT_IN_SECONDS = 30;
+
+static const char HTTP2_CONNECTION_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+static uint32_t read_uint32(_In_reads_bytes_(4) const uint8_t* data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) |
+        (static_cast<uint32_t>(data[1]) << 16) |
+        (static_cast<uint32_t>(data[2]) << 8) |
+        static_cast<uint32_t>(data[3]);
+}
+
+static void append_uint32(_In_ uint32_t value, _Inout_ http_internal_vector<uint8_t>& out)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void append_setting(_In_ uint16_t id, _In_ uint32_t value, _Inout_ http_internal_vector<uint8_t>& out)
+{
+    out.push_back(static_cast<uint8_t>(id >> 8));
+    out.push_back(static_cast<uint8_t>(id));
+    append_uint32(value, out);
+}
+
+static void append_lower(_In_reads_(size) const char* value, _In_ size_t size, _Inout_ http_internal_string& out)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        char c = value[i];
+        out.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c);
+    }
+}
+
+// RFC 7540 8.1.2.2: connection-specific headers aren't allowed in HTTP/2
+static bool is_connection_header(_In_ const http_internal_string& name)
+{
+    return name == "connection" ||
+        name == "host" ||
+        name == "keep-alive" ||
+        name == "proxy-connection" ||
+        name == "transfer-encoding" ||
+        name == "upgrade";
+}
+
+http2_connection::http2_connection(
+    _In_ http2_client* client,
+    _In_ std::shared_ptr<http_dns_resolver> resolver,
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds,
+    _In_ uint32_t idleTimeoutInSeconds
+    ) :
+    m_client(client),
+    m_connector(std::move(resolver)),
+    m_host(host),
+    m_port(port),
+    m_connectionAttemptDelayInMilliseconds(connectionAttemptDelayInMilliseconds),
+    m_idleTimeoutInSeconds(idleTimeoutInSeconds),
+    m_socket(HTTP_INVALID_SOCKET),
+    m_open(false),
+    m_accepting(true),
+    m_stopping(false),
+    m_finished(false),
+    m_lastActive(std::chrono::steady_clock::now()),
+    m_nextStreamId(1),
+    m_sendWindow(HTTP2_DEFAULT_WINDOW_SIZE),
+    m_receiveWindow(HTTP2_DEFAULT_WINDOW_SIZE),
+    m_receiveWindowConsumed(0),
+    m_peerMaxFrameSize(HTTP2_DEFAULT_MAX_FRAME_SIZE),
+    m_peerInitialWindowSize(static_cast<uint32_t>(HTTP2_DEFAULT_WINDOW_SIZE)),
+    m_peerMaxConcurrentStreams(HTTP2_DEFAULT_MAX_CONCURRENT_STREAMS),
+    m_wasOpen(false),
+    m_headerBlockStreamId(0),
+    m_headerBlockEndsStream(false)
+{
+    bool ipv6 = m_host.find(':') != http_internal_string::npos;
+    m_authority = ipv6 ? "[" + m_host + "]" : m_host;
+    if (m_port != 80)
+    {
+        char port[8];
+        snprintf(port, sizeof(port), ":%u", m_port);
+        m_authority += port;
+    }
+}
+
+http2_connection::~http2_connection()
+{
+    close();
+}
+
+void http2_connection::start()
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+bool http2_connection::is_finished()
+{
+    return m_finished;
+}
+
+bool http2_connection::is_accepting()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_accepting;
+}
+
+void http2_connection::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        m_accepting = false;
+        if (m_open)
+        {
+            http_socket_shutdown(m_socket);
+        }
+    }
+
+    m_connector.cancel();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool http2_connection::submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried)
+{
+    uint32_t timeoutInSeconds = 0;
+    HCHttpCallRequestGetTimeout(call, &timeoutInSeconds);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_accepting)
+        {
+            return false;
+        }
+        m_lastActive = std::chrono::steady_clock::now();
+
+        // Keep the call alive until its task is completed, even if the caller closes it first
+        pending_call pending;
+        pending.call = HCHttpCallDuplicateHandle(call);
+        pending.taskHandle = taskHandle;
+        pending.deadline = (timeoutInSeconds == 0) ?
+            (std::chrono::steady_clock::time_point::max)() :
+            std::chrono::steady_clock::now() + std::chrono::seconds(timeoutInSeconds);
+        pending.retried = retried;
+        pending.refused = false;
+        m_pending.push_back(pending);
+        open_streams();
+    }
+
+    flush();
+    return true;
+}
+
+bool http2_connection::connect(_In_ uint32_t timeoutInSeconds)
+{
+    http_socket socket;
+    if (m_connector.connect(m_host, m_port, m_connectionAttemptDelayInMilliseconds, timeoutInSeconds * 1000, &socket) != HC_OK)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_stopping)
+        {
+            http_socket_close(socket);
+            return false;
+        }
+        m_socket = socket;
+        m_open = true;
+        m_wasOpen = true;
+
+        // Prior knowledge: send the preface straight away instead of upgrading from HTTP/1.1
+        m_outgoing.insert(m_outgoing.end(), HTTP2_CONNECTION_PREFACE, HTTP2_CONNECTION_PREFACE + sizeof(HTTP2_CONNECTION_PREFACE) - 1);
+        http_internal_vector<uint8_t> settings;
+        append_setting(HTTP2_SETTINGS_ENABLE_PUSH, 0, settings);
+        append_setting(HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, HTTP2_STREAM_WINDOW_SIZE, settings);
+        write_frame(HTTP2_FRAME_SETTINGS, 0, 0, settings.data(), static_cast<uint32_t>(settings.size()));
+
+        // The connection window can only be raised with WINDOW_UPDATE
+        write_window_update(0, static_cast<uint32_t>(HTTP2_CONNECTION_WINDOW_SIZE - HTTP2_DEFAULT_WINDOW_SIZE));
+        m_receiveWindow = HTTP2_CONNECTION_WINDOW_SIZE;
+
+        open_streams();
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http2_connection: connected to %s", m_authority.c_str());
+    flush();
+    return true;
+}
+
+void http2_connection::run()
+{
+    uint32_t timeoutInSeconds = HTTP2_DEFAULT_TIMEOUT_IN_SECONDS;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_pending.empty())
+        {
+            HCHttpCallRequestGetTimeout(m_pending.front().call, &timeoutInSeconds);
+        }
+    }
+
+    if (connect(timeoutInSeconds != 0 ? timeoutInSeconds : HTTP2_DEFAULT_TIMEOUT_IN_SECONDS))
+    {
+        read_frames();
+    }
+
+    finish();
+    m_finished = true;
+}
+
+void http2_connection::read_frames()
+{
+    uint8_t chunk[16 * 1024];
+    while (true)
+    {
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            check_deadlines();
+            close_if_idle();
+
+            // After GOAWAY, stay open only until the streams the server accepted are done
+            done = m_stopping || (!m_accepting && m_streams.empty());
+        }
+        flush();
+        complete_calls();
+        if (done)
+        {
+            break;
+        }
+
+        int ready = http_socket_wait_readable(m_socket, HTTP2_READ_POLL_INTERVAL_IN_MILLISECONDS);
+        if (ready == 0)
+        {
+            continue;
+        }
+
+        int received = (ready > 0) ? http_socket_receive(m_socket, chunk, sizeof(chunk)) : -1;
+        if (received <= 0)
+        {
+            HC_TRACE_INFORMATION(HTTPCLIENT, "http2_connection: connection to %s closed", m_authority.c_str());
+            break;
+        }
+        m_readBuffer.insert(m_readBuffer.end(), chunk, chunk + received);
+
+        bool ok = true;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            size_t offset = 0;
+            while (ok && m_readBuffer.size() - offset >= HTTP2_FRAME_HEADER_SIZE)
+            {
+                const uint8_t* header = m_readBuffer.data() + offset;
+                uint32_t length = (static_cast<uint32_t>(header[0]) << 16) | (static_cast<uint32_t>(header[1]) << 8) | header[2];
+                if (length > HTTP2_DEFAULT_MAX_FRAME_SIZE)
+                {
+                    ok = connection_error(HTTP2_FRAME_SIZE_ERROR, "frame larger than SETTINGS_MAX_FRAME_SIZE");
+                    break;
+                }
+                if (m_readBuffer.size() - offset < HTTP2_FRAME_HEADER_SIZE + length)
+                {
+                    break;
+                }
+
+                ok = process_frame(header[3], header[4], read_uint32(header + 5) & HTTP2_MAX_STREAM_ID, header + HTTP2_FRAME_HEADER_SIZE, length);
+                offset += HTTP2_FRAME_HEADER_SIZE + length;
+            }
+            m_readBuffer.erase(m_readBuffer.begin(), m_readBuffer.begin() + offset);
+        }
+
+        flush();
+        complete_calls();
+        if (!ok)
+        {
+            break;
+        }
+    }
+}
+
+void http2_connection::finish()
+{
+    {
+        // Take the write lock so no other thread is sending when the socket is closed
+        std::lock_guard<std::mutex> writeLock(m_writeLock);
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_open = false;
+        m_accepting = false;
+        m_outgoing.clear();
+        if (m_socket != HTTP_INVALID_SOCKET)
+        {
+            http_socket_close(m_socket);
+            m_socket = HTTP_INVALID_SOCKET;
+        }
+
+        // Streams that were sent may have been processed, so they can't be retried
+        for (const auto& entry : m_streams)
+        {
+            fail_call(entry.second.pending, HC_E_FAIL);
+        }
+        m_streams.clear();
+
+        // Calls that never made it onto the wire can go to a new connection, unless this one
+        // never connected, in which case the next would most likely fail the same way
+        for (const auto& pending : m_pending)
+        {
+            if (m_wasOpen && !m_stopping)
+            {
+                retry_call(pending);
+            }
+            else
+            {
+                fail_call(pending, HC_E_FAIL);
+            }
+        }
+        m_pending.clear();
+    }
+
+    complete_calls();
+}
+
+void http2_connection::close_if_idle()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!m_streams.empty() || !m_pending.empty())
+    {
+        m_lastActive = now;
+        return;
+    }
+
+    if (!m_accepting || m_idleTimeoutInSeconds == 0 || now - m_lastActive < std::chrono::seconds(m_idleTimeoutInSeconds))
+    {
+        return;
+    }
+
+    // Tell the server we're going so it doesn't treat the close as an error.  The pool opens a
+    // new connection for the next call.
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http2_connection: closing idle connection to %s", m_authority.c_str());
+    http_internal_vector<uint8_t> payload;
+    append_uint32(0, payload);
+    append_uint32(HTTP2_NO_ERROR, payload);
+    write_frame(HTTP2_FRAME_GOAWAY, 0, 0, payload.data(), static_cast<uint32_t>(payload.size()));
+    m_accepting = false;
+}
+
+void http2_connection::check_deadlines()
+{
+    auto now = std::chrono::steady_clock::now();
+    http_internal_vector<uint32_t> expired;
+    for (const auto& entry : m_streams)
+    {
+        if (now >= entry.second.pending.deadline)
+        {
+            expired.push_back(entry.first);
+        }
+    }
+    for (uint32_t streamId : expired)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: HTTP/2 stream %u timed out",
+            m_streams[streamId].pending.call->id, streamId);
+        write_rst_stream(streamId, HTTP2_CANCEL);
+        complete_stream(streamId, HC_E_FAIL, HTTP2_CANCEL);
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        if (now >= it->deadline)
+        {
+            fail_call(*it, HC_E_FAIL);
+            it = m_pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void http2_connection::write_frame(
+    _In_ uint8_t type,
+    _In_ uint8_t flags,
+    _In_ uint32_t streamId,
+    _In_reads_bytes_opt_(length) const uint8_t* payload,
+    _In_ uint32_t length
+    )
+{
+    m_outgoing.push_back(static_cast<uint8_t>(length >> 16));
+    m_outgoing.push_back(static_cast<uint8_t>(length >> 8));
+    m_outgoing.push_back(static_cast<uint8_t>(length));
+    m_outgoing.push_back(type);
+    m_outgoing.push_back(flags);
+    append_uint32(streamId, m_outgoing);
+    if (length > 0)
+    {
+        m_outgoing.insert(m_outgoing.end(), payload, payload + length);
+    }
+}
+
+void http2_connection::write_window_update(_In_ uint32_t streamId, _In_ uint32_t increment)
+{
+    http_internal_vector<uint8_t> payload;
+    append_uint32(increment, payload);
+    write_frame(HTTP2_FRAME_WINDOW_UPDATE, 0, streamId, payload.data(), 4);
+}
+
+void http2_connection::write_rst_stream(_In_ uint32_t streamId, _In_ uint32_t errorCode)
+{
+    http_internal_vector<uint8_t> payload;
+    append_uint32(errorCode, payload);
+    write_frame(HTTP2_FRAME_RST_STREAM, 0, streamId, payload.data(), 4);
+}
+
+bool http2_connection::connection_error(_In_ uint32_t errorCode, _In_z_ PCSTR reason)
+{
+    HC_TRACE_ERROR(HTTPCLIENT, "http2_connection: closing connection to %s: %s", m_authority.c_str(), reason);
+
+    // We never accept streams from the server, so the last stream id is always 0
+    http_internal_vector<uint8_t> payload;
+    append_uint32(0, payload);
+    append_uint32(errorCode, payload);
+    write_frame(HTTP2_FRAME_GOAWAY, 0, 0, payload.data(), static_cast<uint32_t>(payload.size()));
+    m_accepting = false;
+    return false;
+}
+
+void http2_connection::open_streams()
+{
+    while (m_open && !m_pending.empty() && m_streams.size() < m_peerMaxConcurrentStreams)
+    {
+        if (m_nextStreamId > HTTP2_MAX_STREAM_ID)
+        {
+            // Out of stream ids, so the rest go to a new connection
+            m_accepting = false;
+            for (const auto& pending : m_pending)
+            {
+                retry_call(pending);
+            }
+            m_pending.clear();
+            break;
+        }
+
+        pending_call pending = m_pending.front();
+        m_pending.pop_front();
+        open_stream(pending);
+    }
+}
+
+void http2_connection::open_stream(_In_ const pending_call& pending)
+{
+    HC_CALL_HANDLE call = pending.call;
+    uint32_t streamId = m_nextStreamId;
+    m_nextStreamId += 2;
+
+    const BYTE* body = nullptr;
+    uint32_t bodySize = 0;
+    HCHttpCallRequestGetRequestBodyBytes(call, &body, &bodySize);
+
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url);
+    http_internal_string path = uri.Resource();
+
+    http_internal_vector<hpack_header> headers;
+    hpack_header header;
+    header.name = ":method";
+    header.value = method;
+    headers.push_back(header);
+    header.name = ":scheme";
+    header.value = "http";
+    headers.push_back(header);
+    header.name = ":authority";
+    header.value = m_authority;
+    headers.push_back(header);
+    header.name = ":path";
+    header.value = path.empty() ? "/" : path;
+    headers.push_back(header);
+
+    bool foundUserAgent = false;
+    bool foundAcceptEncoding = false;
+    for (const auto& requestHeader : call->requestHeaders)
+    {
+        header.name.clear();
+        append_lower(requestHeader.first.data(), requestHeader.first.size(), header.name);
+        header.value.assign(requestHeader.second.value.data(), requestHeader.second.value.size());
+        if (header.name == "host")
+        {
+            headers[2].value = header.value;
+            continue;
+        }
+        if (is_connection_header(header.name) || (header.name == "te" && header.value != "trailers"))
+        {
+            continue;
+        }
+        foundUserAgent |= header.name == "user-agent";
+        foundAcceptEncoding |= header.name == "accept-encoding";
+        headers.push_back(header);
+    }
+
+    if (!foundUserAgent)
+    {
+        header.name = "user-agent";
+        header.value = "libHttpClient/1.0.0.0";
+        headers.push_back(header);
+    }
+
+    // Advertise only the codings HCHttpCallResponseAppendResponseBodyBytes can decode
+    if (!foundAcceptEncoding && call->responseDecompressionEnabled)
+    {
+        header.name = "accept-encoding";
+        header.value = "gzip, deflate";
+        headers.push_back(header);
+    }
+
+    http_internal_vector<uint8_t> block;
+    m_encoder.encode(headers, block);
+
+    // A header block too big for one frame continues in CONTINUATION frames
+    size_t offset = 0;
+    bool first = true;
+    do
+    {
+        uint32_t chunkSize = static_cast<uint32_t>(MIN(block.size() - offset, static_cast<size_t>(m_peerMaxFrameSize)));
+        uint8_t flags = 0;
+        if (offset + chunkSize == block.size())
+        {
+            flags |= HTTP2_FLAG_END_HEADERS;
+        }
+        if (first && bodySize == 0)
+        {
+            flags |= HTTP2_FLAG_END_STREAM;
+        }
+        write_frame(first ? HTTP2_FRAME_HEADERS : HTTP2_FRAME_CONTINUATION, flags, streamId, block.data() + offset, chunkSize);
+        offset += chunkSize;
+        first = false;
+    } while (offset < block.size());
+
+    stream opened;
+    opened.pending = pending;
+    opened.body = body;
+    opened.bodySize = bodySize;
+    opened.bodyOffset = 0;
+    opened.sendWindow = m_peerInitialWindowSize;
+    opened.receiveWindow = HTTP2_STREAM_WINDOW_SIZE;
+    opened.receiveWindowConsumed = 0;
+    opened.responseHeadersReceived = false;
+    m_streams.emplace(streamId, opened);
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: sent as HTTP/2 stream %u to %s",
+        call->id, streamId, m_authority.c_str());
+
+    if (bodySize > 0)
+    {
+        send_bodies();
+    }
+}
+
+void http2_connection::send_bodies()
+{
+    for (auto& entry : m_streams)
+    {
+        stream& s = entry.second;
+        while (s.bodyOffset < s.bodySize && m_sendWindow > 0 && s.sendWindow > 0)
+        {
+            int64_t chunkSize = s.bodySize - s.bodyOffset;
+            chunkSize = MIN(chunkSize, static_cast<int64_t>(m_peerMaxFrameSize));
+            chunkSize = MIN(chunkSize, m_sendWindow);
+            chunkSize = MIN(chunkSize, s.sendWindow);
+
+            bool last = s.bodyOffset + chunkSize == s.bodySize;
+            write_frame(HTTP2_FRAME_DATA, last ? HTTP2_FLAG_END_STREAM : 0, entry.first, s.body + s.bodyOffset, static_cast<uint32_t>(chunkSize));
+            s.bodyOffset += static_cast<uint32_t>(chunkSize);
+            s.sendWindow -= chunkSize;
+            m_sendWindow -= chunkSize;
+        }
+
+        if (m_sendWindow <= 0)
+        {
+            break;
+        }
+    }
+}
+
+void http2_connection::complete_stream(_In_ uint32_t streamId, _In_ HC_RESULT result, _In_ uint32_t errorCode)
+{
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end())
+    {
+        return;
+    }
+
+    // The server may answer before reading the whole body.  Tell it we've stopped sending.
+    if (result == HC_OK && it->second.bodyOffset < it->second.bodySize)
+    {
+        write_rst_stream(streamId, HTTP2_CANCEL);
+    }
+
+    if (result == HC_OK)
+    {
+        m_completed.push_back(it->second.pending);
+    }
+    else
+    {
+        HCHttpCallResponseSetNetworkErrorCode(it->second.pending.call, result, errorCode);
+        m_completed.push_back(it->second.pending);
+    }
+    m_streams.erase(it);
+    open_streams();
+}
+
+void http2_connection::fail_call(_In_ const pending_call& pending, _In_ HC_RESULT result)
+{
+    HCHttpCallResponseSetNetworkErrorCode(pending.call, result, static_cast<uint32_t>(result));
+    m_completed.push_back(pending);
+}
+
+void http2_connection::retry_call(_In_ const pending_call& pending)
+{
+    if (pending.retried)
+    {
+        fail_call(pending, HC_E_FAIL);
+    }
+    else
+    {
+        m_unprocessed.push_back(pending);
+    }
+}
+
+bool http2_connection::process_frame(
+    _In_ uint8_t type,
+    _In_ uint8_t flags,
+    _In_ uint32_t streamId,
+    _In_reads_bytes_(length) const uint8_t* payload,
+    _In_ uint32_t length
+    )
+{
+    if (m_headerBlockStreamId != 0 && (type != HTTP2_FRAME_CONTINUATION || streamId != m_headerBlockStreamId))
+    {
+        return connection_error(HTTP2_PROTOCOL_ERROR, "header block interrupted");
+    }
+
+    switch (type)
+    {
+        case HTTP2_FRAME_DATA:
+        {
+            if (streamId == 0)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "DATA on stream 0");
+            }
+
+            const uint8_t* data = payload;
+            uint32_t dataSize = length;
+            if ((flags & HTTP2_FLAG_PADDED) != 0)
+            {
+                if (length < 1 || payload[0] >= length)
+                {
+                    return connection_error(HTTP2_PROTOCOL_ERROR, "bad DATA padding");
+                }
+                data = payload + 1;
+                dataSize = length - 1 - payload[0];
+            }
+
+            // Flow control counts the whole frame, padding included
+            if (length > m_receiveWindow)
+            {
+                return connection_error(HTTP2_FLOW_CONTROL_ERROR, "connection window exceeded");
+            }
+            m_receiveWindow -= length;
+            m_receiveWindowConsumed += length;
+            if (m_receiveWindowConsumed >= HTTP2_CONNECTION_WINDOW_SIZE / 2)
+            {
+                write_window_update(0, m_receiveWindowConsumed);
+                m_receiveWindow += m_receiveWindowConsumed;
+                m_receiveWindowConsumed = 0;
+            }
+
+            auto it = m_streams.find(streamId);
+            if (it == m_streams.end())
+            {
+                // A stream we've already finished with, e.g. after a timeout
+                return true;
+            }
+
+            stream& s = it->second;
+            if (!s.responseHeadersReceived || length > s.receiveWindow)
+            {
+                uint32_t errorCode = s.responseHeadersReceived ? HTTP2_FLOW_CONTROL_ERROR : HTTP2_PROTOCOL_ERROR;
+                write_rst_stream(streamId, errorCode);
+                complete_stream(streamId, HC_E_FAIL, errorCode);
+                return true;
+            }
+            s.receiveWindow -= length;
+
+            if (dataSize > 0 && HCHttpCallResponseAppendResponseBodyBytes(s.pending.call, data, dataSize) != HC_OK)
+            {
+                write_rst_stream(streamId, HTTP2_CANCEL);
+                complete_stream(streamId, HC_E_FAIL, HTTP2_CANCEL);
+                return true;
+            }
+
+            if ((flags & HTTP2_FLAG_END_STREAM) != 0)
+            {
+                complete_stream(streamId, HC_OK, 0);
+                return true;
+            }
+
+            s.receiveWindowConsumed += length;
+            if (s.receiveWindowConsumed >= HTTP2_STREAM_WINDOW_SIZE / 2)
+            {
+                write_window_update(streamId, s.receiveWindowConsumed);
+                s.receiveWindow += s.receiveWindowConsumed;
+                s.receiveWindowConsumed = 0;
+            }
+            return true;
+        }
+
+        case HTTP2_FRAME_HEADERS:
+        {
+            if (streamId == 0)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "HEADERS on stream 0");
+            }
+
+            uint32_t offset = 0;
+            uint32_t padding = 0;
+            if ((flags & HTTP2_FLAG_PADDED) != 0)
+            {
+                if (length < 1)
+                {
+                    return connection_error(HTTP2_PROTOCOL_ERROR, "bad HEADERS padding");
+                }
+                padding = payload[0];
+                offset = 1;
+            }
+            if ((flags & HTTP2_FLAG_PRIORITY) != 0)
+            {
+                offset += 5;
+            }
+            if (offset + padding > length)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "bad HEADERS padding");
+            }
+
+            m_headerBlock.assign(payload + offset, payload + length - padding);
+            m_headerBlockStreamId = streamId;
+            m_headerBlockEndsStream = (flags & HTTP2_FLAG_END_STREAM) != 0;
+            return (flags & HTTP2_FLAG_END_HEADERS) != 0 ? process_header_block() : true;
+        }
+
+        case HTTP2_FRAME_CONTINUATION:
+        {
+            if (m_headerBlockStreamId == 0)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "unexpected CONTINUATION");
+            }
+            if (m_headerBlock.size() + length > HTTP2_MAX_HEADER_BLOCK_SIZE)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "header block too large");
+            }
+
+            m_headerBlock.insert(m_headerBlock.end(), payload, payload + length);
+            return (flags & HTTP2_FLAG_END_HEADERS) != 0 ? process_header_block() : true;
+        }
+
+        case HTTP2_FRAME_RST_STREAM:
+        {
+            if (length != 4)
+            {
+                return connection_error(HTTP2_FRAME_SIZE_ERROR, "bad RST_STREAM size");
+            }
+
+            uint32_t errorCode = read_uint32(payload);
+            auto it = m_streams.find(streamId);
+            if (it != m_streams.end())
+            {
+                HC_TRACE_WARNING(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: HTTP/2 stream %u reset with error %u",
+                    it->second.pending.call->id, streamId, errorCode);
+
+                // A refused stream was never processed, so it's safe to send again.  Streams opened
+                // before the server's SETTINGS arrived may be over its limit, so try this connection
+                // once more before moving to a new one.
+                if (errorCode == HTTP2_REFUSED_STREAM)
+                {
+                    pending_call pending = it->second.pending;
+                    m_streams.erase(it);
+                    if (m_accepting && !pending.refused)
+                    {
+                        pending.refused = true;
+                        m_pending.push_front(pending);
+                    }
+                    else
+                    {
+                        retry_call(pending);
+                    }
+                    open_streams();
+                }
+                else
+                {
+                    complete_stream(streamId, HC_E_FAIL, errorCode);
+                }
+            }
+            return true;
+        }
+
+        case HTTP2_FRAME_SETTINGS:
+        {
+            if (streamId != 0)
+            {
+                return connection_error(HTTP2_PROTOCOL_ERROR, "SETTINGS on a stream");
+            }
+            if ((flags & HTTP2_FLAG_ACK) != 0)
+            {
+                return length == 0 ? true : connection_error(HTTP2_FRAME_SIZE_ERROR, "bad SETTINGS ack");
+            }
+            if (length % 6 != 0)
+            {
+                return connection_error(HTTP2_FRAME_SIZE_ERROR, "bad SETTINGS size");
+            }
+
+            for (uint32_t offset = 0; offset < length; offset += 6)
+            {
+                uint16_t id = static_cast<uint16_t>((payload[offset] << 8) | payload[offset + 1]);
+                uint32_t value = read_uint32(payload + offset + 2);
+                switch (id)
+                {
+                    case HTTP2_SETTINGS_HEADER_TABLE_SIZE:
+                        m_encoder.set_max_table_size(value);
+                        break;
+
+                    case HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS:
+                        m_peerMaxConcurrentStreams = value;
+                        break;
+
+                    case HTTP2_SETTINGS_INITIAL_WINDOW_SIZE:
+                    {
+                        if (value > HTTP2_MAX_WINDOW_SIZE)
+                        {
+                            return connection_error(HTTP2_FLOW_CONTROL_ERROR, "bad SETTINGS_INITIAL_WINDOW_SIZE");
+                        }
+
+                        // Applies to streams already open as well as new ones
+                        int64_t delta = static_cast<int64_t>(value) - m_peerInitialWindowSize;
+                        for (auto& entry : m_streams)
+                        {
+                            entry.second.sendWindow += delta;
+                        }
+                        m_peerInitialWindowSize = value;
+                        break;
+                    }
+
+                    case HTTP2_SETTINGS_MAX_FRAME_SIZE:
+                        if (value < HTTP2_DEFAULT_MAX_FRAME_SIZE || value > HTTP2_MAX_ALLOWED_FRAME_SIZE)
+                        {
+                            return connection_error(HTTP2_PROTOCOL_ERROR, "bad SETTINGS_MAX_FRAME_SIZE");
+                        }
+                        m_peerMaxFrameSize = value;
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+
+            write_frame(HTTP2_FRAME_SETTINGS, HTTP2_FLAG_ACK, 0, nullptr, 0);
+            open_streams();
+            send_bodies();
+            return true;
+        }
+
+        case HTTP2_FRAME_PING:
+        {
+            if (length != 8 || streamId != 0)
+            {
+                return connection_error(HTTP2_FRAME_SIZE_ERROR, "bad PING");
+            }
+            if ((flags & HTTP2_FLAG_ACK) == 0)
+            {
+                write_frame(HTTP2_FRAME_PING, HTTP2_FLAG_ACK, 0, payload, length);
+            }
+            return true;
+        }
+
+        case HTTP2_FRAME_GOAWAY:
+        {
+            if (length < 8)
+            {
+                return connection_error(HTTP2_FRAME_SIZE_ERROR, "bad GOAWAY size");
+            }
+
+            uint32_t lastStreamId = read_uint32(payload) & HTTP2_MAX_STREAM_ID;
+            uint32_t errorCode = read_uint32(payload + 4);
+            HC_TRACE_INFORMATION(HTTPCLIENT, "http2_connection: %s is going away, last stream %u, error %u",
+                m_authority.c_str(), lastStreamId, errorCode);
+
+            // Streams after the last one the server processed, and calls still waiting for a
+            // stream, go to a new connection.  The rest finish on this one.
+            m_accepting = false;
+            for (auto it = m_streams.begin(); it != m_streams.end();)
+            {
+                if (it->first > lastStreamId)
+                {
+                    retry_call(it->second.pending);
+                    it = m_streams.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            for (const auto& pending : m_pending)
+            {
+                retry_call(pending);
+            }
+            m_pending.clear();
+            return true;
+        }
+
+        case HTTP2_FRAME_WINDOW_UPDATE:
+        {
+            if (length != 4)
+            {
+                return connection_error(HTTP2_FRAME_SIZE_ERROR, "bad WINDOW_UPDATE size");
+            }
+
+            uint32_t increment = read_uint32(payload) & HTTP2_MAX_STREAM_ID;
+            if (streamId == 0)
+            {
+                m_sendWindow += increment;
+                if (increment == 0 || m_sendWindow > HTTP2_MAX_WINDOW_SIZE)
+                {
+                    return connection_error(HTTP2_FLOW_CONTROL_ERROR, "bad connection WINDOW_UPDATE");
+                }
+            }
+            else
+            {
+                auto it = m_streams.find(streamId);
+                if (it != m_streams.end())
+                {
+                    it->second.sendWindow += increment;
+                    if (increment == 0 || it->second.sendWindow > HTTP2_MAX_WINDOW_SIZE)
+                    {
+                        write_rst_stream(streamId, HTTP2_FLOW_CONTROL_ERROR);
+                        complete_stream(streamId, HC_E_FAIL, HTTP2_FLOW_CONTROL_ERROR);
+                    }
+                }
+            }
+            send_bodies();
+            return true;
+        }
+
+        case HTTP2_FRAME_PUSH_PROMISE:
+            // We disabled push in our SETTINGS
+            return connection_error(HTTP2_PROTOCOL_ERROR, "PUSH_PROMISE with push disabled");
+
+        case HTTP2_FRAME_PRIORITY:
+        default:
+            // Unknown frame types must be ignored
+            return true;
+    }
+}
+
+bool http2_connection::process_header_block()
+{
+    uint32_t streamId = m_headerBlockStreamId;
+    m_headerBlockStreamId = 0;
+
+    // Decode even if the stream is gone, or our table would fall out of step with the server's
+    http_internal_vector<hpack_header> headers;
+    bool decoded = m_decoder.decode(m_headerBlock.data(), m_headerBlock.size(), headers);
+    m_headerBlock.clear();
+    if (!decoded)
+    {
+        return connection_error(HTTP2_COMPRESSION_ERROR, "bad header block");
+    }
+
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end())
+    {
+        return true;
+    }
+
+    stream& s = it->second;
+    if (!s.responseHeadersReceived)
+    {
+        uint32_t statusCode = 0;
+        for (const auto& header : headers)
+        {
+            if (header.name == ":status")
+            {
+                statusCode = static_cast<uint32_t>(atoi(header.value.c_str()));
+            }
+        }
+
+        if (statusCode < 100 || (statusCode < 200 && m_headerBlockEndsStream))
+        {
+            write_rst_stream(streamId, HTTP2_PROTOCOL_ERROR);
+            complete_stream(streamId, HC_E_FAIL, HTTP2_PROTOCOL_ERROR);
+            return true;
+        }
+        if (statusCode < 200)
+        {
+            // Informational, the final response follows
+            return true;
+        }
+
+        // Repeated fields are combined as RFC 7230 3.2.2 allows
+        http_internal_map<http_internal_string, http_internal_string> combined;
+        for (const auto& header : headers)
+        {
+            if (header.name.empty() || header.name[0] == ':')
+            {
+                continue;
+            }
+            auto existing = combined.find(header.name);
+            if (existing == combined.end())
+            {
+                combined.emplace(header.name, header.value);
+            }
+            else
+            {
+                existing->second += ", ";
+                existing->second += header.value;
+            }
+        }
+
+        HCHttpCallResponseSetStatusCode(s.pending.call, statusCode);
+        for (const auto& header : combined)
+        {
+            HCHttpCallResponseSetHeader(s.pending.call, header.first.c_str(), header.second.c_str());
+        }
+        s.responseHeadersReceived = true;
+    }
+    // Trailers are ignored
+
+    if (m_headerBlockEndsStream)
+    {
+        complete_stream(streamId, HC_OK, 0);
+    }
+    return true;
+}
+
+void http2_connection::flush()
+{
+    std::lock_guard<std::mutex> writeLock(m_writeLock);
+    http_internal_vector<uint8_t> outgoing;
+    http_socket socket;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_open || m_outgoing.empty())
+        {
+            return;
+        }
+        outgoing.swap(m_outgoing);
+        socket = m_socket;
+    }
+
+    if (!http_socket_send_all(socket, outgoing.data(), outgoing.size()))
+    {
+        // Wake the reader so it tears the connection down
+        HC_TRACE_ERROR(HTTPCLIENT, "http2_connection: send to %s failed", m_authority.c_str());
+        http_socket_shutdown(socket);
+    }
+}
+
+void http2_connection::complete_calls()
+{
+    http_internal_vector<pending_call> completed;
+    http_internal_vector<pending_call> unprocessed;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        completed.swap(m_completed);
+        unprocessed.swap(m_unprocessed);
+    }
+
+    for (const auto& pending : completed)
+    {
+        HCTaskSetCompleted(pending.taskHandle);
+        HCHttpCallCloseHandle(pending.call);
+    }
+
+    for (const auto& pending : unprocessed)
+    {
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: retrying on a new HTTP/2 connection", pending.call->id);
+        m_client->resubmit(pending.call, pending.taskHandle);
+        HCHttpCallCloseHandle(pending.call);
+    }
+}
+
+http2_client::http2_client(_In_ std::shared_ptr<http_dns_resolver> resolver) :
+    m_resolver(std::move(resolver)),
+    m_connectionAttemptDelayInMilliseconds(0),
+    m_idleTimeoutInSeconds(DEFAULT_CONNECTION_IDLE_TIMEOUT_IN_SECONDS),
+    m_stopping(false)
+{
+}
+
+http2_client::~http2_client()
+{
+    http_internal_vector<std::shared_ptr<http2_connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        for (auto& entry : m_connections)
+        {
+            connections.push_back(entry.second);
+        }
+        m_connections.clear();
+        connections.insert(connections.end(), m_retired.begin(), m_retired.end());
+        m_retired.clear();
+    }
+
+    for (auto& connection : connections)
+    {
+        connection->close();
+    }
+}
+
+void http2_client::perform(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds
+    )
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_connectionAttemptDelayInMilliseconds = connectionAttemptDelayInMilliseconds;
+    }
+    submit(call, taskHandle, false);
+}
+
+void http2_client::resubmit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle)
+{
+    submit(call, taskHandle, true);
+}
+
+void http2_client::prewarm(
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds
+    )
+{
+    http_internal_string lowerHost;
+    append_lower(host.data(), host.size(), lowerHost);
+    char origin[8];
+    snprintf(origin, sizeof(origin), ":%u", port);
+    http_internal_string key = lowerHost + origin;
+
+    http_internal_vector<std::shared_ptr<http2_connection>> finished;
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_stopping)
+    {
+        m_connectionAttemptDelayInMilliseconds = connectionAttemptDelayInMilliseconds;
+        get_connection(key, lowerHost, port, finished);
+    }
+}
+
+void http2_client::set_idle_timeout(_In_ uint32_t idleTimeoutInSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_idleTimeoutInSeconds = idleTimeoutInSeconds;
+}
+
+std::shared_ptr<http2_connection> http2_client::get_connection(
+    _In_ const http_internal_string& key,
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _Inout_ http_internal_vector<std::shared_ptr<http2_connection>>& finished
+    )
+{
+    // Connections that have shut down have no thread left to wait for
+    for (auto it = m_retired.begin(); it != m_retired.end();)
+    {
+        if ((*it)->is_finished())
+        {
+            finished.push_back(*it);
+            it = m_retired.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    auto it = m_connections.find(key);
+    if (it != m_connections.end())
+    {
+        if (it->second->is_accepting())
+        {
+            return it->second;
+        }
+        m_retired.push_back(it->second);
+        m_connections.erase(it);
+    }
+
+    auto connection = http_allocate_shared<http2_connection>(this, m_resolver, host, port, m_connectionAttemptDelayInMilliseconds, m_idleTimeoutInSeconds);
+    connection->start();
+    m_connections.emplace(key, connection);
+    return connection;
+}
+
+void http2_client::submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried)
+{
+    const char* url = nullptr;
+    const char* method = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    Uri uri(url);
+
+    http_internal_string host;
+    append_lower(uri.Host().data(), uri.Host().size(), host);
+    uint16_t port = uri.IsPortDefault() ? 80 : uri.Port();
+
+    if (uri.IsValid() && !host.empty())
+    {
+        char origin[8];
+        snprintf(origin, sizeof(origin), ":%u", port);
+        http_internal_string key = host + origin;
+
+        // A connection that stops taking calls after it is looked up is replaced next time.  The
+        // client lock is released before submitting, since writing the request can block on the
+        // socket and would stall every other origin's calls.
+        http_internal_vector<std::shared_ptr<http2_connection>> finished;
+        for (uint32_t attempt = 0; attempt < 2; attempt++)
+        {
+            std::shared_ptr<http2_connection> connection;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_stopping)
+                {
+                    break;
+                }
+                connection = get_connection(key, host, port, finished);
+            }
+
+            if (connection->submit(call, taskHandle, retried))
+            {
+                return;
+            }
+        }
+    }
+
+    HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: can't send over HTTP/2", call->id);
+    HCHttpCallResponseSetNetworkErrorCode(call, HC_E_FAIL, static_cast<uint32_t>(HC_E_FAIL));
+    HCTaskSetCompleted(taskHandle);
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
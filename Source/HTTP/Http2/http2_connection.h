@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "../http_socket.h"
+#include "../http_connector.h"
+#include "hpack.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+class http_dns_resolver;
+class http2_client;
+
+// One HTTP/2 connection to an origin, carrying many calls at once as streams (RFC 7540).
+//
+// The connection is opened with prior knowledge (h2c) on its own thread, which then reads and
+// dispatches frames.  Calls submitted before the connection is up, or beyond the server's
+// concurrent stream limit, wait in a queue.  Request bodies are sent as the server's flow
+// control windows allow, and received data is acknowledged once half of our window is used.
+//
+// Frames are built under m_lock, in the order the HPACK encoder saw them, and written by
+// whichever thread calls flush() next under m_writeLock.  So a slow socket never blocks the
+// reader from taking m_lock.
+class http2_connection
+{
+public:
+    http2_connection(
+        _In_ http2_client* client,
+        _In_ std::shared_ptr<http_dns_resolver> resolver,
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds,
+        _In_ uint32_t idleTimeoutInSeconds
+        );
+    ~http2_connection();
+
+    void start();
+
+    // Returns false if the connection isn't taking new streams, in which case the caller should
+    // open another connection for the call.  A retried call isn't retried again.
+    bool submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried);
+
+    // True once the connection thread has exited
+    bool is_finished();
+
+    // False once the connection has stopped taking calls
+    bool is_accepting();
+
+    // Fails every outstanding call and waits for the connection thread to exit
+    void close();
+
+private:
+    struct pending_call
+    {
+        HC_CALL_HANDLE call;
+        HC_TASK_HANDLE taskHandle;
+        std::chrono::steady_clock::time_point deadline;
+        bool retried;
+        bool refused;
+    };
+
+    struct stream
+    {
+        pending_call pending;
+        const uint8_t* body;
+        uint32_t bodySize;
+        uint32_t bodyOffset;
+        int64_t sendWindow;
+        int64_t receiveWindow;
+        uint32_t receiveWindowConsumed;
+        bool responseHeadersReceived;
+    };
+
+    void run();
+    bool connect(_In_ uint32_t timeoutInSeconds);
+    void read_frames();
+    bool process_frame(
+        _In_ uint8_t type,
+        _In_ uint8_t flags,
+        _In_ uint32_t streamId,
+        _In_reads_bytes_(length) const uint8_t* payload,
+        _In_ uint32_t length
+        );
+    bool process_header_block();
+    void check_deadlines();
+    void close_if_idle();
+    void finish();
+
+    // Called with m_lock held
+    void write_frame(
+        _In_ uint8_t type,
+        _In_ uint8_t flags,
+        _In_ uint32_t streamId,
+        _In_reads_bytes_opt_(length) const uint8_t* payload,
+        _In_ uint32_t length
+        );
+    void write_window_update(_In_ uint32_t streamId, _In_ uint32_t increment);
+    void write_rst_stream(_In_ uint32_t streamId, _In_ uint32_t errorCode);
+    bool connection_error(_In_ uint32_t errorCode, _In_z_ PCSTR reason);
+    void open_streams();
+    void open_stream(_In_ const pending_call& pending);
+    void send_bodies();
+    void complete_stream(_In_ uint32_t streamId, _In_ HC_RESULT result, _In_ uint32_t errorCode);
+    void fail_call(_In_ const pending_call& pending, _In_ HC_RESULT result);
+    void retry_call(_In_ const pending_call& pending);
+
+    void flush();
+    void complete_calls();
+
+    http2_client* m_client;
+    http_connector m_connector;
+    http_internal_string m_host;
+    http_internal_string m_authority;
+    uint16_t m_port;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    uint32_t m_idleTimeoutInSeconds;
+
+    std::mutex m_lock;
+    std::mutex m_writeLock;
+    std::thread m_thread;
+    http_socket m_socket;
+    bool m_open;
+    bool m_accepting;
+    bool m_stopping;
+    std::atomic<bool> m_finished;
+    std::chrono::steady_clock::time_point m_lastActive;  // when a call was last outstanding
+
+    http_internal_map<uint32_t, stream> m_streams;
+    http_internal_dequeue<pending_call> m_pending;
+    http_internal_vector<pending_call> m_completed;   // to complete once m_lock is released
+    http_internal_vector<pending_call> m_unprocessed; // refused by the server, to retry on a new connection
+    http_internal_vector<uint8_t> m_outgoing;
+
+    hpack_encoder m_encoder;
+    hpack_decoder m_decoder;
+    uint32_t m_nextStreamId;
+    int64_t m_sendWindow;
+    int64_t m_receiveWindow;
+    uint32_t m_receiveWindowConsumed;
+    uint32_t m_peerMaxFrameSize;
+    uint32_t m_peerInitialWindowSize;
+    uint32_t m_peerMaxConcurrentStreams;
+
+    bool m_wasOpen;
+    http_internal_vector<uint8_t> m_readBuffer;
+    uint32_t m_headerBlockStreamId;
+    bool m_headerBlockEndsStream;
+    http_internal_vector<uint8_t> m_headerBlock;
+};
+
+// Pool of HTTP/2 connections, one per origin
+class http2_client
+{
+public:
+    http2_client(_In_ std::shared_ptr<http_dns_resolver> resolver);
+    ~http2_client();
+
+    void perform(
+        _In_ HC_CALL_HANDLE call,
+        _In_ HC_TASK_HANDLE taskHandle,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds
+        );
+
+    // Opens the origin's connection ahead of the first call, if it isn't open already
+    void prewarm(
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds
+        );
+
+    void set_idle_timeout(_In_ uint32_t idleTimeoutInSeconds);
+
+    // Called by a connection for calls the server refused without processing
+    void resubmit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle);
+
+private:
+    void submit(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle, _In_ bool retried);
+
+    // Called with m_lock held.  Returns the origin's connection, opening a new one if there is
+    // none or it has stopped taking calls.
+    std::shared_ptr<http2_connection> get_connection(
+        _In_ const http_internal_string& key,
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _Inout_ http_internal_vector<std::shared_ptr<http2_connection>>& finished
+        );
+
+    std::shared_ptr<http_dns_resolver> m_resolver;
+    std::mutex m_lock;
+    http_internal_map<http_internal_string, std::shared_ptr<http2_connection>> m_connections;
+    http_internal_vector<std::shared_ptr<http2_connection>> m_retired;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    uint32_t m_idleTimeoutInSeconds;
+    bool m_stopping;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -265,14 +265,13 @@ void winhttp_http_task::callback_status_data_available(
 
     if (newBytesAvailable > 0)
     {
-        size_t oldSize = pRequestContext->m_responseBuffer.size();
-        size_t newSize = oldSize + newBytesAvailable;
-        pRequestContext->m_responseBuffer.resize(newSize);
+        // The buffer only holds the chunk being read, it is appended to the
+        // response (and decompressed if needed) when the read completes
+        pRequestContext->m_responseBuffer.resize(newBytesAvailable);
 
-        // Read in body all at once.
         if (!WinHttpReadData(
             hRequestHandle,
-            &pRequestContext->m_responseBuffer[oldSize],
+            &pRequestContext->m_responseBuffer[0],
             newBytesAvailable,
             nullptr))
         {
@@ -282,13 +281,6 @@ void winhttp_http_task::callback_status_data_available(
     else
     {
         // No more data available, complete the request.
-        if (pRequestContext->m_responseBuffer.size() > 0)
-        {
-            pRequestContext->m_responseBuffer.push_back(0); // Add null term
-
-            char* responseString = &pRequestContext->m_responseBuffer[0];
-            HCHttpCallResponseSetResponseString(pRequestContext->m_call, responseString);
-        }
         HCTaskSetCompleted(pRequestContext->m_taskHandle);
     }
 }
@@ -306,13 +298,14 @@ void winhttp_http_task::callback_status_read_complete(
     // If no bytes have been read, then this is the end of the response.
     if (bytesRead == 0)
     {
-        if (pRequestContext->m_responseBuffer.size() > 0)
-        {
-            pRequestContext->m_responseBuffer.push_back(0); // Add null term
+        HCTaskSetCompleted(pRequestContext->m_taskHandle);
+        return;
+    }
 
-            char* responseString = &pRequestContext->m_responseBuffer[0];
-            HCHttpCallResponseSetResponseString(pRequestContext->m_call, responseString);
-        }
+    const BYTE* bodyBytes = reinterpret_cast<const BYTE*>(&pRequestContext->m_responseBuffer[0]);
+    if (HCHttpCallResponseAppendResponseBodyBytes(pRequestContext->m_call, bodyBytes, bytesRead) != HC_OK)
+    {
+        // The network error code has already been set on the call
         HCTaskSetCompleted(pRequestContext->m_taskHandle);
         return;
     }
@@ -640,26 +633,33 @@ http_internal_wstring flatten_http_headers(_In_ HC_CALL_HANDLE call)
     http_internal_wstring flattened_headers;
 
     bool foundUserAgent = false;
-    uint32_t numHeaders = 0;
-    HCHttpCallRequestGetNumHeaders(call, &numHeaders);
-    for (uint32_t i = 0; i < numHeaders; i++)
+    bool foundAcceptEncoding = false;
+    for (auto const& header : call->requestHeaders)
     {
-        const char* iHeaderName;
-        const char* iHeaderValue;
-        HCHttpCallRequestGetHeaderAtIndex(call, i, &iHeaderName, &iHeaderValue);
-        if (iHeaderName != nullptr && iHeaderValue != nullptr)
+        switch (header.second.id)
         {
-            auto wHeaderName = utf16_from_utf8(iHeaderName);
-            if (wHeaderName == L"User-Agent")
-            {
+            case http_header_id::unknown:
+                flattened_headers.append(utf16_from_utf8(header.first.data(), header.first.size()));
+                break;
+
+            case http_header_id::user_agent:
                 foundUserAgent = true;
-            }
+                flattened_headers.append(http_header_wname(header.second.id));
+                break;
 
-            flattened_headers.append(wHeaderName);
-            flattened_headers.push_back(L':');
-            flattened_headers.append(utf16_from_utf8(iHeaderValue));
-            flattened_headers.append(CRLF);
+            case http_header_id::accept_encoding:
+                foundAcceptEncoding = true;
+                flattened_headers.append(http_header_wname(header.second.id));
+                break;
+
+            default:
+                flattened_headers.append(http_header_wname(header.second.id));
+                break;
         }
+
+        flattened_headers.push_back(L':');
+        flattened_headers.append(utf16_from_utf8(header.second.value.data(), header.second.value.size()));
+        flattened_headers.append(CRLF);
     }
 
     if (!foundUserAgent)
@@ -667,6 +667,13 @@ http_internal_wstring flatten_http_headers(_In_ HC_CALL_HANDLE call)
         flattened_headers.append(L"User-Agent:libHttpClient/1.0.0.0\r\n");
     }
 
+    // WinHttp hands back the body as sent so advertise only the codings
+    // HCHttpCallResponseAppendResponseBodyBytes can decode
+    if (!foundAcceptEncoding && call->responseDecompressionEnabled)
+    {
+        flattened_headers.append(L"Accept-Encoding:gzip, deflate\r\n");
+    }
+
     return flattened_headers;
 }
 
@@ -683,12 +690,18 @@ HRESULT winhttp_http_task::send(
     
     // Need to form uri path, query, and fragment for this request.
     http_internal_wstring wEncodedResource = utf16_from_utf8(cUri.Resource());
-    http_internal_wstring wMethod = utf16_from_utf8(method);
+    http_internal_wstring wMethod;
+    PCWSTR wMethodName = http_method_wname(m_call->methodId);
+    if (wMethodName == nullptr)
+    {
+        wMethod = utf16_from_utf8(method);
+        wMethodName = wMethod.c_str();
+    }
 
     // Open the request.
     m_hRequest = WinHttpOpenRequest(
         m_hConnection,
-        wMethod.c_str(),
+        wMethodName,
         wEncodedResource.c_str(),
         nullptr,
         WINHTTP_NO_REFERER,
@@ -10,6 +10,8 @@
 #include "http_response_stream.h"
 #include "http_request_stream.h"
 
+using namespace xbox::httpclient;
+
 xmlhttp_http_task::xmlhttp_http_task(
     _In_ HC_CALL_HANDLE call,
     _In_ HC_TASK_HANDLE taskHandle
@@ -45,9 +47,6 @@ void xmlhttp_http_task::perform_async(
         HCHttpCallRequestGetUrl(call, &method, &url);
         HCHttpCallRequestGetRequestBodyBytes(call, &requestBody, &requestBodyBytes);
 
-        uint32_t numHeaders = 0;
-        HCHttpCallRequestGetNumHeaders(call, &numHeaders);
-
         uint32_t timeoutInSeconds = 0;
         HCHttpCallRequestGetTimeout(call, &timeoutInSeconds);
 
@@ -73,10 +72,17 @@ void xmlhttp_http_task::perform_async(
         std::shared_ptr<hc_task> httpTask2 = shared_from_this();
         std::shared_ptr<xmlhttp_http_task> httpTask = std::dynamic_pointer_cast<xmlhttp_http_task>(httpTask2);
 
-        http_internal_wstring wMethod = utf16_from_utf8(method);
+        http_internal_wstring wMethod;
+        PCWSTR wMethodName = http_method_wname(call->methodId);
+        if (wMethodName == nullptr)
+        {
+            wMethod = utf16_from_utf8(method);
+            wMethodName = wMethod.c_str();
+        }
+
         http_internal_wstring wUrl = utf16_from_utf8(url);
         hr = m_hRequest->Open(
-            wMethod.c_str(),
+            wMethodName,
             wUrl.c_str(),
             Microsoft::WRL::Make<http_request_callback>(httpTask).Get(),
             nullptr,
@@ -101,16 +107,27 @@ void xmlhttp_http_task::perform_async(
         m_hRequest->SetProperty(XHR_PROP_ONDATA_THRESHOLD, XHR_PROP_ONDATA_NEVER);
 #endif
 
-        m_hRequest->SetRequestHeader(L"User-Agent", L"libHttpClient/1.0.0.0");
-        for (uint32_t i = 0; i < numHeaders; i++)
+        bool foundUserAgent = false;
+        for (auto const& header : call->requestHeaders)
         {
-            const char* iHeaderName;
-            const char* iHeaderValue;
-            HCHttpCallRequestGetHeaderAtIndex(call, i, &iHeaderName, &iHeaderValue);
-            if (iHeaderName != nullptr && iHeaderValue != nullptr)
+            PCWSTR wHeaderName = http_header_wname(header.second.id);
+            http_internal_wstring wCustomHeaderName;
+            if (wHeaderName == nullptr)
             {
-                hr = m_hRequest->SetRequestHeader(utf16_from_utf8(iHeaderName).c_str(), utf16_from_utf8(iHeaderValue).c_str());
+                wCustomHeaderName = utf16_from_utf8(header.first.data(), header.first.size());
+                wHeaderName = wCustomHeaderName.c_str();
             }
+            else if (header.second.id == http_header_id::user_agent)
+            {
+                foundUserAgent = true;
+            }
+
+            hr = m_hRequest->SetRequestHeader(wHeaderName, utf16_from_utf8(header.second.value.data(), header.second.value.size()).c_str());
+        }
+
+        if (!foundUserAgent)
+        {
+            m_hRequest->SetRequestHeader(L"User-Agent", L"libHttpClient/1.0.0.0");
         }
 
         hr = m_hRequest->SetCustomResponseStream(Microsoft::WRL::Make<http_response_stream>(httpTask).Get());
@@ -0,0 +1,1542 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "compression.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+static const uint16_t s_lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t s_lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t s_distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t s_distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t s_codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static const uint8_t GZIP_ID1 = 0x1f;
+static const uint8_t GZIP_ID2 = 0x8b;
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+static const uint8_t DEFLATE_METHOD = 8;
+
+class crc32_table
+{
+public:
+    crc32_table()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            m_table[i] = c;
+        }
+    }
+
+    uint32_t operator[](size_t i) const { return m_table[i]; }
+
+private:
+    uint32_t m_table[256];
+};
+
+static const crc32_table s_crc32Table;
+
+uint32_t http_crc32(_In_ uint32_t crc, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = s_crc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t http_adler32(_In_ uint32_t adler, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    const uint32_t ADLER_MOD = 65521;
+    const size_t ADLER_NMAX = 5552; // largest run that can't overflow 32 bits before the modulo
+
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0)
+    {
+        size_t run = MIN(size, ADLER_NMAX);
+        size -= run;
+        while (run-- > 0)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+    return (b << 16) | a;
+}
+
+static bool is_token(_In_z_ PCSTR value, _In_ size_t length, _In_z_ PCSTR token)
+{
+    size_t tokenLength = strlen(token);
+    if (length != tokenLength)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = value[i];
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != token[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+http_content_encoding http_content_encoding_from_header(_In_opt_z_ PCSTR headerValue)
+{
+    if (headerValue == nullptr)
+    {
+        return http_content_encoding::identity;
+    }
+
+    while (*headerValue == ' ' || *headerValue == '\t')
+    {
+        ++headerValue;
+    }
+
+    size_t length = strlen(headerValue);
+    while (length > 0 && (headerValue[length - 1] == ' ' || headerValue[length - 1] == '\t'))
+    {
+        --length;
+    }
+
+    if (length == 0 || is_token(headerValue, length, "identity"))
+    {
+        return http_content_encoding::identity;
+    }
+    if (is_token(headerValue, length, "gzip") || is_token(headerValue, length, "x-gzip"))
+    {
+        return http_content_encoding::gzip;
+    }
+    if (is_token(headerValue, length, "deflate"))
+    {
+        return http_content_encoding::deflate;
+    }
+
+    // Includes stacked codings such as "deflate, gzip" which servers don't send in practice
+    return http_content_encoding::unsupported;
+}
+
+bool http_inflater::huffman::build(_In_reads_(count) const uint8_t* lengths, _In_ uint32_t count)
+{
+    memset(counts, 0, sizeof(counts));
+    memset(fast, 0, sizeof(fast));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        counts[lengths[i]]++;
+    }
+    counts[0] = 0;
+
+    // Reject over-subscribed code sets.  Incomplete sets are allowed, decoding an unused
+    // code is caught in decode_symbol.
+    int32_t left = 1;
+    for (uint32_t len = 1; len < 16; len++)
+    {
+        left <<= 1;
+        left -= counts[len];
+        if (left < 0)
+        {
+            return false;
+        }
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (uint32_t len = 1; len < 15; len++)
+    {
+        offsets[len + 1] = offsets[len] + counts[len];
+    }
+
+    for (uint32_t symbol = 0; symbol < count; symbol++)
+    {
+        if (lengths[symbol] != 0)
+        {
+            symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+        }
+    }
+
+    // Canonical codes are assigned in order of length then symbol.  Codes are stored
+    // most significant bit first but read least significant bit first, so the fast table
+    // is indexed by the bit reversed code.
+    uint32_t code = 0;
+    uint32_t index = 0;
+    for (uint32_t len = 1; len <= fast_bits; len++)
+    {
+        for (uint32_t i = 0; i < counts[len]; i++, index++, code++)
+        {
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < len; bit++)
+            {
+                reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+            }
+
+            for (uint32_t entry = reversed; entry < (1u << fast_bits); entry += (1u << len))
+            {
+                fast[entry] = static_cast<uint16_t>((len << 12) | symbols[index]);
+            }
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
+
+http_inflater::http_inflater(_In_ http_content_encoding encoding) :
+    m_encoding(encoding),
+    m_state(state::header),
+    m_finalBlock(false),
+    m_zlibWrapped(false),
+    m_storedRemaining(0),
+    m_inputPos(0),
+    m_bitBuffer(0),
+    m_bitCount(0),
+    m_outputStart(0),
+    m_outputSize(0),
+    m_checksum(0)
+{
+    if (encoding != http_content_encoding::gzip && encoding != http_content_encoding::deflate && encoding != http_content_encoding::deflate_raw)
+    {
+        m_state = state::error;
+    }
+}
+
+bool http_inflater::need_bits(_In_ uint32_t count)
+{
+    while (m_bitCount < count)
+    {
+        if (m_inputPos == m_input.size())
+        {
+            return false;
+        }
+        m_bitBuffer |= static_cast<uint32_t>(m_input[m_inputPos++]) << m_bitCount;
+        m_bitCount += 8;
+    }
+    return true;
+}
+
+uint32_t http_inflater::take_bits(_In_ uint32_t count)
+{
+    uint32_t value = m_bitBuffer & ((1u << count) - 1);
+    m_bitBuffer >>= count;
+    m_bitCount -= count;
+    return value;
+}
+
+// Returns the symbol, -1 if more input is needed or -2 for an invalid code
+int32_t http_inflater::decode_symbol(_In_ const huffman& table)
+{
+    if (need_bits(huffman::fast_bits))
+    {
+        uint16_t entry = table.fast[m_bitBuffer & ((1u << huffman::fast_bits) - 1)];
+        if (entry != 0)
+        {
+            take_bits(entry >> 12);
+            return entry & 0x0FFF;
+        }
+    }
+
+    // Long code, or the stream is ending and fewer than fast_bits bits are left
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (uint32_t len = 1; len < 16; len++)
+    {
+        if (!need_bits(len))
+        {
+            return -1;
+        }
+
+        code |= static_cast<int32_t>((m_bitBuffer >> (len - 1)) & 1);
+        int32_t count = table.counts[len];
+        if (code - count < first)
+        {
+            take_bits(len);
+            return table.symbols[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -2;
+}
+
+http_inflater::result http_inflater::read_header()
+{
+    if (m_encoding == http_content_encoding::deflate_raw)
+    {
+        return result::ok;
+    }
+
+    if (m_encoding == http_content_encoding::deflate)
+    {
+        // RFC 2616 says deflate means a zlib stream but some servers send raw deflate data
+        if (!need_bits(16))
+        {
+            return result::need_input;
+        }
+
+        uint32_t cmf = m_bitBuffer & 0xFF;
+        uint32_t flg = (m_bitBuffer >> 8) & 0xFF;
+        if ((cmf & 0x0F) == DEFLATE_METHOD && (cmf >> 4) <= 7 && ((cmf << 8) | flg) % 31 == 0)
+        {
+            if (flg & 0x20)
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: zlib preset dictionaries are not supported");
+                return result::error;
+            }
+            take_bits(16);
+            m_zlibWrapped = true;
+            m_checksum = 1;
+        }
+        return result::ok;
+    }
+
+    uint8_t fixedHeader[10];
+    for (auto& b : fixedHeader)
+    {
+        if (!need_bits(8))
+        {
+            return result::need_input;
+        }
+        b = static_cast<uint8_t>(take_bits(8));
+    }
+
+    if (fixedHeader[0] != GZIP_ID1 || fixedHeader[1] != GZIP_ID2 || fixedHeader[2] != DEFLATE_METHOD)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid gzip header");
+        return result::error;
+    }
+
+    uint8_t flags = fixedHeader[3];
+    if (flags & GZIP_FEXTRA)
+    {
+        if (!need_bits(16))
+        {
+            return result::need_input;
+        }
+        uint32_t extraLength = take_bits(16);
+        while (extraLength-- > 0)
+        {
+            if (!need_bits(8))
+            {
+                return result::need_input;
+            }
+            take_bits(8);
+        }
+    }
+
+    for (uint8_t stringFlag : { GZIP_FNAME, GZIP_FCOMMENT })
+    {
+        if (flags & stringFlag)
+        {
+            for (;;)
+            {
+                if (!need_bits(8))
+                {
+                    return result::need_input;
+                }
+                if (take_bits(8) == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (flags & GZIP_FHCRC)
+    {
+        if (!need_bits(16))
+        {
+            return result::need_input;
+        }
+        take_bits(16);
+    }
+
+    return result::ok;
+}
+
+http_inflater::result http_inflater::read_block_header()
+{
+    if (!need_bits(3))
+    {
+        return result::need_input;
+    }
+    m_finalBlock = take_bits(1) != 0;
+    uint32_t type = take_bits(2);
+
+    switch (type)
+    {
+        case 0:
+        {
+            take_bits(m_bitCount & 7);
+            if (!need_bits(32))
+            {
+                return result::need_input;
+            }
+            uint32_t length = take_bits(16);
+            uint32_t lengthComplement = take_bits(16);
+            if (length != (~lengthComplement & 0xFFFF))
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid stored block length");
+                return result::error;
+            }
+            m_storedRemaining = length;
+            m_state = state::stored;
+            return result::ok;
+        }
+
+        case 1:
+        {
+            uint8_t lengths[288 + 30];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+            m_litLen.build(lengths, 288);
+            m_dist.build(lengths + 288, 30);
+            m_state = state::codes;
+            return result::ok;
+        }
+
+        case 2:
+        {
+            result tablesResult = read_dynamic_tables();
+            if (tablesResult == result::ok)
+            {
+                m_state = state::codes;
+            }
+            return tablesResult;
+        }
+
+        default:
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid block type");
+            return result::error;
+    }
+}
+
+// Stored data is copied through as it arrives rather than waiting for the whole block
+http_inflater::result http_inflater::read_stored(_Inout_ http_arena_string& output)
+{
+    // Whole bytes may still be sitting in the bit buffer
+    while (m_storedRemaining > 0 && m_bitCount >= 8)
+    {
+        output.push_back(static_cast<char>(take_bits(8)));
+        --m_storedRemaining;
+    }
+
+    size_t available = MIN(m_input.size() - m_inputPos, static_cast<size_t>(m_storedRemaining));
+    if (available > 0)
+    {
+        output.append(reinterpret_cast<const char*>(&m_input[m_inputPos]), available);
+        m_inputPos += available;
+        m_storedRemaining -= static_cast<uint32_t>(available);
+    }
+
+    if (m_storedRemaining > 0)
+    {
+        return result::need_input;
+    }
+
+    m_state = m_finalBlock ? state::trailer : state::block_header;
+    return result::ok;
+}
+
+http_inflater::result http_inflater::read_dynamic_tables()
+{
+    if (!need_bits(14))
+    {
+        return result::need_input;
+    }
+    uint32_t litLenCount = take_bits(5) + 257;
+    uint32_t distCount = take_bits(5) + 1;
+    uint32_t codeLengthCount = take_bits(4) + 4;
+    if (litLenCount > 286 || distCount > 30)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid dynamic block header");
+        return result::error;
+    }
+
+    uint8_t lengths[286 + 30] = {};
+    for (uint32_t i = 0; i < codeLengthCount; i++)
+    {
+        if (!need_bits(3))
+        {
+            return result::need_input;
+        }
+        lengths[s_codeLengthOrder[i]] = static_cast<uint8_t>(take_bits(3));
+    }
+
+    huffman codeLengths;
+    if (!codeLengths.build(lengths, 19))
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid code length codes");
+        return result::error;
+    }
+
+    uint32_t index = 0;
+    while (index < litLenCount + distCount)
+    {
+        int32_t symbol = decode_symbol(codeLengths);
+        if (symbol == -1)
+        {
+            return result::need_input;
+        }
+        if (symbol < 0)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid code length code");
+            return result::error;
+        }
+
+        if (symbol < 16)
+        {
+            lengths[index++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t repeatLength = 0;
+        uint32_t repeatCount = 0;
+        if (symbol == 16)
+        {
+            if (index == 0)
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: repeat with no previous length");
+                return result::error;
+            }
+            if (!need_bits(2))
+            {
+                return result::need_input;
+            }
+            repeatLength = lengths[index - 1];
+            repeatCount = 3 + take_bits(2);
+        }
+        else if (symbol == 17)
+        {
+            if (!need_bits(3))
+            {
+                return result::need_input;
+            }
+            repeatCount = 3 + take_bits(3);
+        }
+        else
+        {
+            if (!need_bits(7))
+            {
+                return result::need_input;
+            }
+            repeatCount = 11 + take_bits(7);
+        }
+
+        if (index + repeatCount > litLenCount + distCount)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: code lengths overflow");
+            return result::error;
+        }
+        while (repeatCount-- > 0)
+        {
+            lengths[index++] = repeatLength;
+        }
+    }
+
+    if (lengths[256] == 0 ||
+        !m_litLen.build(lengths, litLenCount) ||
+        !m_dist.build(lengths + litLenCount, distCount))
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid literal/length or distance codes");
+        return result::error;
+    }
+
+    return result::ok;
+}
+
+http_inflater::result http_inflater::read_codes(_Inout_ http_arena_string& output)
+{
+    for (;;)
+    {
+        // Output is only written once a whole symbol has been read so running out of
+        // input just rewinds to the start of the symbol
+        size_t inputPos = m_inputPos;
+        uint32_t bitBuffer = m_bitBuffer;
+        uint32_t bitCount = m_bitCount;
+
+        int32_t symbol = decode_symbol(m_litLen);
+        if (symbol == -1)
+        {
+            break;
+        }
+        if (symbol < 0)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid literal/length code");
+            return result::error;
+        }
+
+        if (symbol < 256)
+        {
+            output.push_back(static_cast<char>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+        {
+            m_state = m_finalBlock ? state::trailer : state::block_header;
+            return result::ok;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid length symbol");
+            return result::error;
+        }
+        if (!need_bits(s_lengthExtra[symbol]))
+        {
+            m_inputPos = inputPos;
+            m_bitBuffer = bitBuffer;
+            m_bitCount = bitCount;
+            break;
+        }
+        size_t length = s_lengthBase[symbol] + take_bits(s_lengthExtra[symbol]);
+
+        symbol = decode_symbol(m_dist);
+        if (symbol == -1 || (symbol >= 0 && symbol < 30 && !need_bits(s_distExtra[symbol])))
+        {
+            m_inputPos = inputPos;
+            m_bitBuffer = bitBuffer;
+            m_bitCount = bitCount;
+            break;
+        }
+        if (symbol < 0 || symbol >= 30)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: invalid distance code");
+            return result::error;
+        }
+        size_t distance = s_distBase[symbol] + take_bits(s_distExtra[symbol]);
+        if (distance > output.size() - m_outputStart)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: distance too far back");
+            return result::error;
+        }
+
+        // The source and destination overlap when the distance is shorter than the length.  What
+        // is copied then repeats every distance bytes, so each pass can copy all it has so far.
+        size_t from = output.size() - distance;
+        while (length > 0)
+        {
+            size_t count = MIN(length, output.size() - from);
+            output.append(output, from, count);
+            length -= count;
+        }
+    }
+
+    return result::need_input;
+}
+
+http_inflater::result http_inflater::read_trailer()
+{
+    take_bits(m_bitCount & 7);
+
+    uint32_t trailerLength = (m_encoding == http_content_encoding::gzip) ? 8 : (m_zlibWrapped ? 4 : 0);
+    uint8_t trailer[8];
+    for (uint32_t i = 0; i < trailerLength; i++)
+    {
+        if (!need_bits(8))
+        {
+            return result::need_input;
+        }
+        trailer[i] = static_cast<uint8_t>(take_bits(8));
+    }
+
+    if (m_encoding == http_content_encoding::gzip)
+    {
+        uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uint32_t>(trailer[3]) << 24);
+        uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | (static_cast<uint32_t>(trailer[7]) << 24);
+        if (crc != m_checksum || size != static_cast<uint32_t>(m_outputSize))
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: gzip CRC or size mismatch");
+            return result::error;
+        }
+    }
+    else if (m_zlibWrapped)
+    {
+        uint32_t adler = (static_cast<uint32_t>(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+        if (adler != m_checksum)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: zlib checksum mismatch");
+            return result::error;
+        }
+    }
+
+    return result::ok;
+}
+
+uint32_t http_inflater::update_checksum(
+    _In_ uint32_t checksum,
+    _In_ const http_arena_string& output,
+    _In_ size_t from
+    ) const
+{
+    if (m_encoding == http_content_encoding::deflate_raw)
+    {
+        return checksum;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(output.data()) + from;
+    size_t size = output.size() - from;
+    return (m_encoding == http_content_encoding::gzip) ? http_crc32(checksum, data, size) : http_adler32(checksum, data, size);
+}
+
+HC_RESULT http_inflater::write(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Inout_ http_arena_string& output
+    )
+{
+    if (m_state == state::error)
+    {
+        return HC_E_FAIL;
+    }
+    if (m_state == state::done || size == 0)
+    {
+        return HC_OK;
+    }
+
+    if (m_state == state::header)
+    {
+        m_outputStart = output.size();
+    }
+    else if (output.size() != m_outputStart + m_outputSize)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_inflater: output buffer changed between writes");
+        m_state = state::error;
+        return HC_E_FAIL;
+    }
+
+    m_input.insert(m_input.end(), data, data + size);
+    size_t outputSize = output.size();
+
+    result status = result::ok;
+    while (status == result::ok && m_state != state::done)
+    {
+        // Headers and trailers are small so they are simply read again from the
+        // start if the input runs out part way through
+        size_t inputPos = m_inputPos;
+        uint32_t bitBuffer = m_bitBuffer;
+        uint32_t bitCount = m_bitCount;
+
+        switch (m_state)
+        {
+            case state::header:
+                status = read_header();
+                if (status == result::ok)
+                {
+                    m_state = state::block_header;
+                }
+                break;
+
+            case state::block_header: status = read_block_header(); break;
+            case state::stored: status = read_stored(output); break;
+            case state::codes: status = read_codes(output); break;
+
+            case state::trailer:
+                // The trailer checksum covers everything up to here
+                m_checksum = update_checksum(m_checksum, output, outputSize);
+                m_outputSize += output.size() - outputSize;
+                outputSize = output.size();
+
+                status = read_trailer();
+                if (status == result::ok)
+                {
+                    m_state = state::done;
+                }
+                break;
+
+            default:
+                status = result::error;
+                break;
+        }
+
+        if (status == result::need_input && m_state != state::stored && m_state != state::codes)
+        {
+            m_inputPos = inputPos;
+            m_bitBuffer = bitBuffer;
+            m_bitCount = bitCount;
+        }
+    }
+
+    m_checksum = update_checksum(m_checksum, output, outputSize);
+    m_outputSize += output.size() - outputSize;
+
+    // Drop the input that has been fully decoded
+    m_input.erase(m_input.begin(), m_input.begin() + m_inputPos);
+    m_inputPos = 0;
+
+    if (status == result::error)
+    {
+        m_state = state::error;
+        return HC_E_FAIL;
+    }
+
+    return HC_OK;
+}
+
+void http_inflater::discard_output(_Inout_ http_arena_string& output, _In_ size_t keep)
+{
+    size_t written = output.size() - m_outputStart;
+    if (written > keep)
+    {
+        output.erase(m_outputStart, written - keep);
+    }
+    m_outputSize = output.size() - m_outputStart;
+}
+
+void http_inflater::restart()
+{
+    if (m_state == state::done)
+    {
+        m_state = state::block_header;
+        m_finalBlock = false;
+        m_input.clear();
+        m_inputPos = 0;
+        m_bitBuffer = 0;
+        m_bitCount = 0;
+    }
+}
+
+static const uint32_t DEFLATE_WINDOW_BITS = 15;
+static const uint32_t DEFLATE_MIN_WINDOW_BITS = 8;
+static const uint32_t DEFLATE_MIN_MATCH = 3;
+static const uint32_t DEFLATE_MAX_MATCH = 258;
+static const uint32_t DEFLATE_MAX_CODE_LENGTH = 15;
+static const uint32_t DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH = 7;
+static const size_t DEFLATE_SYMBOLS_PER_BLOCK = 16 * 1024;
+static const uint32_t DEFLATE_END_OF_BLOCK = 256;
+
+// Maps match lengths and distances to their deflate symbols
+class deflate_tables
+{
+public:
+    deflate_tables()
+    {
+        for (uint32_t symbol = 0; symbol < 29; symbol++)
+        {
+            uint32_t count = (symbol == 28) ? 1 : (1u << s_lengthExtra[symbol]);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                lengthSymbol[s_lengthBase[symbol] + i] = static_cast<uint8_t>(symbol);
+            }
+        }
+
+        for (uint32_t symbol = 0; symbol < 30; symbol++)
+        {
+            for (uint32_t i = 0; i < (1u << s_distExtra[symbol]); i++)
+            {
+                uint32_t distance = s_distBase[symbol] + i;
+                distSymbol[dist_index(distance)] = static_cast<uint8_t>(symbol);
+            }
+        }
+    }
+
+    // Distances above 256 use codes with at least 7 extra bits so they are looked up by distance / 128
+    static uint32_t dist_index(_In_ uint32_t distance)
+    {
+        return (distance <= 256) ? distance - 1 : 256 + ((distance - 1) >> 7);
+    }
+
+    uint8_t lengthSymbol[DEFLATE_MAX_MATCH + 1];
+    uint8_t distSymbol[512];
+};
+
+static const deflate_tables s_deflateTables;
+
+// Builds Huffman code lengths no longer than maxLength.  Frequencies are halved and the
+// tree rebuilt in the rare case the optimal tree is too deep.
+static void build_code_lengths(
+    _In_reads_(count) const uint32_t* frequencies,
+    _In_ uint32_t count,
+    _In_ uint32_t maxLength,
+    _Out_writes_(count) uint8_t* lengths
+    )
+{
+    const uint32_t MAX_SYMBOLS = 286;
+    uint32_t weight[2 * MAX_SYMBOLS];
+    uint16_t parent[2 * MAX_SYMBOLS];
+    uint16_t heap[MAX_SYMBOLS];
+    uint16_t leaf[MAX_SYMBOLS];
+
+    memset(lengths, 0, count);
+    uint32_t leafCount = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        weight[i] = frequencies[i];
+        if (frequencies[i] != 0)
+        {
+            leaf[leafCount++] = static_cast<uint16_t>(i);
+        }
+    }
+
+    if (leafCount == 0)
+    {
+        return;
+    }
+    if (leafCount == 1)
+    {
+        lengths[leaf[0]] = 1;
+        return;
+    }
+
+    for (;;)
+    {
+        // Min heap of node indices ordered by weight
+        auto less = [&weight](uint16_t a, uint16_t b) { return weight[a] < weight[b]; };
+        auto sift_down = [&](uint32_t i, uint32_t heapSize)
+        {
+            for (;;)
+            {
+                uint32_t smallest = i;
+                uint32_t left = 2 * i + 1;
+                uint32_t right = left + 1;
+                if (left < heapSize && less(heap[left], heap[smallest])) smallest = left;
+                if (right < heapSize && less(heap[right], heap[smallest])) smallest = right;
+                if (smallest == i) break;
+                std::swap(heap[i], heap[smallest]);
+                i = smallest;
+            }
+        };
+
+        uint32_t heapSize = leafCount;
+        for (uint32_t i = 0; i < leafCount; i++)
+        {
+            heap[i] = leaf[i];
+        }
+        for (uint32_t i = heapSize / 2; i-- > 0;)
+        {
+            sift_down(i, heapSize);
+        }
+
+        // Internal nodes are numbered after the symbols so every parent has a higher index than its children
+        uint32_t next = count;
+        while (heapSize > 1)
+        {
+            uint16_t a = heap[0];
+            heap[0] = heap[--heapSize];
+            sift_down(0, heapSize);
+            uint16_t b = heap[0];
+
+            weight[next] = weight[a] + weight[b];
+            parent[a] = static_cast<uint16_t>(next);
+            parent[b] = static_cast<uint16_t>(next);
+            heap[0] = static_cast<uint16_t>(next);
+            sift_down(0, heapSize);
+            next++;
+        }
+
+        uint32_t root = next - 1;
+        uint8_t depth[2 * MAX_SYMBOLS];
+        depth[root] = 0;
+        for (uint32_t node = root; node-- > count;)
+        {
+            depth[node] = static_cast<uint8_t>(depth[parent[node]] + 1);
+        }
+
+        uint32_t longest = 0;
+        for (uint32_t i = 0; i < leafCount; i++)
+        {
+            uint32_t symbol = leaf[i];
+            uint32_t length = depth[parent[symbol]] + 1u;
+            lengths[symbol] = static_cast<uint8_t>(MIN(length, 255u));
+            if (length > longest)
+            {
+                longest = length;
+            }
+        }
+
+        if (longest <= maxLength)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < leafCount; i++)
+        {
+            weight[leaf[i]] = (weight[leaf[i]] + 1) / 2;
+        }
+    }
+}
+
+void http_deflater::build_codes(
+    _In_reads_(count) const uint8_t* lengths,
+    _In_ uint32_t count,
+    _Out_writes_(count) code* codes
+    )
+{
+    uint32_t lengthCounts[16] = {};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        lengthCounts[lengths[i]]++;
+    }
+    lengthCounts[0] = 0;
+
+    uint32_t nextCode[16] = {};
+    uint32_t value = 0;
+    for (uint32_t len = 1; len < 16; len++)
+    {
+        value = (value + lengthCounts[len - 1]) << 1;
+        nextCode[len] = value;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t len = lengths[i];
+        codes[i].length = static_cast<uint8_t>(len);
+        codes[i].bits = 0;
+        if (len != 0)
+        {
+            uint32_t canonical = nextCode[len]++;
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < len; bit++)
+            {
+                reversed |= ((canonical >> bit) & 1) << (len - 1 - bit);
+            }
+            codes[i].bits = static_cast<uint16_t>(reversed);
+        }
+    }
+}
+
+http_deflater::http_deflater(_In_ HC_COMPRESSION_LEVEL level) :
+    m_maxChain(0),
+    m_niceLength(0),
+    m_lazy(false),
+    m_windowBits(DEFLATE_WINDOW_BITS),
+    m_hashBits(DEFLATE_WINDOW_BITS),
+    m_contextTakeover(false),
+    m_output(nullptr),
+    m_bitBuffer(0),
+    m_bitCount(0)
+{
+    switch (level)
+    {
+        case HC_COMPRESSION_LEVEL_LOW: m_maxChain = 8; m_niceLength = 32; m_lazy = false; break;
+        case HC_COMPRESSION_LEVEL_HIGH: m_maxChain = 1024; m_niceLength = DEFLATE_MAX_MATCH; m_lazy = true; break;
+        default: m_maxChain = 64; m_niceLength = 128; m_lazy = true; break;
+    }
+}
+
+uint32_t http_deflater::hash(_In_ const uint8_t* p) const
+{
+    uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (value * 2654435761u) >> (32 - m_hashBits);
+}
+
+void http_deflater::insert(_In_ const uint8_t* data, _In_ size_t pos)
+{
+    uint32_t h = hash(data + pos);
+    m_prev[pos & ((1u << m_windowBits) - 1)] = m_head[h];
+    m_head[h] = static_cast<uint32_t>(pos + 1);
+}
+
+uint32_t http_deflater::find_match(
+    _In_ const uint8_t* data,
+    _In_ size_t size,
+    _In_ size_t pos,
+    _Out_ uint32_t* distance
+    ) const
+{
+    *distance = 0;
+    uint32_t bestLength = 0;
+    uint32_t maxLength = static_cast<uint32_t>(MIN(size - pos, static_cast<size_t>(DEFLATE_MAX_MATCH)));
+    if (maxLength < DEFLATE_MIN_MATCH)
+    {
+        return 0;
+    }
+
+    const uint8_t* current = data + pos;
+    uint32_t candidate = m_head[hash(current)];
+    for (uint32_t chain = m_maxChain; candidate != 0 && chain > 0; chain--)
+    {
+        size_t matchPos = candidate - 1;
+        if (pos - matchPos > (1u << m_windowBits))
+        {
+            break;
+        }
+
+        const uint8_t* match = data + matchPos;
+        if (match[bestLength] == current[bestLength] && match[0] == current[0])
+        {
+            uint32_t length = 0;
+            while (length < maxLength && match[length] == current[length])
+            {
+                length++;
+            }
+
+            if (length > bestLength)
+            {
+                bestLength = length;
+                *distance = static_cast<uint32_t>(pos - matchPos);
+                if (length >= m_niceLength || length == maxLength)
+                {
+                    break;
+                }
+            }
+        }
+
+        // Slots are reused once the window wraps so stop if the chain stops going backwards
+        uint32_t next = m_prev[matchPos & ((1u << m_windowBits) - 1)];
+        if (next == 0 || next - 1 >= matchPos)
+        {
+            break;
+        }
+        candidate = next;
+    }
+
+    return (bestLength >= DEFLATE_MIN_MATCH) ? bestLength : 0;
+}
+
+void http_deflater::write_bits(_In_ uint32_t value, _In_ uint32_t count)
+{
+    m_bitBuffer |= static_cast<uint64_t>(value) << m_bitCount;
+    m_bitCount += count;
+    while (m_bitCount >= 8)
+    {
+        m_output->push_back(static_cast<uint8_t>(m_bitBuffer));
+        m_bitBuffer >>= 8;
+        m_bitCount -= 8;
+    }
+}
+
+void http_deflater::align_to_byte()
+{
+    if (m_bitCount > 0)
+    {
+        write_bits(0, 8 - m_bitCount);
+    }
+}
+
+void http_deflater::write_stored_block(
+    _In_reads_bytes_(blockSize) const uint8_t* blockData,
+    _In_ size_t blockSize,
+    _In_ bool finalBlock
+    )
+{
+    do
+    {
+        uint32_t length = static_cast<uint32_t>(MIN(blockSize, static_cast<size_t>(0xFFFF)));
+        blockSize -= length;
+        write_bits((finalBlock && blockSize == 0) ? 1 : 0, 1);
+        write_bits(0, 2);
+        align_to_byte();
+        write_bits(length, 16);
+        write_bits(~length & 0xFFFF, 16);
+        m_output->insert(m_output->end(), blockData, blockData + length);
+        blockData += length;
+    } while (blockSize > 0);
+}
+
+void http_deflater::write_symbols(_In_reads_(286) const code* litLen, _In_reads_(30) const code* dist)
+{
+    for (const auto& s : m_symbols)
+    {
+        if (s.distance == 0)
+        {
+            write_bits(litLen[s.litLen].bits, litLen[s.litLen].length);
+            continue;
+        }
+
+        uint32_t lengthSymbol = s_deflateTables.lengthSymbol[s.litLen];
+        write_bits(litLen[257 + lengthSymbol].bits, litLen[257 + lengthSymbol].length);
+        write_bits(s.litLen - s_lengthBase[lengthSymbol], s_lengthExtra[lengthSymbol]);
+
+        uint32_t distSymbol = s_deflateTables.distSymbol[deflate_tables::dist_index(s.distance)];
+        write_bits(dist[distSymbol].bits, dist[distSymbol].length);
+        write_bits(s.distance - s_distBase[distSymbol], s_distExtra[distSymbol]);
+    }
+    write_bits(litLen[DEFLATE_END_OF_BLOCK].bits, litLen[DEFLATE_END_OF_BLOCK].length);
+}
+
+void http_deflater::flush_block(
+    _In_reads_bytes_(blockSize) const uint8_t* blockData,
+    _In_ size_t blockSize,
+    _In_ bool finalBlock
+    )
+{
+    uint32_t litLenFreq[286] = {};
+    uint32_t distFreq[30] = {};
+    uint64_t extraBits = 0;
+    for (const auto& s : m_symbols)
+    {
+        if (s.distance == 0)
+        {
+            litLenFreq[s.litLen]++;
+            continue;
+        }
+        uint32_t lengthSymbol = s_deflateTables.lengthSymbol[s.litLen];
+        uint32_t distSymbol = s_deflateTables.distSymbol[deflate_tables::dist_index(s.distance)];
+        litLenFreq[257 + lengthSymbol]++;
+        distFreq[distSymbol]++;
+        extraBits += s_lengthExtra[lengthSymbol] + s_distExtra[distSymbol];
+    }
+    litLenFreq[DEFLATE_END_OF_BLOCK] = 1;
+
+    // Keep every code complete with at least two symbols, some decoders reject a lone code
+    auto ensure_two_symbols = [](uint32_t* frequencies, uint32_t count)
+    {
+        uint32_t used = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            used += (frequencies[i] != 0) ? 1 : 0;
+        }
+        for (uint32_t i = 0; used < 2; i++)
+        {
+            if (frequencies[i] == 0)
+            {
+                frequencies[i] = 1;
+                used++;
+            }
+        }
+    };
+    ensure_two_symbols(litLenFreq, 286);
+    ensure_two_symbols(distFreq, 30);
+
+    // The fixed code (RFC 1951 3.2.6) covers literal/length symbols 286 and 287 even though they
+    // never occur, and leaving them out shifts every 9 bit code
+    uint8_t fixedLengths[288 + 30];
+    memset(fixedLengths, 8, 144);
+    memset(fixedLengths + 144, 9, 112);
+    memset(fixedLengths + 256, 7, 24);
+    memset(fixedLengths + 280, 8, 8);
+    memset(fixedLengths + 288, 5, 30);
+
+    uint8_t lengths[286 + 30];
+    build_code_lengths(litLenFreq, 286, DEFLATE_MAX_CODE_LENGTH, lengths);
+    build_code_lengths(distFreq, 30, DEFLATE_MAX_CODE_LENGTH, lengths + 286);
+
+    uint32_t litLenCount = 286;
+    while (litLenCount > 257 && lengths[litLenCount - 1] == 0)
+    {
+        litLenCount--;
+    }
+    uint32_t distCount = 30;
+    while (distCount > 1 && lengths[286 + distCount - 1] == 0)
+    {
+        distCount--;
+    }
+
+    // Run length encode the code lengths with symbols 16 (repeat previous), 17 and 18 (repeat zero)
+    uint8_t combined[286 + 30];
+    memcpy(combined, lengths, litLenCount);
+    memcpy(combined + litLenCount, lengths + 286, distCount);
+    uint32_t combinedCount = litLenCount + distCount;
+
+    struct code_length_run
+    {
+        uint8_t symbol;
+        uint8_t extra;
+    };
+    code_length_run runs[286 + 30];
+    uint32_t runCount = 0;
+    uint32_t codeLengthFreq[19] = {};
+    for (uint32_t i = 0; i < combinedCount;)
+    {
+        uint8_t value = combined[i];
+        uint32_t run = 1;
+        while (i + run < combinedCount && combined[i + run] == value)
+        {
+            run++;
+        }
+        i += run;
+
+        if (value == 0)
+        {
+            while (run >= 11)
+            {
+                uint32_t n = MIN(run, 138u);
+                runs[runCount++] = { 18, static_cast<uint8_t>(n - 11) };
+                run -= n;
+            }
+            if (run >= 3)
+            {
+                runs[runCount++] = { 17, static_cast<uint8_t>(run - 3) };
+                run = 0;
+            }
+        }
+        else
+        {
+            runs[runCount++] = { value, 0 };
+            run--;
+            while (run >= 3)
+            {
+                uint32_t n = MIN(run, 6u);
+                runs[runCount++] = { 16, static_cast<uint8_t>(n - 3) };
+                run -= n;
+            }
+        }
+        while (run-- > 0)
+        {
+            runs[runCount++] = { value, 0 };
+        }
+    }
+    for (uint32_t i = 0; i < runCount; i++)
+    {
+        codeLengthFreq[runs[i].symbol]++;
+    }
+
+    uint8_t codeLengthLengths[19];
+    build_code_lengths(codeLengthFreq, 19, DEFLATE_MAX_CODE_LENGTH_CODE_LENGTH, codeLengthLengths);
+    uint32_t codeLengthCount = 19;
+    while (codeLengthCount > 4 && codeLengthLengths[s_codeLengthOrder[codeLengthCount - 1]] == 0)
+    {
+        codeLengthCount--;
+    }
+
+    uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount + extraBits;
+    uint64_t fixedBits = 3 + extraBits;
+    static const uint8_t codeLengthExtra[19] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7 };
+    for (uint32_t i = 0; i < 19; i++)
+    {
+        dynamicBits += static_cast<uint64_t>(codeLengthFreq[i]) * (codeLengthLengths[i] + codeLengthExtra[i]);
+    }
+    for (uint32_t i = 0; i < 286; i++)
+    {
+        dynamicBits += static_cast<uint64_t>(litLenFreq[i]) * lengths[i];
+        fixedBits += static_cast<uint64_t>(litLenFreq[i]) * fixedLengths[i];
+    }
+    for (uint32_t i = 0; i < 30; i++)
+    {
+        dynamicBits += static_cast<uint64_t>(distFreq[i]) * lengths[286 + i];
+        fixedBits += static_cast<uint64_t>(distFreq[i]) * fixedLengths[288 + i];
+    }
+    uint64_t storedBits = 8 * (static_cast<uint64_t>(blockSize) + 5 * (blockSize / 0xFFFF + 1)) + 7;
+
+    if (storedBits <= dynamicBits && storedBits <= fixedBits)
+    {
+        write_stored_block(blockData, blockSize, finalBlock);
+    }
+    else if (fixedBits <= dynamicBits)
+    {
+        code litLen[288];
+        code dist[30];
+        build_codes(fixedLengths, 288, litLen);
+        build_codes(fixedLengths + 288, 30, dist);
+        write_bits(finalBlock ? 1 : 0, 1);
+        write_bits(1, 2);
+        write_symbols(litLen, dist);
+    }
+    else
+    {
+        code litLen[286];
+        code dist[30];
+        code codeLengthCodes[19];
+        build_codes(lengths, 286, litLen);
+        build_codes(lengths + 286, 30, dist);
+        build_codes(codeLengthLengths, 19, codeLengthCodes);
+
+        write_bits(finalBlock ? 1 : 0, 1);
+        write_bits(2, 2);
+        write_bits(litLenCount - 257, 5);
+        write_bits(distCount - 1, 5);
+        write_bits(codeLengthCount - 4, 4);
+        for (uint32_t i = 0; i < codeLengthCount; i++)
+        {
+            write_bits(codeLengthLengths[s_codeLengthOrder[i]], 3);
+        }
+        for (uint32_t i = 0; i < runCount; i++)
+        {
+            const code& c = codeLengthCodes[runs[i].symbol];
+            write_bits(c.bits, c.length);
+            write_bits(runs[i].extra, codeLengthExtra[runs[i].symbol]);
+        }
+        write_symbols(litLen, dist);
+    }
+
+    m_symbols.clear();
+}
+
+// Compresses data[start, size) as one or more blocks.  Bytes before start are only matched against.
+void http_deflater::deflate_range(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t start,
+    _In_ size_t size,
+    _In_ bool finalBlock
+    )
+{
+    size_t blockStart = start;
+    size_t pos = start;
+    while (pos < size)
+    {
+        uint32_t distance = 0;
+        uint32_t length = find_match(data, size, pos, &distance);
+        if (size - pos >= DEFLATE_MIN_MATCH)
+        {
+            insert(data, pos);
+        }
+
+        // Lazy matching: emit a literal instead if the next position has a longer match
+        if (m_lazy && length != 0 && length < m_niceLength && pos + 1 < size)
+        {
+            uint32_t nextDistance = 0;
+            if (find_match(data, size, pos + 1, &nextDistance) > length)
+            {
+                length = 0;
+            }
+        }
+
+        if (length != 0)
+        {
+            m_symbols.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+            for (size_t i = pos + 1; i < pos + length && size - i >= DEFLATE_MIN_MATCH; i++)
+            {
+                insert(data, i);
+            }
+            pos += length;
+        }
+        else
+        {
+            m_symbols.push_back({ data[pos], 0 });
+            pos++;
+        }
+
+        if (m_symbols.size() >= DEFLATE_SYMBOLS_PER_BLOCK)
+        {
+            flush_block(data + blockStart, pos - blockStart, finalBlock && pos == size);
+            blockStart = pos;
+        }
+    }
+
+    if (blockStart < size || size == start || !m_symbols.empty())
+    {
+        flush_block(data + blockStart, size - blockStart, finalBlock);
+    }
+}
+
+HC_RESULT http_deflater::compress(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Inout_ http_internal_vector<uint8_t>& output
+    )
+{
+    if (data == nullptr && size > 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    m_head.assign(1u << m_hashBits, 0);
+    m_prev.assign(1u << m_windowBits, 0);
+    m_symbols.clear();
+    m_symbols.reserve(DEFLATE_SYMBOLS_PER_BLOCK);
+    m_output = &output;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+
+    static const uint8_t gzipHeader[10] = { GZIP_ID1, GZIP_ID2, DEFLATE_METHOD, 0, 0, 0, 0, 0, 0, 0xFF };
+    output.insert(output.end(), gzipHeader, gzipHeader + sizeof(gzipHeader));
+
+    deflate_range(data, 0, size, true);
+    align_to_byte();
+
+    uint32_t crc = http_crc32(0, data, size);
+    uint32_t isize = static_cast<uint32_t>(size);
+    for (uint32_t value : { crc, isize })
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            output.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    m_output = nullptr;
+    return HC_OK;
+}
+
+
+void http_deflater::set_message_window(_In_ uint32_t windowBits, _In_ bool contextTakeover)
+{
+    m_windowBits = (windowBits < DEFLATE_MIN_WINDOW_BITS) ? DEFLATE_MIN_WINDOW_BITS : MIN(windowBits, DEFLATE_WINDOW_BITS);
+    m_hashBits = m_windowBits;
+    m_contextTakeover = contextTakeover;
+    m_head.clear();
+    m_prev.clear();
+    m_history.clear();
+}
+
+// Keeps between one and two windows of history.  Positions move down by a whole number of windows
+// so their slots in m_prev stay the same; ones that fall off the front become empty.
+void http_deflater::slide_message_window()
+{
+    size_t windowSize = static_cast<size_t>(1) << m_windowBits;
+    if (m_history.size() < 2 * windowSize)
+    {
+        return;
+    }
+
+    size_t slide = ((m_history.size() - windowSize) / windowSize) * windowSize;
+    m_history.erase(m_history.begin(), m_history.begin() + slide);
+    for (auto* table : { &m_head, &m_prev })
+    {
+        for (auto& position : *table)
+        {
+            position = (position > slide) ? static_cast<uint32_t>(position - slide) : 0;
+        }
+    }
+}
+
+HC_RESULT http_deflater::compress_message(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Inout_ http_internal_vector<uint8_t>& output
+    )
+{
+    if (data == nullptr && size > 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (m_head.empty() || !m_contextTakeover)
+    {
+        m_head.assign(1u << m_hashBits, 0);
+        m_prev.assign(1u << m_windowBits, 0);
+    }
+    m_symbols.clear();
+    m_output = &output;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+
+    if (size > 0)
+    {
+        if (m_contextTakeover)
+        {
+            size_t start = m_history.size();
+            m_history.insert(m_history.end(), data, data + size);
+            deflate_range(m_history.data(), start, m_history.size(), false);
+            slide_message_window();
+        }
+        else
+        {
+            deflate_range(data, 0, size, false);
+        }
+    }
+
+    // The sync flush leaves the stream on a byte boundary, ready for the next message
+    write_stored_block(nullptr, 0, false);
+    output.resize(output.size() - 4);
+
+    m_output = nullptr;
+    return HC_OK;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
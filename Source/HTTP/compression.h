@@ -0,0 +1,191 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+enum class http_content_encoding : uint8_t
+{
+    identity,
+    gzip,
+    deflate,
+    deflate_raw,  // raw RFC 1951 data with no header or trailer, as WebSocket permessage-deflate sends
+    unsupported
+};
+
+// The most a compressed response body may decompress to.  Deflate can expand over 1000 times, so
+// without a limit a small response could exhaust memory.
+const size_t HTTP_MAX_DECOMPRESSED_BODY_SIZE = 64 * 1024 * 1024;
+
+// Parses a Content-Encoding header value.  A nullptr or empty value is identity.
+http_content_encoding http_content_encoding_from_header(_In_opt_z_ PCSTR headerValue);
+
+uint32_t http_crc32(_In_ uint32_t crc, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+uint32_t http_adler32(_In_ uint32_t adler, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+
+// Streaming RFC 1951 decoder for gzip (RFC 1952) and deflate (RFC 1950, or raw RFC 1951
+// as sent by some servers) content codings, and for raw deflate streams.
+//
+// Compressed data can be written in arbitrarily sized chunks as it arrives from the network.
+// Every complete symbol is decoded straight onto the end of the output buffer; input that
+// ends part way through a symbol or header is held back until the next write.  Back references
+// are resolved against the output buffer so the same buffer must be passed to every write.
+class http_inflater
+{
+public:
+    http_inflater(_In_ http_content_encoding encoding);
+
+    HC_RESULT write(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _Inout_ http_arena_string& output
+        );
+
+    // True once the end of the compressed stream and its trailer have been read
+    bool is_done() const { return m_state == state::done; }
+
+    // Drops all but the last keep bytes written to output.  Later back references can only reach
+    // what is kept, so a raw stream that carries a series of messages keeps its window size.
+    void discard_output(_Inout_ http_arena_string& output, _In_ size_t keep);
+
+    // Starts a new raw deflate stream once the last one has ended with a final block, dropping
+    // any input after it.  The output kept so far can still be referred back to.
+    void restart();
+
+private:
+    enum class state : uint8_t
+    {
+        header,
+        block_header,
+        stored,
+        codes,
+        trailer,
+        done,
+        error
+    };
+
+    enum class result : uint8_t
+    {
+        ok,
+        need_input,
+        error
+    };
+
+    struct huffman
+    {
+        static const uint32_t fast_bits = 9;
+
+        bool build(_In_reads_(count) const uint8_t* lengths, _In_ uint32_t count);
+
+        uint16_t counts[16];
+        uint16_t symbols[288];
+        uint16_t fast[1 << fast_bits]; // (code length << 12) | symbol, 0 when the code is longer than fast_bits
+    };
+
+    bool need_bits(_In_ uint32_t count);
+    uint32_t take_bits(_In_ uint32_t count);
+    int32_t decode_symbol(_In_ const huffman& table);
+
+    result read_header();
+    result read_block_header();
+    result read_stored(_Inout_ http_arena_string& output);
+    result read_dynamic_tables();
+    result read_codes(_Inout_ http_arena_string& output);
+    result read_trailer();
+    uint32_t update_checksum(_In_ uint32_t checksum, _In_ const http_arena_string& output, _In_ size_t from) const;
+
+    http_content_encoding m_encoding;
+    state m_state;
+    bool m_finalBlock;
+    bool m_zlibWrapped;
+    uint32_t m_storedRemaining;
+
+    http_internal_vector<uint8_t> m_input;
+    size_t m_inputPos;
+    uint32_t m_bitBuffer;
+    uint32_t m_bitCount;
+
+    size_t m_outputStart;
+    size_t m_outputSize;
+    uint32_t m_checksum;
+
+    huffman m_litLen;
+    huffman m_dist;
+};
+
+// One pass gzip (RFC 1952) encoder for request bodies, and raw deflate encoder for messages.
+//
+// Matches are found with hash chains over a 32KB window; the level trades chain length
+// and lazy matching for speed.  Each block is emitted as stored, fixed or dynamic
+// Huffman, whichever is smallest.
+class http_deflater
+{
+public:
+    http_deflater(_In_ HC_COMPRESSION_LEVEL level);
+
+    HC_RESULT compress(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _Inout_ http_internal_vector<uint8_t>& output
+        );
+
+    // Sets the window compress_message() uses, 2^windowBits bytes for windowBits from 8 to 15.
+    // With context takeover, matches can reach back into earlier messages.
+    void set_message_window(_In_ uint32_t windowBits, _In_ bool contextTakeover);
+
+    // Appends one message as raw deflate data (RFC 1951) ended by a sync flush, an empty stored
+    // block, so the stream carries on with the next message.  The 00 00 FF FF of that last block
+    // is left off, as WebSocket permessage-deflate (RFC 7692 7.2.1) sends it.
+    HC_RESULT compress_message(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _Inout_ http_internal_vector<uint8_t>& output
+        );
+
+private:
+    struct symbol
+    {
+        uint16_t litLen;   // literal byte, or match length when distance is non-zero
+        uint16_t distance;
+    };
+
+    struct code
+    {
+        uint16_t bits;     // bit reversed so it can be written least significant bit first
+        uint8_t length;
+    };
+
+    static void build_codes(_In_reads_(count) const uint8_t* lengths, _In_ uint32_t count, _Out_writes_(count) code* codes);
+
+    uint32_t hash(_In_ const uint8_t* p) const;
+    void insert(_In_ const uint8_t* data, _In_ size_t pos);
+    uint32_t find_match(_In_ const uint8_t* data, _In_ size_t size, _In_ size_t pos, _Out_ uint32_t* distance) const;
+    void deflate_range(_In_ const uint8_t* data, _In_ size_t start, _In_ size_t size, _In_ bool finalBlock);
+    void slide_message_window();
+
+    void flush_block(_In_ const uint8_t* blockData, _In_ size_t blockSize, _In_ bool finalBlock);
+    void write_stored_block(_In_ const uint8_t* blockData, _In_ size_t blockSize, _In_ bool finalBlock);
+    void write_symbols(_In_reads_(286) const code* litLen, _In_reads_(30) const code* dist);
+    void write_bits(_In_ uint32_t value, _In_ uint32_t count);
+    void align_to_byte();
+
+    uint32_t m_maxChain;
+    uint32_t m_niceLength;
+    bool m_lazy;
+    uint32_t m_windowBits;
+    uint32_t m_hashBits;
+    bool m_contextTakeover;
+
+    http_internal_vector<uint32_t> m_head;  // most recent position + 1 for each hash, 0 when empty
+    http_internal_vector<uint32_t> m_prev;  // previous position + 1 with the same hash, indexed by position within the window
+    http_internal_vector<symbol> m_symbols;
+    http_internal_vector<uint8_t> m_history;  // earlier messages, then the one being compressed
+
+    http_internal_vector<uint8_t>* m_output;
+    uint64_t m_bitBuffer;
+    uint32_t m_bitCount;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
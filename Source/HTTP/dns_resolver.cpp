@@ -0,0 +1,297 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include <algorithm>
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+#include "dns_resolver.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// getaddrinfo doesn't report the record TTL, so system lookups are cached for a fixed time
+const uint32_t DEFAULT_DNS_TTL_IN_SECONDS = 60;
+const uint32_t DEFAULT_NEGATIVE_DNS_TTL_IN_SECONDS = 10;
+
+// A host used this many times within its TTL is looked up again once 90% of the TTL has passed
+const uint32_t DNS_PREFETCH_MIN_HITS = 2;
+const uint32_t DNS_PREFETCH_TTL_PERCENT = 90;
+
+const uint32_t DNS_RESOLVER_THREAD_COUNT = 2;
+const size_t DNS_MAX_CACHE_ENTRIES = 256;
+
+http_dns_resolver::http_dns_resolver() :
+    m_lookupFunc(system_lookup),
+    m_stopping(false)
+{
+}
+
+http_dns_resolver::~http_dns_resolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+
+    // Don't leave anyone waiting on a lookup that will never finish
+    http_internal_vector<http_internal_string> noAddresses;
+    for (auto& entry : m_entries)
+    {
+        for (const auto& pending : entry.second.waiters)
+        {
+            complete(pending, HC_E_FAIL, noAddresses);
+        }
+    }
+}
+
+HC_RESULT http_dns_resolver::system_lookup(
+    _In_z_ PCSTR hostName,
+    _Inout_ http_internal_vector<http_internal_string>& addresses,
+    _Out_ uint32_t* ttlSeconds
+    )
+{
+    *ttlSeconds = 0;
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    int error = getaddrinfo(hostName, nullptr, &hints, &results);
+    if (error != 0)
+    {
+        HC_TRACE_WARNING(HTTPCLIENT, "http_dns_resolver: lookup of %s failed with %d", hostName, error);
+        return HC_E_FAIL;
+    }
+
+    for (addrinfo* result = results; result != nullptr; result = result->ai_next)
+    {
+        char address[NI_MAXHOST];
+        if (getnameinfo(result->ai_addr, static_cast<socklen_t>(result->ai_addrlen), address, sizeof(address), nullptr, 0, NI_NUMERICHOST) == 0 &&
+            std::find(addresses.begin(), addresses.end(), address) == addresses.end())
+        {
+            addresses.push_back(address);
+        }
+    }
+    freeaddrinfo(results);
+
+    return addresses.empty() ? HC_E_FAIL : HC_OK;
+}
+
+void http_dns_resolver::complete(
+    _In_ const waiter& completion,
+    _In_ HC_RESULT result,
+    _In_ const http_internal_vector<http_internal_string>& addresses
+    )
+{
+    http_internal_vector<PCSTR> addressStrings;
+    addressStrings.reserve(addresses.size());
+    for (const auto& address : addresses)
+    {
+        addressStrings.push_back(address.c_str());
+    }
+
+    try
+    {
+        completion.completionRoutine(
+            completion.context,
+            result,
+            static_cast<uint32_t>(addressStrings.size()),
+            addressStrings.empty() ? nullptr : addressStrings.data());
+    }
+    catch (...)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_dns_resolver: completion routine threw");
+    }
+}
+
+HC_RESULT http_dns_resolver::resolve(
+    _In_z_ PCSTR hostName,
+    _In_opt_ void* context,
+    _In_ HC_DNS_RESOLVE_COMPLETION_FUNC completionRoutine
+    )
+{
+    // Host names are case insensitive
+    http_internal_string key(hostName);
+    for (auto& c : key)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+
+    waiter completion;
+    completion.context = context;
+    completion.completionRoutine = completionRoutine;
+
+    HC_RESULT result;
+    http_internal_vector<http_internal_string> addresses;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_stopping)
+        {
+            return HC_E_FAIL;
+        }
+
+        cache_entry& entry = m_entries[key];
+        auto now = std::chrono::steady_clock::now();
+        if (!entry.hasResult || now >= entry.expires)
+        {
+            entry.waiters.push_back(completion);
+            if (!entry.lookupPending)
+            {
+                entry.lookupPending = true;
+                queue_lookup(key);
+            }
+            return HC_OK;
+        }
+
+        entry.hits++;
+        if (entry.result == HC_OK && !entry.lookupPending && entry.hits >= DNS_PREFETCH_MIN_HITS && now >= entry.prefetchAfter)
+        {
+            HC_TRACE_INFORMATION(HTTPCLIENT, "http_dns_resolver: prefetching %s", key.c_str());
+            entry.lookupPending = true;
+            queue_lookup(key);
+        }
+
+        result = entry.result;
+        addresses = entry.addresses;
+    }
+
+    complete(completion, result, addresses);
+    return HC_OK;
+}
+
+void http_dns_resolver::set_lookup_function(_In_opt_ http_dns_lookup_func lookupFunc)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_lookupFunc = (lookupFunc != nullptr) ? lookupFunc : system_lookup;
+    }
+    clear();
+}
+
+void http_dns_resolver::clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        if (it->second.lookupPending)
+        {
+            it->second.hasResult = false;
+            ++it;
+        }
+        else
+        {
+            it = m_entries.erase(it);
+        }
+    }
+}
+
+void http_dns_resolver::queue_lookup(_In_ const http_internal_string& hostName)
+{
+    // Called with m_lock held
+    m_queue.push(hostName);
+    if (m_threads.empty())
+    {
+        for (uint32_t i = 0; i < DNS_RESOLVER_THREAD_COUNT; i++)
+        {
+            m_threads.emplace_back([this]() { worker(); });
+        }
+    }
+    m_wake.notify_one();
+}
+
+void http_dns_resolver::trim()
+{
+    // Called with m_lock held.  Drops expired entries that nobody is waiting on.
+    if (m_entries.size() <= DNS_MAX_CACHE_ENTRIES)
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        if (!it->second.lookupPending && (!it->second.hasResult || now >= it->second.expires))
+        {
+            it = m_entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void http_dns_resolver::worker()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_stopping)
+        {
+            return;
+        }
+
+        http_internal_string hostName = m_queue.front();
+        m_queue.pop();
+        http_dns_lookup_func lookupFunc = m_lookupFunc;
+
+        lock.unlock();
+        HC_RESULT result = HC_E_FAIL;
+        uint32_t ttlSeconds = 0;
+        http_internal_vector<http_internal_string> addresses;
+        try
+        {
+            result = lookupFunc(hostName.c_str(), addresses, &ttlSeconds);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_dns_resolver: lookup of %s threw", hostName.c_str());
+        }
+        if (result != HC_OK)
+        {
+            addresses.clear();
+        }
+        if (ttlSeconds == 0)
+        {
+            ttlSeconds = (result == HC_OK) ? DEFAULT_DNS_TTL_IN_SECONDS : DEFAULT_NEGATIVE_DNS_TTL_IN_SECONDS;
+        }
+        lock.lock();
+
+        auto now = std::chrono::steady_clock::now();
+        cache_entry& entry = m_entries[hostName];
+        entry.result = result;
+        entry.addresses = addresses;
+        entry.expires = now + std::chrono::seconds(ttlSeconds);
+        entry.prefetchAfter = now + std::chrono::milliseconds(static_cast<uint64_t>(ttlSeconds) * DNS_PREFETCH_TTL_PERCENT * 10);
+        entry.hasResult = true;
+        entry.lookupPending = false;
+        entry.hits = 0;
+
+        http_internal_vector<waiter> waiters;
+        waiters.swap(entry.waiters);
+        trim();
+
+        HC_TRACE_INFORMATION(HTTPCLIENT, "http_dns_resolver: resolved %s to %u addresses, caching for %us",
+            hostName.c_str(), static_cast<uint32_t>(addresses.size()), ttlSeconds);
+
+        lock.unlock();
+        for (const auto& pending : waiters)
+        {
+            complete(pending, result, addresses);
+        }
+        lock.lock();
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Resolves a host name to numeric addresses.  ttlSeconds is how long the result may be cached,
+// or 0 to use the resolver's default for successful or failed lookups.
+typedef HC_RESULT (*http_dns_lookup_func)(
+    _In_z_ PCSTR hostName,
+    _Inout_ http_internal_vector<http_internal_string>& addresses,
+    _Out_ uint32_t* ttlSeconds
+    );
+
+// Asynchronous host name resolver with a TTL cache for HTTP providers.
+//
+// Lookups block in getaddrinfo, so they are run on the resolver's own threads rather than on
+// the thread driving the task queue.  Concurrent requests for the same host share one lookup.
+// Successful results are cached for their TTL and failures for a shorter negative TTL.  A host
+// that is used repeatedly is looked up again in the background shortly before its entry
+// expires, so hot hosts never wait on a cold lookup.
+//
+// The resolver doesn't start the socket library itself; callers start it through
+// http_singleton::start_sockets() before the first lookup.
+class http_dns_resolver
+{
+public:
+    http_dns_resolver();
+    ~http_dns_resolver();
+
+    // Completes on the calling thread when the answer is cached, otherwise on a resolver thread
+    HC_RESULT resolve(
+        _In_z_ PCSTR hostName,
+        _In_opt_ void* context,
+        _In_ HC_DNS_RESOLVE_COMPLETION_FUNC completionRoutine
+        );
+
+    // Replaces the system resolver, e.g. with a fixed table for tests.  Pass nullptr to restore it.
+    // Clears the cache.
+    void set_lookup_function(_In_opt_ http_dns_lookup_func lookupFunc);
+    void clear();
+
+private:
+    struct waiter
+    {
+        void* context;
+        HC_DNS_RESOLVE_COMPLETION_FUNC completionRoutine;
+    };
+
+    struct cache_entry
+    {
+        cache_entry() :
+            result(HC_OK),
+            hasResult(false),
+            lookupPending(false),
+            hits(0)
+        {
+        }
+
+        HC_RESULT result;
+        http_internal_vector<http_internal_string> addresses;
+        std::chrono::steady_clock::time_point expires;
+        std::chrono::steady_clock::time_point prefetchAfter;
+        bool hasResult;
+        bool lookupPending;
+        uint32_t hits;  // since the last lookup
+        http_internal_vector<waiter> waiters;
+    };
+
+    static HC_RESULT system_lookup(
+        _In_z_ PCSTR hostName,
+        _Inout_ http_internal_vector<http_internal_string>& addresses,
+        _Out_ uint32_t* ttlSeconds
+        );
+    static void complete(
+        _In_ const waiter& completion,
+        _In_ HC_RESULT result,
+        _In_ const http_internal_vector<http_internal_string>& addresses
+        );
+
+    void queue_lookup(_In_ const http_internal_string& hostName);
+    void trim();
+    void worker();
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    http_internal_map<http_internal_string, cache_entry> m_entries;
+    http_internal_queue<http_internal_string> m_queue;
+    http_internal_vector<std::thread> m_threads;
+    http_dns_lookup_func m_lookupFunc;
+    bool m_stopping;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
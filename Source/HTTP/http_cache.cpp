@@ -0,0 +1,735 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "httpcall.h"
+#include "http_cache.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Variants kept for each method and URL, so a Vary header on a per-user value can't grow one
+// URL's list without bound.  The oldest stored variant makes room for a new one.
+const size_t HTTP_CACHE_MAX_VARIANTS = 8;
+
+struct cache_control
+{
+    cache_control() :
+        noStore(false),
+        noCache(false),
+        maxAge(-1)
+    {
+    }
+
+    bool noStore;
+    bool noCache;
+    int64_t maxAge;
+};
+
+static bool is_space(_In_ char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static bool equals_ignore_case(_In_reads_(length) PCSTR value, _In_ size_t length, _In_z_ PCSTR token)
+{
+    size_t i = 0;
+    for (; i < length && token[i] != 0; i++)
+    {
+        char c = value[i];
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != token[i])
+        {
+            return false;
+        }
+    }
+    return i == length && token[i] == 0;
+}
+
+// Calls fn(item, length) for each comma separated item of a header value with surrounding whitespace trimmed
+template<typename FN>
+static void for_each_list_item(_In_opt_z_ PCSTR value, _In_ FN fn)
+{
+    if (value == nullptr)
+    {
+        return;
+    }
+
+    while (*value != 0)
+    {
+        PCSTR end = strchr(value, ',');
+        size_t length = (end != nullptr) ? static_cast<size_t>(end - value) : strlen(value);
+
+        PCSTR item = value;
+        size_t itemLength = length;
+        while (itemLength > 0 && is_space(*item))
+        {
+            ++item;
+            --itemLength;
+        }
+        while (itemLength > 0 && is_space(item[itemLength - 1]))
+        {
+            --itemLength;
+        }
+        if (itemLength > 0)
+        {
+            fn(item, itemLength);
+        }
+
+        value += length;
+        if (*value == ',')
+        {
+            ++value;
+        }
+    }
+}
+
+static int64_t parse_seconds(_In_reads_(length) PCSTR value, _In_ size_t length)
+{
+    if (length > 0 && value[0] == '"')
+    {
+        ++value;
+        length = (length >= 2) ? length - 2 : 0;
+    }
+
+    int64_t seconds = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (value[i] < '0' || value[i] > '9')
+        {
+            return -1;
+        }
+        seconds = seconds * 10 + (value[i] - '0');
+        if (seconds > INT32_MAX)
+        {
+            seconds = INT32_MAX;
+        }
+    }
+    return (length > 0) ? seconds : -1;
+}
+
+static cache_control parse_cache_control(_In_opt_z_ PCSTR value)
+{
+    cache_control result;
+    for_each_list_item(value, [&result](PCSTR item, size_t length)
+    {
+        PCSTR equals = static_cast<PCSTR>(memchr(item, '=', length));
+        size_t nameLength = (equals != nullptr) ? static_cast<size_t>(equals - item) : length;
+
+        if (equals_ignore_case(item, nameLength, "no-store"))
+        {
+            result.noStore = true;
+        }
+        else if (equals_ignore_case(item, nameLength, "no-cache"))
+        {
+            result.noCache = true;
+        }
+        else if (equals_ignore_case(item, nameLength, "max-age") && equals != nullptr)
+        {
+            result.maxAge = parse_seconds(equals + 1, length - nameLength - 1);
+        }
+    });
+    return result;
+}
+
+static PCSTR find_request_header(_In_ HC_CALL_HANDLE call, _In_z_ PCSTR headerName)
+{
+    auto headerId = http_header_id_from_name(headerName);
+    auto it = call->requestHeaders.find(headerId == http_header_id::unknown ? headerName : http_header_name(headerId));
+    return (it != call->requestHeaders.end()) ? it->second.value.c_str() : nullptr;
+}
+
+http_response_cache::http_response_cache() :
+    m_maxSize(0),
+    m_size(0)
+{
+}
+
+void http_response_cache::set_max_size(_In_ size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_maxSize = maxBytes;
+    evict_to(maxBytes);
+}
+
+size_t http_response_cache::max_size()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_maxSize;
+}
+
+size_t http_response_cache::size()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_size;
+}
+
+void http_response_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    evict_to(0);
+}
+
+HC_RESULT http_response_cache::set_file(_In_opt_z_ PCSTR filePath, _In_ uint64_t maxFileSize)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_disk.close();
+    return (filePath != nullptr) ? m_disk.open(filePath, maxFileSize) : HC_OK;
+}
+
+http_internal_string http_response_cache::make_key(_In_ HC_CALL_HANDLE call)
+{
+    http_internal_string key;
+    key.reserve(call->method.size() + 1 + call->url.size());
+    key.append(call->method.data(), call->method.size());
+    key.push_back(' ');
+    key.append(call->url.data(), call->url.size());
+    return key;
+}
+
+bool http_response_cache::matches_vary(_In_ const cache_entry& entry, _In_ HC_CALL_HANDLE call)
+{
+    for (const auto& varyHeader : entry.varyHeaders)
+    {
+        PCSTR value = find_request_header(call, varyHeader.first.c_str());
+        if (varyHeader.second != (value != nullptr ? value : ""))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void http_response_cache::fill_response(_In_ const cache_entry& entry, _In_ HC_CALL_HANDLE call)
+{
+    call->statusCode = entry.statusCode;
+    call->networkErrorCode = HC_OK;
+    call->platformNetworkErrorCode = 0;
+    call->responseHeaders.clear();
+    for (const auto& header : entry.responseHeaders)
+    {
+        call->responseHeaders.emplace(
+            http_arena_string(header.first.data(), header.first.size(), &call->arena),
+            http_arena_string(header.second.data(), header.second.size(), &call->arena));
+    }
+    call->responseString.assign(entry.responseBody.data(), entry.responseBody.size());
+}
+
+std::chrono::steady_clock::time_point http_response_cache::compute_expiry(_In_ HC_CALL_HANDLE call)
+{
+    auto now = std::chrono::steady_clock::now();
+    cache_control control = parse_cache_control(http_find_response_header(call->responseHeaders, http_header_id::cache_control));
+    if (control.noCache || control.maxAge <= 0)
+    {
+        return now;
+    }
+
+    PCSTR ageValue = http_find_response_header(call->responseHeaders, http_header_id::age);
+    int64_t age = (ageValue != nullptr) ? parse_seconds(ageValue, strlen(ageValue)) : 0;
+    int64_t freshFor = control.maxAge - ((age > 0) ? age : 0);
+    return (freshFor > 0) ? now + std::chrono::seconds(freshFor) : now;
+}
+
+bool http_response_cache::lookup(_In_ HC_CALL_HANDLE call)
+{
+    call->cacheState = http_cache_state::none;
+    if (call->methodId != http_method_id::get)
+    {
+        return false;
+    }
+
+    // Callers that send their own validators or opt out are handled entirely by the server
+    cache_control requestControl = parse_cache_control(find_request_header(call, http_header_name(http_header_id::cache_control)));
+    if (requestControl.noStore ||
+        find_request_header(call, http_header_name(http_header_id::if_none_match)) != nullptr ||
+        find_request_header(call, http_header_name(http_header_id::if_modified_since)) != nullptr)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!is_enabled())
+    {
+        return false;
+    }
+
+    call->cacheState = http_cache_state::miss;
+    std::shared_ptr<cache_entry> found = find(make_key(call), call);
+    if (found == nullptr)
+    {
+        return false;
+    }
+    const cache_entry& entry = *found;
+
+    if (!requestControl.noCache && std::chrono::steady_clock::now() < entry.expires)
+    {
+        fill_response(entry, call);
+        call->cacheState = http_cache_state::none;
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]: completed from cache", call->id);
+        return true;
+    }
+
+    if (entry.etag.empty() && entry.lastModified.empty())
+    {
+        return false;
+    }
+
+    if (!entry.etag.empty())
+    {
+        auto& header = call->requestHeaders[http_header_name(http_header_id::if_none_match)];
+        header.id = http_header_id::if_none_match;
+        header.value.assign(entry.etag.data(), entry.etag.size());
+    }
+    if (!entry.lastModified.empty())
+    {
+        auto& header = call->requestHeaders[http_header_name(http_header_id::if_modified_since)];
+        header.id = http_header_id::if_modified_since;
+        header.value.assign(entry.lastModified.data(), entry.lastModified.size());
+    }
+    call->cacheState = http_cache_state::revalidating;
+    call->cacheEntry = std::move(found);
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]: revalidating stale cache entry", call->id);
+    return false;
+}
+
+void http_response_cache::on_response(_In_ HC_CALL_HANDLE call)
+{
+    http_cache_state state = call->cacheState;
+    std::shared_ptr<cache_entry> revalidated = std::move(call->cacheEntry);
+    call->cacheState = http_cache_state::none;
+    if (state == http_cache_state::none)
+    {
+        return;
+    }
+
+    if (state == http_cache_state::revalidating)
+    {
+        // The conditional headers were ours, don't leave them on a call that may be reset and performed again
+        call->requestHeaders.erase(http_header_name(http_header_id::if_none_match));
+        call->requestHeaders.erase(http_header_name(http_header_id::if_modified_since));
+    }
+
+    if (call->networkErrorCode != HC_OK)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    http_internal_string key = make_key(call);
+
+    if (state == http_cache_state::revalidating && call->statusCode == 304 && revalidated != nullptr)
+    {
+        // Only the in-memory copy is refreshed.  The copy on disk keeps its old expiry and
+        // is revalidated again if it is loaded after a restart.
+        cache_entry& entry = *revalidated;
+        entry.expires = compute_expiry(call);
+        PCSTR etag = http_find_response_header(call->responseHeaders, http_header_id::etag);
+        if (etag != nullptr)
+        {
+            entry.etag = etag;
+        }
+        fill_response(entry, call);
+
+        // Put back an entry evicted while the request was in flight, unless a newer response
+        // has taken its place
+        if (find_in_memory(key, call) == m_lru.end())
+        {
+            insert(revalidated);
+        }
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformWriteResults [ID %llu]: not modified, completed from cache", call->id);
+        return;
+    }
+
+    // A response that can't be stored only evicts the variants this request selects if it says
+    // they no longer describe the resource.  Server errors and transient failures leave them to be
+    // served or revalidated next time.
+    std::shared_ptr<cache_entry> stored = create_entry(call, key);
+    if (stored == nullptr && !invalidates(call->statusCode))
+    {
+        return;
+    }
+
+    for (auto it = find_in_memory(key, call); it != m_lru.end(); it = find_in_memory(key, call))
+    {
+        remove(it);
+    }
+    if (stored != nullptr)
+    {
+        insert(stored);
+    }
+
+    if (m_disk.is_open())
+    {
+        http_internal_vector<std::shared_ptr<cache_entry>> variants;
+        read_variants(key, variants);
+        variants.erase(std::remove_if(variants.begin(), variants.end(), [call](const std::shared_ptr<cache_entry>& variant)
+        {
+            return matches_vary(*variant, call);
+        }), variants.end());
+        if (stored != nullptr)
+        {
+            variants.push_back(stored);
+        }
+        if (variants.size() > HTTP_CACHE_MAX_VARIANTS)
+        {
+            variants.erase(variants.begin(), variants.end() - HTTP_CACHE_MAX_VARIANTS);
+        }
+        write_variants(key, variants);
+    }
+}
+
+bool http_response_cache::invalidates(_In_ uint32_t statusCode)
+{
+    // A new representation, or none at all
+    return (statusCode >= 200 && statusCode < 400 && statusCode != 304) || statusCode == 404 || statusCode == 410;
+}
+
+http_response_cache::entry_list::iterator http_response_cache::find_in_memory(_In_ const http_internal_string& key, _In_ HC_CALL_HANDLE call)
+{
+    auto it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        for (auto variant : it->second)
+        {
+            if (matches_vary(**variant, call))
+            {
+                return variant;
+            }
+        }
+    }
+    return m_lru.end();
+}
+
+std::shared_ptr<http_response_cache::cache_entry> http_response_cache::find(_In_ const http_internal_string& key, _In_ HC_CALL_HANDLE call)
+{
+    auto it = find_in_memory(key, call);
+    if (it != m_lru.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it);
+        return *it;
+    }
+
+    // Variants evicted from memory may still be on disk
+    http_internal_vector<std::shared_ptr<cache_entry>> variants;
+    read_variants(key, variants);
+    for (const auto& variant : variants)
+    {
+        if (matches_vary(*variant, call))
+        {
+            // Promoted to memory when it fits, otherwise the entry only lives as long as the caller holds it
+            insert(variant);
+            return variant;
+        }
+    }
+    return nullptr;
+}
+
+void http_response_cache::read_variants(_In_ const http_internal_string& key, _Inout_ http_internal_vector<std::shared_ptr<cache_entry>>& variants)
+{
+    http_internal_vector<uint8_t> data;
+    if (!m_disk.read(key, data))
+    {
+        return;
+    }
+
+    if (!deserialize(data, variants))
+    {
+        variants.clear();
+        m_disk.remove(key);
+        return;
+    }
+
+    for (const auto& variant : variants)
+    {
+        variant->key = key;
+        variant->size = entry_size(*variant);
+    }
+}
+
+void http_response_cache::write_variants(_In_ const http_internal_string& key, _In_ const http_internal_vector<std::shared_ptr<cache_entry>>& variants)
+{
+    if (variants.empty())
+    {
+        m_disk.remove(key);
+        return;
+    }
+
+    http_internal_vector<uint8_t> data;
+    serialize(variants, data);
+    if (m_disk.write(key, data.data(), data.size()) != HC_OK)
+    {
+        m_disk.remove(key);
+    }
+}
+
+std::shared_ptr<http_response_cache::cache_entry> http_response_cache::create_entry(_In_ HC_CALL_HANDLE call, _In_ const http_internal_string& key)
+{
+    if (call->statusCode != 200)
+    {
+        return nullptr;
+    }
+
+    cache_control control = parse_cache_control(http_find_response_header(call->responseHeaders, http_header_id::cache_control));
+    PCSTR etag = http_find_response_header(call->responseHeaders, http_header_id::etag);
+    PCSTR lastModified = http_find_response_header(call->responseHeaders, http_header_id::last_modified);
+    bool hasValidator = etag != nullptr || lastModified != nullptr;
+    if (control.noStore || (control.maxAge <= 0 && !hasValidator))
+    {
+        return nullptr;
+    }
+
+    auto stored = http_allocate_shared<cache_entry>();
+    cache_entry& entry = *stored;
+
+    bool varyAll = false;
+    for_each_list_item(http_find_response_header(call->responseHeaders, http_header_id::vary), [&](PCSTR item, size_t length)
+    {
+        if (length == 1 && item[0] == '*')
+        {
+            varyAll = true;
+            return;
+        }
+        http_internal_string name(item, length);
+        PCSTR value = find_request_header(call, name.c_str());
+        entry.varyHeaders.emplace_back(std::move(name), http_internal_string(value != nullptr ? value : ""));
+    });
+    if (varyAll)
+    {
+        return nullptr;
+    }
+
+    entry.key = key;
+    entry.statusCode = call->statusCode;
+    entry.responseBody.assign(call->responseString.data(), call->responseString.size());
+    entry.etag = (etag != nullptr) ? etag : "";
+    entry.lastModified = (lastModified != nullptr) ? lastModified : "";
+    entry.expires = compute_expiry(call);
+    for (const auto& header : call->responseHeaders)
+    {
+        entry.responseHeaders.emplace(
+            http_internal_string(header.first.data(), header.first.size()),
+            http_internal_string(header.second.data(), header.second.size()));
+    }
+    entry.size = entry_size(entry);
+    return stored;
+}
+
+void http_response_cache::insert(_In_ const std::shared_ptr<cache_entry>& entry)
+{
+    size_t size = entry->size;
+    if (size > m_maxSize)
+    {
+        return;
+    }
+
+    auto variants = m_entries.find(entry->key);
+    if (variants != m_entries.end() && variants->second.size() >= HTTP_CACHE_MAX_VARIANTS)
+    {
+        remove(variants->second.front());
+    }
+
+    evict_to(m_maxSize - size);
+    m_size += size;
+    m_lru.push_front(entry);
+    m_entries[entry->key].push_back(m_lru.begin());
+}
+
+size_t http_response_cache::entry_size(_In_ const cache_entry& entry)
+{
+    size_t size = sizeof(cache_entry) + entry.key.size() + entry.responseBody.size() + entry.etag.size() + entry.lastModified.size();
+    for (const auto& header : entry.responseHeaders)
+    {
+        size += header.first.size() + header.second.size();
+    }
+    for (const auto& varyHeader : entry.varyHeaders)
+    {
+        size += varyHeader.first.size() + varyHeader.second.size();
+    }
+    return size;
+}
+
+// A record on disk holds every stored variant of a method and URL: a format version and the number
+// of variants, then for each its status code, its expiry as seconds since the Unix epoch, and its
+// headers, validators and body.  Integers are little endian and strings are length prefixed.
+const uint32_t cache_entry_format = 2;
+
+static void append_uint32(_Inout_ http_internal_vector<uint8_t>& data, _In_ uint32_t value)
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+static void append_string(_Inout_ http_internal_vector<uint8_t>& data, _In_ const http_internal_string& value)
+{
+    append_uint32(data, static_cast<uint32_t>(value.size()));
+    data.insert(data.end(), value.begin(), value.end());
+}
+
+struct entry_reader
+{
+    entry_reader(_In_ const http_internal_vector<uint8_t>& data) :
+        pos(data.data()),
+        end(data.data() + data.size())
+    {
+    }
+
+    bool read_uint32(_Out_ uint32_t* value)
+    {
+        *value = 0;
+        if (end - pos < 4)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            *value |= static_cast<uint32_t>(*pos++) << (i * 8);
+        }
+        return true;
+    }
+
+    bool read_string(_Inout_ http_internal_string& value)
+    {
+        uint32_t length = 0;
+        if (!read_uint32(&length) || static_cast<size_t>(end - pos) < length)
+        {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+        return true;
+    }
+
+    const uint8_t* pos;
+    const uint8_t* end;
+};
+
+void http_response_cache::serialize(_In_ const http_internal_vector<std::shared_ptr<cache_entry>>& variants, _Inout_ http_internal_vector<uint8_t>& data)
+{
+    size_t size = 0;
+    for (const auto& variant : variants)
+    {
+        size += variant->size;
+    }
+    data.reserve(size);
+    append_uint32(data, cache_entry_format);
+    append_uint32(data, static_cast<uint32_t>(variants.size()));
+
+    for (const auto& variant : variants)
+    {
+        const cache_entry& entry = *variant;
+        auto remaining = std::chrono::duration_cast<std::chrono::seconds>(entry.expires - std::chrono::steady_clock::now());
+        auto expires = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()) + remaining;
+        uint64_t expiresSeconds = (expires.count() > 0) ? static_cast<uint64_t>(expires.count()) : 0;
+
+        append_uint32(data, entry.statusCode);
+        append_uint32(data, static_cast<uint32_t>(expiresSeconds));
+        append_uint32(data, static_cast<uint32_t>(expiresSeconds >> 32));
+        append_uint32(data, static_cast<uint32_t>(entry.responseHeaders.size()));
+        for (const auto& header : entry.responseHeaders)
+        {
+            append_string(data, header.first);
+            append_string(data, header.second);
+        }
+        append_uint32(data, static_cast<uint32_t>(entry.varyHeaders.size()));
+        for (const auto& varyHeader : entry.varyHeaders)
+        {
+            append_string(data, varyHeader.first);
+            append_string(data, varyHeader.second);
+        }
+        append_string(data, entry.etag);
+        append_string(data, entry.lastModified);
+        append_string(data, entry.responseBody);
+    }
+}
+
+bool http_response_cache::deserialize(_In_ const http_internal_vector<uint8_t>& data, _Inout_ http_internal_vector<std::shared_ptr<cache_entry>>& variants)
+{
+    entry_reader reader(data);
+    uint32_t format = 0;
+    uint32_t variantCount = 0;
+    if (!reader.read_uint32(&format) || format != cache_entry_format ||
+        !reader.read_uint32(&variantCount) || variantCount > HTTP_CACHE_MAX_VARIANTS)
+    {
+        return false;
+    }
+
+    int64_t nowSeconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    auto now = std::chrono::steady_clock::now();
+    for (uint32_t variant = 0; variant < variantCount; variant++)
+    {
+        auto stored = http_allocate_shared<cache_entry>();
+        cache_entry& entry = *stored;
+        uint32_t expiresLow = 0;
+        uint32_t expiresHigh = 0;
+        uint32_t count = 0;
+        if (!reader.read_uint32(&entry.statusCode) ||
+            !reader.read_uint32(&expiresLow) ||
+            !reader.read_uint32(&expiresHigh) ||
+            !reader.read_uint32(&count))
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            http_internal_string name;
+            http_internal_string value;
+            if (!reader.read_string(name) || !reader.read_string(value))
+            {
+                return false;
+            }
+            entry.responseHeaders.emplace(std::move(name), std::move(value));
+        }
+
+        if (!reader.read_uint32(&count))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            http_internal_string name;
+            http_internal_string value;
+            if (!reader.read_string(name) || !reader.read_string(value))
+            {
+                return false;
+            }
+            entry.varyHeaders.emplace_back(std::move(name), std::move(value));
+        }
+
+        if (!reader.read_string(entry.etag) || !reader.read_string(entry.lastModified) || !reader.read_string(entry.responseBody))
+        {
+            return false;
+        }
+
+        int64_t expiresSeconds = static_cast<int64_t>((static_cast<uint64_t>(expiresHigh) << 32) | expiresLow);
+        entry.expires = (expiresSeconds > nowSeconds) ? now + std::chrono::seconds(expiresSeconds - nowSeconds) : now;
+        variants.push_back(std::move(stored));
+    }
+    return true;
+}
+
+void http_response_cache::remove(_In_ entry_list::iterator it)
+{
+    m_size -= (*it)->size;
+    auto variants = m_entries.find((*it)->key);
+    variants->second.erase(std::find(variants->second.begin(), variants->second.end(), it));
+    if (variants->second.empty())
+    {
+        m_entries.erase(variants);
+    }
+    m_lru.erase(it);
+}
+
+void http_response_cache::evict_to(_In_ size_t maxBytes)
+{
+    while (m_size > maxBytes && !m_lru.empty())
+    {
+        remove(std::prev(m_lru.end()));
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
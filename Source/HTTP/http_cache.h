@@ -0,0 +1,98 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "http_disk_cache.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// How HttpCallPerformExecute involved the cache in a call, so the result can be
+// stored or merged when the call completes
+enum class http_cache_state : uint8_t
+{
+    none,           // not cacheable, served from cache, or caching is off
+    miss,           // no usable entry; store the response if it is cacheable
+    revalidating    // a stale entry exists and conditional headers were added to the request
+};
+
+// A stored response, shared by http_response_cache and any call revalidating it
+struct http_cache_entry
+{
+    http_internal_string key;
+    uint32_t statusCode;
+    http_internal_map<http_internal_string, http_internal_string> responseHeaders;
+    http_internal_string responseBody;
+    http_internal_vector<std::pair<http_internal_string, http_internal_string>> varyHeaders;
+    http_internal_string etag;
+    http_internal_string lastModified;
+    std::chrono::steady_clock::time_point expires;
+    size_t size;
+};
+
+// In-memory cache of GET responses, bounded by the bytes held and evicted least recently used first.
+//
+// Entries are keyed by method and URL, and each key keeps a few variants.  A response with a Vary
+// header records the request header values it was selected by and only matches requests with the
+// same values, so requests that alternate between variants each keep their own.  A response
+// replaces the variants its request matched if it can be stored.  If it can't, it only evicts them
+// when its status says they are out of date, never on a server error or a failed request.  Freshness
+// follows the Cache-Control max-age (less any Age) of the stored response; stale entries with an
+// ETag or Last-Modified are revalidated with If-None-Match / If-Modified-Since and a 304 completes
+// the call from the cached body.  The call pins the entry it revalidates, so the 304 completes from
+// it even if the entry was evicted or replaced while the request was in flight.
+//
+// An http_disk_cache can be attached as a second tier, with one record holding the variants of each
+// key.  Stored responses are written through to it and entries missing from memory are loaded back
+// from it, which lets responses outlive the process.
+class http_response_cache
+{
+public:
+    http_response_cache();
+
+    void set_max_size(_In_ size_t maxBytes);
+    size_t max_size();
+    size_t size();
+    void clear();
+    HC_RESULT set_file(_In_opt_z_ PCSTR filePath, _In_ uint64_t maxFileSize);
+
+    // Called before the transport.  Returns true if the call was filled in from a fresh entry
+    // and needs no network request.  Otherwise sets call->cacheState to record what to do
+    // with the response, and call->cacheEntry to the entry being revalidated.
+    bool lookup(_In_ HC_CALL_HANDLE call);
+
+    // Called once the transport has completed the call
+    void on_response(_In_ HC_CALL_HANDLE call);
+
+private:
+    typedef http_cache_entry cache_entry;
+    typedef http_internal_list<std::shared_ptr<cache_entry>> entry_list;
+
+    static http_internal_string make_key(_In_ HC_CALL_HANDLE call);
+    static bool matches_vary(_In_ const cache_entry& entry, _In_ HC_CALL_HANDLE call);
+    static void fill_response(_In_ const cache_entry& entry, _In_ HC_CALL_HANDLE call);
+    static std::chrono::steady_clock::time_point compute_expiry(_In_ HC_CALL_HANDLE call);
+    static size_t entry_size(_In_ const cache_entry& entry);
+    static bool invalidates(_In_ uint32_t statusCode);
+    static std::shared_ptr<cache_entry> create_entry(_In_ HC_CALL_HANDLE call, _In_ const http_internal_string& key);
+    static void serialize(_In_ const http_internal_vector<std::shared_ptr<cache_entry>>& variants, _Inout_ http_internal_vector<uint8_t>& data);
+    static bool deserialize(_In_ const http_internal_vector<uint8_t>& data, _Inout_ http_internal_vector<std::shared_ptr<cache_entry>>& variants);
+
+    bool is_enabled() const { return m_maxSize > 0 || m_disk.is_open(); }
+    entry_list::iterator find_in_memory(_In_ const http_internal_string& key, _In_ HC_CALL_HANDLE call);
+    std::shared_ptr<cache_entry> find(_In_ const http_internal_string& key, _In_ HC_CALL_HANDLE call);
+    void read_variants(_In_ const http_internal_string& key, _Inout_ http_internal_vector<std::shared_ptr<cache_entry>>& variants);
+    void write_variants(_In_ const http_internal_string& key, _In_ const http_internal_vector<std::shared_ptr<cache_entry>>& variants);
+    void insert(_In_ const std::shared_ptr<cache_entry>& entry);
+    void remove(_In_ entry_list::iterator it);
+    void evict_to(_In_ size_t maxBytes);
+
+    std::mutex m_lock;
+    entry_list m_lru; // most recently used first
+    http_internal_map<http_internal_string, http_internal_vector<entry_list::iterator>> m_entries; // variants of each key, oldest stored first
+    size_t m_maxSize;
+    size_t m_size;
+    http_disk_cache m_disk;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "httpcall.h"
+#include "http_coalescer.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+bool http_request_coalescer::make_key(_In_ HC_CALL_HANDLE call, _Inout_ http_internal_string& key)
+{
+    // Only requests without side effects or a body can share a response
+    if ((call->methodId != http_method_id::get && call->methodId != http_method_id::head) || !call->requestBodyBytes.empty())
+    {
+        return false;
+    }
+
+    // requestHeaders is ordered by name so identical header sets give identical keys
+    key.append(call->method.data(), call->method.size());
+    key.push_back(' ');
+    key.append(call->url.data(), call->url.size());
+    for (const auto& header : call->requestHeaders)
+    {
+        key.push_back('\n');
+        key.append(header.first.data(), header.first.size());
+        key.push_back(':');
+        key.append(header.second.value.data(), header.second.value.size());
+    }
+    return true;
+}
+
+bool http_request_coalescer::try_attach(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle)
+{
+    call->coalescingKey.clear();
+    http_internal_string key;
+    if (!call->coalescingEnabled || !make_key(call, key))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_flights.find(key);
+    if (it == m_flights.end())
+    {
+        m_flights.emplace(key, http_internal_vector<follower>());
+        call->coalescingKey.assign(key.data(), key.size());
+        return false;
+    }
+
+    // Keep the follower alive until the leader completes it, even if the caller closes it first
+    follower attached;
+    attached.call = HCHttpCallDuplicateHandle(call);
+    attached.taskHandle = taskHandle;
+    it->second.push_back(attached);
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]: attached to an identical call in flight", call->id);
+    return true;
+}
+
+void http_request_coalescer::on_complete(_In_ HC_CALL_HANDLE call)
+{
+    if (call->coalescingKey.empty())
+    {
+        return;
+    }
+
+    http_internal_vector<follower> followers;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_flights.find(http_internal_string(call->coalescingKey.data(), call->coalescingKey.size()));
+        if (it != m_flights.end())
+        {
+            followers.swap(it->second);
+            m_flights.erase(it);
+        }
+    }
+    call->coalescingKey.clear();
+
+    if (followers.empty())
+    {
+        return;
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformWriteResults [ID %llu]: completing %u coalesced calls",
+        call->id, static_cast<uint32_t>(followers.size()));
+
+    // Copy the body out of the leader's arena once so every call references the same copy
+    if (call->sharedResponseBody == nullptr)
+    {
+        call->sharedResponseBody = http_allocate_shared<http_internal_string>(call->responseString.data(), call->responseString.size());
+        call->responseString.clear();
+    }
+
+    for (auto& attached : followers)
+    {
+        HC_CALL_HANDLE followerCall = attached.call;
+        followerCall->statusCode = call->statusCode;
+        followerCall->networkErrorCode = call->networkErrorCode;
+        followerCall->platformNetworkErrorCode = call->platformNetworkErrorCode;
+        followerCall->responseHeaders.clear();
+        for (const auto& header : call->responseHeaders)
+        {
+            followerCall->responseHeaders.emplace(
+                http_arena_string(header.first.data(), header.first.size(), &followerCall->arena),
+                http_arena_string(header.second.data(), header.second.size(), &followerCall->arena));
+        }
+        followerCall->responseString.clear();
+        followerCall->sharedResponseBody = call->sharedResponseBody;
+
+        HCTaskSetCompleted(attached.taskHandle);
+        HCHttpCallCloseHandle(followerCall);
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Single-flight coalescing of identical GET and HEAD calls.
+//
+// The first call for a given method, URL and set of request headers becomes the leader of a
+// flight and is performed as usual.  Identical calls performed while the leader is in flight
+// attach to it as followers and are never sent.  When the leader's results are written, each
+// follower gets a copy of its status and headers and a reference to one shared response body,
+// and its task is completed.
+class http_request_coalescer
+{
+public:
+    // Called before the call is sent.  Returns true if the call was attached to a flight and
+    // its task will be completed by the leader.
+    bool try_attach(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle);
+
+    // Called when a call's results are written.  Completes the followers if it was a leader.
+    void on_complete(_In_ HC_CALL_HANDLE call);
+
+private:
+    struct follower
+    {
+        HC_CALL_HANDLE call;
+        HC_TASK_HANDLE taskHandle;
+    };
+
+    static bool make_key(_In_ HC_CALL_HANDLE call, _Inout_ http_internal_string& key);
+
+    std::mutex m_lock;
+    http_internal_map<http_internal_string, http_internal_vector<follower>> m_flights;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
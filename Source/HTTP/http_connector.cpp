@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "dns_resolver.h"
+#include "http_connector.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+http_connector::http_connector(_In_ std::shared_ptr<http_dns_resolver> resolver) :
+    m_resolver(std::move(resolver)),
+    m_cancelled(false)
+{
+}
+
+http_connector::~http_connector()
+{
+    cancel();
+}
+
+void HC_CALLING_CONV http_connector::resolved(
+    _In_opt_ void* context,
+    _In_ HC_RESULT result,
+    _In_ uint32_t addressCount,
+    _In_reads_(addressCount) PCSTR* addresses
+    )
+{
+    auto pending = static_cast<lookup*>(context);
+    std::shared_ptr<lookup> self;
+    {
+        std::lock_guard<std::mutex> lock(pending->lock);
+        pending->result = result;
+        for (uint32_t i = 0; i < addressCount; i++)
+        {
+            pending->addresses.push_back(addresses[i]);
+        }
+        pending->finished = true;
+        pending->done.notify_all();
+        self = std::move(pending->self);
+    }
+}
+
+HC_RESULT http_connector::connect(
+    _In_ const http_internal_string& host,
+    _In_ uint16_t port,
+    _In_ uint32_t attemptDelayInMilliseconds,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Out_ http_socket* connectedSocket
+    )
+{
+    *connectedSocket = HTTP_INVALID_SOCKET;
+
+    auto pending = http_allocate_shared<lookup>();
+    pending->self = pending;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_cancelled)
+        {
+            return HC_E_FAIL;
+        }
+        m_lookup = pending;
+    }
+
+    if (m_resolver->resolve(host.c_str(), pending.get(), resolved) != HC_OK)
+    {
+        pending->self.reset();
+        return HC_E_FAIL;
+    }
+
+    http_internal_vector<PCSTR> addresses;
+    {
+        std::unique_lock<std::mutex> lock(pending->lock);
+        pending->done.wait(lock, [&pending]() { return pending->finished || pending->cancelled; });
+        if (!pending->finished || pending->result != HC_OK || pending->addresses.empty())
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "http_connector: failed to resolve %s", host.c_str());
+            return HC_E_FAIL;
+        }
+
+        // The lookup is finished, so nothing else touches the addresses
+        for (const auto& address : pending->addresses)
+        {
+            addresses.push_back(address.c_str());
+        }
+    }
+
+    HC_RESULT result = http_connect_race(
+        addresses.data(),
+        static_cast<uint32_t>(addresses.size()),
+        port,
+        attemptDelayInMilliseconds,
+        timeoutInMilliseconds,
+        connectedSocket);
+    if (result != HC_OK)
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_connector: failed to connect to %s port %u", host.c_str(), port);
+    }
+    return result;
+}
+
+void http_connector::cancel()
+{
+    std::shared_ptr<lookup> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_cancelled = true;
+        pending = m_lookup;
+    }
+
+    if (pending != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(pending->lock);
+        pending->cancelled = true;
+        pending->done.notify_all();
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "http_socket.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+class http_dns_resolver;
+
+// How long the HTTP/1.1 and HTTP/2 pools keep a connection open with no calls on it
+const uint32_t DEFAULT_CONNECTION_IDLE_TIMEOUT_IN_SECONDS = 60;
+
+// Resolves a host and races connections to its addresses, for the transports that open their
+// own sockets.  connect() blocks the calling thread, and cancel() may be called from any other
+// thread to make a connect() that is waiting on the resolver give up.
+class http_connector
+{
+public:
+    http_connector(_In_ std::shared_ptr<http_dns_resolver> resolver);
+    ~http_connector();
+
+    HC_RESULT connect(
+        _In_ const http_internal_string& host,
+        _In_ uint16_t port,
+        _In_ uint32_t attemptDelayInMilliseconds,
+        _In_ uint32_t timeoutInMilliseconds,
+        _Out_ http_socket* connectedSocket
+        );
+
+    void cancel();
+
+private:
+    struct lookup
+    {
+        lookup() : finished(false), cancelled(false), result(HC_E_FAIL) {}
+
+        std::mutex lock;
+        std::condition_variable done;
+        bool finished;
+        bool cancelled;
+        HC_RESULT result;
+        http_internal_vector<http_internal_string> addresses;
+        std::shared_ptr<lookup> self;  // keeps the lookup alive until the resolver calls back
+    };
+
+    static void HC_CALLING_CONV resolved(
+        _In_opt_ void* context,
+        _In_ HC_RESULT result,
+        _In_ uint32_t addressCount,
+        _In_reads_(addressCount) PCSTR* addresses
+        );
+
+    std::shared_ptr<http_dns_resolver> m_resolver;
+    std::mutex m_lock;
+    std::shared_ptr<lookup> m_lookup;
+    bool m_cancelled;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,558 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+
+#include <algorithm>
+#include <cstdio>
+#if !HC_USE_HANDLES
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "compression.h"
+#include "http_disk_cache.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+struct segment_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t reserved[2];
+};
+
+const uint32_t segment_magic = 0x43444348; // "HCDC"
+const uint32_t segment_version = 1;
+const uint32_t record_magic = 0x52434448;  // "HDCR"
+const uint32_t record_flag_tombstone = 0x1;
+const uint32_t record_alignment = 8;
+const uint64_t min_segment_size = 4096;
+
+http_disk_cache::http_disk_cache() :
+    m_maxSize(0),
+#if HC_USE_HANDLES
+    m_file(nullptr),
+    m_mapping(nullptr),
+#else
+    m_file(-1),
+#endif
+    m_view(nullptr),
+    m_viewSize(0),
+    m_writeOffset(0),
+    m_indexCount(0),
+    m_useClock(0),
+    m_liveSize(0)
+{
+}
+
+http_disk_cache::~http_disk_cache()
+{
+    close();
+}
+
+HC_RESULT http_disk_cache::open(_In_z_ PCSTR filePath, _In_ uint64_t maxSize)
+{
+    close();
+
+    // Offsets are 32 bit so the segment can't grow past 4GB
+    maxSize = MIN(maxSize, static_cast<uint64_t>(UINT32_MAX)) & ~static_cast<uint64_t>(record_alignment - 1);
+    if (maxSize < min_segment_size)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    m_filePath = filePath;
+    m_maxSize = maxSize;
+    if (!map(m_filePath, false))
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_disk_cache: failed to map %s", filePath);
+        close();
+        return HC_E_FAIL;
+    }
+
+    recover();
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http_disk_cache: opened %s with %u entries, %llu bytes", filePath, m_indexCount, m_liveSize);
+    return HC_OK;
+}
+
+void http_disk_cache::close()
+{
+    unmap();
+    m_filePath.clear();
+    m_index.clear();
+    m_indexCount = 0;
+    m_liveSize = 0;
+}
+
+uint64_t http_disk_cache::hash_key(_In_reads_bytes_(size) const char* key, _In_ size_t size)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<uint8_t>(key[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint32_t http_disk_cache::record_size(_In_ size_t keyLength, _In_ size_t valueLength)
+{
+    uint64_t size = sizeof(record_header) + static_cast<uint64_t>(keyLength) + valueLength;
+    size = (size + record_alignment - 1) & ~static_cast<uint64_t>(record_alignment - 1);
+    return (size <= UINT32_MAX) ? static_cast<uint32_t>(size) : UINT32_MAX;
+}
+
+uint32_t http_disk_cache::record_checksum(_In_ const record_header* header)
+{
+    const uint8_t* fields = reinterpret_cast<const uint8_t*>(&header->keyLength);
+    uint32_t crc = http_crc32(0, fields, sizeof(record_header) - offsetof(record_header, keyLength));
+    return http_crc32(crc, reinterpret_cast<const uint8_t*>(header + 1), static_cast<size_t>(header->keyLength) + header->valueLength);
+}
+
+bool http_disk_cache::map(_In_ const http_internal_string& filePath, _In_ bool truncate)
+{
+    uint64_t size = m_maxSize;
+
+#if HC_USE_HANDLES
+    auto widePath = utf16_from_utf8(filePath);
+#if HC_UWP_API
+    m_file = CreateFile2(widePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, nullptr);
+#else
+    m_file = CreateFileW(widePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+#endif
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        return false;
+    }
+
+    // The segment is always its maximum size; the unused tail reads as zeros
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(m_file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+    {
+        unmap();
+        return false;
+    }
+
+#if HC_UWP_API
+    m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READWRITE, size, nullptr);
+    void* view = (m_mapping != nullptr) ? MapViewOfFileFromApp(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, static_cast<SIZE_T>(size)) : nullptr;
+#else
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    void* view = (m_mapping != nullptr) ? MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(size)) : nullptr;
+#endif
+#else
+    m_file = ::open(filePath.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0600);
+    if (m_file < 0)
+    {
+        return false;
+    }
+
+    // The segment is always its maximum size; the unused tail reads as zeros
+    if (ftruncate(m_file, static_cast<off_t>(size)) != 0)
+    {
+        unmap();
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if (view == MAP_FAILED)
+    {
+        view = nullptr;
+    }
+#endif
+
+    if (view == nullptr)
+    {
+        unmap();
+        return false;
+    }
+
+    m_view = static_cast<uint8_t*>(view);
+    m_viewSize = static_cast<uint32_t>(size);
+    return true;
+}
+
+void http_disk_cache::flush()
+{
+#if HC_USE_HANDLES
+    FlushViewOfFile(m_view, 0);
+    FlushFileBuffers(m_file);
+#else
+    msync(m_view, m_viewSize, MS_SYNC);
+#endif
+}
+
+void http_disk_cache::unmap()
+{
+#if HC_USE_HANDLES
+    if (m_view != nullptr)
+    {
+        UnmapViewOfFile(m_view);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_view != nullptr)
+    {
+        munmap(m_view, m_viewSize);
+    }
+    if (m_file >= 0)
+    {
+        ::close(m_file);
+        m_file = -1;
+    }
+#endif
+    m_view = nullptr;
+    m_viewSize = 0;
+    m_writeOffset = 0;
+}
+
+void http_disk_cache::recover()
+{
+    m_index.assign(16, index_slot());
+    m_indexCount = 0;
+    m_useClock = 0;
+    m_liveSize = 0;
+    m_writeOffset = sizeof(segment_header);
+
+    auto header = reinterpret_cast<segment_header*>(m_view);
+    if (header->magic != segment_magic || header->version != segment_version)
+    {
+        // A new file reads as zeros; anything else was written by another version and is discarded
+        if (header->magic != 0)
+        {
+            memset(m_view, 0, m_viewSize);
+        }
+        header->magic = segment_magic;
+        header->version = segment_version;
+        return;
+    }
+
+    // Replay the records in the order they were written.  Later copies of a key replace earlier
+    // ones and tombstones remove them.  Records are read back oldest first, so that is also the
+    // recency order until they are used again.
+    bool cleanEnd = false;
+    while (m_viewSize - m_writeOffset >= sizeof(record_header))
+    {
+        const record_header* record = record_at(m_writeOffset);
+        if (record->magic != record_magic)
+        {
+            static const record_header empty = {};
+            cleanEnd = memcmp(record, &empty, sizeof(record_header)) == 0;
+            break;
+        }
+
+        uint32_t size = record_size(record->keyLength, record->valueLength);
+        if (size > m_viewSize - m_writeOffset || record_checksum(record) != record->checksum)
+        {
+            break;
+        }
+
+        http_internal_string key(reinterpret_cast<const char*>(record + 1), record->keyLength);
+        uint64_t keyHash = hash_key(key.data(), key.size());
+        index_slot* existing = find_slot(keyHash, key);
+        if (existing != nullptr)
+        {
+            m_liveSize -= record_size(record_at(existing->offset)->keyLength, record_at(existing->offset)->valueLength);
+            index_erase(existing);
+        }
+        if ((record->flags & record_flag_tombstone) == 0)
+        {
+            index_insert(keyHash, m_writeOffset, ++m_useClock);
+            m_liveSize += size;
+        }
+
+        m_writeOffset += size;
+    }
+
+    if (!cleanEnd && m_writeOffset < m_viewSize)
+    {
+        // A torn or corrupt record.  Clear everything after the last good record so nothing left
+        // of it can be mistaken for a record appended later.
+        HC_TRACE_WARNING(HTTPCLIENT, "http_disk_cache: discarding corrupt data at offset %u", m_writeOffset);
+        memset(m_view + m_writeOffset, 0, m_viewSize - m_writeOffset);
+    }
+}
+
+const http_disk_cache::record_header* http_disk_cache::record_at(_In_ uint32_t offset) const
+{
+    return reinterpret_cast<const record_header*>(m_view + offset);
+}
+
+bool http_disk_cache::record_matches(_In_ uint32_t offset, _In_ const http_internal_string& key) const
+{
+    const record_header* record = record_at(offset);
+    return record->keyLength == key.size() && memcmp(record + 1, key.data(), key.size()) == 0;
+}
+
+uint32_t http_disk_cache::append(_In_ const http_internal_string& key, _In_reads_bytes_(size) const uint8_t* value, _In_ size_t size, _In_ uint32_t flags)
+{
+    uint32_t recordSize = record_size(key.size(), size);
+    if (recordSize > m_viewSize - m_writeOffset)
+    {
+        return 0;
+    }
+
+    uint32_t offset = m_writeOffset;
+    auto record = reinterpret_cast<record_header*>(m_view + offset);
+    uint8_t* payload = reinterpret_cast<uint8_t*>(record + 1);
+    memcpy(payload, key.data(), key.size());
+    if (size > 0)
+    {
+        memcpy(payload + key.size(), value, size);
+    }
+
+    record->keyLength = static_cast<uint32_t>(key.size());
+    record->valueLength = static_cast<uint32_t>(size);
+    record->flags = flags;
+    record->reserved = 0;
+    record->checksum = record_checksum(record);
+    record->magic = record_magic;
+
+    m_writeOffset += recordSize;
+    return offset;
+}
+
+bool http_disk_cache::read(_In_ const http_internal_string& key, _Inout_ http_internal_vector<uint8_t>& value)
+{
+    if (!is_open())
+    {
+        return false;
+    }
+
+    index_slot* slot = find_slot(hash_key(key.data(), key.size()), key);
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    const record_header* record = record_at(slot->offset);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(record + 1) + record->keyLength;
+    value.assign(data, data + record->valueLength);
+    slot->lastUse = ++m_useClock;
+    return true;
+}
+
+HC_RESULT http_disk_cache::write(_In_ const http_internal_string& key, _In_reads_bytes_(size) const uint8_t* value, _In_ size_t size)
+{
+    if (!is_open())
+    {
+        return HC_E_FAIL;
+    }
+
+    uint64_t budget = (static_cast<uint64_t>(m_viewSize) - sizeof(segment_header)) / 4 * 3;
+    uint32_t recordSize = record_size(key.size(), size);
+    if (recordSize > budget)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    uint64_t keyHash = hash_key(key.data(), key.size());
+    index_slot* existing = find_slot(keyHash, key);
+    if (existing != nullptr)
+    {
+        m_liveSize -= record_size(record_at(existing->offset)->keyLength, record_at(existing->offset)->valueLength);
+        index_erase(existing);
+    }
+
+    uint32_t offset = append(key, value, size, 0);
+    if (offset == 0)
+    {
+        HC_RESULT hr = compact(budget - recordSize);
+        if (hr != HC_OK)
+        {
+            return hr;
+        }
+
+        offset = append(key, value, size, 0);
+        if (offset == 0)
+        {
+            return HC_E_FAIL;
+        }
+    }
+
+    index_insert(keyHash, offset, ++m_useClock);
+    m_liveSize += recordSize;
+    return HC_OK;
+}
+
+void http_disk_cache::remove(_In_ const http_internal_string& key)
+{
+    if (!is_open())
+    {
+        return;
+    }
+
+    index_slot* slot = find_slot(hash_key(key.data(), key.size()), key);
+    if (slot == nullptr)
+    {
+        return;
+    }
+
+    m_liveSize -= record_size(record_at(slot->offset)->keyLength, record_at(slot->offset)->valueLength);
+    index_erase(slot);
+
+    if (append(key, nullptr, 0, record_flag_tombstone) == 0)
+    {
+        // Compacting drops the record, so no tombstone is needed
+        compact((static_cast<uint64_t>(m_viewSize) - sizeof(segment_header)) / 4 * 3);
+    }
+}
+
+HC_RESULT http_disk_cache::compact(_In_ uint64_t budget)
+{
+    // Keep the most recently used records that fit in the budget, written oldest first so the
+    // recency order survives the replay in recover()
+    http_internal_vector<index_slot> live;
+    live.reserve(m_indexCount);
+    for (const auto& slot : m_index)
+    {
+        if (slot.offset != 0)
+        {
+            live.push_back(slot);
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const index_slot& lhs, const index_slot& rhs)
+    {
+        return lhs.lastUse > rhs.lastUse;
+    });
+
+    uint64_t keptSize = 0;
+    size_t keptCount = 0;
+    for (; keptCount < live.size(); keptCount++)
+    {
+        uint32_t size = record_size(record_at(live[keptCount].offset)->keyLength, record_at(live[keptCount].offset)->valueLength);
+        if (keptSize + size > budget)
+        {
+            break;
+        }
+        keptSize += size;
+    }
+    live.resize(keptCount);
+    std::reverse(live.begin(), live.end());
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "http_disk_cache: compacting %s, keeping %u of %u entries",
+        m_filePath.c_str(), static_cast<uint32_t>(keptCount), m_indexCount);
+
+    // Build the new segment alongside the old one and swap it in with a rename, so a crash
+    // part way through leaves the old segment intact
+    http_internal_string tempPath = m_filePath + ".tmp";
+    {
+        http_disk_cache compacted;
+        compacted.m_maxSize = m_maxSize;
+        if (!compacted.map(tempPath, true))
+        {
+            return HC_E_FAIL;
+        }
+        compacted.recover();
+
+        for (const auto& slot : live)
+        {
+            const record_header* record = record_at(slot.offset);
+            http_internal_string key(reinterpret_cast<const char*>(record + 1), record->keyLength);
+            compacted.append(key, reinterpret_cast<const uint8_t*>(record + 1) + record->keyLength, record->valueLength, 0);
+        }
+        compacted.flush();
+    }
+
+    unmap();
+    bool renamed;
+#if HC_USE_HANDLES
+    renamed = MoveFileExW(utf16_from_utf8(tempPath).c_str(), utf16_from_utf8(m_filePath).c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    renamed = ::rename(tempPath.c_str(), m_filePath.c_str()) == 0;
+#endif
+
+    if (!map(m_filePath, false))
+    {
+        HC_TRACE_ERROR(HTTPCLIENT, "http_disk_cache: failed to remap %s", m_filePath.c_str());
+        close();
+        return HC_E_FAIL;
+    }
+    recover();
+    return renamed ? HC_OK : HC_E_FAIL;
+}
+
+http_disk_cache::index_slot* http_disk_cache::find_slot(_In_ uint64_t keyHash, _In_ const http_internal_string& key)
+{
+    size_t mask = m_index.size() - 1;
+    for (size_t i = static_cast<size_t>(keyHash) & mask; m_index[i].offset != 0; i = (i + 1) & mask)
+    {
+        if (m_index[i].keyHash == keyHash && record_matches(m_index[i].offset, key))
+        {
+            return &m_index[i];
+        }
+    }
+    return nullptr;
+}
+
+void http_disk_cache::index_insert(_In_ uint64_t keyHash, _In_ uint32_t offset, _In_ uint32_t lastUse)
+{
+    if ((m_indexCount + 1) * 2 > m_index.size())
+    {
+        index_grow();
+    }
+
+    size_t mask = m_index.size() - 1;
+    size_t i = static_cast<size_t>(keyHash) & mask;
+    while (m_index[i].offset != 0)
+    {
+        i = (i + 1) & mask;
+    }
+
+    m_index[i].keyHash = keyHash;
+    m_index[i].offset = offset;
+    m_index[i].lastUse = lastUse;
+    m_indexCount++;
+}
+
+void http_disk_cache::index_erase(_In_ index_slot* slot)
+{
+    // Backward shift deletion: move later entries of the probe run into the hole unless
+    // that would put them before their home slot
+    size_t mask = m_index.size() - 1;
+    size_t hole = static_cast<size_t>(slot - m_index.data());
+    for (size_t i = (hole + 1) & mask; m_index[i].offset != 0; i = (i + 1) & mask)
+    {
+        size_t home = static_cast<size_t>(m_index[i].keyHash) & mask;
+        bool reachable = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable)
+        {
+            m_index[hole] = m_index[i];
+            hole = i;
+        }
+    }
+
+    m_index[hole] = index_slot();
+    m_indexCount--;
+}
+
+void http_disk_cache::index_grow()
+{
+    http_internal_vector<index_slot> old;
+    old.swap(m_index);
+    m_index.assign(old.size() * 2, index_slot());
+    m_indexCount = 0;
+    for (const auto& slot : old)
+    {
+        if (slot.offset != 0)
+        {
+            index_insert(slot.keyHash, slot.offset, slot.lastUse);
+        }
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
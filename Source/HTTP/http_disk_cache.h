@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Persistent key/value store behind http_response_cache, kept in a single memory mapped segment file.
+//
+// Records are only ever appended: writing a key again appends a new copy and removing a key appends
+// a tombstone.  Each record carries a CRC32 of its contents, so on open the segment is scanned from
+// the start and everything after the first torn or corrupt record is discarded.  The index mapping
+// keys to record offsets lives in memory and is rebuilt by that scan.
+//
+// When an append doesn't fit, the live records are compacted most recently used first into a new
+// segment which then replaces the old one.  Records that don't fit in three quarters of the maximum
+// size are evicted.
+//
+// Not thread safe; http_response_cache serializes access.
+class http_disk_cache
+{
+public:
+    http_disk_cache();
+    ~http_disk_cache();
+
+    HC_RESULT open(_In_z_ PCSTR filePath, _In_ uint64_t maxSize);
+    void close();
+    bool is_open() const { return m_view != nullptr; }
+
+    bool read(_In_ const http_internal_string& key, _Inout_ http_internal_vector<uint8_t>& value);
+    HC_RESULT write(_In_ const http_internal_string& key, _In_reads_bytes_(size) const uint8_t* value, _In_ size_t size);
+    void remove(_In_ const http_internal_string& key);
+
+    // Bytes of live records, excluding overwritten copies and tombstones
+    uint64_t size() const { return m_liveSize; }
+
+private:
+    struct record_header
+    {
+        uint32_t magic;
+        uint32_t checksum;     // CRC32 of keyLength onwards, including the key and value
+        uint32_t keyLength;
+        uint32_t valueLength;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    struct index_slot
+    {
+        uint64_t keyHash;
+        uint32_t offset;       // 0 when the slot is empty
+        uint32_t lastUse;
+    };
+
+    static uint64_t hash_key(_In_reads_bytes_(size) const char* key, _In_ size_t size);
+    static uint32_t record_size(_In_ size_t keyLength, _In_ size_t valueLength);
+    static uint32_t record_checksum(_In_ const record_header* header);
+
+    bool map(_In_ const http_internal_string& filePath, _In_ bool truncate);
+    void flush();
+    void unmap();
+    void recover();
+    HC_RESULT compact(_In_ uint64_t budget);
+
+    const record_header* record_at(_In_ uint32_t offset) const;
+    bool record_matches(_In_ uint32_t offset, _In_ const http_internal_string& key) const;
+    uint32_t append(_In_ const http_internal_string& key, _In_reads_bytes_(size) const uint8_t* value, _In_ size_t size, _In_ uint32_t flags);
+
+    index_slot* find_slot(_In_ uint64_t keyHash, _In_ const http_internal_string& key);
+    void index_insert(_In_ uint64_t keyHash, _In_ uint32_t offset, _In_ uint32_t lastUse);
+    void index_erase(_In_ index_slot* slot);
+    void index_grow();
+
+    http_internal_string m_filePath;
+    uint64_t m_maxSize;
+
+#if HC_USE_HANDLES
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+    uint8_t* m_view;
+    uint32_t m_viewSize;
+    uint32_t m_writeOffset;
+
+    http_internal_vector<index_slot> m_index; // open addressed with linear probing, capacity a power of two
+    uint32_t m_indexCount;
+    uint32_t m_useClock;
+    uint64_t m_liveSize;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "http_headers.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+struct interned_name
+{
+    PCSTR name;
+    PCWSTR wname;
+    size_t length;
+};
+
+#define INTERNED_NAME(x) { x, L##x, sizeof(x) - 1 }
+
+// Indexed by http_header_id
+static const interned_name s_headerNames[] =
+{
+    { nullptr, nullptr, 0 },
+    INTERNED_NAME("Accept"),
+    INTERNED_NAME("Accept-Encoding"),
+    INTERNED_NAME("Accept-Language"),
+    INTERNED_NAME("Age"),
+    INTERNED_NAME("Authorization"),
+    INTERNED_NAME("Cache-Control"),
+    INTERNED_NAME("Connection"),
+    INTERNED_NAME("Content-Encoding"),
+    INTERNED_NAME("Content-Length"),
+    INTERNED_NAME("Content-Type"),
+    INTERNED_NAME("Cookie"),
+    INTERNED_NAME("ETag"),
+    INTERNED_NAME("Host"),
+    INTERNED_NAME("If-Modified-Since"),
+    INTERNED_NAME("If-None-Match"),
+    INTERNED_NAME("Last-Modified"),
+    INTERNED_NAME("User-Agent"),
+    INTERNED_NAME("Vary"),
+};
+static_assert(ARRAYSIZE(s_headerNames) == static_cast<size_t>(http_header_id::count), "header table out of sync with http_header_id");
+
+// Indexed by http_method_id
+static const interned_name s_methodNames[] =
+{
+    { nullptr, nullptr, 0 },
+    INTERNED_NAME("GET"),
+    INTERNED_NAME("HEAD"),
+    INTERNED_NAME("POST"),
+    INTERNED_NAME("PUT"),
+    INTERNED_NAME("DELETE"),
+    INTERNED_NAME("PATCH"),
+    INTERNED_NAME("OPTIONS"),
+};
+static_assert(ARRAYSIZE(s_methodNames) == static_cast<size_t>(http_method_id::count), "method table out of sync with http_method_id");
+
+#undef INTERNED_NAME
+
+static char ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+http_header_id http_header_id_from_name(_In_z_ PCSTR headerName)
+{
+    if (headerName == nullptr)
+    {
+        return http_header_id::unknown;
+    }
+
+    size_t length = strlen(headerName);
+    for (size_t i = 1; i < ARRAYSIZE(s_headerNames); i++)
+    {
+        const interned_name& entry = s_headerNames[i];
+        if (entry.length != length)
+        {
+            continue;
+        }
+
+        size_t j = 0;
+        while (j < length && ascii_lower(entry.name[j]) == ascii_lower(headerName[j]))
+        {
+            j++;
+        }
+
+        if (j == length)
+        {
+            return static_cast<http_header_id>(i);
+        }
+    }
+
+    return http_header_id::unknown;
+}
+
+PCSTR http_header_name(_In_ http_header_id id)
+{
+    auto index = static_cast<size_t>(id);
+    return index < ARRAYSIZE(s_headerNames) ? s_headerNames[index].name : nullptr;
+}
+
+PCWSTR http_header_wname(_In_ http_header_id id)
+{
+    auto index = static_cast<size_t>(id);
+    return index < ARRAYSIZE(s_headerNames) ? s_headerNames[index].wname : nullptr;
+}
+
+PCSTR http_find_response_header(
+    _In_ const http_arena_map<http_arena_string, http_arena_string>& headers,
+    _In_ http_header_id id
+    )
+{
+    for (const auto& header : headers)
+    {
+        if (http_header_id_from_name(header.first.c_str()) == id)
+        {
+            return header.second.c_str();
+        }
+    }
+    return nullptr;
+}
+
+http_method_id http_method_id_from_name(_In_z_ PCSTR method)
+{
+    if (method == nullptr)
+    {
+        return http_method_id::unknown;
+    }
+
+    size_t length = strlen(method);
+    for (size_t i = 1; i < ARRAYSIZE(s_methodNames); i++)
+    {
+        const interned_name& entry = s_methodNames[i];
+        if (entry.length == length && memcmp(entry.name, method, length) == 0)
+        {
+            return static_cast<http_method_id>(i);
+        }
+    }
+
+    return http_method_id::unknown;
+}
+
+PCSTR http_method_name(_In_ http_method_id id)
+{
+    auto index = static_cast<size_t>(id);
+    return index < ARRAYSIZE(s_methodNames) ? s_methodNames[index].name : nullptr;
+}
+
+PCWSTR http_method_wname(_In_ http_method_id id)
+{
+    auto index = static_cast<size_t>(id);
+    return index < ARRAYSIZE(s_methodNames) ? s_methodNames[index].wname : nullptr;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Header names that are interned in a static table.  The id is assigned once when the
+// header is set on the call so transports can switch on it and serialize the name from
+// constant storage rather than converting or comparing strings for every request.
+enum class http_header_id : uint8_t
+{
+    unknown = 0,
+    accept,
+    accept_encoding,
+    accept_language,
+    age,
+    authorization,
+    cache_control,
+    connection,
+    content_encoding,
+    content_length,
+    content_type,
+    cookie,
+    etag,
+    host,
+    if_modified_since,
+    if_none_match,
+    last_modified,
+    user_agent,
+    vary,
+    count
+};
+
+enum class http_method_id : uint8_t
+{
+    unknown = 0,
+    get,
+    head,
+    post,
+    put,
+    delete_,
+    patch,
+    options,
+    count
+};
+
+// Allocator aware so the value is placed in the owning call's arena
+struct http_header_value
+{
+    typedef http_arena_allocator<char> allocator_type;
+
+    http_header_value() :
+        id(http_header_id::unknown)
+    {
+    }
+
+    explicit http_header_value(_In_ const allocator_type& alloc) :
+        id(http_header_id::unknown),
+        value(alloc)
+    {
+    }
+
+    http_header_value(_In_ const http_header_value& other, _In_ const allocator_type& alloc) :
+        id(other.id),
+        value(other.value, alloc)
+    {
+    }
+
+    http_header_value(_In_ http_header_value&& other, _In_ const allocator_type& alloc) :
+        id(other.id),
+        value(std::move(other.value), alloc)
+    {
+    }
+
+    http_header_id id;
+    http_arena_string value;
+};
+
+// Header names are matched case-insensitively as required by RFC 7230
+http_header_id http_header_id_from_name(_In_z_ PCSTR headerName);
+
+// Returns the canonical spelling of a well-known header, or nullptr for http_header_id::unknown
+PCSTR http_header_name(_In_ http_header_id id);
+PCWSTR http_header_wname(_In_ http_header_id id);
+
+// Response headers keep the server's spelling, this finds a well-known one regardless of case.
+// Returns nullptr if the header isn't present.
+PCSTR http_find_response_header(
+    _In_ const http_arena_map<http_arena_string, http_arena_string>& headers,
+    _In_ http_header_id id
+    );
+
+// Methods are case-sensitive tokens so only the canonical upper case spelling is interned
+http_method_id http_method_id_from_name(_In_z_ PCSTR method);
+
+PCSTR http_method_name(_In_ http_method_id id);
+PCWSTR http_method_wname(_In_ http_method_id id);
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
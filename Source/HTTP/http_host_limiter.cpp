@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "httpcall.h"
+#include "http_host_limiter.h"
+#include "uri.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+static void to_lower_in_place(_Inout_ http_internal_string& value)
+{
+    for (auto& c : value)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+}
+
+http_host_limiter::http_host_limiter() :
+    m_maxCallsPerHost(DEFAULT_MAX_CALLS_PER_HOST)
+{
+}
+
+http_host_limiter::~http_host_limiter()
+{
+    // Calls still waiting at cleanup are never sent
+    for (auto& host : m_hosts)
+    {
+        for (auto& waiter : host.second.waiting)
+        {
+            HCHttpCallCloseHandle(waiter.call);
+        }
+    }
+}
+
+http_internal_string http_host_limiter::host_key(_In_ HC_CALL_HANDLE call)
+{
+    Uri uri(http_internal_string(call->url.data(), call->url.size()));
+    if (!uri.IsValid())
+    {
+        return http_internal_string();
+    }
+
+    http_internal_string host = uri.Host();
+    to_lower_in_place(host);
+    return host;
+}
+
+void http_host_limiter::set_max_calls_per_host(
+    _In_ uint32_t maxCallsPerHost,
+    _Inout_ http_internal_vector<http_host_waiter>& admitted
+    )
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_maxCallsPerHost = maxCallsPerHost;
+
+    for (auto& host : m_hosts)
+    {
+        auto& state = host.second;
+        while (!state.waiting.empty() && (m_maxCallsPerHost == 0 || state.inFlight < m_maxCallsPerHost))
+        {
+            auto waiter = state.waiting.front();
+            state.waiting.pop_front();
+            waiter.call->hostSlotKey.assign(host.first.data(), host.first.size());
+            state.inFlight++;
+            admitted.push_back(waiter);
+        }
+    }
+}
+
+uint32_t http_host_limiter::max_calls_per_host()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_maxCallsPerHost;
+}
+
+bool http_host_limiter::try_acquire(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle)
+{
+    call->hostSlotKey.clear();
+    http_internal_string key = host_key(call);
+    if (key.empty())
+    {
+        // Left for the perform function to fail
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto& state = m_hosts[key];
+    if (m_maxCallsPerHost == 0 || state.inFlight < m_maxCallsPerHost)
+    {
+        state.inFlight++;
+        call->hostSlotKey.assign(key.data(), key.size());
+        return true;
+    }
+
+    state.waiting.push_back(http_host_waiter{ HCHttpCallDuplicateHandle(call), taskHandle });
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: waiting for one of %u calls to %s to finish, %zu waiting",
+        call->id, m_maxCallsPerHost, key.c_str(), state.waiting.size());
+    return false;
+}
+
+bool http_host_limiter::release(_In_ HC_CALL_HANDLE call, _Out_ http_host_waiter* next)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (call->hostSlotKey.empty())
+    {
+        return false;
+    }
+
+    http_internal_string key(call->hostSlotKey.data(), call->hostSlotKey.size());
+    call->hostSlotKey.clear();
+
+    auto it = m_hosts.find(key);
+    if (it == m_hosts.end())
+    {
+        return false;
+    }
+
+    auto& state = it->second;
+    state.inFlight--;
+    if (!state.waiting.empty() && (m_maxCallsPerHost == 0 || state.inFlight < m_maxCallsPerHost))
+    {
+        *next = state.waiting.front();
+        state.waiting.pop_front();
+        next->call->hostSlotKey.assign(key.data(), key.size());
+        state.inFlight++;
+        return true;
+    }
+
+    if (state.inFlight == 0 && state.waiting.empty())
+    {
+        m_hosts.erase(it);
+    }
+    return false;
+}
+
+void http_host_limiter::get_stats(_In_opt_z_ PCSTR host, _Out_ uint32_t* inFlight, _Out_ uint32_t* queued)
+{
+    *inFlight = 0;
+    *queued = 0;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (host != nullptr)
+    {
+        http_internal_string key(host);
+        to_lower_in_place(key);
+        auto it = m_hosts.find(key);
+        if (it != m_hosts.end())
+        {
+            *inFlight = it->second.inFlight;
+            *queued = static_cast<uint32_t>(it->second.waiting.size());
+        }
+        return;
+    }
+
+    for (const auto& state : m_hosts)
+    {
+        *inFlight += state.second.inFlight;
+        *queued += static_cast<uint32_t>(state.second.waiting.size());
+    }
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// No limit unless the app sets one with HCGlobalSetMaxCallsPerHost()
+const uint32_t DEFAULT_MAX_CALLS_PER_HOST = 0;
+
+// Holds a reference on call, taken with HCHttpCallDuplicateHandle(), until the call is sent
+struct http_host_waiter
+{
+    HC_CALL_HANDLE call;
+    HC_TASK_HANDLE taskHandle;
+};
+
+// Caps the number of calls in flight to each host.
+//
+// A call takes one of its host's slots before it is handed to the perform function and gives it
+// back when its task is completed.  Calls beyond the limit wait in first in, first out order and
+// each freed slot passes straight to the oldest waiting call for that host, so a burst of calls
+// never opens more than the limit's worth of requests to one server.
+class http_host_limiter
+{
+public:
+    http_host_limiter();
+    ~http_host_limiter();
+
+    // 0 removes the limit.  Raising the limit admits waiting calls, which are appended to admitted.
+    void set_max_calls_per_host(
+        _In_ uint32_t maxCallsPerHost,
+        _Inout_ http_internal_vector<http_host_waiter>& admitted
+        );
+    uint32_t max_calls_per_host();
+
+    // Returns true if the call can be sent now.  Otherwise it takes a reference on the call, waits
+    // for a slot and is returned by release() once it has one.
+    bool try_acquire(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle);
+
+    // Called when a call's task is completed.  If the call held a slot that passes to a waiting
+    // call, returns true with the call to send next.
+    bool release(_In_ HC_CALL_HANDLE call, _Out_ http_host_waiter* next);
+
+    // Counts for one host, or summed over every host if host is nullptr
+    void get_stats(_In_opt_z_ PCSTR host, _Out_ uint32_t* inFlight, _Out_ uint32_t* queued);
+
+private:
+    struct host_state
+    {
+        uint32_t inFlight;
+        http_internal_dequeue<http_host_waiter> waiting;
+    };
+
+    static http_internal_string host_key(_In_ HC_CALL_HANDLE call);
+
+    std::mutex m_lock;
+    http_internal_map<http_internal_string, host_state> m_hosts;
+    uint32_t m_maxCallsPerHost;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,524 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include <climits>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#include "http_socket.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+bool http_socket_startup()
+{
+#if defined(_WIN32)
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+void http_socket_cleanup()
+{
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void http_socket_close(_In_ http_socket socket)
+{
+#if defined(_WIN32)
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool http_socket_set_blocking(_In_ http_socket socket, _In_ bool blocking)
+{
+#if defined(_WIN32)
+    u_long nonBlocking = blocking ? 0 : 1;
+    return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0)
+    {
+        return false;
+    }
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) == 0;
+#endif
+}
+
+void http_socket_shutdown(_In_ http_socket socket)
+{
+#if defined(_WIN32)
+    shutdown(socket, SD_BOTH);
+#else
+    shutdown(socket, SHUT_RDWR);
+#endif
+}
+
+int http_socket_wait_readable(_In_ http_socket socket, _In_ uint32_t timeoutInMilliseconds)
+{
+#if defined(_WIN32)
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(socket, &readSet);
+    timeval timeout;
+    timeout.tv_sec = static_cast<long>(timeoutInMilliseconds / 1000);
+    timeout.tv_usec = static_cast<long>((timeoutInMilliseconds % 1000) * 1000);
+    int result = select(0, &readSet, nullptr, nullptr, &timeout);
+#else
+    pollfd pollFd = {};
+    pollFd.fd = socket;
+    pollFd.events = POLLIN;
+    int result = poll(&pollFd, 1, static_cast<int>(timeoutInMilliseconds));
+    if (result < 0 && errno == EINTR)
+    {
+        return 0;
+    }
+#endif
+    return result < 0 ? -1 : (result > 0 ? 1 : 0);
+}
+
+bool http_socket_send_all(_In_ http_socket socket, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    while (size > 0)
+    {
+#if defined(_WIN32)
+        int sent = send(socket, reinterpret_cast<const char*>(data), static_cast<int>(MIN(size, static_cast<size_t>(INT_MAX))), 0);
+#elif defined(MSG_NOSIGNAL)
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+#else
+        ssize_t sent = send(socket, data, size, 0);
+#endif
+        if (sent <= 0)
+        {
+#if !defined(_WIN32)
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+#endif
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+int http_socket_receive(_In_ http_socket socket, _Out_writes_bytes_to_(size, return) uint8_t* buffer, _In_ size_t size)
+{
+    int maxSize = static_cast<int>(MIN(size, static_cast<size_t>(INT_MAX)));
+#if defined(_WIN32)
+    int received = recv(socket, reinterpret_cast<char*>(buffer), maxSize, 0);
+#else
+    ssize_t received;
+    do
+    {
+        received = recv(socket, buffer, static_cast<size_t>(maxSize), 0);
+    } while (received < 0 && errno == EINTR);
+#endif
+    return received < 0 ? -1 : static_cast<int>(received);
+}
+
+int http_socket_send(_In_ http_socket socket, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+#if defined(_WIN32)
+    int sent = send(socket, reinterpret_cast<const char*>(data), static_cast<int>(MIN(size, static_cast<size_t>(INT_MAX))), 0);
+#else
+    ssize_t sent;
+    do
+    {
+#if defined(MSG_NOSIGNAL)
+        sent = send(socket, data, MIN(size, static_cast<size_t>(INT_MAX)), MSG_NOSIGNAL);
+#else
+        sent = send(socket, data, MIN(size, static_cast<size_t>(INT_MAX)), 0);
+#endif
+    } while (sent < 0 && errno == EINTR);
+#endif
+    return sent < 0 ? -1 : static_cast<int>(sent);
+}
+
+int http_socket_send_buffers(
+    _In_ http_socket socket,
+    _In_reads_(count) const http_socket_buffer* buffers,
+    _In_ size_t count
+    )
+{
+    // The total is kept within what the return value can report
+    size_t remaining = static_cast<size_t>(INT_MAX);
+    size_t used = 0;
+#if defined(_WIN32)
+    WSABUF platformBuffers[HTTP_SOCKET_MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < count && used < HTTP_SOCKET_MAX_SEND_BUFFERS && remaining > 0; ++i)
+    {
+        size_t size = MIN(buffers[i].size, remaining);
+        platformBuffers[used].buf = reinterpret_cast<CHAR*>(const_cast<uint8_t*>(buffers[i].data));
+        platformBuffers[used].len = static_cast<ULONG>(size);
+        remaining -= size;
+        ++used;
+    }
+
+    DWORD sent = 0;
+    if (WSASend(socket, platformBuffers, static_cast<DWORD>(used), &sent, 0, nullptr, nullptr) != 0)
+    {
+        return -1;
+    }
+    return static_cast<int>(sent);
+#else
+    iovec platformBuffers[HTTP_SOCKET_MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < count && used < HTTP_SOCKET_MAX_SEND_BUFFERS && remaining > 0; ++i)
+    {
+        size_t size = MIN(buffers[i].size, remaining);
+        platformBuffers[used].iov_base = const_cast<uint8_t*>(buffers[i].data);
+        platformBuffers[used].iov_len = size;
+        remaining -= size;
+        ++used;
+    }
+
+    // sendmsg() rather than writev() so a closed peer can't raise SIGPIPE
+    msghdr message = {};
+    message.msg_iov = platformBuffers;
+    message.msg_iovlen = used;
+    ssize_t sent;
+    do
+    {
+#if defined(MSG_NOSIGNAL)
+        sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+#else
+        sent = sendmsg(socket, &message, 0);
+#endif
+    } while (sent < 0 && errno == EINTR);
+    return sent < 0 ? -1 : static_cast<int>(sent);
+#endif
+}
+
+bool http_socket_would_block()
+{
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+int http_socket_poll(
+    _Inout_updates_(count) http_socket_poll_entry* entries,
+    _In_ size_t count,
+    _In_ uint32_t timeoutInMilliseconds
+    )
+{
+#if defined(_WIN32)
+    http_internal_vector<WSAPOLLFD> pollFds(count);
+#else
+    http_internal_vector<pollfd> pollFds(count);
+#endif
+    for (size_t i = 0; i < count; i++)
+    {
+        pollFds[i].fd = entries[i].socket;
+        pollFds[i].events = static_cast<short>(POLLIN | (entries[i].wantWrite ? POLLOUT : 0));
+        pollFds[i].revents = 0;
+    }
+
+#if defined(_WIN32)
+    int result = WSAPoll(pollFds.data(), static_cast<ULONG>(count), static_cast<INT>(timeoutInMilliseconds));
+#else
+    int result = poll(pollFds.data(), static_cast<nfds_t>(count), static_cast<int>(timeoutInMilliseconds));
+    if (result < 0 && errno == EINTR)
+    {
+        result = 0;
+    }
+#endif
+
+    for (size_t i = 0; i < count; i++)
+    {
+        short revents = result > 0 ? pollFds[i].revents : 0;
+        entries[i].readable = (revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) != 0;
+        entries[i].writable = (revents & POLLOUT) != 0;
+    }
+    return result < 0 ? -1 : result;
+}
+
+http_socket http_socket_open_wake()
+{
+    http_socket socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket == HTTP_INVALID_SOCKET)
+    {
+        return HTTP_INVALID_SOCKET;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+#if defined(_WIN32)
+    int length = sizeof(address);
+#else
+    socklen_t length = sizeof(address);
+#endif
+    if (bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) != 0 ||
+        connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        !http_socket_set_blocking(socket, false))
+    {
+        http_socket_close(socket);
+        return HTTP_INVALID_SOCKET;
+    }
+    return socket;
+}
+
+struct connect_attempt
+{
+    http_socket socket;
+    uint32_t addressIndex;
+};
+
+// Starts a non-blocking connect.  Returns HTTP_INVALID_SOCKET if the attempt failed immediately.
+static http_socket start_connect(_In_z_ PCSTR address, _In_ uint16_t port)
+{
+    char portString[8];
+    snprintf(portString, sizeof(portString), "%u", port);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(address, portString, &hints, &result) != 0)
+    {
+        return HTTP_INVALID_SOCKET;
+    }
+
+    http_socket socket = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (socket != HTTP_INVALID_SOCKET)
+    {
+        bool started = false;
+        if (http_socket_set_blocking(socket, false))
+        {
+#if defined(_WIN32)
+            started = connect(socket, result->ai_addr, static_cast<int>(result->ai_addrlen)) == 0 || WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            started = connect(socket, result->ai_addr, result->ai_addrlen) == 0 || errno == EINPROGRESS;
+#endif
+        }
+        if (!started)
+        {
+            http_socket_close(socket);
+            socket = HTTP_INVALID_SOCKET;
+        }
+    }
+
+    freeaddrinfo(result);
+    return socket;
+}
+
+// Waits up to timeoutInMilliseconds for attempts to finish.  Each finished attempt's index
+// is added to finished.
+static void wait_for_attempts(
+    _In_ const http_internal_vector<connect_attempt>& attempts,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Inout_ http_internal_vector<size_t>& finished
+    )
+{
+#if defined(_WIN32)
+    // WSAPoll doesn't report failed connects on older versions of Windows, so use select.
+    // A failed connect is reported in the except set.
+    fd_set writeSet;
+    fd_set exceptSet;
+    FD_ZERO(&writeSet);
+    FD_ZERO(&exceptSet);
+    for (const auto& attempt : attempts)
+    {
+        FD_SET(attempt.socket, &writeSet);
+        FD_SET(attempt.socket, &exceptSet);
+    }
+
+    timeval timeout;
+    timeout.tv_sec = static_cast<long>(timeoutInMilliseconds / 1000);
+    timeout.tv_usec = static_cast<long>((timeoutInMilliseconds % 1000) * 1000);
+    if (select(0, nullptr, &writeSet, &exceptSet, &timeout) <= 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < attempts.size(); i++)
+    {
+        if (FD_ISSET(attempts[i].socket, &writeSet) || FD_ISSET(attempts[i].socket, &exceptSet))
+        {
+            finished.push_back(i);
+        }
+    }
+#else
+    http_internal_vector<pollfd> pollFds;
+    for (const auto& attempt : attempts)
+    {
+        pollfd pollFd = {};
+        pollFd.fd = attempt.socket;
+        pollFd.events = POLLOUT;
+        pollFds.push_back(pollFd);
+    }
+
+    if (poll(pollFds.data(), static_cast<nfds_t>(pollFds.size()), static_cast<int>(timeoutInMilliseconds)) <= 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < pollFds.size(); i++)
+    {
+        if (pollFds[i].revents != 0)
+        {
+            finished.push_back(i);
+        }
+    }
+#endif
+}
+
+static bool attempt_succeeded(_In_ http_socket socket)
+{
+    int error = 0;
+#if defined(_WIN32)
+    int length = sizeof(error);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0)
+#else
+    socklen_t length = sizeof(error);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+#endif
+    {
+        return false;
+    }
+    return error == 0;
+}
+
+HC_RESULT http_connect_race(
+    _In_reads_(addressCount) const PCSTR* addresses,
+    _In_ uint32_t addressCount,
+    _In_ uint16_t port,
+    _In_ uint32_t attemptDelayInMilliseconds,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Out_ http_socket* connectedSocket
+    )
+{
+    *connectedSocket = HTTP_INVALID_SOCKET;
+    if (addressCount == 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    // Interleave the families so a broken path for one only costs a single attempt delay
+    http_internal_vector<uint32_t> ipv6;
+    http_internal_vector<uint32_t> ipv4;
+    for (uint32_t i = 0; i < addressCount; i++)
+    {
+        (strchr(addresses[i], ':') != nullptr ? ipv6 : ipv4).push_back(i);
+    }
+    bool preferIpv6 = strchr(addresses[0], ':') != nullptr;
+    const auto& firstFamily = preferIpv6 ? ipv6 : ipv4;
+    const auto& secondFamily = preferIpv6 ? ipv4 : ipv6;
+    http_internal_vector<uint32_t> order;
+    for (size_t i = 0; i < firstFamily.size() || i < secondFamily.size(); i++)
+    {
+        if (i < firstFamily.size())
+        {
+            order.push_back(firstFamily[i]);
+        }
+        if (i < secondFamily.size())
+        {
+            order.push_back(secondFamily[i]);
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + std::chrono::milliseconds(timeoutInMilliseconds);
+    auto nextAttempt = now;
+    size_t next = 0;
+    http_internal_vector<connect_attempt> attempts;
+    http_internal_vector<size_t> finished;
+
+    while (true)
+    {
+        now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        // Start the next attempt when its delay is up, or straight away if nothing is in flight
+        if (next < order.size() && (now >= nextAttempt || attempts.empty()))
+        {
+            uint32_t addressIndex = order[next++];
+            http_socket socket = start_connect(addresses[addressIndex], port);
+            if (socket == HTTP_INVALID_SOCKET)
+            {
+                HC_TRACE_INFORMATION(HTTPCLIENT, "http_connect_race: connect to %s failed to start", addresses[addressIndex]);
+                continue;
+            }
+
+            connect_attempt attempt;
+            attempt.socket = socket;
+            attempt.addressIndex = addressIndex;
+            attempts.push_back(attempt);
+            nextAttempt = now + std::chrono::milliseconds(attemptDelayInMilliseconds);
+        }
+
+        if (attempts.empty())
+        {
+            break;
+        }
+
+        auto waitUntil = (next < order.size() && nextAttempt < deadline) ? nextAttempt : deadline;
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(waitUntil - now).count();
+        finished.clear();
+        wait_for_attempts(attempts, static_cast<uint32_t>(wait > 0 ? wait : 0), finished);
+
+        // Walk backwards so erasing keeps the remaining indices valid
+        for (size_t i = finished.size(); i-- > 0;)
+        {
+            connect_attempt attempt = attempts[finished[i]];
+            attempts.erase(attempts.begin() + finished[i]);
+
+            if (*connectedSocket == HTTP_INVALID_SOCKET && attempt_succeeded(attempt.socket))
+            {
+                HC_TRACE_INFORMATION(HTTPCLIENT, "http_connect_race: connected to %s", addresses[attempt.addressIndex]);
+                *connectedSocket = attempt.socket;
+            }
+            else
+            {
+                HC_TRACE_INFORMATION(HTTPCLIENT, "http_connect_race: connect to %s failed", addresses[attempt.addressIndex]);
+                http_socket_close(attempt.socket);
+                nextAttempt = now;
+            }
+        }
+
+        if (*connectedSocket != HTTP_INVALID_SOCKET)
+        {
+            break;
+        }
+    }
+
+    for (const auto& attempt : attempts)
+    {
+        http_socket_close(attempt.socket);
+    }
+
+    if (*connectedSocket == HTTP_INVALID_SOCKET)
+    {
+        return HC_E_FAIL;
+    }
+
+    http_socket_set_blocking(*connectedSocket, true);
+    return HC_OK;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+#if defined(_WIN32)
+typedef SOCKET http_socket;
+const http_socket HTTP_INVALID_SOCKET = INVALID_SOCKET;
+#else
+typedef int http_socket;
+const http_socket HTTP_INVALID_SOCKET = -1;
+#endif
+
+// Starts the platform socket library.  Each successful call must be matched by http_socket_cleanup().
+bool http_socket_startup();
+void http_socket_cleanup();
+
+void http_socket_close(_In_ http_socket socket);
+bool http_socket_set_blocking(_In_ http_socket socket, _In_ bool blocking);
+
+// Stops both directions, waking a thread blocked on the socket
+void http_socket_shutdown(_In_ http_socket socket);
+
+// Returns 1 if the socket is readable, 0 on timeout and -1 on error
+int http_socket_wait_readable(_In_ http_socket socket, _In_ uint32_t timeoutInMilliseconds);
+
+// Blocking I/O.  http_socket_receive returns the number of bytes read, 0 once the peer has
+// closed the connection, or -1 on error.
+bool http_socket_send_all(_In_ http_socket socket, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+int http_socket_receive(_In_ http_socket socket, _Out_writes_bytes_to_(size, return) uint8_t* buffer, _In_ size_t size);
+
+// Non-blocking I/O.  http_socket_send returns the number of bytes written, which may be fewer
+// than size, or -1 on error.  After a -1 from either call, http_socket_would_block() says whether
+// the socket just wasn't ready.
+int http_socket_send(_In_ http_socket socket, _In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+bool http_socket_would_block();
+
+struct http_socket_buffer
+{
+    const uint8_t* data;
+    size_t size;
+};
+
+// The most buffers one http_socket_send_buffers() call takes
+const size_t HTTP_SOCKET_MAX_SEND_BUFFERS = 64;
+
+// Non-blocking gathered write of the buffers, in order, with one system call (writev semantics).
+// Returns the number of bytes written like http_socket_send(), which may end part way through
+// any buffer.
+int http_socket_send_buffers(
+    _In_ http_socket socket,
+    _In_reads_(count) const http_socket_buffer* buffers,
+    _In_ size_t count
+    );
+
+struct http_socket_poll_entry
+{
+    http_socket socket;
+    bool wantWrite;
+    bool readable;  // also set on an error or hang up, so the next receive reports it
+    bool writable;
+};
+
+// Waits for any of the sockets to be ready.  Returns the number that are, 0 on timeout and -1 on error.
+int http_socket_poll(
+    _Inout_updates_(count) http_socket_poll_entry* entries,
+    _In_ size_t count,
+    _In_ uint32_t timeoutInMilliseconds
+    );
+
+// Opens a non-blocking UDP socket on the loopback interface that is connected to itself.  Sending
+// a byte on it wakes a thread in http_socket_poll() that is waiting for it to be readable.
+http_socket http_socket_open_wake();
+
+// Connects to the first reachable address using Happy Eyeballs (RFC 8305).
+//
+// Addresses are numeric IPv4 or IPv6 strings in preference order, as returned by http_dns_resolver.
+// They are reordered to alternate between address families, starting with the family of the first
+// address, and a non-blocking connect is started to each in turn every attemptDelay milliseconds,
+// or as soon as the previous attempt fails.  The first attempt to connect wins and every other
+// socket is closed.  Blocks the calling thread for at most timeoutInMilliseconds.  The connected
+// socket is returned in blocking mode.
+HC_RESULT http_connect_race(
+    _In_reads_(addressCount) const PCSTR* addresses,
+    _In_ uint32_t addressCount,
+    _In_ uint16_t port,
+    _In_ uint32_t attemptDelayInMilliseconds,
+    _In_ uint32_t timeoutInMilliseconds,
+    _Out_ http_socket* connectedSocket
+    );
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -4,6 +4,7 @@
 #include "pch.h"
 #include "httpcall.h"
 #include "../mock/mock.h"
+#include "uri.h"
 
 using namespace xbox::httpclient;
 
@@ -22,12 +23,15 @@ try
     if (nullptr == httpSingleton)
         return HC_E_NOTINITIALISED;
 
-    HC_CALL* call = new HC_CALL();
+    HC_CALL* call = new HC_CALL(httpSingleton->m_callArenaSize);
 
     call->retryAllowed = httpSingleton->m_retryAllowed;
     call->timeoutInSeconds = httpSingleton->m_timeoutInSeconds;
     call->timeoutWindowInSeconds = httpSingleton->m_timeoutWindowInSeconds;
     call->retryDelayInSeconds = httpSingleton->m_retryDelayInSeconds;
+    call->responseDecompressionEnabled = httpSingleton->m_responseDecompressionEnabled;
+    call->compressionLevel = httpSingleton->m_compressionLevel;
+    call->coalescingEnabled = httpSingleton->m_coalescingEnabled;
 
     call->id = ++httpSingleton->m_lastId;
 
@@ -72,6 +76,13 @@ try
     if (refCount <= 0)
     {
         assert(refCount == 0); // should only fire at 0
+        auto httpSingleton = get_http_singleton(false);
+        if (httpSingleton != nullptr)
+        {
+            httpSingleton->record_call_arena_usage(call->arena.bytes_used());
+        }
+
+        // Releases every block of the call's arena in one go
         delete call;
     }
 
@@ -79,6 +90,134 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallReset(
+    _In_ HC_CALL_HANDLE call
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    if (call->performInProgress)
+    {
+        return HC_E_PERFORMALREADYCALLED;
+    }
+
+    uint64_t previousId = call->id;
+    call->id = ++httpSingleton->m_lastId;
+
+    // clear() keeps the string capacity and map nodes go back to the call's arena
+    call->responseString.clear();
+    call->sharedResponseBody.reset();
+    call->responseHeaders.clear();
+    call->responseInflater.reset();
+    call->cacheState = http_cache_state::none;
+    call->cacheEntry.reset();
+    call->coalescingKey.clear();
+    call->hostSlotKey.clear();
+    call->statusCode = 0;
+    call->networkErrorCode = HC_OK;
+    call->platformNetworkErrorCode = 0;
+    call->task.reset();
+    call->performCalled = false;
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallReset [ID %llu]: previous ID %llu", call->id, previousId);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallClone(
+    _In_ HC_CALL_HANDLE templateCall,
+    _Out_ HC_CALL_HANDLE* callHandle
+    ) HC_NOEXCEPT
+try
+{
+    if (templateCall == nullptr || callHandle == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    // Size the arena so the copied request fits in a single block
+    size_t arenaSize = httpSingleton->m_callArenaSize;
+    std::unique_ptr<HC_CALL> call(new HC_CALL(max(arenaSize, templateCall->arena.bytes_used())));
+
+    // Assignment keeps the new call's allocator so everything is copied into its own arena
+    call->method = templateCall->method;
+    call->methodId = templateCall->methodId;
+    call->url = templateCall->url;
+    call->requestBodyBytes = templateCall->requestBodyBytes;
+    call->requestHeaders = templateCall->requestHeaders;
+
+    call->retryAllowed = templateCall->retryAllowed;
+    call->timeoutInSeconds = templateCall->timeoutInSeconds;
+    call->timeoutWindowInSeconds = templateCall->timeoutWindowInSeconds;
+    call->retryDelayInSeconds = templateCall->retryDelayInSeconds;
+    call->enableAssertsForThrottling = templateCall->enableAssertsForThrottling;
+    call->responseDecompressionEnabled = templateCall->responseDecompressionEnabled;
+    call->compressionLevel = templateCall->compressionLevel;
+    call->requestBodyCompressed = templateCall->requestBodyCompressed;
+    call->coalescingEnabled = templateCall->coalescingEnabled;
+
+    call->id = ++httpSingleton->m_lastId;
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallClone [ID %llu]: template ID %llu", call->id, templateCall->id);
+
+    *callHandle = call.release();
+    return HC_OK;
+}
+CATCH_RETURN()
+
+// Bodies smaller than this fit in a packet or two so compressing them saves no round trips
+static const size_t MIN_COMPRESSED_REQUEST_BODY_SIZE = 1024;
+
+static void compress_request_body(_In_ HC_CALL_HANDLE call)
+{
+    if (call->compressionLevel == HC_COMPRESSION_LEVEL_NONE ||
+        call->requestBodyCompressed ||
+        call->requestBodyBytes.size() < MIN_COMPRESSED_REQUEST_BODY_SIZE)
+    {
+        return;
+    }
+
+    // Leave bodies the caller has already encoded alone
+    PCSTR contentEncodingName = http_header_name(http_header_id::content_encoding);
+    if (call->requestHeaders.find(contentEncodingName) != call->requestHeaders.end())
+    {
+        return;
+    }
+
+    http_internal_vector<uint8_t> compressed;
+    http_deflater deflater(call->compressionLevel);
+    if (deflater.compress(call->requestBodyBytes.data(), call->requestBodyBytes.size(), compressed) != HC_OK ||
+        compressed.size() >= call->requestBodyBytes.size())
+    {
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]: request body not compressible, sending as is", call->id);
+        return;
+    }
+
+    HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]: compressed request body from %llu to %llu bytes",
+        call->id, static_cast<uint64_t>(call->requestBodyBytes.size()), static_cast<uint64_t>(compressed.size()));
+
+    call->requestBodyBytes.assign(compressed.begin(), compressed.end());
+    call->requestBodyString.clear();
+    auto& header = call->requestHeaders[contentEncodingName];
+    header.id = http_header_id::content_encoding;
+    header.value = "gzip";
+    call->requestBodyCompressed = true;
+}
+
 HC_RESULT HttpCallPerformExecute(
     _In_opt_ void* executionRoutineContext,
     _In_ HC_TASK_HANDLE taskHandle
@@ -97,6 +236,7 @@ try
     }
 
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformExecute [ID %llu]", call->id);
+    http_task_set_execute_completed_routine(taskHandle, http_call_perform_completed, call);
 
     bool matchedMocks = false;
     if (httpSingleton->m_mocksEnabled)
@@ -108,19 +248,28 @@ try
         }
     }
    
-    if (!matchedMocks) // if there wasn't a matched mock, then real call
+    if (!matchedMocks && httpSingleton->m_requestCoalescer->try_attach(call, taskHandle))
     {
-        HC_HTTP_CALL_PERFORM_FUNC performFunc = httpSingleton->m_performFunc;
-        if (performFunc != nullptr)
+        // Completed along with the identical call already in flight
+        return HC_OK;
+    }
+
+    bool servedFromCache = false;
+    if (!matchedMocks)
+    {
+        servedFromCache = httpSingleton->m_responseCache->lookup(call);
+        if (servedFromCache)
         {
-            try
-            {
-                performFunc(call, taskHandle);
-            }
-            catch (...)
-            {
-                HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: failed", call->id);
-            }
+            HCTaskSetCompleted(taskHandle);
+        }
+    }
+
+    if (!matchedMocks && !servedFromCache) // if there wasn't a matched mock or fresh cache entry, then real call
+    {
+        // Otherwise the call waits until a call to the same host completes
+        if (httpSingleton->m_hostLimiter->try_acquire(call, taskHandle))
+        {
+            http_call_perform_admitted(HCHttpCallDuplicateHandle(call), taskHandle);
         }
     }
 
@@ -128,6 +277,84 @@ try
 }
 CATCH_RETURN()
 
+static void perform_call(_In_ HC_CALL_HANDLE call, _In_ HC_TASK_HANDLE taskHandle)
+{
+    auto httpSingleton = get_http_singleton(false);
+    if (nullptr == httpSingleton)
+        return;
+
+    HC_HTTP_CALL_PERFORM_FUNC performFunc = httpSingleton->m_performFunc;
+    if (performFunc != nullptr)
+    {
+        try
+        {
+            compress_request_body(call);
+            performFunc(call, taskHandle);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerform [ID %llu]: failed", call->id);
+        }
+    }
+}
+
+// Calls admitted on this thread while it is inside a perform function
+static thread_local http_internal_dequeue<http_host_waiter>* t_admittedCalls = nullptr;
+
+void http_call_perform_admitted(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+{
+    // A perform function that completes its task before returning passes the host slot on to
+    // the next waiting call from inside it.  Send those calls in a loop here rather than
+    // recursing once per waiting call.
+    if (t_admittedCalls != nullptr)
+    {
+        t_admittedCalls->push_back(http_host_waiter{ call, taskHandle });
+        return;
+    }
+
+    http_internal_dequeue<http_host_waiter> admitted;
+    admitted.push_back(http_host_waiter{ call, taskHandle });
+    t_admittedCalls = &admitted;
+    while (!admitted.empty())
+    {
+        auto next = admitted.front();
+        admitted.pop_front();
+        perform_call(next.call, next.taskHandle);
+        HCHttpCallCloseHandle(next.call);
+    }
+    t_admittedCalls = nullptr;
+}
+
+void http_call_perform_completed(
+    _In_opt_ void* context,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+{
+    UNREFERENCED_PARAMETER(taskHandle);
+    HC_CALL_HANDLE call = static_cast<HC_CALL_HANDLE>(context);
+    if (call == nullptr)
+    {
+        return;
+    }
+    call->performInProgress = false;
+
+    auto httpSingleton = get_http_singleton(false);
+    if (httpSingleton == nullptr)
+    {
+        return;
+    }
+
+    // A call waiting for the host's slot is sent now
+    http_host_waiter nextCall = {};
+    if (httpSingleton->m_hostLimiter->release(call, &nextCall))
+    {
+        http_call_perform_admitted(nextCall.call, nextCall.taskHandle);
+    }
+}
+
 HC_RESULT HttpCallPerformWriteResults(
     _In_opt_ void* writeResultsRoutineContext,
     _In_ HC_TASK_HANDLE taskHandleId,
@@ -143,6 +370,19 @@ try
     {
         HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerformWriteResults [ID %llu]", call->id);
 
+        if (call->responseInflater != nullptr && !call->responseInflater->is_done() && call->networkErrorCode == HC_OK)
+        {
+            HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallPerformWriteResults [ID %llu]: compressed response body was truncated", call->id);
+            call->networkErrorCode = HC_E_FAIL;
+        }
+
+        auto httpSingleton = get_http_singleton(false);
+        if (httpSingleton != nullptr)
+        {
+            httpSingleton->m_responseCache->on_response(call);
+            httpSingleton->m_requestCoalescer->on_complete(call);
+        }
+
         HCHttpCallPerformCompletionRoutine completeFn = (HCHttpCallPerformCompletionRoutine)completionRoutine;
         if (completeFn != nullptr)
         {
@@ -171,8 +411,9 @@ try
 
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallPerform [ID %llu]", call->id);
     call->performCalled = true;
+    call->performInProgress = true;
 
-    return HCTaskCreate(
+    HC_RESULT result = HCTaskCreate(
         taskSubsystemId,
         taskGroupId,
         HttpCallPerformExecute, (void*)call,
@@ -180,7 +421,126 @@ try
         completionRoutine, completionRoutineContext,
         taskHandle
         );
+    if (result != HC_OK)
+    {
+        call->performInProgress = false;
+    }
+    return result;
 }
 CATCH_RETURN()
 
+// Calls with the same key go to the same connection pool, so a batch keeps them together
+static http_internal_string http_call_origin(_In_ HC_CALL_HANDLE call)
+{
+    Uri uri(http_internal_string(call->url.data(), call->url.size()));
+    if (!uri.IsValid())
+    {
+        return http_internal_string();
+    }
+
+    char port[8];
+    snprintf(port, sizeof(port), ":%u", uri.IsPortDefault() ? (uri.IsSecure() ? 443 : 80) : uri.Port());
+    http_internal_string origin = uri.Scheme() + "://" + uri.Host() + port;
+    for (auto& c : origin)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return origin;
+}
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallBatchPerform(
+    _In_reads_(callCount) const HC_CALL_HANDLE* calls,
+    _In_ uint32_t callCount,
+    _Out_writes_opt_(callCount) HC_TASK_HANDLE* taskHandles,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCHttpCallPerformCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (calls == nullptr || callCount == 0)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    // Every call is checked before any task is created, so a bad batch queues nothing.  A call
+    // listed twice would be performed twice at once.
+    http_internal_vector<HC_CALL_HANDLE> sortedCalls(calls, calls + callCount);
+    std::sort(sortedCalls.begin(), sortedCalls.end(), std::less<HC_CALL_HANDLE>());
+    if (sortedCalls.front() == nullptr || std::adjacent_find(sortedCalls.begin(), sortedCalls.end()) != sortedCalls.end())
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    http_internal_vector<http_internal_string> origins;
+    origins.reserve(callCount);
+    for (uint32_t i = 0; i < callCount; i++)
+    {
+        RETURN_IF_PERFORM_CALLED(calls[i]);
+        origins.push_back(http_call_origin(calls[i]));
+    }
+
+    // Queue calls to the same origin next to each other, otherwise in the order given, so they
+    // are picked up together and share connections
+    http_internal_vector<uint32_t> order(callCount);
+    for (uint32_t i = 0; i < callCount; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&origins](uint32_t a, uint32_t b)
+    {
+        return origins[a] < origins[b];
+    });
 
+    http_internal_vector<void*> contexts(callCount);
+    for (uint32_t i = 0; i < callCount; i++)
+    {
+        HC_CALL_HANDLE call = calls[order[i]];
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallBatchPerform [ID %llu]", call->id);
+        contexts[i] = (void*)call;
+    }
+
+    // Set before the tasks are queued since a task can complete before this returns
+    for (uint32_t i = 0; i < callCount; i++)
+    {
+        calls[i]->performCalled = true;
+        calls[i]->performInProgress = true;
+    }
+
+    http_internal_vector<HC_TASK_HANDLE> queuedHandles(callCount);
+    HC_RESULT result = http_task_create_batch(
+        taskSubsystemId,
+        taskGroupId,
+        HttpCallPerformExecute,
+        HttpCallPerformWriteResults,
+        contexts.data(),
+        callCount,
+        completionRoutine,
+        completionRoutineContext,
+        queuedHandles.data()
+        );
+    if (result != HC_OK)
+    {
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            calls[i]->performCalled = false;
+            calls[i]->performInProgress = false;
+        }
+        return result;
+    }
+
+    if (taskHandles != nullptr)
+    {
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            taskHandles[order[i]] = queuedHandles[i];
+        }
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
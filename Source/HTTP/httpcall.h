@@ -3,35 +3,68 @@
 
 #pragma once
 #include "pch.h"
+#include "http_headers.h"
+#include "compression.h"
+#include "http_cache.h"
+#include "http_coalescer.h"
+#include "http_host_limiter.h"
+#include "dns_resolver.h"
+#include "http_socket.h"
+#include "http_connector.h"
+#include "Http1/http1_connection.h"
+#include "Http2/http2_connection.h"
 
 struct HC_CALL
 {
-    HC_CALL() :
+    HC_CALL(_In_ size_t arenaSize) :
+        arena(arenaSize),
+        method(&arena),
+        methodId(xbox::httpclient::http_method_id::unknown),
+        url(&arena),
+        requestBodyBytes(&arena),
+        requestBodyString(&arena),
+        requestHeaders(&arena),
+        responseString(&arena),
+        responseHeaders(&arena),
         statusCode(0),
         networkErrorCode(HC_OK),
         platformNetworkErrorCode(0),
         id(0),
+        refCount(1),
         retryAllowed(false),
         timeoutInSeconds(0),
         timeoutWindowInSeconds(0),
         retryDelayInSeconds(0),
         enableAssertsForThrottling(false),
+        responseDecompressionEnabled(false),
+        compressionLevel(HC_COMPRESSION_LEVEL_NONE),
+        requestBodyCompressed(false),
+        cacheState(xbox::httpclient::http_cache_state::none),
+        coalescingEnabled(false),
+        coalescingKey(&arena),
+        hostSlotKey(&arena),
         performCalled(false),
-        refCount(1)
+        performInProgress(false)
     {
     }
 
-    http_internal_string method;
-    http_internal_string url;
-    http_internal_vector<uint8_t> requestBodyBytes;
-    http_internal_string requestBodyString;
-    http_internal_map<http_internal_string, http_internal_string> requestHeaders;
+    // Backs every string, buffer and map below; must be declared first
+    xbox::httpclient::http_arena arena;
 
-    http_internal_string responseString;
-    http_internal_map<http_internal_string, http_internal_string> responseHeaders;
+    http_arena_string method;
+    xbox::httpclient::http_method_id methodId;
+    http_arena_string url;
+    http_arena_vector<uint8_t> requestBodyBytes;
+    http_arena_string requestBodyString;
+    http_arena_map<http_arena_string, xbox::httpclient::http_header_value> requestHeaders;
+
+    http_arena_string responseString;
+    std::shared_ptr<http_internal_string> sharedResponseBody; // replaces responseString when the body is shared by coalesced calls
+    http_arena_map<http_arena_string, http_arena_string> responseHeaders;
     uint32_t statusCode;
     HC_RESULT networkErrorCode;
     uint32_t platformNetworkErrorCode;
+    std::shared_ptr<xbox::httpclient::http_inflater> responseInflater;
     std::shared_ptr<xbox::httpclient::hc_task> task;
     uint64_t id;
     std::atomic<int> refCount;
@@ -41,9 +74,37 @@ struct HC_CALL
     uint32_t timeoutWindowInSeconds;
     uint32_t retryDelayInSeconds;
     bool enableAssertsForThrottling;
+    bool responseDecompressionEnabled;
+    HC_COMPRESSION_LEVEL compressionLevel;
+    bool requestBodyCompressed;
+    xbox::httpclient::http_cache_state cacheState;
+    std::shared_ptr<xbox::httpclient::http_cache_entry> cacheEntry; // pinned while cacheState is revalidating
+    bool coalescingEnabled;
+    http_arena_string coalescingKey; // set while the call leads a flight of coalesced calls
+    http_arena_string hostSlotKey; // set while the call holds one of its host's slots
     bool performCalled;
+    std::atomic<bool> performInProgress; // set from HCHttpCallPerform() until the call's task is completed
 };
 
+HC_RESULT HttpCallPerformExecute(
+    _In_opt_ void* executionRoutineContext,
+    _In_ HC_TASK_HANDLE taskHandle
+    );
+
+// Called when a call's task is completed, before its results are written.  Gives back the
+// call's host slot.
+void http_call_perform_completed(
+    _In_opt_ void* context,
+    _In_ HC_TASK_HANDLE taskHandle
+    );
+
+// Hands a call that holds its host's slot to the perform function, then releases the caller's
+// reference on the call
+void http_call_perform_admitted(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    );
+
 void Internal_HCHttpCallPerform(
     _In_ HC_CALL_HANDLE call, 
     _In_ HC_TASK_HANDLE taskHandle
@@ -25,6 +25,7 @@ try
         return HC_E_NOTINITIALISED;
 
     call->method = method;
+    call->methodId = http_method_id_from_name(method);
     call->url = url;
 
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetUrl [ID %llu]: method=%s url=%s",
@@ -77,6 +78,12 @@ try
 
     call->requestBodyBytes.assign(requestBodyBytes, requestBodyBytes + requestBodySize);
     call->requestBodyString.clear();
+    if (call->requestBodyCompressed)
+    {
+        // The Content-Encoding was added when the previous body was compressed
+        call->requestHeaders.erase(http_header_name(http_header_id::content_encoding));
+        call->requestBodyCompressed = false;
+    }
 
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetRequestBodyBytes [ID %llu]: requestBodySize=%lu",
         call->id, requestBodySize);
@@ -144,7 +151,7 @@ try
 
     if (call->requestBodyString.empty())
     {
-        call->requestBodyString = http_internal_string(reinterpret_cast<char const*>(call->requestBodyBytes.data()), call->requestBodyBytes.size());
+        call->requestBodyString.assign(reinterpret_cast<char const*>(call->requestBodyBytes.data()), call->requestBodyBytes.size());
     }
     *requestBody = call->requestBodyString.c_str();
     return HC_OK;
@@ -165,7 +172,12 @@ try
     }
     RETURN_IF_PERFORM_CALLED(call);
 
-    call->requestHeaders[headerName] = headerValue;
+    // Well-known headers are keyed by their canonical name so differently cased
+    // spellings of the same header replace each other instead of being sent twice
+    auto headerId = http_header_id_from_name(headerName);
+    auto& header = call->requestHeaders[headerId == http_header_id::unknown ? headerName : http_header_name(headerId)];
+    header.id = headerId;
+    header.value = headerValue;
 
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetHeader [ID %llu]: %s=%s",
         call->id, headerName, headerValue);
@@ -186,10 +198,11 @@ try
         return HC_E_INVALIDARG;
     }
 
-    auto it = call->requestHeaders.find(headerName);
+    auto headerId = http_header_id_from_name(headerName);
+    auto it = call->requestHeaders.find(headerId == http_header_id::unknown ? headerName : http_header_name(headerId));
     if (it != call->requestHeaders.end())
     {
-        *headerValue = it->second.c_str();
+        *headerValue = it->second.value.c_str();
     }
     else
     {
@@ -236,7 +249,7 @@ try
         if (index == headerIndex)
         {
             *headerName = it->first.c_str();
-            *headerValue = it->second.c_str();
+            *headerValue = it->second.value.c_str();
             return HC_OK;
         }
 
@@ -467,3 +480,173 @@ try
 CATCH_RETURN()
 
 
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetResponseDecompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ bool enabled
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        httpSingleton->m_responseDecompressionEnabled = enabled;
+    }
+    else
+    {
+        RETURN_IF_PERFORM_CALLED(call);
+        call->responseDecompressionEnabled = enabled;
+
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetResponseDecompression [ID %llu]: enabled=%s",
+            call->id, enabled ? "true" : "false");
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetResponseDecompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ bool* enabled
+    ) HC_NOEXCEPT
+try
+{
+    if (enabled == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        *enabled = httpSingleton->m_responseDecompressionEnabled;
+    }
+    else
+    {
+        *enabled = call->responseDecompressionEnabled;
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetCompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ HC_COMPRESSION_LEVEL level
+    ) HC_NOEXCEPT
+try
+{
+    if (level < HC_COMPRESSION_LEVEL_NONE || level > HC_COMPRESSION_LEVEL_HIGH)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        httpSingleton->m_compressionLevel = level;
+    }
+    else
+    {
+        RETURN_IF_PERFORM_CALLED(call);
+        call->compressionLevel = level;
+
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetCompression [ID %llu]: level=%d",
+            call->id, level);
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetCompression(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ HC_COMPRESSION_LEVEL* level
+    ) HC_NOEXCEPT
+try
+{
+    if (level == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        *level = httpSingleton->m_compressionLevel;
+    }
+    else
+    {
+        *level = call->compressionLevel;
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestSetCoalescing(
+    _In_opt_ HC_CALL_HANDLE call,
+    _In_ bool enabled
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        httpSingleton->m_coalescingEnabled = enabled;
+    }
+    else
+    {
+        RETURN_IF_PERFORM_CALLED(call);
+        call->coalescingEnabled = enabled;
+
+        HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallRequestSetCoalescing [ID %llu]: enabled=%s",
+            call->id, enabled ? "true" : "false");
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallRequestGetCoalescing(
+    _In_opt_ HC_CALL_HANDLE call,
+    _Out_ bool* enabled
+    ) HC_NOEXCEPT
+try
+{
+    if (enabled == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (call == nullptr)
+    {
+        auto httpSingleton = get_http_singleton(true);
+        if (nullptr == httpSingleton)
+            return HC_E_NOTINITIALISED;
+
+        *enabled = httpSingleton->m_coalescingEnabled;
+    }
+    else
+    {
+        *enabled = call->coalescingEnabled;
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
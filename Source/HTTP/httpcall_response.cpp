@@ -6,6 +6,17 @@
 
 using namespace xbox::httpclient;
 
+// Compressed bodies are decoded a chunk at a time so one that expands past
+// HTTP_MAX_DECOMPRESSED_BODY_SIZE is stopped within about a megabyte of it
+const size_t HTTP_INFLATE_CHUNK_SIZE = 1024;
+
+static void erase_response_header(_In_ HC_CALL_HANDLE call, _In_ http_header_id id)
+{
+    for (auto it = call->responseHeaders.begin(); it != call->responseHeaders.end();)
+    {
+        it = (http_header_id_from_name(it->first.c_str()) == id) ? call->responseHeaders.erase(it) : std::next(it);
+    }
+}
 
 HC_API HC_RESULT HC_CALLING_CONV
 HCHttpCallResponseGetResponseString(
@@ -19,7 +30,7 @@ try
         return HC_E_INVALIDARG;
     }
 
-    *responseString = call->responseString.c_str();
+    *responseString = (call->sharedResponseBody != nullptr) ? call->sharedResponseBody->c_str() : call->responseString.c_str();
     return HC_OK;
 }
 CATCH_RETURN()
@@ -37,11 +48,85 @@ try
     }
 
     call->responseString = responseString;
+    call->sharedResponseBody.reset();
     HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallResponseSetResponseString [ID %llu]: responseString=%.2048s", call->id, responseString);
     return HC_OK;
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCHttpCallResponseAppendResponseBodyBytes(
+    _In_ HC_CALL_HANDLE call,
+    _In_reads_bytes_(bodySize) const BYTE* bodyBytes,
+    _In_ uint32_t bodySize
+    ) HC_NOEXCEPT
+try
+{
+    if (call == nullptr || (bodyBytes == nullptr && bodySize > 0))
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (call->responseInflater == nullptr && call->responseString.empty() && call->responseDecompressionEnabled)
+    {
+        // Only decode what we asked for.  If the caller set its own Accept-Encoding it
+        // gets the body exactly as the server sent it.
+        bool callerSetAcceptEncoding = call->requestHeaders.find(http_header_name(http_header_id::accept_encoding)) != call->requestHeaders.end();
+        http_content_encoding encoding = http_content_encoding_from_header(
+            http_find_response_header(call->responseHeaders, http_header_id::content_encoding));
+        if (!callerSetAcceptEncoding &&
+            (encoding == http_content_encoding::gzip || encoding == http_content_encoding::deflate))
+        {
+            call->responseInflater = http_allocate_shared<http_inflater>(encoding);
+            HC_TRACE_INFORMATION(HTTPCLIENT, "HCHttpCallResponseAppendResponseBodyBytes [ID %llu]: decompressing %s response",
+                call->id, encoding == http_content_encoding::gzip ? "gzip" : "deflate");
+
+            // The headers describe the body the app gets, and the response cache stores, rather than
+            // what was on the wire
+            erase_response_header(call, http_header_id::content_encoding);
+            erase_response_header(call, http_header_id::content_length);
+        }
+    }
+
+    if (call->responseInflater != nullptr)
+    {
+        // Nothing more is decoded once the body has failed
+        if (call->networkErrorCode != HC_OK)
+        {
+            return call->networkErrorCode;
+        }
+
+        while (bodySize > 0)
+        {
+            uint32_t chunkSize = MIN(bodySize, static_cast<uint32_t>(HTTP_INFLATE_CHUNK_SIZE));
+            HC_RESULT hr = call->responseInflater->write(bodyBytes, chunkSize, call->responseString);
+            if (hr != HC_OK)
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallResponseAppendResponseBodyBytes [ID %llu]: failed to decompress response body", call->id);
+                call->networkErrorCode = hr;
+                return hr;
+            }
+            if (call->responseString.size() > HTTP_MAX_DECOMPRESSED_BODY_SIZE)
+            {
+                HC_TRACE_ERROR(HTTPCLIENT, "HCHttpCallResponseAppendResponseBodyBytes [ID %llu]: response body decompresses to more than %u bytes",
+                    call->id, static_cast<uint32_t>(HTTP_MAX_DECOMPRESSED_BODY_SIZE));
+                call->networkErrorCode = HC_E_BUFFERTOOSMALL;
+                return HC_E_BUFFERTOOSMALL;
+            }
+
+            bodyBytes += chunkSize;
+            bodySize -= chunkSize;
+        }
+    }
+    else if (bodySize > 0)
+    {
+        call->responseString.append(reinterpret_cast<const char*>(bodyBytes), bodySize);
+    }
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
 HC_API HC_RESULT HC_CALLING_CONV
 HCHttpCallResponseGetStatusCode(
     _In_ HC_CALL_HANDLE call,
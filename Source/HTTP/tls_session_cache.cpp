@@ -0,0 +1,158 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "tls_session_cache.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Servers usually issue two TLS 1.3 tickets per handshake, so keep a couple of spares
+const size_t TLS_MAX_SESSIONS_PER_ORIGIN = 4;
+const size_t TLS_MAX_ORIGINS = 64;
+const uint32_t TLS_MAX_SESSION_SIZE = 16 * 1024;
+
+// Used when the provider doesn't know the lifetime.  RFC 8446 caps tickets at 7 days.
+const uint32_t TLS_DEFAULT_SESSION_LIFETIME_IN_SECONDS = 300;
+const uint32_t TLS_MAX_SESSION_LIFETIME_IN_SECONDS = 7 * 24 * 60 * 60;
+
+http_tls_session_cache::http_tls_session_cache() :
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+http_internal_string http_tls_session_cache::make_key(_In_ const http_internal_string& origin)
+{
+    // Host names are case insensitive
+    http_internal_string key(origin);
+    for (auto& c : key)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return key;
+}
+
+void http_tls_session_cache::store(
+    _In_ const http_internal_string& origin,
+    _In_reads_bytes_(sessionDataSize) const uint8_t* sessionData,
+    _In_ uint32_t sessionDataSize,
+    _In_ uint32_t lifetimeInSeconds
+    )
+{
+    if (sessionDataSize == 0 || sessionDataSize > TLS_MAX_SESSION_SIZE)
+    {
+        return;
+    }
+    if (lifetimeInSeconds == 0)
+    {
+        lifetimeInSeconds = TLS_DEFAULT_SESSION_LIFETIME_IN_SECONDS;
+    }
+    if (lifetimeInSeconds > TLS_MAX_SESSION_LIFETIME_IN_SECONDS)
+    {
+        lifetimeInSeconds = TLS_MAX_SESSION_LIFETIME_IN_SECONDS;
+    }
+
+    session stored;
+    stored.data.assign(sessionData, sessionData + sessionDataSize);
+    stored.expires = std::chrono::steady_clock::now() + std::chrono::seconds(lifetimeInSeconds);
+
+    http_internal_string key = make_key(origin);
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_origins.find(key);
+    if (it == m_origins.end())
+    {
+        m_lru.push_front(key);
+        it = m_origins.emplace(key, origin_entry()).first;
+        it->second.lruPosition = m_lru.begin();
+
+        if (m_origins.size() > TLS_MAX_ORIGINS)
+        {
+            m_origins.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+    }
+    else
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+    }
+
+    auto& sessions = it->second.sessions;
+    if (sessions.size() >= TLS_MAX_SESSIONS_PER_ORIGIN)
+    {
+        sessions.erase(sessions.begin());
+    }
+    sessions.push_back(std::move(stored));
+}
+
+HC_RESULT http_tls_session_cache::take(
+    _In_ const http_internal_string& origin,
+    _In_ uint32_t bufferSize,
+    _Out_writes_bytes_to_opt_(bufferSize, *sessionDataSize) uint8_t* buffer,
+    _Out_ uint32_t* sessionDataSize
+    )
+{
+    *sessionDataSize = 0;
+
+    http_internal_string key = make_key(origin);
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_origins.find(key);
+    if (it != m_origins.end())
+    {
+        // Expired sessions would only cost a failed resumption, so drop them here
+        auto& sessions = it->second.sessions;
+        auto now = std::chrono::steady_clock::now();
+        while (!sessions.empty() && now >= sessions.back().expires)
+        {
+            sessions.pop_back();
+        }
+
+        if (!sessions.empty())
+        {
+            const auto& newest = sessions.back();
+            *sessionDataSize = static_cast<uint32_t>(newest.data.size());
+            if (buffer == nullptr || bufferSize < newest.data.size())
+            {
+                return HC_E_BUFFERTOOSMALL;
+            }
+
+            memcpy(buffer, newest.data.data(), newest.data.size());
+            sessions.pop_back();
+            m_hits++;
+        }
+
+        if (sessions.empty())
+        {
+            m_lru.erase(it->second.lruPosition);
+            m_origins.erase(it);
+        }
+
+        if (*sessionDataSize != 0)
+        {
+            return HC_OK;
+        }
+    }
+
+    m_misses++;
+    return HC_OK;
+}
+
+void http_tls_session_cache::get_stats(_Out_ uint64_t* hits, _Out_ uint64_t* misses)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    *hits = m_hits;
+    *misses = m_misses;
+}
+
+void http_tls_session_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_origins.clear();
+    m_lru.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Per-origin cache of TLS sessions for HTTP providers that do their own TLS.
+//
+// Providers store the session state (a TLS 1.3 ticket or TLS 1.2 session) after each handshake
+// and take one before the next connection to the same origin, so it can resume instead of
+// doing a full handshake.  Each stored session is handed out once, as RFC 8446 recommends for
+// tickets, and the newest is handed out first.  Origins are evicted least recently used first.
+class http_tls_session_cache
+{
+public:
+    http_tls_session_cache();
+
+    void store(
+        _In_ const http_internal_string& origin,
+        _In_reads_bytes_(sessionDataSize) const uint8_t* sessionData,
+        _In_ uint32_t sessionDataSize,
+        _In_ uint32_t lifetimeInSeconds
+        );
+
+    // Removes the newest unexpired session for the origin and copies it to buffer.  Sets
+    // sessionDataSize to 0 if there is none.  If buffer is too small the session is left in
+    // the cache and HC_E_BUFFERTOOSMALL is returned with the size needed.
+    HC_RESULT take(
+        _In_ const http_internal_string& origin,
+        _In_ uint32_t bufferSize,
+        _Out_writes_bytes_to_opt_(bufferSize, *sessionDataSize) uint8_t* buffer,
+        _Out_ uint32_t* sessionDataSize
+        );
+
+    void get_stats(_Out_ uint64_t* hits, _Out_ uint64_t* misses);
+    void clear();
+
+private:
+    struct session
+    {
+        http_internal_vector<uint8_t> data;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct origin_entry
+    {
+        http_internal_vector<session> sessions;  // oldest first
+        http_internal_list<http_internal_string>::iterator lruPosition;
+    };
+
+    static http_internal_string make_key(_In_ const http_internal_string& origin);
+
+    std::mutex m_lock;
+    http_internal_map<http_internal_string, origin_entry> m_origins;
+    http_internal_list<http_internal_string> m_lru;  // most recently used first
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
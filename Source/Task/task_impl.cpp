@@ -51,6 +51,74 @@ void http_task_queue_pending(_In_ HC_TASK* task)
     httpSingleton->set_task_pending_ready();
 }
 
+HC_RESULT http_task_create_batch(
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_ HC_TASK_EXECUTE_FUNC executionRoutine,
+    _In_ HC_TASK_WRITE_RESULTS_FUNC writeResultsRoutine,
+    _In_reads_(count) void* const* contexts,
+    _In_ uint32_t count,
+    _In_opt_ void* completionRoutine,
+    _In_opt_ void* completionRoutineContext,
+    _Out_writes_(count) HC_TASK_HANDLE* taskHandles
+    )
+{
+    auto httpSingleton = get_http_singleton(false);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    // Allocate everything before taking any lock so a failure leaves nothing queued
+    http_internal_vector<HC_TASK_PTR> tasks;
+    tasks.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        HC_TASK_PTR task = http_allocate_unique<HC_TASK>();
+        task->executionRoutine = executionRoutine;
+        task->executionRoutineContext = contexts[i];
+        task->writeResultsRoutine = writeResultsRoutine;
+        task->writeResultsRoutineContext = contexts[i];
+        task->completionRoutine = completionRoutine;
+        task->completionRoutineContext = completionRoutineContext;
+        task->taskSubsystemId = taskSubsystemId;
+        task->taskGroupId = taskGroupId;
+        task->state = http_task_state::pending;
+        tasks.push_back(std::move(task));
+    }
+
+    http_internal_vector<HC_TASK*> queued;
+    queued.reserve(count);
+    {
+        std::lock_guard<std::mutex> lock(httpSingleton->m_taskHandleIdMapLock);
+        auto& taskHandleIdMap = httpSingleton->m_taskHandleIdMap;
+        for (auto& task : tasks)
+        {
+            task->id = httpSingleton->m_lastId++;
+            taskHandles[queued.size()] = task->id;
+            queued.push_back(task.get());
+            taskHandleIdMap[task->id] = std::move(task);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(httpSingleton->m_taskLock);
+        auto& taskPendingQueue = httpSingleton->get_task_pending_queue(taskSubsystemId);
+        for (auto task : queued)
+        {
+            taskPendingQueue.push(task);
+        }
+
+        HC_TRACE_INFORMATION(HTTPCLIENT, "Task queue pending batch: queueSize=%zu taskCount=%u taskGroupId=%llu",
+            taskPendingQueue.size(), count, taskGroupId);
+    }
+
+    for (auto task : queued)
+    {
+        raise_task_event(httpSingleton, task, HC_TASK_EVENT_PENDING);
+    }
+    httpSingleton->set_task_pending_ready();
+    return HC_OK;
+}
+
 HC_TASK* http_task_get_next_pending(_In_ HC_SUBSYSTEM_ID taskSubsystemId)
 {
     auto httpSingleton = get_http_singleton(false);
@@ -108,6 +176,12 @@ void http_task_queue_completed(_In_ HC_TASK_HANDLE taskHandleId)
 
     taskHandle->state = http_task_state::completed;
 
+    // Before the task is queued, since the caller can free the task's context as soon as it is
+    if (taskHandle->executeCompletedRoutine != nullptr)
+    {
+        taskHandle->executeCompletedRoutine(taskHandle->executeCompletedRoutineContext, taskHandleId);
+    }
+
     HC_TASK* task = nullptr;
     {
         std::lock_guard<std::mutex> guard(httpSingleton->m_taskLock);
@@ -143,6 +217,20 @@ void http_task_queue_completed(_In_ HC_TASK_HANDLE taskHandleId)
     raise_task_event(httpSingleton, task, HC_TASK_EVENT_EXECUTE_COMPLETED);
 }
 
+void http_task_set_execute_completed_routine(
+    _In_ HC_TASK_HANDLE taskHandle,
+    _In_ http_task_execute_completed_func executeCompletedRoutine,
+    _In_opt_ void* context
+    )
+{
+    HC_TASK* task = http_task_get_task_from_handle_id(taskHandle);
+    if (task != nullptr)
+    {
+        task->executeCompletedRoutine = executeCompletedRoutine;
+        task->executeCompletedRoutineContext = context;
+    }
+}
+
 HC_TASK* http_task_get_next_completed(_In_ HC_SUBSYSTEM_ID taskSubsystemId, _In_ uint64_t taskGroupId)
 {
     auto httpSingleton = get_http_singleton(false);
@@ -12,6 +12,10 @@ enum http_task_state
     completed
 };
 
+// Called when a task's execution is completed, before the task is queued for its write results
+// routine.  Lets the code that runs a task react to it finishing without this layer knowing about it.
+typedef void (*http_task_execute_completed_func)(_In_opt_ void* context, _In_ HC_TASK_HANDLE taskHandle);
+
 struct HC_TASK
 {
     HC_TASK() :
@@ -22,6 +26,8 @@ struct HC_TASK
         writeResultsRoutineContext(nullptr),
         completionRoutine(nullptr),
         completionRoutineContext(nullptr),
+        executeCompletedRoutine(nullptr),
+        executeCompletedRoutineContext(nullptr),
         taskSubsystemId(HC_SUBSYSTEM_ID_GAME_MIN),
         taskGroupId(0),
         id(0)
@@ -38,6 +44,8 @@ struct HC_TASK
     void* writeResultsRoutineContext;
     void* completionRoutine;
     void* completionRoutineContext;
+    http_task_execute_completed_func executeCompletedRoutine;
+    void* executeCompletedRoutineContext;
     HC_SUBSYSTEM_ID taskSubsystemId;
     uint64_t taskGroupId;
     uint64_t id;
@@ -52,11 +60,33 @@ typedef HC_UNIQUE_PTR< HC_TASK > HC_TASK_PTR;
 NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
 
 void http_task_queue_pending(_In_ HC_TASK* info);
+
+// Creates a task per context, each using the context for both its execution and write results
+// routines, and queues them in order as one unit.  The task map and the pending queue are each
+// locked once, and waiters are woken once, however many tasks there are.
+HC_RESULT http_task_create_batch(
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_ HC_TASK_EXECUTE_FUNC executionRoutine,
+    _In_ HC_TASK_WRITE_RESULTS_FUNC writeResultsRoutine,
+    _In_reads_(count) void* const* contexts,
+    _In_ uint32_t count,
+    _In_opt_ void* completionRoutine,
+    _In_opt_ void* completionRoutineContext,
+    _Out_writes_(count) HC_TASK_HANDLE* taskHandles
+    );
 void http_task_process_pending(_In_ HC_TASK* task);
 HC_TASK* http_task_get_next_pending(_In_ HC_SUBSYSTEM_ID taskSubsystemId);
 
 void http_task_process_completed(_In_ HC_TASK* task);
 void http_task_queue_completed(_In_ HC_TASK_HANDLE taskHandle);
+
+// Must be set from the task's execution routine, before anything can complete it
+void http_task_set_execute_completed_routine(
+    _In_ HC_TASK_HANDLE taskHandle,
+    _In_ http_task_execute_completed_func executeCompletedRoutine,
+    _In_opt_ void* context
+    );
 HC_TASK* http_task_get_next_completed(_In_ HC_SUBSYSTEM_ID taskSubsystemId, _In_ uint64_t taskGroupId);
 
 HC_TASK* http_task_get_task_from_handle_id(_In_ HC_TASK_HANDLE taskHandleId);
@@ -0,0 +1,1894 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include <algorithm>
+#include "uri.h"
+#include "websocket_connection.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+const size_t WEBSOCKET_MAX_HANDSHAKE_SIZE = 64 * 1024;
+const uint32_t WEBSOCKET_POLL_INTERVAL_IN_MILLISECONDS = 1000;
+const uint32_t WEBSOCKET_DEFAULT_TIMEOUT_IN_SECONDS = 30;
+
+static http_internal_string trim(_In_ const http_internal_string& value)
+{
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == http_internal_string::npos)
+    {
+        return http_internal_string();
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+static http_internal_string to_lower(_In_ const http_internal_string& value)
+{
+    http_internal_string lower;
+    for (char c : value)
+    {
+        lower.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c);
+    }
+    return lower;
+}
+
+// Splits a comma separated header value into its trimmed, non-empty tokens
+static http_internal_vector<http_internal_string> split_tokens(_In_ const http_internal_string& value)
+{
+    http_internal_vector<http_internal_string> tokens;
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == http_internal_string::npos)
+        {
+            end = value.size();
+        }
+        http_internal_string token = trim(value.substr(start, end - start));
+        if (!token.empty())
+        {
+            tokens.push_back(token);
+        }
+        start = end + 1;
+    }
+    return tokens;
+}
+
+static http_internal_string make_authority(_In_ const http_internal_string& host, _In_ uint16_t port, _In_ uint16_t defaultPort)
+{
+    bool ipv6 = host.find(':') != http_internal_string::npos;
+    http_internal_string authority = ipv6 ? "[" + host + "]" : host;
+    if (port != defaultPort)
+    {
+        char portString[8];
+        snprintf(portString, sizeof(portString), ":%u", port);
+        authority += portString;
+    }
+    return authority;
+}
+
+// Reads an HTTP response head from a blocking socket.  Bytes after the head, such as the first
+// frames from the server, are left in leftover.
+static bool read_response_head(
+    _In_ http_socket socket,
+    _In_ std::chrono::steady_clock::time_point deadline,
+    _Out_ uint32_t* statusCode,
+    _Inout_ http_internal_map<http_internal_string, http_internal_string>& headers,
+    _Inout_ http_internal_vector<uint8_t>& leftover
+    )
+{
+    *statusCode = 0;
+    http_internal_string head;
+    uint8_t chunk[4096];
+    size_t headEnd = http_internal_string::npos;
+    while (headEnd == http_internal_string::npos)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline || head.size() > WEBSOCKET_MAX_HANDSHAKE_SIZE)
+        {
+            return false;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        int ready = http_socket_wait_readable(socket, static_cast<uint32_t>(MIN(remaining, static_cast<long long>(WEBSOCKET_POLL_INTERVAL_IN_MILLISECONDS))));
+        if (ready == 0)
+        {
+            continue;
+        }
+
+        int received = (ready > 0) ? http_socket_receive(socket, chunk, sizeof(chunk)) : -1;
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        size_t searchFrom = head.size() >= 3 ? head.size() - 3 : 0;
+        head.append(reinterpret_cast<const char*>(chunk), static_cast<size_t>(received));
+        headEnd = head.find("\r\n\r\n", searchFrom);
+    }
+
+    leftover.assign(head.begin() + headEnd + 4, head.end());
+    head.resize(headEnd);
+
+    size_t lineEnd = head.find("\r\n");
+    http_internal_string statusLine = head.substr(0, lineEnd);
+    size_t space = statusLine.find(' ');
+    if (statusLine.compare(0, 5, "HTTP/") != 0 || space == http_internal_string::npos)
+    {
+        return false;
+    }
+    *statusCode = static_cast<uint32_t>(strtoul(statusLine.c_str() + space + 1, nullptr, 10));
+
+    while (lineEnd != http_internal_string::npos)
+    {
+        size_t lineStart = lineEnd + 2;
+        lineEnd = head.find("\r\n", lineStart);
+        http_internal_string line = head.substr(lineStart, lineEnd == http_internal_string::npos ? http_internal_string::npos : lineEnd - lineStart);
+        size_t colon = line.find(':');
+        if (colon == http_internal_string::npos)
+        {
+            continue;
+        }
+
+        // Repeated headers are joined, as for any list valued header (RFC 7230 3.2.2)
+        http_internal_string name = to_lower(trim(line.substr(0, colon)));
+        http_internal_string value = trim(line.substr(colon + 1));
+        auto& existing = headers[name];
+        existing = existing.empty() ? value : existing + ", " + value;
+    }
+    return true;
+}
+
+websocket_connection::websocket_connection(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ std::shared_ptr<http_dns_resolver> resolver,
+    _In_ uint32_t connectionAttemptDelayInMilliseconds,
+    _In_ uint32_t timeoutInSeconds
+    ) :
+    m_websocket(websocket),
+    m_connector(resolver),
+    m_resolver(std::move(resolver)),
+    m_connectionAttemptDelayInMilliseconds(connectionAttemptDelayInMilliseconds),
+    m_timeoutInSeconds(timeoutInSeconds != 0 ? timeoutInSeconds : WEBSOCKET_DEFAULT_TIMEOUT_IN_SECONDS),
+    m_reactor(nullptr),
+    m_state(connection_state::connecting),
+    m_socket(HTTP_INVALID_SOCKET),
+    m_closeRequested(false),
+    m_connectFinished(false),
+    m_connectResult(HC_E_FAIL),
+    m_platformErrorCode(0),
+    m_random(std::random_device()()),
+    m_outgoingOffset(0),
+    m_raiseCloseEvent(false),
+    m_closeStatus(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_NORMAL),
+    m_pingSequence(0),
+    m_pingOutstanding(false),
+    m_reconnectAttempt(0),
+    m_reconnectDelayInMilliseconds(0),
+    m_dropStatus(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE),
+    m_unparsedFrames(false),
+    m_messageBuffer(nullptr),
+    m_frameRemaining(0),
+    m_frameFin(false),
+    m_messageOpcode(websocket_opcode::text),
+    m_messageCompressed(false),
+    m_inMessage(false)
+{
+}
+
+websocket_connection::~websocket_connection()
+{
+    if (m_socket != HTTP_INVALID_SOCKET)
+    {
+        http_socket_close(m_socket);
+    }
+    if (m_messageBuffer != nullptr)
+    {
+        websocket_buffer_pool::release(m_messageBuffer);
+    }
+}
+
+HC_RESULT websocket_connection::connect_result()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_connectResult;
+}
+
+uint32_t websocket_connection::platform_error_code()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_platformErrorCode;
+}
+
+bool websocket_connection::is_connect_finished()
+{
+    return m_connectFinished;
+}
+
+HC_RESULT websocket_connection::connect(_In_ websocket_reactor* reactor)
+{
+    bool cancelled;
+    {
+        // A reconnect backs off first, unless the app disconnects while it waits
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_closeRequestedChanged.wait_for(lock, std::chrono::milliseconds(m_reconnectDelayInMilliseconds), [this] { return m_closeRequested; });
+        cancelled = m_closeRequested;
+    }
+
+    HC_RESULT result = HC_E_FAIL;
+    Uri uri(m_websocket->uri);
+    if (cancelled)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: connect cancelled", m_websocket->id);
+    }
+    else if (!uri.IsValid() || uri.Scheme() != "ws")
+    {
+        // There's no TLS stack under the native sockets, so wss:// needs a platform implementation
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: only ws:// URIs are supported", m_websocket->id);
+    }
+    else
+    {
+        uint16_t port = uri.IsPortDefault() ? 80 : uri.Port();
+        http_internal_string authority = make_authority(uri.Host(), port, 80);
+        http_internal_string resource = uri.Resource();
+        if (resource.empty() || resource[0] != '/')
+        {
+            resource = "/" + resource;
+        }
+
+        http_internal_string connectHost = uri.Host();
+        uint16_t connectPort = port;
+        bool proxied = false;
+        if (!m_websocket->proxyUri.empty())
+        {
+            Uri proxyUri(m_websocket->proxyUri);
+            if (proxyUri.IsValid())
+            {
+                connectHost = proxyUri.Host();
+                connectPort = proxyUri.IsPortDefault() ? 80 : proxyUri.Port();
+                proxied = true;
+            }
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(m_timeoutInSeconds);
+        http_socket socket = HTTP_INVALID_SOCKET;
+        if (m_connector.connect(connectHost, connectPort, m_connectionAttemptDelayInMilliseconds, m_timeoutInSeconds * 1000, &socket) == HC_OK)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_socket = socket;
+                if (m_closeRequested)
+                {
+                    http_socket_shutdown(socket);
+                }
+            }
+
+            result = HC_OK;
+            if (proxied)
+            {
+                // Tunnel through the proxy (RFC 7231 4.3.6)
+                http_internal_string request = "CONNECT " + make_authority(uri.Host(), port, 0) + " HTTP/1.1\r\nHost: " + make_authority(uri.Host(), port, 0) + "\r\n\r\n";
+                uint32_t statusCode = 0;
+                http_internal_map<http_internal_string, http_internal_string> headers;
+                http_internal_vector<uint8_t> leftover;
+                if (!http_socket_send_all(socket, reinterpret_cast<const uint8_t*>(request.data()), request.size()) ||
+                    !read_response_head(socket, deadline, &statusCode, headers, leftover) ||
+                    statusCode < 200 || statusCode >= 300)
+                {
+                    HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: proxy refused the tunnel with status %u", m_websocket->id, statusCode);
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_platformErrorCode = statusCode;
+                    result = HC_E_FAIL;
+                }
+            }
+
+            if (result == HC_OK)
+            {
+                result = handshake(socket, authority, resource, deadline);
+            }
+        }
+    }
+
+    bool open = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (result == HC_OK && !m_closeRequested && http_socket_set_blocking(m_socket, false))
+        {
+            m_reactor = reactor;
+            m_state = connection_state::open;
+            m_lastReceiveTime = std::chrono::steady_clock::now();
+            m_nextPingTime = m_lastReceiveTime + std::chrono::seconds(m_websocket->pingIntervalInSeconds);
+            m_unparsedFrames = !m_readBuffer.empty();
+            open = true;
+
+            for (auto& message : m_pending)
+            {
+                queue_message(std::move(message));
+            }
+            m_pending.clear();
+        }
+        else
+        {
+            if (m_socket != HTTP_INVALID_SOCKET)
+            {
+                http_socket_close(m_socket);
+                m_socket = HTTP_INVALID_SOCKET;
+            }
+            m_state = connection_state::closed;
+        }
+        m_connectResult = open ? HC_OK : HC_E_FAIL;
+    }
+
+    if (open)
+    {
+        // Released in finish(), so the handle outlives every callback the reactor makes with it.  A
+        // reconnect has held its reference since it was scheduled.
+        if (m_reconnectAttempt == 0)
+        {
+            HCWebSocketDuplicateHandle(m_websocket);
+        }
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: connected to %s", m_websocket->id, m_websocket->uri.c_str());
+
+        if (m_reconnectAttempt > 0)
+        {
+            try
+            {
+                Internal_HCWebSocketRaiseReconnectEvent(m_websocket, HC_WEBSOCKET_RECONNECT_SUCCEEDED, m_reconnectAttempt, 0);
+            }
+            catch (...)
+            {
+                HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: reconnect function threw", m_websocket->id);
+            }
+        }
+    }
+    else
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: connect to %s failed", m_websocket->id, m_websocket->uri.c_str());
+        if (m_reconnectAttempt > 0)
+        {
+            reconnect_failed(reactor);
+        }
+    }
+
+    m_connectFinished = true;
+    return open ? HC_OK : HC_E_FAIL;
+}
+
+HC_RESULT websocket_connection::handshake(
+    _In_ http_socket socket,
+    _In_ const http_internal_string& authority,
+    _In_ const http_internal_string& resource,
+    _In_ std::chrono::steady_clock::time_point deadline
+    )
+{
+    uint8_t nonce[16];
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (auto& byte : nonce)
+        {
+            byte = static_cast<uint8_t>(m_random());
+        }
+    }
+    http_internal_string key = websocket_base64_encode(nonce, sizeof(nonce));
+
+    // The headers the handshake depends on can't be overridden by the app
+    http_internal_string request = "GET " + resource + " HTTP/1.1\r\n";
+    request += "Host: " + authority + "\r\n";
+    request += "Upgrade: websocket\r\n";
+    request += "Connection: Upgrade\r\n";
+    request += "Sec-WebSocket-Key: " + key + "\r\n";
+    request += "Sec-WebSocket-Version: 13\r\n";
+    if (!m_websocket->subProtocol.empty())
+    {
+        request += "Sec-WebSocket-Protocol: " + m_websocket->subProtocol + "\r\n";
+    }
+
+    websocket_deflate_params deflateOffer = {};
+    bool deflateOffered = false;
+    if (m_websocket->compressionLevel != HC_COMPRESSION_LEVEL_NONE)
+    {
+        uint32_t windowBits = 0;
+        deflateOffered = websocket_deflate_fit_window(m_websocket->compressionWindowBits, m_websocket->compressionMemoryLimit, &windowBits);
+        if (deflateOffered)
+        {
+            deflateOffer.clientMaxWindowBits = windowBits;
+            deflateOffer.serverMaxWindowBits = windowBits;
+            deflateOffer.clientNoContextTakeover = !m_websocket->compressionContextTakeover;
+            deflateOffer.serverNoContextTakeover = !m_websocket->compressionContextTakeover;
+            request += "Sec-WebSocket-Extensions: " + websocket_deflate_offer(deflateOffer) + "\r\n";
+        }
+        else
+        {
+            HC_TRACE_WARNING(WEBSOCKET, "Websocket [ID %llu]: compression doesn't fit in %u bytes, not offering it", m_websocket->id, m_websocket->compressionMemoryLimit);
+        }
+    }
+    for (const auto& header : m_websocket->connectHeaders)
+    {
+        http_internal_string name = to_lower(header.first);
+        if (name == "host" || name == "upgrade" || name == "connection" || name == "sec-websocket-key" ||
+            name == "sec-websocket-version" || name == "sec-websocket-extensions" ||
+            (name == "sec-websocket-protocol" && !m_websocket->subProtocol.empty()))
+        {
+            continue;
+        }
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    request += "\r\n";
+
+    if (!http_socket_send_all(socket, reinterpret_cast<const uint8_t*>(request.data()), request.size()))
+    {
+        return HC_E_FAIL;
+    }
+
+    uint32_t statusCode = 0;
+    http_internal_map<http_internal_string, http_internal_string> headers;
+    if (!read_response_head(socket, deadline, &statusCode, headers, m_readBuffer))
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: no handshake response", m_websocket->id);
+        return HC_E_FAIL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_platformErrorCode = statusCode;
+    }
+    if (statusCode != 101)
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: server answered the handshake with status %u", m_websocket->id, statusCode);
+        return HC_E_FAIL;
+    }
+
+    // RFC 6455 4.1, the client must fail the connection if any of these don't hold
+    bool upgraded = false;
+    for (const auto& token : split_tokens(to_lower(headers["connection"])))
+    {
+        upgraded = upgraded || token == "upgrade";
+    }
+    bool protocolOffered = true;
+    auto protocol = headers.find("sec-websocket-protocol");
+    if (protocol != headers.end())
+    {
+        protocolOffered = false;
+        for (const auto& offered : split_tokens(m_websocket->subProtocol))
+        {
+            protocolOffered = protocolOffered || offered == protocol->second;
+        }
+    }
+
+    // The server can only accept extensions that were offered
+    websocket_deflate_params deflateAccepted = {};
+    const http_internal_string& extensions = headers["sec-websocket-extensions"];
+    bool extensionsAccepted = extensions.empty() ||
+        (deflateOffered && websocket_deflate_parse_response(extensions, deflateOffer, &deflateAccepted));
+
+    if (to_lower(headers["upgrade"]) != "websocket" || !upgraded ||
+        headers["sec-websocket-accept"] != websocket_accept_key(key) ||
+        !extensionsAccepted || !protocolOffered)
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: invalid handshake response", m_websocket->id);
+        return HC_E_FAIL;
+    }
+
+    if (!extensions.empty())
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: negotiated %s", m_websocket->id, extensions.c_str());
+        m_deflate = http_allocate_shared<websocket_deflate>(deflateAccepted, m_websocket->compressionLevel);
+        m_websocket->compressionNegotiated = true;
+    }
+    return HC_OK;
+}
+
+void websocket_connection::send(_In_ std::shared_ptr<websocket_outgoing_message> message)
+{
+    websocket_reactor* reactor = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_state == connection_state::open)
+        {
+            queue_message(std::move(message));
+            reactor = m_reactor;
+        }
+        else if (m_state == connection_state::connecting && m_reconnectAttempt > 0 && !m_closeRequested && m_websocket->reconnectReplay)
+        {
+            m_pending.push_back(std::move(message));
+        }
+        else
+        {
+            message->result = HC_E_FAIL;
+            m_completed.push_back(std::move(message));
+        }
+    }
+
+    if (reactor != nullptr)
+    {
+        reactor->wake();
+    }
+    complete_messages();
+}
+
+bool websocket_connection::send_broadcast(_In_ const std::shared_ptr<const websocket_broadcast_frame>& frame)
+{
+    websocket_reactor* reactor = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_state != connection_state::open)
+        {
+            return false;
+        }
+
+        outgoing_frame outgoing;
+        memcpy(outgoing.header, frame->header, frame->headerSize);
+        outgoing.headerSize = frame->headerSize;
+        outgoing.payloadSize = frame->payload.size();
+        outgoing.broadcast = frame;
+        m_outgoing.push_back(std::move(outgoing));
+
+        m_websocket->uncompressedBytesSent += frame->payload.size();
+        m_websocket->compressedBytesSent += frame->payload.size();
+        reactor = m_reactor;
+    }
+
+    if (reactor != nullptr)
+    {
+        reactor->wake();
+    }
+    return true;
+}
+
+void websocket_connection::disconnect(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus)
+{
+    websocket_reactor* reactor = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_closeRequested = true;
+        m_closeRequestedChanged.notify_all();
+        if (m_state == connection_state::connecting)
+        {
+            if (m_socket != HTTP_INVALID_SOCKET)
+            {
+                http_socket_shutdown(m_socket);
+            }
+        }
+        else if (m_state == connection_state::open)
+        {
+            HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: closing with status %d", m_websocket->id, closeStatus);
+            queue_close(static_cast<uint16_t>(closeStatus));
+            m_state = connection_state::closing;
+            m_closeDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(WEBSOCKET_CLOSE_TIMEOUT_IN_SECONDS);
+            reactor = m_reactor;
+        }
+    }
+
+    m_connector.cancel();
+    if (reactor != nullptr)
+    {
+        reactor->wake();
+    }
+}
+
+http_socket websocket_connection::socket()
+{
+    return m_socket;
+}
+
+bool websocket_connection::wants_write()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return !m_outgoing.empty();
+}
+
+bool websocket_connection::process(_In_ bool readable, _In_ bool writable)
+{
+    auto now = std::chrono::steady_clock::now();
+    bool connected = true;
+    if (m_unparsedFrames)
+    {
+        // A server may send its first messages in the same write as the 101 and then wait for us
+        m_unparsedFrames = false;
+        connected = parse_frames();
+    }
+
+    if (connected && readable)
+    {
+        m_lastReceiveTime = now;
+        connected = read_frames();
+    }
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (connected)
+        {
+            keep_alive(now);
+        }
+
+        if (connected && (writable || !m_outgoing.empty()))
+        {
+            write_frames();
+        }
+
+        if (m_state == connection_state::closing && now >= m_closeDeadline)
+        {
+            HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: server didn't answer the close", m_websocket->id);
+            m_state = connection_state::closed;
+            drop_frames();
+        }
+
+        // Once closed, the socket is dropped as soon as the last frames are written
+        done = !connected || (m_state == connection_state::closed && m_outgoing.empty());
+    }
+
+    complete_messages();
+    return !done;
+}
+
+bool websocket_connection::read_frames()
+{
+    if (m_frameRemaining > 0)
+    {
+        return read_frame_payload();
+    }
+
+    uint8_t chunk[16 * 1024];
+    int received = http_socket_receive(m_socket, chunk, sizeof(chunk));
+    if (received < 0 && http_socket_would_block())
+    {
+        return true;
+    }
+
+    if (received <= 0)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: connection closed", m_websocket->id);
+        std::lock_guard<std::mutex> lock(m_lock);
+        close_with_event(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE);
+        return false;
+    }
+
+    m_readBuffer.insert(m_readBuffer.end(), chunk, chunk + received);
+    return parse_frames();
+}
+
+bool websocket_connection::read_frame_payload()
+{
+    auto& message = m_messageBuffer->bytes;
+    size_t messageStart = message.size();
+    size_t readSize = static_cast<size_t>(MIN(m_frameRemaining, static_cast<uint64_t>(WEBSOCKET_DIRECT_READ_SIZE)));
+    message.resize(messageStart + readSize);
+    int received = http_socket_receive(m_socket, message.data() + messageStart, readSize);
+    message.resize(messageStart + (received > 0 ? static_cast<size_t>(received) : 0));
+    if (received < 0 && http_socket_would_block())
+    {
+        return true;
+    }
+
+    if (received <= 0)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: connection closed", m_websocket->id);
+        std::lock_guard<std::mutex> lock(m_lock);
+        close_with_event(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE);
+        return false;
+    }
+
+    m_frameRemaining -= static_cast<uint64_t>(received);
+    return message_appended(messageStart, static_cast<size_t>(received), m_frameRemaining == 0 && m_frameFin);
+}
+
+bool websocket_connection::parse_frames()
+{
+    size_t offset = 0;
+    bool ok = true;
+    while (ok)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state == connection_state::closed)
+            {
+                break;
+            }
+        }
+
+        websocket_frame_header header;
+        auto parsed = websocket_parse_frame_header(m_readBuffer.data() + offset, m_readBuffer.size() - offset, &header);
+        if (parsed == websocket_parse_result::incomplete)
+        {
+            break;
+        }
+
+        // Servers never mask, and the only reserved bit in use is RSV1 on the first frame of a
+        // compressed message
+        bool compressed = m_deflate != nullptr && header.rsv == WEBSOCKET_RSV1 &&
+            (header.opcode == websocket_opcode::text || header.opcode == websocket_opcode::binary);
+        if (parsed == websocket_parse_result::invalid || header.masked || (header.rsv != 0 && !compressed))
+        {
+            ok = fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+        if (header.payloadLength > WEBSOCKET_MAX_MESSAGE_SIZE)
+        {
+            ok = fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_TOO_LARGE);
+            break;
+        }
+        size_t available = m_readBuffer.size() - offset - header.headerSize;
+        if (available < header.payloadLength)
+        {
+            // The rest of a long frame is read straight into the message, unless it has to be
+            // decompressed first
+            bool uncompressed = header.rsv == 0 && !(header.opcode == websocket_opcode::continuation && m_messageCompressed);
+            if (header.payloadLength >= WEBSOCKET_DIRECT_READ_THRESHOLD && uncompressed &&
+                (header.opcode == websocket_opcode::text || header.opcode == websocket_opcode::binary || header.opcode == websocket_opcode::continuation))
+            {
+                if (!begin_data_frame(header))
+                {
+                    ok = fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+                    break;
+                }
+                if (m_messageBuffer->bytes.size() + header.payloadLength > WEBSOCKET_MAX_MESSAGE_SIZE)
+                {
+                    ok = fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_TOO_LARGE);
+                    break;
+                }
+
+                const uint8_t* payload = m_readBuffer.data() + offset + header.headerSize;
+                offset += header.headerSize + available;
+                m_frameRemaining = header.payloadLength - available;
+                m_frameFin = header.fin;
+                ok = append_message(false, payload, available);
+            }
+            break;
+        }
+
+        const uint8_t* payload = m_readBuffer.data() + offset + header.headerSize;
+        size_t payloadSize = static_cast<size_t>(header.payloadLength);
+        offset += header.headerSize + payloadSize;
+        ok = handle_frame(header, payload, payloadSize);
+    }
+
+    m_readBuffer.erase(m_readBuffer.begin(), m_readBuffer.begin() + offset);
+    return ok;
+}
+
+bool websocket_connection::handle_frame(
+    _In_ const websocket_frame_header& header,
+    _In_reads_bytes_(size) const uint8_t* payload,
+    _In_ size_t size
+    )
+{
+    switch (header.opcode)
+    {
+        case websocket_opcode::continuation:
+        case websocket_opcode::text:
+        case websocket_opcode::binary:
+            if (!begin_data_frame(header))
+            {
+                return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+            }
+            return append_message(header.fin, payload, size);
+
+        case websocket_opcode::close:
+            return handle_close(payload, size);
+
+        case websocket_opcode::ping:
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state == connection_state::open)
+            {
+                queue_frame(websocket_opcode::pong, payload, size);
+            }
+            return true;
+        }
+
+        case websocket_opcode::pong:
+            handle_pong(payload, size);
+            return true;
+
+        default:
+            return true;
+    }
+}
+
+void websocket_connection::handle_pong(_In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size)
+{
+    // Our pings carry their sequence number.  An unsolicited pong, or the answer to a ping that
+    // was replaced, is a heartbeat with nothing to measure.
+    uint64_t sequence = 0;
+    if (!m_pingOutstanding || size != sizeof(sequence))
+    {
+        return;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        sequence = (sequence << 8) | payload[i];
+    }
+    if (sequence != m_pingSequence)
+    {
+        return;
+    }
+    m_pingOutstanding = false;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_pingSentTime);
+    uint32_t roundTripTime = static_cast<uint32_t>(MIN(elapsed.count(), static_cast<long long>(UINT32_MAX)));
+    uint32_t smoothed = m_websocket->smoothedRoundTripTime;
+    uint32_t minimum = m_websocket->minRoundTripTime;
+    m_websocket->roundTripTime = roundTripTime;
+    m_websocket->smoothedRoundTripTime = smoothed == 0 ? roundTripTime : static_cast<uint32_t>((7ull * smoothed + roundTripTime) / 8);
+    m_websocket->minRoundTripTime = (minimum == 0 || roundTripTime < minimum) ? roundTripTime : minimum;
+    HC_TRACE_VERBOSE(WEBSOCKET, "Websocket [ID %llu]: ping round trip %u ms", m_websocket->id, roundTripTime);
+}
+
+bool websocket_connection::begin_data_frame(_In_ const websocket_frame_header& header)
+{
+    if (header.opcode == websocket_opcode::continuation)
+    {
+        return m_inMessage;
+    }
+
+    // A new message can't start until the fragments of the last one are all in
+    if (m_inMessage)
+    {
+        return false;
+    }
+    if (m_messageBuffer == nullptr)
+    {
+        m_messageBuffer = m_websocket->bufferPool->acquire();
+    }
+    m_messageValidator.reset();
+    m_messageOpcode = header.opcode;
+    m_messageCompressed = header.rsv == WEBSOCKET_RSV1;
+    m_inMessage = true;
+    return true;
+}
+
+bool websocket_connection::append_message(
+    _In_ bool fin,
+    _In_reads_bytes_(size) const uint8_t* payload,
+    _In_ size_t size
+    )
+{
+    auto& message = m_messageBuffer->bytes;
+    size_t messageStart = message.size();
+    if (m_messageCompressed)
+    {
+        HC_RESULT result = m_deflate->decompress(payload, size, fin, WEBSOCKET_MAX_MESSAGE_SIZE, message);
+        if (result == HC_E_BUFFERTOOSMALL)
+        {
+            return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_TOO_LARGE);
+        }
+        if (result != HC_OK)
+        {
+            return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_INCONSISTENT_DATATYPE);
+        }
+    }
+    else
+    {
+        if (message.size() + size > WEBSOCKET_MAX_MESSAGE_SIZE)
+        {
+            return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_TOO_LARGE);
+        }
+        message.insert(message.end(), payload, payload + size);
+    }
+    return message_appended(messageStart, size, fin);
+}
+
+bool websocket_connection::message_appended(_In_ size_t messageStart, _In_ size_t receivedSize, _In_ bool fin)
+{
+    m_websocket->compressedBytesReceived += receivedSize;
+
+    // Text is validated as it arrives, so a bad message fails without waiting for the rest
+    auto& message = m_messageBuffer->bytes;
+    if (m_messageOpcode == websocket_opcode::text &&
+        !m_messageValidator.write(message.data() + messageStart, message.size() - messageStart))
+    {
+        return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_INCONSISTENT_DATATYPE);
+    }
+    return fin ? deliver_message() : true;
+}
+
+bool websocket_connection::handle_close(_In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size)
+{
+    // The body, if there is one, is a status code and then a UTF-8 reason (RFC 6455 5.5.1)
+    uint16_t closeStatus = 0;
+    if (size == 1)
+    {
+        return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+    }
+    if (size >= 2)
+    {
+        closeStatus = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+        bool valid = (closeStatus >= 1000 && closeStatus <= 1003) ||
+            (closeStatus >= 1007 && closeStatus <= 1011) ||
+            (closeStatus >= 3000 && closeStatus <= 4999);
+        if (!valid)
+        {
+            return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+        }
+        if (!websocket_is_valid_utf8(payload + 2, size - 2))
+        {
+            return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_INCONSISTENT_DATATYPE);
+        }
+    }
+
+    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: server closed with status %u", m_websocket->id, closeStatus);
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_state == connection_state::open)
+    {
+        // Echo the status back, which completes the closing handshake
+        queue_close(closeStatus);
+        close_with_event(closeStatus != 0 ?
+            static_cast<HC_WEBSOCKET_CLOSE_STATUS>(closeStatus) :
+            HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_NORMAL);
+    }
+    m_state = connection_state::closed;
+    return true;
+}
+
+bool websocket_connection::deliver_message()
+{
+    m_inMessage = false;
+    if (m_messageOpcode == websocket_opcode::text && !m_messageValidator.is_complete())
+    {
+        return fail(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_INCONSISTENT_DATATYPE);
+    }
+
+    auto& message = m_messageBuffer->bytes;
+    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: received a %llu byte message", m_websocket->id, static_cast<unsigned long long>(message.size()));
+    m_websocket->uncompressedBytesReceived += message.size();
+
+    message.push_back(0);
+    try
+    {
+        Internal_HCWebSocketRaiseMessage(m_websocket, m_messageOpcode == websocket_opcode::binary, m_messageBuffer);
+    }
+    catch (...)
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: message function threw", m_websocket->id);
+    }
+
+    // Only the message function could have retained the buffer, so if it didn't the buffer is
+    // still ours to reuse
+    if (m_messageBuffer->refCount > 1 || message.capacity() > WEBSOCKET_BUFFER_MAX_KEPT_CAPACITY)
+    {
+        websocket_buffer_pool::release(m_messageBuffer);
+        m_messageBuffer = nullptr;
+    }
+    else
+    {
+        message.clear();
+    }
+    return true;
+}
+
+bool websocket_connection::fail(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus)
+{
+    HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: failing the connection with status %d", m_websocket->id, closeStatus);
+    m_frameRemaining = 0;
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_state == connection_state::open)
+    {
+        queue_close(static_cast<uint16_t>(closeStatus));
+    }
+    close_with_event(closeStatus);
+    return true;
+}
+
+void websocket_connection::queue_frame(
+    _In_ websocket_opcode opcode,
+    _In_reads_bytes_opt_(size) const uint8_t* payload,
+    _In_ size_t size
+    )
+{
+    outgoing_frame frame;
+    size = MIN(size, WEBSOCKET_MAX_CONTROL_PAYLOAD_SIZE);
+    if (size > 0)
+    {
+        memcpy(frame.controlPayload, payload, size);
+    }
+    push_frame(std::move(frame), opcode, 0, frame.controlPayload, size);
+}
+
+void websocket_connection::queue_message(_In_ std::shared_ptr<websocket_outgoing_message> message)
+{
+    // Messages are compressed in the order they are queued, which is the order the server
+    // decompresses them in
+    uint8_t rsv = 0;
+    size_t uncompressedSize = message->payload.size();
+    if (m_deflate != nullptr)
+    {
+        if (m_websocket->reconnectReplay)
+        {
+            message->uncompressedPayload = message->payload;
+        }
+        if (m_deflate->compress(message->payload) == HC_OK)
+        {
+            rsv = WEBSOCKET_RSV1;
+        }
+    }
+    m_websocket->uncompressedBytesSent += uncompressedSize;
+    m_websocket->compressedBytesSent += message->payload.size();
+
+    outgoing_frame frame;
+    websocket_opcode opcode = message->opcode;
+    uint8_t* payload = message->payload.data();
+    size_t size = message->payload.size();
+    frame.message = std::move(message);
+    push_frame(std::move(frame), opcode, rsv, payload, size);
+}
+
+void websocket_connection::push_frame(
+    _In_ outgoing_frame&& frame,
+    _In_ websocket_opcode opcode,
+    _In_ uint8_t rsv,
+    _Inout_updates_bytes_(size) uint8_t* payload,
+    _In_ size_t size
+    )
+{
+    uint32_t key = static_cast<uint32_t>(m_random());
+    uint8_t maskKey[4] = { static_cast<uint8_t>(key), static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key >> 16), static_cast<uint8_t>(key >> 24) };
+
+    frame.headerSize = websocket_write_frame_header(opcode, true, rsv, size, maskKey, frame.header);
+    frame.payloadSize = size;
+    if (size > 0)
+    {
+        websocket_mask(payload, size, maskKey, 0);
+    }
+    m_outgoing.push_back(std::move(frame));
+}
+
+void websocket_connection::queue_close(_In_ uint16_t closeStatus)
+{
+    // 1005 and 1006 are only ever reported locally, so they're sent as a close with no body
+    if (closeStatus == 0 || closeStatus == 1005 || closeStatus == 1006)
+    {
+        queue_frame(websocket_opcode::close, nullptr, 0);
+    }
+    else
+    {
+        uint8_t payload[2] = { static_cast<uint8_t>(closeStatus >> 8), static_cast<uint8_t>(closeStatus) };
+        queue_frame(websocket_opcode::close, payload, sizeof(payload));
+    }
+}
+
+void websocket_connection::close_with_event(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus)
+{
+    // A close the app asked for gets its event from HCWebSocketDisconnect()
+    if (m_state == connection_state::open)
+    {
+        m_raiseCloseEvent = true;
+        m_closeStatus = closeStatus;
+    }
+    m_state = connection_state::closed;
+}
+
+void websocket_connection::write_frames()
+{
+    // Each pass gathers as many queued frames as one write takes, so a burst of small messages
+    // goes out in one system call rather than one each
+    while (!m_outgoing.empty())
+    {
+        http_socket_buffer buffers[HTTP_SOCKET_MAX_SEND_BUFFERS];
+        size_t count = 0;
+        size_t gathered = 0;
+        size_t skip = m_outgoingOffset;
+        for (auto frame = m_outgoing.begin(); frame != m_outgoing.end() && count + 2 <= HTTP_SOCKET_MAX_SEND_BUFFERS; ++frame)
+        {
+            http_socket_buffer parts[2] = { { frame->header, frame->headerSize }, { frame->payload(), frame->payloadSize } };
+            for (const auto& part : parts)
+            {
+                if (skip >= part.size)
+                {
+                    skip -= part.size;
+                    continue;
+                }
+                buffers[count].data = part.data + skip;
+                buffers[count].size = part.size - skip;
+                gathered += buffers[count].size;
+                skip = 0;
+                ++count;
+            }
+        }
+
+        int sent = http_socket_send_buffers(m_socket, buffers, count);
+        if (sent < 0)
+        {
+            if (!http_socket_would_block())
+            {
+                // Nothing more can be written, so what is queued fails
+                close_with_event(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE);
+                drop_frames();
+            }
+            break;
+        }
+
+        // Every frame that is now fully written completes its message
+        size_t written = m_outgoingOffset + static_cast<size_t>(sent);
+        while (!m_outgoing.empty() && written >= m_outgoing.front().headerSize + m_outgoing.front().payloadSize)
+        {
+            outgoing_frame& frame = m_outgoing.front();
+            written -= frame.headerSize + frame.payloadSize;
+            if (frame.message != nullptr)
+            {
+                frame.message->result = HC_OK;
+                m_completed.push_back(std::move(frame.message));
+            }
+            m_outgoing.pop_front();
+        }
+        m_outgoingOffset = written;
+
+        if (static_cast<size_t>(sent) < gathered)
+        {
+            // The socket's send buffer is full
+            break;
+        }
+    }
+}
+
+void websocket_connection::drop_frames()
+{
+    for (auto& frame : m_outgoing)
+    {
+        auto& message = frame.message;
+        if (message == nullptr)
+        {
+            continue;
+        }
+
+        if (m_websocket->reconnectReplay)
+        {
+            // Put the payload back as it was given, since a new connection masks and compresses
+            // it afresh
+            if ((frame.header[0] & (WEBSOCKET_RSV1 << 4)) != 0)
+            {
+                message->payload.swap(message->uncompressedPayload);
+            }
+            else if (!message->payload.empty())
+            {
+                websocket_mask(message->payload.data(), message->payload.size(), frame.header + frame.headerSize - 4, 0);
+            }
+            message->uncompressedPayload.clear();
+        }
+        m_unsent.push_back(std::move(message));
+    }
+    m_outgoing.clear();
+    m_outgoingOffset = 0;
+}
+
+void websocket_connection::keep_alive(_In_ std::chrono::steady_clock::time_point now)
+{
+    uint32_t pingInterval = m_websocket->pingIntervalInSeconds;
+    uint32_t pongTimeout = m_websocket->pongTimeoutInSeconds;
+    if (m_state != connection_state::open || pingInterval == 0)
+    {
+        return;
+    }
+
+    // Anything from the server shows it is still there, even if it is slow to answer the ping
+    if (m_pingOutstanding && pongTimeout != 0 &&
+        now - m_pingSentTime >= std::chrono::seconds(pongTimeout) &&
+        now - m_lastReceiveTime >= std::chrono::seconds(pongTimeout))
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: nothing received for %u seconds after a ping", m_websocket->id, pongTimeout);
+        close_with_event(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE);
+        drop_frames();
+        return;
+    }
+
+    if (now < m_nextPingTime || (m_pingOutstanding && pongTimeout != 0))
+    {
+        return;
+    }
+
+    uint64_t sequence = ++m_pingSequence;
+    uint8_t payload[sizeof(sequence)];
+    for (size_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = static_cast<uint8_t>(sequence >> (8 * (sizeof(payload) - 1 - i)));
+    }
+    queue_frame(websocket_opcode::ping, payload, sizeof(payload));
+    m_pingSentTime = now;
+    m_pingOutstanding = true;
+    m_nextPingTime = now + std::chrono::seconds(pingInterval);
+}
+
+void websocket_connection::fail_messages(_Inout_ http_internal_vector<std::shared_ptr<websocket_outgoing_message>>& messages)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (auto& message : messages)
+        {
+            message->result = HC_E_FAIL;
+            m_completed.push_back(std::move(message));
+        }
+    }
+    messages.clear();
+    complete_messages();
+}
+
+void websocket_connection::complete_messages()
+{
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        completed.swap(m_completed);
+    }
+
+    // Nothing is waiting on the tasks once the library is cleaning up
+    if (!completed.empty() && get_http_singleton(false) != nullptr)
+    {
+        for (const auto& message : completed)
+        {
+            HCTaskSetCompleted(message->taskHandle);
+        }
+    }
+}
+
+void websocket_connection::finish()
+{
+    bool raiseCloseEvent;
+    HC_WEBSOCKET_CLOSE_STATUS closeStatus;
+    websocket_reactor* reactor;
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> unsent;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_socket != HTTP_INVALID_SOCKET)
+        {
+            http_socket_close(m_socket);
+            m_socket = HTTP_INVALID_SOCKET;
+        }
+        close_with_event(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE);
+        reactor = m_reactor;
+        m_reactor = nullptr;
+
+        drop_frames();
+        unsent.swap(m_unsent);
+
+        raiseCloseEvent = m_raiseCloseEvent;
+        closeStatus = m_closeStatus;
+        m_raiseCloseEvent = false;
+    }
+
+    // A drop the app didn't ask for is a reconnect's to report, once it gives up.  If the app
+    // disconnected since the connection closed, HCWebSocketDisconnect() raised the event.
+    if (raiseCloseEvent && reconnect(reactor, 1, closeStatus, unsent))
+    {
+        raiseCloseEvent = false;
+    }
+    if (raiseCloseEvent)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        raiseCloseEvent = !m_closeRequested;
+    }
+    fail_messages(unsent);
+
+    if (raiseCloseEvent)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: raising close event with status %d", m_websocket->id, closeStatus);
+        try
+        {
+            Internal_HCWebSocketRaiseCloseEvent(m_websocket, closeStatus);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: close function threw", m_websocket->id);
+        }
+    }
+
+    HCWebSocketCloseHandle(m_websocket);
+}
+
+static bool is_reconnectable(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus)
+{
+    // 1012 (service restart) and 1013 (try again later) are newer than HC_WEBSOCKET_CLOSE_STATUS
+    switch (static_cast<uint32_t>(closeStatus))
+    {
+        case HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_GOING_AWAY:
+        case HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE:
+        case HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_SERVER_TERMINATE:
+        case 1012:
+        case 1013:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool websocket_connection::reconnect(
+    _In_opt_ websocket_reactor* reactor,
+    _In_ uint32_t attempt,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS dropStatus,
+    _Inout_ http_internal_vector<std::shared_ptr<websocket_outgoing_message>>& unsent
+    )
+{
+    HC_WEBSOCKET_HANDLE websocket = m_websocket;
+    if (reactor == nullptr || attempt > websocket->reconnectMaxAttempts || !is_reconnectable(dropStatus))
+    {
+        return false;
+    }
+
+    auto successor = http_allocate_shared<websocket_connection>(websocket, m_resolver, m_connectionAttemptDelayInMilliseconds, m_timeoutInSeconds);
+    {
+        // HCWebSocketDisconnect() may have reached this connection after it dropped
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_closeRequested)
+        {
+            return false;
+        }
+        successor->m_reconnectDelayInMilliseconds = websocket_reconnect_delay(
+            attempt,
+            websocket->reconnectInitialDelayInMilliseconds,
+            websocket->reconnectMaxDelayInMilliseconds,
+            static_cast<uint32_t>(m_random()));
+    }
+    successor->m_reconnectAttempt = attempt;
+    successor->m_dropStatus = dropStatus;
+    if (websocket->reconnectReplay)
+    {
+        successor->m_pending.swap(unsent);
+    }
+
+    // Sends and disconnects go to the new connection from here on
+    HCWebSocketDuplicateHandle(websocket);
+    std::atomic_store(&websocket->task, std::static_pointer_cast<hc_task>(successor));
+
+    // A disconnect that reached this connection before the new one was published is passed on, so
+    // the new connection gives up without connecting and releases its reference
+    bool closeRequested;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        closeRequested = m_closeRequested;
+    }
+    if (closeRequested)
+    {
+        successor->disconnect(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_NORMAL);
+    }
+    else
+    {
+        uint32_t delay = successor->m_reconnectDelayInMilliseconds;
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: reconnect attempt %u in %u ms", websocket->id, attempt, delay);
+        try
+        {
+            Internal_HCWebSocketRaiseReconnectEvent(websocket, HC_WEBSOCKET_RECONNECT_SCHEDULED, attempt, delay);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: reconnect function threw", websocket->id);
+        }
+    }
+
+    reactor->connect(successor, 0);
+    return true;
+}
+
+void websocket_connection::reconnect_failed(_In_opt_ websocket_reactor* reactor)
+{
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> pending;
+    bool closeRequested;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        pending.swap(m_pending);
+        closeRequested = m_closeRequested;
+    }
+
+    // HCWebSocketDisconnect() raised the close event if the app gave up on the reconnect
+    bool reconnecting = !closeRequested && reconnect(reactor, m_reconnectAttempt + 1, m_dropStatus, pending);
+    fail_messages(pending);
+    if (!closeRequested && !reconnecting)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: giving up reconnecting, raising close event with status %d", m_websocket->id, m_dropStatus);
+        try
+        {
+            Internal_HCWebSocketRaiseCloseEvent(m_websocket, m_dropStatus);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(WEBSOCKET, "Websocket [ID %llu]: close function threw", m_websocket->id);
+        }
+    }
+
+    HCWebSocketCloseHandle(m_websocket);
+}
+
+void websocket_connection::abandon_connect()
+{
+    if (m_reconnectAttempt > 0)
+    {
+        reconnect_failed(nullptr);
+    }
+    m_connectFinished = true;
+}
+
+uint32_t websocket_reconnect_delay(
+    _In_ uint32_t attempt,
+    _In_ uint32_t initialDelayInMilliseconds,
+    _In_ uint32_t maxDelayInMilliseconds,
+    _In_ uint32_t random
+    )
+{
+    uint64_t ceiling = initialDelayInMilliseconds;
+    for (uint32_t i = 1; i < attempt && ceiling < maxDelayInMilliseconds; i++)
+    {
+        ceiling *= 2;
+    }
+    ceiling = MIN(ceiling, static_cast<uint64_t>(maxDelayInMilliseconds));
+
+    // "Full jitter": anywhere from no delay up to the ceiling
+    return static_cast<uint32_t>(random % (ceiling + 1));
+}
+
+websocket_reactor::websocket_reactor() :
+    m_wakeSocket(HTTP_INVALID_SOCKET),
+    m_wakePending(false),
+    m_stopping(false)
+{
+}
+
+websocket_reactor::~websocket_reactor()
+{
+    http_internal_vector<std::shared_ptr<websocket_connection>> connecting;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+        for (const auto& worker : m_connectWorkers)
+        {
+            connecting.push_back(worker.connection);
+        }
+    }
+
+    for (const auto& connection : connecting)
+    {
+        connection->disconnect(HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_GOING_AWAY);
+    }
+    join_connect_workers(true);
+
+    wake();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    // Connections that opened after the reactor thread stopped
+    http_internal_vector<std::shared_ptr<websocket_connection>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        remaining.swap(m_connections);
+    }
+    for (const auto& connection : remaining)
+    {
+        connection->finish();
+    }
+
+    if (m_wakeSocket != HTTP_INVALID_SOCKET)
+    {
+        http_socket_close(m_wakeSocket);
+    }
+}
+
+bool websocket_reactor::start()
+{
+    if (m_thread.joinable())
+    {
+        return true;
+    }
+
+    m_wakeSocket = http_socket_open_wake();
+    if (m_wakeSocket == HTTP_INVALID_SOCKET)
+    {
+        return false;
+    }
+    m_thread = std::thread([this]() { run(); });
+    return true;
+}
+
+void websocket_reactor::connect(_In_ std::shared_ptr<websocket_connection> connection, _In_ HC_TASK_HANDLE taskHandle)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_stopping && start())
+        {
+            // The worker owns the connection until it is joined, so the thread can use it bare
+            websocket_connection* rawConnection = connection.get();
+            connect_worker worker;
+            worker.connection = connection;
+            worker.thread = std::thread([this, rawConnection, taskHandle]()
+            {
+                if (rawConnection->connect(this) == HC_OK)
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    for (const auto& pending : m_connectWorkers)
+                    {
+                        if (pending.connection.get() == rawConnection)
+                        {
+                            m_connections.push_back(pending.connection);
+                        }
+                    }
+                }
+                wake();
+
+                // A reconnect has no task
+                if (taskHandle != 0)
+                {
+                    HCTaskSetCompleted(taskHandle);
+                }
+            });
+            m_connectWorkers.push_back(std::move(worker));
+            return;
+        }
+    }
+
+    HC_TRACE_ERROR(WEBSOCKET, "websocket_reactor: couldn't start");
+    connection->abandon_connect();
+    if (taskHandle != 0)
+    {
+        HCTaskSetCompleted(taskHandle);
+    }
+}
+
+void websocket_reactor::wake()
+{
+    if (m_wakeSocket != HTTP_INVALID_SOCKET && !m_wakePending.exchange(true))
+    {
+        uint8_t byte = 0;
+        http_socket_send(m_wakeSocket, &byte, 1);
+    }
+}
+
+void websocket_reactor::join_connect_workers(_In_ bool all)
+{
+    http_internal_vector<connect_worker> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (size_t i = m_connectWorkers.size(); i-- > 0;)
+        {
+            if (all || m_connectWorkers[i].connection->is_connect_finished())
+            {
+                finished.push_back(std::move(m_connectWorkers[i]));
+                m_connectWorkers.erase(m_connectWorkers.begin() + i);
+            }
+        }
+    }
+
+    for (auto& worker : finished)
+    {
+        worker.thread.join();
+    }
+}
+
+void websocket_reactor::run()
+{
+    http_internal_vector<std::shared_ptr<websocket_connection>> connections;
+    http_internal_vector<http_socket_poll_entry> entries;
+    while (true)
+    {
+        join_connect_workers(false);
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_stopping)
+            {
+                connections = m_connections;
+                m_connections.clear();
+                break;
+            }
+            connections = m_connections;
+        }
+
+        entries.resize(connections.size() + 1);
+        entries[0].socket = m_wakeSocket;
+        entries[0].wantWrite = false;
+        bool unparsedFrames = false;
+        for (size_t i = 0; i < connections.size(); i++)
+        {
+            entries[i + 1].socket = connections[i]->socket();
+            entries[i + 1].wantWrite = connections[i]->wants_write();
+            unparsedFrames = unparsedFrames || connections[i]->has_unparsed_frames();
+        }
+
+        if (http_socket_poll(entries.data(), entries.size(), unparsedFrames ? 0 : WEBSOCKET_POLL_INTERVAL_IN_MILLISECONDS) < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        if (entries[0].readable)
+        {
+            // Clear the flag first so a wake that races with the drain isn't lost
+            m_wakePending = false;
+            uint8_t drain[64];
+            while (http_socket_receive(m_wakeSocket, drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+
+        for (size_t i = 0; i < connections.size(); i++)
+        {
+            if (!connections[i]->process(entries[i + 1].readable, entries[i + 1].writable))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_connections.erase(std::remove(m_connections.begin(), m_connections.end(), connections[i]), m_connections.end());
+                }
+                connections[i]->finish();
+            }
+        }
+        connections.clear();
+    }
+
+    for (const auto& connection : connections)
+    {
+        connection->finish();
+    }
+}
+
+HC_RESULT WebSocketConnectExecute(
+    _In_opt_ void* executionRoutineContext,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+try
+{
+    HC_WEBSOCKET_HANDLE websocket = static_cast<HC_WEBSOCKET_HANDLE>(executionRoutineContext);
+    auto httpSingleton = get_http_singleton(false);
+    if (websocket == nullptr || httpSingleton == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Connect executing", websocket->id);
+    auto connection = std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task));
+    httpSingleton->m_websocketReactor->connect(connection, taskHandle);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_RESULT WebSocketConnectWriteResults(
+    _In_opt_ void* writeResultsRoutineContext,
+    _In_ HC_TASK_HANDLE taskHandleId,
+    _In_opt_ void* completionRoutine,
+    _In_opt_ void* completionRoutineContext
+    )
+try
+{
+    UNREFERENCED_PARAMETER(taskHandleId);
+    HC_WEBSOCKET_HANDLE websocket = static_cast<HC_WEBSOCKET_HANDLE>(writeResultsRoutineContext);
+    if (websocket != nullptr)
+    {
+        HCWebSocketCompletionRoutine completeFn = static_cast<HCWebSocketCompletionRoutine>(completionRoutine);
+        auto connection = std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task));
+        if (completeFn != nullptr && connection != nullptr)
+        {
+            completeFn(completionRoutineContext, websocket, connection->connect_result(), connection->platform_error_code());
+        }
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_RESULT WebSocketSendMessageExecute(
+    _In_opt_ void* executionRoutineContext,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+try
+{
+    auto message = executionRoutineContext != nullptr ? static_cast<websocket_outgoing_message*>(executionRoutineContext)->self : nullptr;
+    if (message == nullptr)
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket: Send message execute null");
+        return HC_E_INVALIDARG;
+    }
+
+    message->taskHandle = taskHandle;
+    message->connection->send(message);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_RESULT WebSocketSendMessageWriteResults(
+    _In_opt_ void* writeResultsRoutineContext,
+    _In_ HC_TASK_HANDLE taskHandleId,
+    _In_opt_ void* completionRoutine,
+    _In_opt_ void* completionRoutineContext
+    )
+try
+{
+    UNREFERENCED_PARAMETER(taskHandleId);
+    // Drops the reference the task held
+    std::shared_ptr<websocket_outgoing_message> message;
+    if (writeResultsRoutineContext != nullptr)
+    {
+        message = std::move(static_cast<websocket_outgoing_message*>(writeResultsRoutineContext)->self);
+    }
+    if (message == nullptr)
+    {
+        HC_TRACE_ERROR(WEBSOCKET, "Websocket write result null call");
+        return HC_E_INVALIDARG;
+    }
+
+    HCWebSocketCompletionRoutine completeFn = static_cast<HCWebSocketCompletionRoutine>(completionRoutine);
+    if (completeFn != nullptr)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket: Message [ID %llu] send complete", message->id);
+        completeFn(completionRoutineContext, message->websocket, message->result, 0);
+    }
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_RESULT websocket_connect(
+    _In_z_ PCSTR uri,
+    _In_z_ PCSTR subProtocol,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    auto httpSingleton = get_http_singleton(false);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    if (!httpSingleton->start_sockets())
+    {
+        return HC_E_FAIL;
+    }
+
+    websocket->uri = uri;
+    websocket->subProtocol = subProtocol;
+    websocket->task = http_allocate_shared<websocket_connection>(
+        websocket,
+        httpSingleton->m_dnsResolver,
+        httpSingleton->m_connectionAttemptDelayInMilliseconds,
+        httpSingleton->m_timeoutInSeconds);
+
+    return HCTaskCreate(
+        taskSubsystemId,
+        taskGroupId,
+        WebSocketConnectExecute, static_cast<void*>(websocket),
+        WebSocketConnectWriteResults, static_cast<void*>(websocket),
+        completionRoutine, completionRoutineContext,
+        nullptr);
+}
+
+static HC_RESULT send_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ websocket_opcode opcode,
+    _In_reads_bytes_(size) const uint8_t* payload,
+    _In_ size_t size,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    auto httpSingleton = get_http_singleton(false);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    auto connection = std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task));
+    if (connection == nullptr)
+    {
+        return HC_E_NOTINITIALISED;
+    }
+
+    auto outgoing = http_allocate_shared<websocket_outgoing_message>();
+    outgoing->connection = connection;
+    outgoing->websocket = websocket;
+    outgoing->opcode = opcode;
+    outgoing->payload.assign(payload, payload + size);
+    outgoing->taskHandle = 0;
+    outgoing->result = HC_E_FAIL;
+    outgoing->id = ++httpSingleton->m_lastId;
+    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Message [ID %llu] queued", websocket->id, outgoing->id);
+
+    // The task holds a reference through the message itself rather than the shared_ptr_cache, so
+    // sending doesn't take the global cache lock
+    outgoing->self = outgoing;
+    void* rawMessage = outgoing.get();
+    HC_RESULT result = HCTaskCreate(
+        taskSubsystemId,
+        taskGroupId,
+        WebSocketSendMessageExecute, rawMessage,
+        WebSocketSendMessageWriteResults, rawMessage,
+        completionRoutine, completionRoutineContext,
+        nullptr);
+    if (result != HC_OK)
+    {
+        outgoing->self = nullptr;
+    }
+    return result;
+}
+
+HC_RESULT websocket_send_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR message,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    return send_message(
+        websocket,
+        websocket_opcode::text,
+        reinterpret_cast<const uint8_t*>(message),
+        strlen(message),
+        taskSubsystemId,
+        taskGroupId,
+        completionRoutineContext,
+        completionRoutine);
+}
+
+HC_RESULT websocket_send_binary_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    return send_message(
+        websocket,
+        websocket_opcode::binary,
+        payloadBytes,
+        payloadSize,
+        taskSubsystemId,
+        taskGroupId,
+        completionRoutineContext,
+        completionRoutine);
+}
+
+HC_RESULT websocket_broadcast(
+    _In_reads_(websocketCount) const HC_WEBSOCKET_HANDLE* websockets,
+    _In_ uint32_t websocketCount,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _Out_opt_ uint32_t* queuedCount
+    )
+{
+    // Every connection sends the frame with the same mask, which is still chosen afresh for each
+    // broadcast so the app can't predict it
+    uint32_t key = std::random_device()();
+    uint8_t maskKey[4] = { static_cast<uint8_t>(key), static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key >> 16), static_cast<uint8_t>(key >> 24) };
+
+    auto frame = http_allocate_shared<websocket_broadcast_frame>();
+    frame->headerSize = websocket_write_frame_header(websocket_opcode::binary, true, 0, payloadSize, maskKey, frame->header);
+    frame->payload.assign(payloadBytes, payloadBytes + payloadSize);
+    if (payloadSize > 0)
+    {
+        websocket_mask(frame->payload.data(), payloadSize, maskKey, 0);
+    }
+
+    uint32_t queued = 0;
+    for (uint32_t i = 0; i < websocketCount; ++i)
+    {
+        auto connection = std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websockets[i]->task));
+        if (connection != nullptr && connection->send_broadcast(frame))
+        {
+            ++queued;
+        }
+    }
+
+    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket: broadcast of %u bytes queued on %u of %u", payloadSize, queued, websocketCount);
+    if (queuedCount != nullptr)
+    {
+        *queuedCount = queued;
+    }
+    return HC_OK;
+}
+
+HC_RESULT websocket_disconnect(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    )
+{
+    auto connection = std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task));
+    if (connection == nullptr)
+    {
+        return HC_E_NOTINITIALISED;
+    }
+
+    connection->disconnect(closeStatus);
+    return HC_OK;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,322 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "../hcwebsocket.h"
+#include "../../HTTP/http_socket.h"
+#include "../../HTTP/http_connector.h"
+#include "websocket_frame.h"
+#include "websocket_deflate.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+class http_dns_resolver;
+class websocket_reactor;
+class websocket_connection;
+
+// How long to wait for the server to answer our close frame before dropping the connection
+const uint32_t WEBSOCKET_CLOSE_TIMEOUT_IN_SECONDS = 5;
+
+// Larger messages are refused with HC_WEBSOCKET_CLOSE_TOO_LARGE
+const size_t WEBSOCKET_MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+// Uncompressed data frames at least this long are read straight into the message buffer once
+// their header is in, rather than gathered in the read buffer and copied
+const size_t WEBSOCKET_DIRECT_READ_THRESHOLD = 16 * 1024;
+const size_t WEBSOCKET_DIRECT_READ_SIZE = 64 * 1024;
+
+// Reconnect attempts (counting from 1) wait a random time up to initialDelay * 2^(attempt - 1),
+// capped at maxDelay, so clients that dropped together don't all reconnect together
+uint32_t websocket_reconnect_delay(
+    _In_ uint32_t attempt,
+    _In_ uint32_t initialDelayInMilliseconds,
+    _In_ uint32_t maxDelayInMilliseconds,
+    _In_ uint32_t random
+    );
+
+// A message passed to HCWebSocketSendMessage() or HCWebSocketSendBinaryMessage().  Its task's context is the raw pointer, and
+// self keeps it alive until the results of the task are written.  The payload is compressed in place when it is queued, if
+// permessage-deflate was negotiated, and then masked in place.  If it may be replayed after a reconnect, the payload is
+// unmasked again when the connection drops, and a compressed one is kept as it was given.
+struct websocket_outgoing_message
+{
+    std::shared_ptr<websocket_outgoing_message> self;
+    std::shared_ptr<websocket_connection> connection;
+    HC_WEBSOCKET_HANDLE websocket;
+    websocket_opcode opcode;
+    http_internal_vector<uint8_t> payload;
+    http_internal_vector<uint8_t> uncompressedPayload;
+    HC_TASK_HANDLE taskHandle;
+    HC_RESULT result;
+    uint64_t id;
+};
+
+// A binary message passed to HCWebSocketBroadcast().  It is framed and masked once, and every
+// connection it is queued on writes the same bytes, so it is never compressed.  The last
+// connection to write it frees it.
+struct websocket_broadcast_frame
+{
+    uint8_t header[WEBSOCKET_MAX_FRAME_HEADER_SIZE];
+    size_t headerSize;
+    http_internal_vector<uint8_t> payload;
+};
+
+// A client WebSocket connection (RFC 6455) over a plain socket.
+//
+// A connect thread resolves the host, connects, through an HTTP proxy if the WebSocket has one,
+// and performs the opening handshake.  The connection is then handed to the websocket_reactor,
+// which does all of its reads and writes on non-blocking sockets.  Other threads only queue frames
+// under m_lock and wake the reactor.  Messages are passed to the app's message function on the
+// reactor thread as they complete, with fragments joined and decompressed if permessage-deflate was
+// negotiated, from buffers the app can retain.
+//
+// The close event is raised when the server closes the connection or it fails.  It isn't raised
+// when the app calls HCWebSocketDisconnect(), which raises its own.  If the WebSocket has a
+// reconnect policy, a connection that drops instead hands what is left to send to a new connection,
+// which replaces it as the WebSocket's task and connects after a backoff.  The close event waits
+// until the last attempt fails.
+class websocket_connection : public hc_task
+{
+public:
+    websocket_connection(
+        _In_ HC_WEBSOCKET_HANDLE websocket,
+        _In_ std::shared_ptr<http_dns_resolver> resolver,
+        _In_ uint32_t connectionAttemptDelayInMilliseconds,
+        _In_ uint32_t timeoutInSeconds
+        );
+    ~websocket_connection();
+
+    // Called on the connect thread.  On success the socket is left non-blocking for the reactor
+    // and the connection holds a reference on the WebSocket handle until finish().
+    HC_RESULT connect(_In_ websocket_reactor* reactor);
+    HC_RESULT connect_result();
+    uint32_t platform_error_code();
+    bool is_connect_finished();
+
+    // Called on the connect thread when the reactor couldn't take the connection
+    void abandon_connect();
+
+    // Frames and queues the message.  Its task is completed once it has been written, or the
+    // connection has closed.  While a reconnect is connecting, the message waits for it if it
+    // replays messages.
+    void send(_In_ std::shared_ptr<websocket_outgoing_message> message);
+
+    // Queues a broadcast if the connection is open, and returns whether it did.  Nothing is
+    // completed once it has been written, and it isn't replayed after a reconnect.
+    bool send_broadcast(_In_ const std::shared_ptr<const websocket_broadcast_frame>& frame);
+
+    // Starts the closing handshake, or gives up on a connect in progress
+    void disconnect(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus);
+
+    // Called on the reactor thread.  process() returns false once the connection is done, after
+    // which the reactor calls finish().  has_unparsed_frames() is true until process() has parsed
+    // the frames the server sent along with its handshake response, which the socket won't signal.
+    http_socket socket();
+    bool wants_write();
+    bool has_unparsed_frames() const { return m_unparsedFrames; }
+    bool process(_In_ bool readable, _In_ bool writable);
+    void finish();
+
+private:
+    enum class connection_state
+    {
+        connecting,
+        open,
+        closing,  // we sent a close frame and are waiting for the server's
+        closed    // no more frames are read, and the socket is closed once what is queued is written
+    };
+
+    // A frame waiting to be written.  A message's payload is masked in place and written from the
+    // message, and a broadcast's from the frame all its connections share, so sending never copies
+    // it.  A control frame's short payload is kept in the frame.
+    struct outgoing_frame
+    {
+        uint8_t header[WEBSOCKET_MAX_FRAME_HEADER_SIZE];
+        size_t headerSize;
+        uint8_t controlPayload[WEBSOCKET_MAX_CONTROL_PAYLOAD_SIZE];
+        size_t payloadSize;
+        std::shared_ptr<websocket_outgoing_message> message;  // completed once the frame is written
+        std::shared_ptr<const websocket_broadcast_frame> broadcast;
+
+        const uint8_t* payload() const
+        {
+            return message != nullptr ? message->payload.data() : broadcast != nullptr ? broadcast->payload.data() : controlPayload;
+        }
+    };
+
+    HC_RESULT handshake(
+        _In_ http_socket socket,
+        _In_ const http_internal_string& authority,
+        _In_ const http_internal_string& resource,
+        _In_ std::chrono::steady_clock::time_point deadline
+        );
+
+    bool read_frames();
+    bool read_frame_payload();
+    bool parse_frames();
+    bool handle_frame(_In_ const websocket_frame_header& header, _In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size);
+    bool begin_data_frame(_In_ const websocket_frame_header& header);
+    bool append_message(_In_ bool fin, _In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size);
+    bool message_appended(_In_ size_t messageStart, _In_ size_t receivedSize, _In_ bool fin);
+    bool handle_close(_In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size);
+    void handle_pong(_In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size);
+    bool deliver_message();
+    bool fail(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus);
+
+    // Called with m_lock held
+    void queue_frame(_In_ websocket_opcode opcode, _In_reads_bytes_opt_(size) const uint8_t* payload, _In_ size_t size);
+    void queue_message(_In_ std::shared_ptr<websocket_outgoing_message> message);
+    void push_frame(_In_ outgoing_frame&& frame, _In_ websocket_opcode opcode, _In_ uint8_t rsv, _Inout_updates_bytes_(size) uint8_t* payload, _In_ size_t size);
+    void queue_close(_In_ uint16_t closeStatus);
+    void close_with_event(_In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus);
+    void write_frames();
+    void drop_frames();
+    void keep_alive(_In_ std::chrono::steady_clock::time_point now);
+
+    void complete_messages();
+    void fail_messages(_Inout_ http_internal_vector<std::shared_ptr<websocket_outgoing_message>>& messages);
+
+    // Hands the unsent messages to a new connection that connects after a backoff.  Returns false,
+    // leaving the messages, if the policy allows no more attempts or the app has disconnected.
+    bool reconnect(
+        _In_opt_ websocket_reactor* reactor,
+        _In_ uint32_t attempt,
+        _In_ HC_WEBSOCKET_CLOSE_STATUS dropStatus,
+        _Inout_ http_internal_vector<std::shared_ptr<websocket_outgoing_message>>& unsent
+        );
+    void reconnect_failed(_In_opt_ websocket_reactor* reactor);
+
+    HC_WEBSOCKET_HANDLE m_websocket;
+    http_connector m_connector;
+    std::shared_ptr<http_dns_resolver> m_resolver;
+    uint32_t m_connectionAttemptDelayInMilliseconds;
+    uint32_t m_timeoutInSeconds;
+
+    std::mutex m_lock;
+    websocket_reactor* m_reactor;
+    connection_state m_state;
+    http_socket m_socket;
+    bool m_closeRequested;
+    std::condition_variable m_closeRequestedChanged;
+    std::atomic<bool> m_connectFinished;
+    HC_RESULT m_connectResult;
+    uint32_t m_platformErrorCode;
+    std::mt19937 m_random;
+    std::shared_ptr<websocket_deflate> m_deflate;  // set by the handshake if the server accepted permessage-deflate
+
+    // Written by the reactor
+    http_internal_dequeue<outgoing_frame> m_outgoing;
+    size_t m_outgoingOffset;  // bytes of the first frame already written
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> m_unsent;  // dropped frames' messages, replayed or failed by finish()
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> m_completed;  // to complete once m_lock is released
+    std::chrono::steady_clock::time_point m_closeDeadline;
+    bool m_raiseCloseEvent;
+    HC_WEBSOCKET_CLOSE_STATUS m_closeStatus;
+
+    // Keepalive.  Only one ping is waited on at a time, unless there is no pong timeout, when each
+    // ping replaces the last.
+    std::chrono::steady_clock::time_point m_nextPingTime;
+    std::chrono::steady_clock::time_point m_pingSentTime;
+    std::chrono::steady_clock::time_point m_lastReceiveTime;
+    uint64_t m_pingSequence;
+    bool m_pingOutstanding;
+
+    // Set on a connection that replaces one that dropped.  It holds a reference on the WebSocket
+    // handle from when it is scheduled.
+    uint32_t m_reconnectAttempt;  // 0 for the app's own connect
+    uint32_t m_reconnectDelayInMilliseconds;
+    HC_WEBSOCKET_CLOSE_STATUS m_dropStatus;
+    http_internal_vector<std::shared_ptr<websocket_outgoing_message>> m_pending;  // sent once the reconnect is open
+
+    // Only touched by the connect thread, then the reactor
+    http_internal_vector<uint8_t> m_readBuffer;
+    bool m_unparsedFrames;  // m_readBuffer holds bytes read with the handshake response
+    HC_WEBSOCKET_BUFFER* m_messageBuffer;  // from the WebSocket's pool, and kept for the next message unless the app retained it
+    uint64_t m_frameRemaining;  // payload bytes still to read straight into m_messageBuffer
+    bool m_frameFin;
+    websocket_opcode m_messageOpcode;
+    websocket_utf8_validator m_messageValidator;
+    bool m_messageCompressed;
+    bool m_inMessage;
+};
+
+// Runs every open native WebSocket connection from one thread, so thousands of mostly idle
+// connections cost a poll entry each rather than a thread each.  Connections are handed over
+// once their handshake is done.
+class websocket_reactor
+{
+public:
+    websocket_reactor();
+    ~websocket_reactor();
+
+    // Starts connecting on a thread of its own, since resolving and connecting block.  The task is
+    // completed once the connection is open or has failed.
+    void connect(_In_ std::shared_ptr<websocket_connection> connection, _In_ HC_TASK_HANDLE taskHandle);
+
+    // Makes the reactor thread look at its connections again, for frames that were just queued
+    void wake();
+
+private:
+    struct connect_worker
+    {
+        std::shared_ptr<websocket_connection> connection;
+        std::thread thread;
+    };
+
+    bool start();
+    void run();
+    void join_connect_workers(_In_ bool all);
+
+    std::mutex m_lock;
+    std::thread m_thread;
+    http_socket m_wakeSocket;
+    std::atomic<bool> m_wakePending;
+    bool m_stopping;
+    http_internal_vector<std::shared_ptr<websocket_connection>> m_connections;
+    http_internal_vector<connect_worker> m_connectWorkers;
+};
+
+HC_RESULT websocket_connect(
+    _In_z_ PCSTR uri,
+    _In_z_ PCSTR subProtocol,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    );
+
+HC_RESULT websocket_send_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR message,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    );
+
+HC_RESULT websocket_send_binary_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    );
+
+HC_RESULT websocket_broadcast(
+    _In_reads_(websocketCount) const HC_WEBSOCKET_HANDLE* websockets,
+    _In_ uint32_t websocketCount,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _Out_opt_ uint32_t* queuedCount
+    );
+
+HC_RESULT websocket_disconnect(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    );
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,270 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "websocket_deflate.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+static const char WEBSOCKET_DEFLATE_EXTENSION[] = "permessage-deflate";
+
+// Deflate data expands at most about 1000 times, so inflating 1KB at a time bounds what a single
+// write can add before the message size is checked
+const size_t WEBSOCKET_DEFLATE_INFLATE_CHUNK_SIZE = 1024;
+
+static http_internal_string trim_and_lower(_In_ const http_internal_string& value)
+{
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == http_internal_string::npos)
+    {
+        return http_internal_string();
+    }
+    size_t end = value.find_last_not_of(" \t");
+
+    http_internal_string result;
+    for (size_t i = begin; i <= end; i++)
+    {
+        char c = value[i];
+        result.push_back((c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c);
+    }
+    return result;
+}
+
+static http_internal_vector<http_internal_string> split(_In_ const http_internal_string& value, _In_ char separator)
+{
+    http_internal_vector<http_internal_string> parts;
+    size_t start = 0;
+    for (;;)
+    {
+        size_t end = value.find(separator, start);
+        parts.push_back(trim_and_lower(value.substr(start, end == http_internal_string::npos ? http_internal_string::npos : end - start)));
+        if (end == http_internal_string::npos)
+        {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+// Window bits are a number from 8 to 15, which may be quoted (RFC 7692 7.1.2)
+static bool parse_window_bits(_In_ http_internal_string value, _Out_ uint32_t* windowBits)
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+    {
+        value = value.substr(1, value.size() - 2);
+    }
+
+    if (value.size() == 1 && value[0] >= '8' && value[0] <= '9')
+    {
+        *windowBits = static_cast<uint32_t>(value[0] - '0');
+        return true;
+    }
+    if (value.size() == 2 && value[0] == '1' && value[1] >= '0' && value[1] <= '5')
+    {
+        *windowBits = static_cast<uint32_t>(10 + value[1] - '0');
+        return true;
+    }
+    return false;
+}
+
+size_t websocket_deflate_memory_size(_In_ uint32_t windowBits)
+{
+    // Sending keeps a hash table and chain table of 4 byte positions and up to two windows of
+    // history.  Receiving keeps up to two windows of output.
+    size_t windowSize = static_cast<size_t>(1) << windowBits;
+    return 4 * windowSize + 4 * windowSize + 2 * windowSize + 2 * windowSize + sizeof(websocket_deflate);
+}
+
+bool websocket_deflate_fit_window(_In_ uint32_t maxWindowBits, _In_ uint32_t memoryLimit, _Out_ uint32_t* windowBits)
+{
+    *windowBits = 0;
+    for (uint32_t bits = MIN(maxWindowBits, WEBSOCKET_DEFLATE_MAX_WINDOW_BITS); bits >= WEBSOCKET_DEFLATE_MIN_WINDOW_BITS; bits--)
+    {
+        if (memoryLimit == 0 || websocket_deflate_memory_size(bits) <= memoryLimit)
+        {
+            *windowBits = bits;
+            return true;
+        }
+    }
+    return false;
+}
+
+http_internal_string websocket_deflate_offer(_In_ const websocket_deflate_params& offer)
+{
+    char windowBits[64];
+    http_internal_string value = WEBSOCKET_DEFLATE_EXTENSION;
+    snprintf(windowBits, sizeof(windowBits), "; client_max_window_bits=%u", offer.clientMaxWindowBits);
+    value += windowBits;
+    if (offer.serverMaxWindowBits < WEBSOCKET_DEFLATE_MAX_WINDOW_BITS)
+    {
+        snprintf(windowBits, sizeof(windowBits), "; server_max_window_bits=%u", offer.serverMaxWindowBits);
+        value += windowBits;
+    }
+    if (offer.clientNoContextTakeover)
+    {
+        value += "; client_no_context_takeover";
+    }
+    if (offer.serverNoContextTakeover)
+    {
+        value += "; server_no_context_takeover";
+    }
+    return value;
+}
+
+bool websocket_deflate_parse_response(
+    _In_ const http_internal_string& value,
+    _In_ const websocket_deflate_params& offer,
+    _Out_ websocket_deflate_params* accepted
+    )
+{
+    *accepted = offer;
+    accepted->serverMaxWindowBits = WEBSOCKET_DEFLATE_MAX_WINDOW_BITS;
+    accepted->serverNoContextTakeover = false;
+
+    // Only the one extension was offered, so that is all the server can answer with
+    if (split(value, ',').size() != 1)
+    {
+        return false;
+    }
+    auto params = split(value, ';');
+    if (params[0] != WEBSOCKET_DEFLATE_EXTENSION)
+    {
+        return false;
+    }
+
+    bool seen[4] = {};
+    for (size_t i = 1; i < params.size(); i++)
+    {
+        size_t equals = params[i].find('=');
+        http_internal_string name = trim_and_lower(params[i].substr(0, equals));
+        http_internal_string paramValue = (equals == http_internal_string::npos) ? http_internal_string() : trim_and_lower(params[i].substr(equals + 1));
+
+        size_t index;
+        uint32_t windowBits = 0;
+        if (name == "server_no_context_takeover" && equals == http_internal_string::npos)
+        {
+            index = 0;
+            accepted->serverNoContextTakeover = true;
+        }
+        else if (name == "client_no_context_takeover" && equals == http_internal_string::npos)
+        {
+            index = 1;
+            accepted->clientNoContextTakeover = true;
+        }
+        else if (name == "server_max_window_bits" && parse_window_bits(paramValue, &windowBits))
+        {
+            index = 2;
+            accepted->serverMaxWindowBits = windowBits;
+        }
+        else if (name == "client_max_window_bits" && parse_window_bits(paramValue, &windowBits) && windowBits <= offer.clientMaxWindowBits)
+        {
+            index = 3;
+            accepted->clientMaxWindowBits = windowBits;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (seen[index])
+        {
+            return false;
+        }
+        seen[index] = true;
+    }
+
+    // A server that accepts a smaller window must use it, or our window would be too small
+    return accepted->serverMaxWindowBits <= offer.serverMaxWindowBits;
+}
+
+websocket_deflate::websocket_deflate(_In_ const websocket_deflate_params& params, _In_ HC_COMPRESSION_LEVEL level) :
+    m_params(params),
+    m_deflater(level),
+    m_inflater(http_content_encoding::deflate_raw)
+{
+    m_deflater.set_message_window(params.clientMaxWindowBits, !params.clientNoContextTakeover);
+}
+
+HC_RESULT websocket_deflate::compress(_Inout_ http_internal_vector<uint8_t>& payload)
+{
+    m_compressed.clear();
+    HC_RESULT result = m_deflater.compress_message(payload.data(), payload.size(), m_compressed);
+    if (result == HC_OK)
+    {
+        payload.swap(m_compressed);
+    }
+    return result;
+}
+
+HC_RESULT websocket_deflate::decompress(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _In_ bool fin,
+    _In_ size_t maxMessageSize,
+    _Inout_ http_internal_vector<uint8_t>& message
+    )
+{
+    HC_RESULT result = inflate(data, size, maxMessageSize, message);
+    if (result != HC_OK || !fin)
+    {
+        return result;
+    }
+
+    // Put back the end of the sync flush the sender left off (RFC 7692 7.2.2)
+    static const uint8_t syncFlushTail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+    result = inflate(syncFlushTail, sizeof(syncFlushTail), maxMessageSize, message);
+    if (result != HC_OK)
+    {
+        return result;
+    }
+
+    if (m_params.serverNoContextTakeover)
+    {
+        m_inflater = http_inflater(http_content_encoding::deflate_raw);
+        m_window.clear();
+    }
+    else
+    {
+        // The server may have ended the message with a final block, after which the next starts a new stream
+        m_inflater.restart();
+    }
+    return HC_OK;
+}
+
+HC_RESULT websocket_deflate::inflate(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _In_ size_t maxMessageSize,
+    _Inout_ http_internal_vector<uint8_t>& message
+    )
+{
+    size_t windowSize = static_cast<size_t>(1) << m_params.serverMaxWindowBits;
+    while (size > 0)
+    {
+        size_t chunkSize = MIN(size, WEBSOCKET_DEFLATE_INFLATE_CHUNK_SIZE);
+        size_t windowEnd = m_window.size();
+        HC_RESULT result = m_inflater.write(data, chunkSize, m_window);
+        if (result != HC_OK)
+        {
+            return result;
+        }
+
+        if (message.size() + (m_window.size() - windowEnd) > maxMessageSize)
+        {
+            return HC_E_BUFFERTOOSMALL;
+        }
+        message.insert(message.end(), m_window.begin() + windowEnd, m_window.end());
+
+        // Only the last window can be referred back to
+        if (m_window.size() > 2 * windowSize)
+        {
+            m_inflater.discard_output(m_window, windowSize);
+        }
+
+        data += chunkSize;
+        size -= chunkSize;
+    }
+    return HC_OK;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+#include "../../HTTP/compression.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// The permessage-deflate extension (RFC 7692).
+//
+// The client offers it in the Sec-WebSocket-Extensions header and the server accepts it, possibly
+// with smaller windows or without context takeover.  Data messages sent with RSV1 set are raw
+// deflate data that ends in a sync flush with its last 4 bytes left off.  With context takeover
+// each side's LZ77 window carries over from one message to the next, which is what makes short,
+// repetitive messages such as JSON compress well.
+
+const uint32_t WEBSOCKET_DEFLATE_MIN_WINDOW_BITS = 8;
+const uint32_t WEBSOCKET_DEFLATE_MAX_WINDOW_BITS = 15;
+
+struct websocket_deflate_params
+{
+    uint32_t clientMaxWindowBits;  // the window for messages we send
+    uint32_t serverMaxWindowBits;  // the window for messages the server sends
+    bool clientNoContextTakeover;
+    bool serverNoContextTakeover;
+};
+
+// The memory the compression state of one connection needs with windows of 2^windowBits bytes:
+// the match tables and history for sending, and the window kept for receiving
+size_t websocket_deflate_memory_size(_In_ uint32_t windowBits);
+
+// Picks the largest window up to maxWindowBits whose state fits in memoryLimit bytes, 0 being no
+// limit.  Returns false if not even the smallest one fits.
+bool websocket_deflate_fit_window(_In_ uint32_t maxWindowBits, _In_ uint32_t memoryLimit, _Out_ uint32_t* windowBits);
+
+// The Sec-WebSocket-Extensions value for the offer
+http_internal_string websocket_deflate_offer(_In_ const websocket_deflate_params& offer);
+
+// Parses the Sec-WebSocket-Extensions value the server answered the offer with.  Returns false if
+// the server accepted something that wasn't offered or answered with invalid parameters, either
+// of which fails the connection (RFC 7692 5.1, 7.1).
+bool websocket_deflate_parse_response(
+    _In_ const http_internal_string& value,
+    _In_ const websocket_deflate_params& offer,
+    _Out_ websocket_deflate_params* accepted
+    );
+
+// The compression contexts of one connection.  compress() is called for each message as it is
+// queued, in the order the messages are sent, and decompress() for the frames of each compressed
+// message as they arrive.  The two directions share nothing so they can run on different threads.
+class websocket_deflate
+{
+public:
+    websocket_deflate(_In_ const websocket_deflate_params& params, _In_ HC_COMPRESSION_LEVEL level);
+
+    // Replaces payload with the compressed message
+    HC_RESULT compress(_Inout_ http_internal_vector<uint8_t>& payload);
+
+    // Appends what the frame decompresses to.  Returns HC_E_BUFFERTOOSMALL, having stopped part
+    // way, once the message would be larger than maxMessageSize.
+    HC_RESULT decompress(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _In_ bool fin,
+        _In_ size_t maxMessageSize,
+        _Inout_ http_internal_vector<uint8_t>& message
+        );
+
+    const websocket_deflate_params& params() const { return m_params; }
+
+private:
+    HC_RESULT inflate(
+        _In_reads_bytes_(size) const uint8_t* data,
+        _In_ size_t size,
+        _In_ size_t maxMessageSize,
+        _Inout_ http_internal_vector<uint8_t>& message
+        );
+
+    websocket_deflate_params m_params;
+    http_deflater m_deflater;
+    http_internal_vector<uint8_t> m_compressed;
+
+    http_inflater m_inflater;
+    http_arena_string m_window;  // the inflater's output, whose last 2^serverMaxWindowBits bytes later messages can refer back to
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,692 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "websocket_frame.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WEBSOCKET_SIMD_X86 1
+#if _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define WEBSOCKET_SIMD_NEON 1
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic anywhere.  GCC and Clang need the function marked with the
+// instruction set it uses, since the rest of the file is built for the baseline.
+#if defined(__GNUC__) || defined(__clang__)
+#define WEBSOCKET_TARGET_SSE2 __attribute__((target("sse2")))
+#define WEBSOCKET_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WEBSOCKET_TARGET_SSE2
+#define WEBSOCKET_TARGET_AVX2
+#endif
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// RFC 6455 1.3
+static const char WEBSOCKET_ACCEPT_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+websocket_parse_result websocket_parse_frame_header(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Out_ websocket_frame_header* header
+    )
+{
+    *header = websocket_frame_header();
+    if (size < 2)
+    {
+        return websocket_parse_result::incomplete;
+    }
+
+    header->fin = (data[0] & 0x80) != 0;
+    header->rsv = static_cast<uint8_t>((data[0] >> 4) & 0x7);
+    header->opcode = static_cast<websocket_opcode>(data[0] & 0x0F);
+    header->masked = (data[1] & 0x80) != 0;
+
+    switch (header->opcode)
+    {
+        case websocket_opcode::continuation:
+        case websocket_opcode::text:
+        case websocket_opcode::binary:
+        case websocket_opcode::close:
+        case websocket_opcode::ping:
+        case websocket_opcode::pong:
+            break;
+
+        default:
+            return websocket_parse_result::invalid;
+    }
+
+    size_t headerSize = 2;
+    uint64_t length = data[1] & 0x7F;
+    if (length == 126)
+    {
+        headerSize += 2;
+    }
+    else if (length == 127)
+    {
+        headerSize += 8;
+    }
+    if (header->masked)
+    {
+        headerSize += 4;
+    }
+    if (size < headerSize)
+    {
+        return websocket_parse_result::incomplete;
+    }
+
+    size_t offset = 2;
+    if (length == 126)
+    {
+        length = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+        offset += 2;
+    }
+    else if (length == 127)
+    {
+        length = 0;
+        for (size_t i = 0; i < 8; i++)
+        {
+            length = (length << 8) | data[2 + i];
+        }
+        offset += 8;
+
+        // The most significant bit must be 0
+        if ((length >> 63) != 0)
+        {
+            return websocket_parse_result::invalid;
+        }
+    }
+
+    if (websocket_is_control(header->opcode) && (!header->fin || length > WEBSOCKET_MAX_CONTROL_PAYLOAD_SIZE))
+    {
+        return websocket_parse_result::invalid;
+    }
+
+    if (header->masked)
+    {
+        memcpy(header->maskKey, data + offset, 4);
+    }
+    header->payloadLength = length;
+    header->headerSize = headerSize;
+    return websocket_parse_result::complete;
+}
+
+size_t websocket_write_frame_header(
+    _In_ websocket_opcode opcode,
+    _In_ bool fin,
+    _In_ uint8_t rsv,
+    _In_ size_t size,
+    _In_reads_opt_(4) const uint8_t* maskKey,
+    _Out_writes_to_(WEBSOCKET_MAX_FRAME_HEADER_SIZE, return) uint8_t* header
+    )
+{
+    size_t headerSize = 0;
+    header[headerSize++] = static_cast<uint8_t>((fin ? 0x80 : 0) | ((rsv & 0x7) << 4) | static_cast<uint8_t>(opcode));
+
+    uint8_t maskBit = maskKey != nullptr ? 0x80 : 0;
+    if (size < 126)
+    {
+        header[headerSize++] = static_cast<uint8_t>(maskBit | size);
+    }
+    else if (size <= 0xFFFF)
+    {
+        header[headerSize++] = static_cast<uint8_t>(maskBit | 126);
+        header[headerSize++] = static_cast<uint8_t>(size >> 8);
+        header[headerSize++] = static_cast<uint8_t>(size);
+    }
+    else
+    {
+        header[headerSize++] = static_cast<uint8_t>(maskBit | 127);
+        uint64_t length = size;
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            header[headerSize++] = static_cast<uint8_t>(length >> shift);
+        }
+    }
+
+    if (maskKey != nullptr)
+    {
+        memcpy(header + headerSize, maskKey, 4);
+        headerSize += 4;
+    }
+    return headerSize;
+}
+
+void websocket_write_frame(
+    _In_ websocket_opcode opcode,
+    _In_ bool fin,
+    _In_ uint8_t rsv,
+    _In_reads_bytes_opt_(size) const uint8_t* payload,
+    _In_ size_t size,
+    _In_reads_opt_(4) const uint8_t* maskKey,
+    _Inout_ http_internal_vector<uint8_t>& out
+    )
+{
+    uint8_t header[WEBSOCKET_MAX_FRAME_HEADER_SIZE];
+    size_t headerSize = websocket_write_frame_header(opcode, fin, rsv, size, maskKey, header);
+    out.insert(out.end(), header, header + headerSize);
+
+    if (size > 0)
+    {
+        size_t payloadOffset = out.size();
+        out.insert(out.end(), payload, payload + size);
+        if (maskKey != nullptr)
+        {
+            websocket_mask(out.data() + payloadOffset, size, maskKey, 0);
+        }
+    }
+}
+
+// Scalar code masks 8 bytes at a time and skips ASCII 8 bytes at a time.  The vector kernels do
+// 16 (SSE2, NEON) or 32 (AVX2) and finish the tail with the scalar ones.
+typedef void (*mask_kernel)(_Inout_updates_bytes_(size) uint8_t* data, _In_ size_t size, _In_reads_(4) const uint8_t* key);
+typedef size_t (*ascii_prefix_kernel)(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+
+static void mask_scalar(_Inout_updates_bytes_(size) uint8_t* data, _In_ size_t size, _In_reads_(4) const uint8_t* key)
+{
+    uint8_t key8[8] = { key[0], key[1], key[2], key[3], key[0], key[1], key[2], key[3] };
+    uint64_t key64;
+    memcpy(&key64, key8, sizeof(key64));
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        word ^= key64;
+        memcpy(data + i, &word, sizeof(word));
+    }
+    for (; i < size; i++)
+    {
+        data[i] ^= key[i & 3];
+    }
+}
+
+// The number of bytes before the first one with its high bit set
+static size_t ascii_prefix_scalar(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0)
+        {
+            break;
+        }
+    }
+    while (i < size && data[i] < 0x80)
+    {
+        i++;
+    }
+    return i;
+}
+
+#if WEBSOCKET_SIMD_X86
+static uint32_t count_trailing_zeros(_In_ uint32_t value)
+{
+#if _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+static bool cpu_has_sse2()
+{
+#if _MSC_VER
+#if defined(_M_X64)
+    return true;
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#endif
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2") != 0;
+#endif
+}
+
+static bool cpu_has_avx2()
+{
+#if _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // The OS has to save the YMM registers too
+    __cpuid(info, 1);
+    const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+WEBSOCKET_TARGET_SSE2 static void mask_sse2(_Inout_updates_bytes_(size) uint8_t* data, _In_ size_t size, _In_reads_(4) const uint8_t* key)
+{
+    int32_t key32;
+    memcpy(&key32, key, sizeof(key32));
+    const __m128i keyVector = _mm_set1_epi32(key32);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i* block = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), keyVector));
+    }
+    mask_scalar(data + i, size - i, key);
+}
+
+WEBSOCKET_TARGET_SSE2 static size_t ascii_prefix_sse2(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        uint32_t highBits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+        if (highBits != 0)
+        {
+            return i + count_trailing_zeros(highBits);
+        }
+    }
+    return i + ascii_prefix_scalar(data + i, size - i);
+}
+
+WEBSOCKET_TARGET_AVX2 static void mask_avx2(_Inout_updates_bytes_(size) uint8_t* data, _In_ size_t size, _In_reads_(4) const uint8_t* key)
+{
+    int32_t key32;
+    memcpy(&key32, key, sizeof(key32));
+    const __m256i keyVector = _mm256_set1_epi32(key32);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i* block = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(block, _mm256_xor_si256(_mm256_loadu_si256(block), keyVector));
+    }
+    mask_scalar(data + i, size - i, key);
+}
+
+WEBSOCKET_TARGET_AVX2 static size_t ascii_prefix_avx2(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        uint32_t highBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i))));
+        if (highBits != 0)
+        {
+            return i + count_trailing_zeros(highBits);
+        }
+    }
+    return i + ascii_prefix_scalar(data + i, size - i);
+}
+#endif
+
+#if WEBSOCKET_SIMD_NEON
+static void mask_neon(_Inout_updates_bytes_(size) uint8_t* data, _In_ size_t size, _In_reads_(4) const uint8_t* key)
+{
+    uint32_t key32;
+    memcpy(&key32, key, sizeof(key32));
+    const uint8x16_t keyVector = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), keyVector));
+    }
+    mask_scalar(data + i, size - i, key);
+}
+
+static size_t ascii_prefix_neon(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    const uint8x16_t highBit = vdupq_n_u8(0x80);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        uint64x2_t highBits = vreinterpretq_u64_u8(vandq_u8(vld1q_u8(data + i), highBit));
+        if ((vgetq_lane_u64(highBits, 0) | vgetq_lane_u64(highBits, 1)) != 0)
+        {
+            break;
+        }
+    }
+    return i + ascii_prefix_scalar(data + i, size - i);
+}
+#endif
+
+struct simd_kernels
+{
+    mask_kernel mask;
+    ascii_prefix_kernel asciiPrefix;
+};
+
+static bool is_simd_level_supported(_In_ websocket_simd_level level)
+{
+    switch (level)
+    {
+        case websocket_simd_level::scalar:
+            return true;
+#if WEBSOCKET_SIMD_X86
+        case websocket_simd_level::sse2:
+            return cpu_has_sse2();
+        case websocket_simd_level::avx2:
+            return cpu_has_avx2();
+#endif
+#if WEBSOCKET_SIMD_NEON
+        case websocket_simd_level::neon:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+static std::atomic<int> s_simdLevel(-1);
+
+websocket_simd_level websocket_get_simd_level()
+{
+    int level = s_simdLevel.load();
+    if (level < 0)
+    {
+        const websocket_simd_level preferred[] =
+        {
+            websocket_simd_level::avx2,
+            websocket_simd_level::sse2,
+            websocket_simd_level::neon,
+            websocket_simd_level::scalar
+        };
+        for (websocket_simd_level candidate : preferred)
+        {
+            if (is_simd_level_supported(candidate))
+            {
+                level = static_cast<int>(candidate);
+                break;
+            }
+        }
+        s_simdLevel = level;
+    }
+    return static_cast<websocket_simd_level>(level);
+}
+
+bool websocket_set_simd_level(_In_ websocket_simd_level level)
+{
+    if (!is_simd_level_supported(level))
+    {
+        return false;
+    }
+    s_simdLevel = static_cast<int>(level);
+    return true;
+}
+
+static simd_kernels get_simd_kernels()
+{
+    switch (websocket_get_simd_level())
+    {
+#if WEBSOCKET_SIMD_X86
+        case websocket_simd_level::sse2:
+            return { mask_sse2, ascii_prefix_sse2 };
+        case websocket_simd_level::avx2:
+            return { mask_avx2, ascii_prefix_avx2 };
+#endif
+#if WEBSOCKET_SIMD_NEON
+        case websocket_simd_level::neon:
+            return { mask_neon, ascii_prefix_neon };
+#endif
+        default:
+            return { mask_scalar, ascii_prefix_scalar };
+    }
+}
+
+void websocket_mask(
+    _Inout_updates_bytes_(size) uint8_t* data,
+    _In_ size_t size,
+    _In_reads_(4) const uint8_t* maskKey,
+    _In_ size_t keyOffset
+    )
+{
+    // Rotate the key so the kernels can start at key byte 0
+    const uint8_t key[4] =
+    {
+        maskKey[keyOffset & 3],
+        maskKey[(keyOffset + 1) & 3],
+        maskKey[(keyOffset + 2) & 3],
+        maskKey[(keyOffset + 3) & 3]
+    };
+    get_simd_kernels().mask(data, size, key);
+}
+
+websocket_utf8_validator::websocket_utf8_validator()
+{
+    reset();
+}
+
+bool websocket_utf8_validator::write(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    ascii_prefix_kernel asciiPrefix = get_simd_kernels().asciiPrefix;
+
+    size_t i = 0;
+    while (i < size)
+    {
+        if (m_remaining > 0)
+        {
+            uint8_t next = data[i++];
+            if (next < m_nextMin || next > m_nextMax)
+            {
+                return false;
+            }
+            m_nextMin = 0x80;
+            m_nextMax = 0xBF;
+            m_remaining--;
+            continue;
+        }
+
+        // Most text is mostly ASCII, which the kernels skip a vector at a time
+        i += asciiPrefix(data + i, size - i);
+        if (i == size)
+        {
+            break;
+        }
+
+        // The range of the second byte rules out overlong forms, surrogates and code points past U+10FFFF
+        uint8_t lead = data[i++];
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            m_remaining = 1;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            m_remaining = 2;
+            if (lead == 0xE0)
+            {
+                m_nextMin = 0xA0;
+            }
+            else if (lead == 0xED)
+            {
+                m_nextMax = 0x9F;
+            }
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            m_remaining = 3;
+            if (lead == 0xF0)
+            {
+                m_nextMin = 0x90;
+            }
+            else if (lead == 0xF4)
+            {
+                m_nextMax = 0x8F;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool websocket_utf8_validator::is_complete() const
+{
+    return m_remaining == 0;
+}
+
+void websocket_utf8_validator::reset()
+{
+    m_remaining = 0;
+    m_nextMin = 0x80;
+    m_nextMax = 0xBF;
+}
+
+bool websocket_is_valid_utf8(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    websocket_utf8_validator validator;
+    return validator.write(data, size) && validator.is_complete();
+}
+
+http_internal_string websocket_base64_encode(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    http_internal_string encoded;
+    encoded.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3)
+    {
+        uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < size)
+        {
+            group |= static_cast<uint32_t>(data[i + 1]) << 8;
+        }
+        if (i + 2 < size)
+        {
+            group |= data[i + 2];
+        }
+
+        encoded.push_back(alphabet[(group >> 18) & 0x3F]);
+        encoded.push_back(alphabet[(group >> 12) & 0x3F]);
+        encoded.push_back(i + 1 < size ? alphabet[(group >> 6) & 0x3F] : '=');
+        encoded.push_back(i + 2 < size ? alphabet[group & 0x3F] : '=');
+    }
+    return encoded;
+}
+
+static uint32_t rotate_left(_In_ uint32_t value, _In_ uint32_t bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 (RFC 3174), which the handshake uses only to prove the server understood the request
+static void sha1(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size, _Out_writes_(20) uint8_t* digest)
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    http_internal_vector<uint8_t> message(data, data + size);
+    message.push_back(0x80);
+    while (message.size() % 64 != 56)
+    {
+        message.push_back(0);
+    }
+    uint64_t bitLength = static_cast<uint64_t>(size) * 8;
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+        message.push_back(static_cast<uint8_t>(bitLength >> shift));
+    }
+
+    for (size_t block = 0; block < message.size(); block += 64)
+    {
+        uint32_t w[80];
+        for (size_t i = 0; i < 16; i++)
+        {
+            const uint8_t* word = message.data() + block + i * 4;
+            w[i] = (static_cast<uint32_t>(word[0]) << 24) | (static_cast<uint32_t>(word[1]) << 16) |
+                (static_cast<uint32_t>(word[2]) << 8) | word[3];
+        }
+        for (size_t i = 16; i < 80; i++)
+        {
+            w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0];
+        uint32_t b = h[1];
+        uint32_t c = h[2];
+        uint32_t d = h[3];
+        uint32_t e = h[4];
+        for (size_t i = 0; i < 80; i++)
+        {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate_left(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (size_t i = 0; i < 5; i++)
+    {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+http_internal_string websocket_accept_key(_In_ const http_internal_string& key)
+{
+    http_internal_string value = key + WEBSOCKET_ACCEPT_GUID;
+    uint8_t digest[20];
+    sha1(reinterpret_cast<const uint8_t*>(value.data()), value.size(), digest);
+    return websocket_base64_encode(digest, sizeof(digest));
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -0,0 +1,140 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// WebSocket framing (RFC 6455 section 5).
+//
+// Every frame starts with a 2 to 14 byte header giving its opcode, whether it ends the message,
+// and the payload length.  Frames from a client are masked with a 4 byte key that the server
+// XORs back out; frames from a server never are.  Control frames (close, ping and pong) carry at
+// most 125 bytes and can arrive between the fragments of a data message.
+
+enum class websocket_opcode : uint8_t
+{
+    continuation = 0x0,
+    text = 0x1,
+    binary = 0x2,
+    close = 0x8,
+    ping = 0x9,
+    pong = 0xA
+};
+
+const size_t WEBSOCKET_MAX_FRAME_HEADER_SIZE = 14;
+const size_t WEBSOCKET_MAX_CONTROL_PAYLOAD_SIZE = 125;
+
+// The first reserved bit, which marks the first frame of a compressed message (RFC 7692 6)
+const uint8_t WEBSOCKET_RSV1 = 0x4;
+
+struct websocket_frame_header
+{
+    bool fin;
+    uint8_t rsv;  // the three reserved bits, which are 0 unless an extension was negotiated
+    websocket_opcode opcode;
+    bool masked;
+    uint8_t maskKey[4];
+    uint64_t payloadLength;
+    size_t headerSize;
+};
+
+enum class websocket_parse_result
+{
+    complete,
+    incomplete,
+    invalid
+};
+
+inline bool websocket_is_control(_In_ websocket_opcode opcode)
+{
+    return (static_cast<uint8_t>(opcode) & 0x8) != 0;
+}
+
+// Parses the frame header at the start of data.  Doesn't wait for the payload.  Unknown opcodes
+// and control frames that are fragmented or too long are invalid.
+websocket_parse_result websocket_parse_frame_header(
+    _In_reads_bytes_(size) const uint8_t* data,
+    _In_ size_t size,
+    _Out_ websocket_frame_header* header
+    );
+
+// Writes just the header of a frame with a payload of size bytes and returns its length, for a
+// payload that is masked in place with websocket_mask() and sent from where it is.
+size_t websocket_write_frame_header(
+    _In_ websocket_opcode opcode,
+    _In_ bool fin,
+    _In_ uint8_t rsv,
+    _In_ size_t size,
+    _In_reads_opt_(4) const uint8_t* maskKey,
+    _Out_writes_to_(WEBSOCKET_MAX_FRAME_HEADER_SIZE, return) uint8_t* header
+    );
+
+// Appends a frame.  If maskKey is given the payload is masked with it, as every client frame
+// must be with a key the server can't predict (RFC 6455 5.3).
+void websocket_write_frame(
+    _In_ websocket_opcode opcode,
+    _In_ bool fin,
+    _In_ uint8_t rsv,
+    _In_reads_bytes_opt_(size) const uint8_t* payload,
+    _In_ size_t size,
+    _In_reads_opt_(4) const uint8_t* maskKey,
+    _Inout_ http_internal_vector<uint8_t>& out
+    );
+
+// The vector instructions the masking and UTF-8 kernels use.  The best level the CPU supports is
+// picked the first time either runs.
+enum class websocket_simd_level
+{
+    scalar,
+    sse2,
+    avx2,
+    neon
+};
+
+websocket_simd_level websocket_get_simd_level();
+
+// Forces a level, for tests and benchmarks.  Returns false, changing nothing, if the CPU doesn't
+// support it.
+bool websocket_set_simd_level(_In_ websocket_simd_level level);
+
+// XORs data with the masking key, starting keyOffset bytes into the payload.  Masking and
+// unmasking are the same operation.
+void websocket_mask(
+    _Inout_updates_bytes_(size) uint8_t* data,
+    _In_ size_t size,
+    _In_reads_(4) const uint8_t* maskKey,
+    _In_ size_t keyOffset
+    );
+
+// Validates UTF-8 (RFC 3629) written in pieces, so a text message can be checked frame by frame
+// as it arrives and failed at the first bad byte.  Overlong forms and surrogates are invalid.
+class websocket_utf8_validator
+{
+public:
+    websocket_utf8_validator();
+
+    // Returns false once the text written so far can't be the start of valid UTF-8
+    bool write(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+
+    // Whether the text written so far ends on a whole code point
+    bool is_complete() const;
+
+    void reset();
+
+private:
+    uint32_t m_remaining;  // continuation bytes still to come for the current code point
+    uint8_t m_nextMin;     // the range the next continuation byte must fall in
+    uint8_t m_nextMax;
+};
+
+// Text messages must be valid UTF-8
+bool websocket_is_valid_utf8(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+
+http_internal_string websocket_base64_encode(_In_reads_bytes_(size) const uint8_t* data, _In_ size_t size);
+
+// The Sec-WebSocket-Accept value a server answers the Sec-WebSocket-Key with (RFC 6455 4.2.2)
+http_internal_string websocket_accept_key(_In_ const http_internal_string& key);
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -35,6 +35,19 @@ HC_RESULT Internal_HCWebSocketSendMessage(
     return HC_OK;
 }
 
+HC_RESULT Internal_HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    return HC_OK;
+}
+
 HC_RESULT Internal_HCWebSocketDisconnect(
     _In_ HC_WEBSOCKET_HANDLE websocket,
     _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
@@ -3,6 +3,7 @@
 
 #include "pch.h"
 #include "../hcwebsocket.h"
+#include "../Native/websocket_connection.h"
 
 using namespace xbox::httpclient;
 
@@ -17,8 +18,8 @@ HC_RESULT Internal_HCWebSocketConnect(
     _In_opt_ HCWebSocketCompletionRoutine completionRoutine
     )
 {
-    // TODO
-    return HC_OK;
+    // Win32 has no WebSocket stack of its own, so this is always the native implementation
+    return websocket_connect(uri, subProtocol, websocket, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
 }
 
 HC_RESULT Internal_HCWebSocketSendMessage(
@@ -30,8 +31,20 @@ HC_RESULT Internal_HCWebSocketSendMessage(
     _In_opt_ HCWebSocketCompletionRoutine completionRoutine
     )
 {
-    // TODO
-    return HC_OK;
+    return websocket_send_message(websocket, message, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+}
+
+HC_RESULT Internal_HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    return websocket_send_binary_message(websocket, payloadBytes, payloadSize, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
 }
 
 HC_RESULT Internal_HCWebSocketDisconnect(
@@ -39,7 +52,6 @@ HC_RESULT Internal_HCWebSocketDisconnect(
     _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
     )
 {
-    // TODO
-    return HC_OK;
+    return websocket_disconnect(websocket, closeStatus);
 }
 
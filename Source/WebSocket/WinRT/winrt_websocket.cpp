@@ -16,6 +16,7 @@ class websocket_outgoing_message
 {
 public: 
     http_internal_string m_message;
+    bool m_binary;
     HC_TASK_HANDLE m_taskHandle;
     HC_SUBSYSTEM_ID m_taskSubsystemId;
     uint64_t m_taskGroupId;
@@ -79,17 +80,32 @@ void ReceiveContext::OnReceive(MessageWebSocket^ sender, MessageWebSocketMessage
         const auto len = reader->UnconsumedBufferLength;
         if (len > 0)
         {
-            std::string payload;
-            payload.resize(len);
-            reader->ReadBytes(Platform::ArrayReference<uint8_t>(reinterpret_cast<uint8 *>(&payload[0]), len));
-            HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: receieved msg [%s]", m_websocket->id, payload.c_str());
-
-            HC_WEBSOCKET_MESSAGE_FUNC messageFunc = nullptr;
-            HCWebSocketGetFunctions(&messageFunc, nullptr);
-            if (messageFunc != nullptr)
+            // Read into a buffer from the WebSocket's pool, which the app can retain
+            HC_WEBSOCKET_BUFFER* buffer = m_websocket->bufferPool->acquire();
+            try
             {
-                messageFunc(m_websocket, payload.c_str());
+                buffer->bytes.resize(len + 1);
+                reader->ReadBytes(Platform::ArrayReference<uint8_t>(reinterpret_cast<uint8 *>(buffer->bytes.data()), len));
+                buffer->bytes[len] = 0;
+
+                bool isBinary = args->MessageType == SocketMessageType::Binary;
+                if (isBinary)
+                {
+                    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: receieved binary msg [%u bytes]", m_websocket->id, len);
+                }
+                else
+                {
+                    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: receieved msg [%s]", m_websocket->id, reinterpret_cast<const char*>(buffer->bytes.data()));
+                }
+
+                Internal_HCWebSocketRaiseMessage(m_websocket, isBinary, buffer);
             }
+            catch (...)
+            {
+                websocket_buffer_pool::release(buffer);
+                throw;
+            }
+            websocket_buffer_pool::release(buffer);
         }
     }
     catch (Platform::Exception ^e)
@@ -104,12 +120,7 @@ void ReceiveContext::OnClosed(IWebSocket^ sender, WebSocketClosedEventArgs^ args
 {
     HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: on closed event triggered", m_websocket->id);
 
-    HC_WEBSOCKET_CLOSE_EVENT_FUNC closeFunc = nullptr;
-    HCWebSocketGetFunctions(nullptr, &closeFunc);
-    if (closeFunc != nullptr)
-    {
-        closeFunc(m_websocket, static_cast<HC_WEBSOCKET_CLOSE_STATUS>(args->Code));
-    }
+    Internal_HCWebSocketRaiseCloseEvent(m_websocket, static_cast<HC_WEBSOCKET_CLOSE_STATUS>(args->Code));
 }
 
 inline bool str_icmp(const char* left, const char* right)
@@ -285,6 +296,34 @@ HC_RESULT Internal_HCWebSocketConnect(
         nullptr);
 }
 
+HC_RESULT QueueWebSocketMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ std::shared_ptr<websocket_outgoing_message> msg
+    )
+{
+    std::shared_ptr<winrt_websocket_task> websocketTask = std::dynamic_pointer_cast<winrt_websocket_task>(websocket->task);
+
+    bool sendInProgress = false;
+    {
+        std::lock_guard<std::mutex> lock(websocketTask->m_outgoingMessageQueueLock);
+        if (websocketTask->m_outgoingMessageQueue.size() > 0)
+        {
+            sendInProgress = true;
+        }
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: send msg queue size: %d", websocketTask->m_websocketHandle->id, websocketTask->m_outgoingMessageQueue.size());
+
+        websocketTask->m_outgoingMessageQueue.push(msg);
+    }
+
+    // No sends in progress, so start sending the message
+    if (!sendInProgress)
+    {
+        MessageWebSocketSendMessage(websocketTask);
+    }
+    
+    return HC_OK;
+}
+
 HC_RESULT Internal_HCWebSocketSendMessage(
     _In_ HC_WEBSOCKET_HANDLE websocket,
     _In_z_ PCSTR message,
@@ -302,10 +341,10 @@ HC_RESULT Internal_HCWebSocketSendMessage(
     auto httpSingleton = get_http_singleton(false);
     if (nullptr == httpSingleton)
         return HC_E_NOTINITIALISED;
-    std::shared_ptr<winrt_websocket_task> websocketTask = std::dynamic_pointer_cast<winrt_websocket_task>(websocket->task);
 
     std::shared_ptr<websocket_outgoing_message> msg = std::make_shared<websocket_outgoing_message>();
     msg->m_message = message;
+    msg->m_binary = false;
     msg->m_taskSubsystemId = taskSubsystemId;
     msg->m_taskGroupId = taskGroupId;
     msg->m_completionRoutineContext = completionRoutineContext;
@@ -317,25 +356,38 @@ HC_RESULT Internal_HCWebSocketSendMessage(
         return HC_E_INVALIDARG;
     }
 
-    bool sendInProgress = false;
-    {
-        std::lock_guard<std::mutex> lock(websocketTask->m_outgoingMessageQueueLock);
-        if (websocketTask->m_outgoingMessageQueue.size() > 0)
-        {
-            sendInProgress = true;
-        }
-        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: send msg queue size: %d", websocketTask->m_websocketHandle->id, websocketTask->m_outgoingMessageQueue.size());
-
-        websocketTask->m_outgoingMessageQueue.push(msg);
-    }
+    return QueueWebSocketMessage(websocket, msg);
+}
 
-    // No sends in progress, so start sending the message
-    if (!sendInProgress)
+HC_RESULT Internal_HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    if (payloadBytes == nullptr && payloadSize > 0)
     {
-        MessageWebSocketSendMessage(websocketTask);
+        return HC_E_INVALIDARG;
     }
-    
-    return HC_OK;
+
+    auto httpSingleton = get_http_singleton(false);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    std::shared_ptr<websocket_outgoing_message> msg = std::make_shared<websocket_outgoing_message>();
+    msg->m_message.assign(reinterpret_cast<const char*>(payloadBytes), payloadSize);
+    msg->m_binary = true;
+    msg->m_taskSubsystemId = taskSubsystemId;
+    msg->m_taskGroupId = taskGroupId;
+    msg->m_completionRoutineContext = completionRoutineContext;
+    msg->m_completionRoutine = completionRoutine;
+    msg->m_id = ++httpSingleton->m_lastId;
+
+    return QueueWebSocketMessage(websocket, msg);
 }
 
 struct SendMessageCallbackContent
@@ -362,9 +414,17 @@ try
     HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Send message executing", websocket->id);
 
     auto msg = sendMsgContext->nextMessage;
-    HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Message [ID %llu] [%s]", websocket->id, msg->m_id, msg->m_message.c_str());
+    if (msg->m_binary)
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Message [ID %llu] [%u bytes]", websocket->id, msg->m_id, static_cast<uint32_t>(msg->m_message.length()));
+    }
+    else
+    {
+        HC_TRACE_INFORMATION(WEBSOCKET, "Websocket [ID %llu]: Message [ID %llu] [%s]", websocket->id, msg->m_id, msg->m_message.c_str());
+    }
 
-    websocketTask->m_messageWebSocket->Control->MessageType = SocketMessageType::Utf8;
+    // The message type can change between messages
+    websocketTask->m_messageWebSocket->Control->MessageType = msg->m_binary ? SocketMessageType::Binary : SocketMessageType::Utf8;
     unsigned char* uchar = reinterpret_cast<unsigned char*>(const_cast<char*>(msg->m_message.c_str()));
     websocketTask->m_messageDataWriter->WriteBytes(Platform::ArrayReference<unsigned char>(uchar, static_cast<unsigned int>(msg->m_message.length())));
 
@@ -3,6 +3,9 @@
 
 #include "pch.h"
 #include "hcwebsocket.h"
+#include "uri.h"
+#include "Native/websocket_connection.h"
+#include "Native/websocket_deflate.h"
 
 using namespace xbox::httpclient;
 
@@ -68,6 +71,118 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetCompression(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_COMPRESSION_LEVEL level,
+    _In_ uint32_t maxWindowBits,
+    _In_ bool contextTakeover
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || level < HC_COMPRESSION_LEVEL_NONE || level > HC_COMPRESSION_LEVEL_HIGH ||
+        maxWindowBits < WEBSOCKET_DEFLATE_MIN_WINDOW_BITS || maxWindowBits > WEBSOCKET_DEFLATE_MAX_WINDOW_BITS)
+    {
+        return HC_E_INVALIDARG;
+    }
+    RETURN_IF_WEBSOCKET_CONNECT_CALLED(websocket);
+
+    websocket->compressionLevel = level;
+    websocket->compressionWindowBits = maxWindowBits;
+    websocket->compressionContextTakeover = contextTakeover;
+
+    HC_TRACE_INFORMATION(WEBSOCKET, "HCWebSocketSetCompression [ID %llu]: level %d, window bits %u, context takeover %d",
+        websocket->id, level, maxWindowBits, contextTakeover);
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetCompressionMemoryLimit(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t memoryLimitInBytes
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+    RETURN_IF_WEBSOCKET_CONNECT_CALLED(websocket);
+
+    websocket->compressionMemoryLimit = memoryLimitInBytes;
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetCompressionStats(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ bool* negotiated,
+    _Out_ uint64_t* uncompressedBytesSent,
+    _Out_ uint64_t* compressedBytesSent,
+    _Out_ uint64_t* uncompressedBytesReceived,
+    _Out_ uint64_t* compressedBytesReceived
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || negotiated == nullptr || uncompressedBytesSent == nullptr || compressedBytesSent == nullptr ||
+        uncompressedBytesReceived == nullptr || compressedBytesReceived == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    *negotiated = websocket->compressionNegotiated;
+    *uncompressedBytesSent = websocket->uncompressedBytesSent;
+    *compressedBytesSent = websocket->compressedBytesSent;
+    *uncompressedBytesReceived = websocket->uncompressedBytesReceived;
+    *compressedBytesReceived = websocket->compressedBytesReceived;
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetKeepAlive(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t pingIntervalInSeconds,
+    _In_ uint32_t pongTimeoutInSeconds
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+    RETURN_IF_WEBSOCKET_CONNECT_CALLED(websocket);
+
+    websocket->pingIntervalInSeconds = pingIntervalInSeconds;
+    websocket->pongTimeoutInSeconds = pongTimeoutInSeconds;
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetRoundTripTime(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ uint32_t* roundTripTimeInMilliseconds,
+    _Out_ uint32_t* smoothedRoundTripTimeInMilliseconds,
+    _Out_ uint32_t* minRoundTripTimeInMilliseconds
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || roundTripTimeInMilliseconds == nullptr || smoothedRoundTripTimeInMilliseconds == nullptr ||
+        minRoundTripTimeInMilliseconds == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    *roundTripTimeInMilliseconds = websocket->roundTripTime;
+    *smoothedRoundTripTimeInMilliseconds = websocket->smoothedRoundTripTime;
+    *minRoundTripTimeInMilliseconds = websocket->minRoundTripTime;
+    return HC_OK;
+}
+CATCH_RETURN()
+
 HC_API HC_RESULT HC_CALLING_CONV
 HCWebSocketSetFunctions(
     _In_opt_ HC_WEBSOCKET_MESSAGE_FUNC messageFunc,
@@ -86,6 +201,136 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetBinaryMessageFunction(
+    _In_opt_ HC_WEBSOCKET_BINARY_MESSAGE_FUNC binaryMessageFunc
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->m_websocketBinaryMessageFunc = binaryMessageFunc;
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetHandleFunctions(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_opt_ HC_WEBSOCKET_HANDLE_MESSAGE_FUNC messageFunc,
+    _In_opt_ HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC binaryMessageFunc,
+    _In_opt_ HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC closeFunc,
+    _In_opt_ void* context
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+    RETURN_IF_WEBSOCKET_CONNECT_CALLED(websocket);
+
+    websocket->messageFunc = messageFunc;
+    websocket->binaryMessageFunc = binaryMessageFunc;
+    websocket->closeFunc = closeFunc;
+    websocket->functionContext = context;
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSetReconnectPolicy(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ uint32_t maxAttempts,
+    _In_ uint32_t initialDelayInMilliseconds,
+    _In_ uint32_t maxDelayInMilliseconds,
+    _In_ bool replayUnsentMessages,
+    _In_opt_ HC_WEBSOCKET_RECONNECT_EVENT_FUNC reconnectFunc,
+    _In_opt_ void* context
+    ) HC_NOEXCEPT
+try
+{
+    // Without a delay every client that dropped at once would reconnect at once
+    if (websocket == nullptr ||
+        (maxAttempts > 0 && (initialDelayInMilliseconds == 0 || maxDelayInMilliseconds < initialDelayInMilliseconds)))
+    {
+        return HC_E_INVALIDARG;
+    }
+    RETURN_IF_WEBSOCKET_CONNECT_CALLED(websocket);
+
+    websocket->reconnectMaxAttempts = maxAttempts;
+    websocket->reconnectInitialDelayInMilliseconds = initialDelayInMilliseconds;
+    websocket->reconnectMaxDelayInMilliseconds = maxDelayInMilliseconds;
+    websocket->reconnectReplay = replayUnsentMessages;
+    websocket->reconnectFunc = reconnectFunc;
+    websocket->reconnectContext = context;
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketRetainMessageBuffer(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_ HC_WEBSOCKET_BUFFER_HANDLE* buffer
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || buffer == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    *buffer = nullptr;
+    if (websocket->deliveringBuffer == nullptr)
+    {
+        return HC_E_FAIL;
+    }
+
+    websocket_buffer_pool::retain(websocket->deliveringBuffer);
+    *buffer = websocket->deliveringBuffer;
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetMessageBufferBytes(
+    _In_ HC_WEBSOCKET_BUFFER_HANDLE buffer,
+    _Outptr_ const uint8_t** payloadBytes,
+    _Out_ uint32_t* payloadSize
+    ) HC_NOEXCEPT
+try
+{
+    if (buffer == nullptr || payloadBytes == nullptr || payloadSize == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    *payloadBytes = buffer->bytes.data();
+    *payloadSize = buffer->size();
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketReleaseMessageBuffer(
+    _In_ HC_WEBSOCKET_BUFFER_HANDLE buffer
+    ) HC_NOEXCEPT
+try
+{
+    if (buffer == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    websocket_buffer_pool::release(buffer);
+    return HC_OK;
+}
+CATCH_RETURN()
+
 HC_API HC_RESULT HC_CALLING_CONV
 HCWebSocketConnect(
     _In_z_ PCSTR uri,
@@ -162,6 +407,74 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || (payloadBytes == nullptr && payloadSize > 0))
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    auto sendFunc = httpSingleton->m_websocketSendBinaryMessageFunc;
+    if (sendFunc != nullptr)
+    {
+        try
+        {
+            sendFunc(websocket, payloadBytes, payloadSize, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+        }
+        catch (...)
+        {
+            HC_TRACE_ERROR(WEBSOCKET, "HCWebSocketSendBinaryMessage [ID %llu]: failed", websocket->id);
+        }
+    }
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketBroadcast(
+    _In_reads_(websocketCount) const HC_WEBSOCKET_HANDLE* websockets,
+    _In_ uint32_t websocketCount,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _Out_opt_ uint32_t* queuedCount
+    ) HC_NOEXCEPT
+try
+{
+    if ((websockets == nullptr && websocketCount > 0) || (payloadBytes == nullptr && payloadSize > 0))
+    {
+        return HC_E_INVALIDARG;
+    }
+    for (uint32_t i = 0; i < websocketCount; ++i)
+    {
+        if (websockets[i] == nullptr)
+        {
+            return HC_E_INVALIDARG;
+        }
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    return websocket_broadcast(websockets, websocketCount, payloadBytes, payloadSize, queuedCount);
+}
+CATCH_RETURN()
+
 HC_API HC_RESULT HC_CALLING_CONV
 HCWebSocketDisconnect(
     _In_ HC_WEBSOCKET_HANDLE websocket
@@ -177,7 +490,6 @@ try
     if (nullptr == httpSingleton)
         return HC_E_NOTINITIALISED;
 
-    auto closeEventFunc = httpSingleton->m_websocketCloseEventFunc;
     auto closeFunc = httpSingleton->m_websocketDisconnectFunc;
     if (closeFunc != nullptr)
     {
@@ -185,11 +497,7 @@ try
         {
             HC_WEBSOCKET_CLOSE_STATUS closeStatus = HC_WEBSOCKET_CLOSE_STATUS::HC_WEBSOCKET_CLOSE_NORMAL;
             closeFunc(websocket, closeStatus);
-
-            if(closeEventFunc != nullptr)
-            {
-                closeEventFunc(websocket, closeStatus);
-            }
+            Internal_HCWebSocketRaiseCloseEvent(websocket, closeStatus);
         }
         catch (...)
         {
@@ -288,6 +596,144 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalSetWebSocketSendBinaryMessageFunction(
+    _In_opt_ HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC websocketSendBinaryMessageFunc
+    ) HC_NOEXCEPT
+try
+{
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    httpSingleton->m_websocketSendBinaryMessageFunc = (websocketSendBinaryMessageFunc) ? websocketSendBinaryMessageFunc : Internal_HCWebSocketSendBinaryMessage;
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCGlobalGetWebSocketSendBinaryMessageFunction(
+    _Out_ HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC* websocketSendBinaryMessageFunc
+    ) HC_NOEXCEPT
+try
+{
+    if (websocketSendBinaryMessageFunc == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    *websocketSendBinaryMessageFunc = httpSingleton->m_websocketSendBinaryMessageFunc;
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeConnect(
+    _In_z_ PCSTR uri,
+    _In_z_ PCSTR subProtocol,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (uri == nullptr || websocket == nullptr || subProtocol == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    // Only cleartext WebSockets are native.  wss:// needs TLS, so it goes to the platform, which
+    // on Win32 is this same engine and fails the connect.
+    Uri parsedUri(uri);
+    if (!parsedUri.IsValid() || parsedUri.Scheme() != "ws")
+    {
+        return Internal_HCWebSocketConnect(uri, subProtocol, websocket, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+    }
+
+    return websocket_connect(uri, subProtocol, websocket, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeSendMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR message,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (message == nullptr || websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task)) == nullptr)
+    {
+        return Internal_HCWebSocketSendMessage(websocket, message, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+    }
+
+    return websocket_send_message(websocket, message, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr || (payloadBytes == nullptr && payloadSize > 0))
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task)) == nullptr)
+    {
+        return Internal_HCWebSocketSendBinaryMessage(websocket, payloadBytes, payloadSize, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+    }
+
+    return websocket_send_binary_message(websocket, payloadBytes, payloadSize, taskSubsystemId, taskGroupId, completionRoutineContext, completionRoutine);
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketNativeDisconnect(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (std::dynamic_pointer_cast<websocket_connection>(std::atomic_load(&websocket->task)) == nullptr)
+    {
+        return Internal_HCWebSocketDisconnect(websocket, closeStatus);
+    }
+
+    return websocket_disconnect(websocket, closeStatus);
+}
+CATCH_RETURN()
+
 HC_API HC_RESULT HC_CALLING_CONV
 HCWebSocketGetProxyUri(
     _In_ HC_WEBSOCKET_HANDLE websocket,
@@ -406,3 +852,151 @@ try
 }
 CATCH_RETURN()
 
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetBinaryMessageFunction(
+    _Out_ HC_WEBSOCKET_BINARY_MESSAGE_FUNC* binaryMessageFunc
+    ) HC_NOEXCEPT
+try
+{
+    if (binaryMessageFunc == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    auto httpSingleton = get_http_singleton(true);
+    if (nullptr == httpSingleton)
+        return HC_E_NOTINITIALISED;
+
+    *binaryMessageFunc = httpSingleton->m_websocketBinaryMessageFunc;
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+HC_API HC_RESULT HC_CALLING_CONV
+HCWebSocketGetHandleFunctions(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_MESSAGE_FUNC* messageFunc,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC* binaryMessageFunc,
+    _Out_opt_ HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC* closeFunc,
+    _Out_opt_ void** context
+    ) HC_NOEXCEPT
+try
+{
+    if (websocket == nullptr)
+    {
+        return HC_E_INVALIDARG;
+    }
+
+    if (messageFunc != nullptr)
+    {
+        *messageFunc = websocket->messageFunc;
+    }
+    if (binaryMessageFunc != nullptr)
+    {
+        *binaryMessageFunc = websocket->binaryMessageFunc;
+    }
+    if (closeFunc != nullptr)
+    {
+        *closeFunc = websocket->closeFunc;
+    }
+    if (context != nullptr)
+    {
+        *context = websocket->functionContext;
+    }
+
+    return HC_OK;
+}
+CATCH_RETURN()
+
+static void raise_message(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ bool isBinary,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    )
+{
+    // The WebSocket's own functions are called directly, without looking up the singleton
+    if (websocket->messageFunc != nullptr || websocket->binaryMessageFunc != nullptr)
+    {
+        if (isBinary && websocket->binaryMessageFunc != nullptr)
+        {
+            websocket->binaryMessageFunc(websocket->functionContext, websocket, payloadBytes, payloadSize);
+        }
+        else if (websocket->messageFunc != nullptr)
+        {
+            websocket->messageFunc(websocket->functionContext, websocket, reinterpret_cast<PCSTR>(payloadBytes), payloadSize);
+        }
+        return;
+    }
+
+    auto httpSingleton = get_http_singleton(false);
+    if (httpSingleton == nullptr)
+    {
+        return;
+    }
+
+    HC_WEBSOCKET_BINARY_MESSAGE_FUNC binaryMessageFunc = httpSingleton->m_websocketBinaryMessageFunc;
+    HC_WEBSOCKET_MESSAGE_FUNC messageFunc = httpSingleton->m_websocketMessageFunc;
+    if (isBinary && binaryMessageFunc != nullptr)
+    {
+        binaryMessageFunc(websocket, payloadBytes, payloadSize);
+    }
+    else if (messageFunc != nullptr)
+    {
+        messageFunc(websocket, reinterpret_cast<PCSTR>(payloadBytes));
+    }
+}
+
+void Internal_HCWebSocketRaiseMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ bool isBinary,
+    _In_ HC_WEBSOCKET_BUFFER* buffer
+    )
+{
+    // Messages are only delivered on one thread per WebSocket, so this needs no lock
+    websocket->deliveringBuffer = buffer;
+    try
+    {
+        raise_message(websocket, isBinary, buffer->bytes.data(), buffer->size());
+    }
+    catch (...)
+    {
+        websocket->deliveringBuffer = nullptr;
+        throw;
+    }
+    websocket->deliveringBuffer = nullptr;
+}
+
+void Internal_HCWebSocketRaiseCloseEvent(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    )
+{
+    if (websocket->closeFunc != nullptr)
+    {
+        websocket->closeFunc(websocket->functionContext, websocket, closeStatus);
+        return;
+    }
+
+    auto httpSingleton = get_http_singleton(false);
+    HC_WEBSOCKET_CLOSE_EVENT_FUNC closeFunc = httpSingleton != nullptr ? httpSingleton->m_websocketCloseEventFunc : nullptr;
+    if (closeFunc != nullptr)
+    {
+        closeFunc(websocket, closeStatus);
+    }
+}
+
+void Internal_HCWebSocketRaiseReconnectEvent(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_RECONNECT_EVENT reconnectEvent,
+    _In_ uint32_t attempt,
+    _In_ uint32_t delayInMilliseconds
+    )
+{
+    if (websocket->reconnectFunc != nullptr)
+    {
+        websocket->reconnectFunc(websocket->reconnectContext, websocket, reconnectEvent, attempt, delayInMilliseconds);
+    }
+}
+
@@ -3,13 +3,40 @@
 
 #pragma once
 #include "pch.h"
+#include "websocket_buffer.h"
 
 struct HC_WEBSOCKET
 {
     HC_WEBSOCKET() :
         id(0),
         refCount(1),
-        connectCalled(false)
+        connectCalled(false),
+        compressionLevel(HC_COMPRESSION_LEVEL_NONE),
+        compressionWindowBits(15),
+        compressionContextTakeover(true),
+        compressionMemoryLimit(0),
+        compressionNegotiated(false),
+        uncompressedBytesSent(0),
+        compressedBytesSent(0),
+        uncompressedBytesReceived(0),
+        compressedBytesReceived(0),
+        pingIntervalInSeconds(0),
+        pongTimeoutInSeconds(0),
+        roundTripTime(0),
+        smoothedRoundTripTime(0),
+        minRoundTripTime(0),
+        reconnectMaxAttempts(0),
+        reconnectInitialDelayInMilliseconds(0),
+        reconnectMaxDelayInMilliseconds(0),
+        reconnectReplay(false),
+        reconnectFunc(nullptr),
+        reconnectContext(nullptr),
+        messageFunc(nullptr),
+        binaryMessageFunc(nullptr),
+        closeFunc(nullptr),
+        functionContext(nullptr),
+        bufferPool(http_allocate_shared<xbox::httpclient::websocket_buffer_pool>()),
+        deliveringBuffer(nullptr)
     {
     }
 
@@ -21,6 +48,45 @@ struct HC_WEBSOCKET
     http_internal_string uri;
     http_internal_string subProtocol;
     std::shared_ptr<xbox::httpclient::hc_task> task;
+
+    // permessage-deflate (RFC 7692), which the native WebSocket engine offers when connecting
+    HC_COMPRESSION_LEVEL compressionLevel;
+    uint32_t compressionWindowBits;
+    bool compressionContextTakeover;
+    uint32_t compressionMemoryLimit;
+    std::atomic<bool> compressionNegotiated;
+    std::atomic<uint64_t> uncompressedBytesSent;
+    std::atomic<uint64_t> compressedBytesSent;
+    std::atomic<uint64_t> uncompressedBytesReceived;
+    std::atomic<uint64_t> compressedBytesReceived;
+
+    // Keepalive pings, which the native WebSocket engine sends.  The round trip times are in
+    // milliseconds and stay 0 until the first pong.
+    uint32_t pingIntervalInSeconds;
+    uint32_t pongTimeoutInSeconds;
+    std::atomic<uint32_t> roundTripTime;
+    std::atomic<uint32_t> smoothedRoundTripTime;
+    std::atomic<uint32_t> minRoundTripTime;
+
+    // Set with HCWebSocketSetReconnectPolicy().  The native WebSocket engine replaces task with a
+    // new connection when it reconnects, so task must be read with std::atomic_load.
+    uint32_t reconnectMaxAttempts;
+    uint32_t reconnectInitialDelayInMilliseconds;
+    uint32_t reconnectMaxDelayInMilliseconds;
+    bool reconnectReplay;
+    HC_WEBSOCKET_RECONNECT_EVENT_FUNC reconnectFunc;
+    void* reconnectContext;
+
+    // Set with HCWebSocketSetHandleFunctions() before connecting, so they can be read without a lock
+    HC_WEBSOCKET_HANDLE_MESSAGE_FUNC messageFunc;
+    HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC binaryMessageFunc;
+    HC_WEBSOCKET_HANDLE_CLOSE_EVENT_FUNC closeFunc;
+    void* functionContext;
+
+    // Received messages are read into buffers from this pool.  deliveringBuffer is the one being
+    // passed to a message function, which HCWebSocketRetainMessageBuffer() takes a reference on.
+    std::shared_ptr<xbox::httpclient::websocket_buffer_pool> bufferPool;
+    HC_WEBSOCKET_BUFFER* deliveringBuffer;
 };
 
 HC_RESULT Internal_HCWebSocketConnect(
@@ -42,7 +108,39 @@ HC_RESULT Internal_HCWebSocketSendMessage(
     _In_opt_ HCWebSocketCompletionRoutine completionRoutine
     );
 
+HC_RESULT Internal_HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    );
+
 HC_RESULT Internal_HCWebSocketDisconnect(
     _In_ HC_WEBSOCKET_HANDLE websocket,
     _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
     );
+
+// Passes a received message to the WebSocket's own functions, or else to the global ones.  The
+// functions can retain the buffer, so the caller must check its reference count before reusing it.
+void Internal_HCWebSocketRaiseMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ bool isBinary,
+    _In_ HC_WEBSOCKET_BUFFER* buffer
+    );
+
+// Passes a close event to the WebSocket's own close function, or else to the global one
+void Internal_HCWebSocketRaiseCloseEvent(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    );
+
+// Passes a reconnect event to the function set with HCWebSocketSetReconnectPolicy(), if any
+void Internal_HCWebSocketRaiseReconnectEvent(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_RECONNECT_EVENT reconnectEvent,
+    _In_ uint32_t attempt,
+    _In_ uint32_t delayInMilliseconds
+    );
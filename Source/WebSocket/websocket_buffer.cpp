@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "websocket_buffer.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+websocket_buffer_pool::websocket_buffer_pool()
+{
+    // Returning a buffer never allocates
+    m_free.reserve(WEBSOCKET_BUFFER_MAX_FREE);
+}
+
+websocket_buffer_pool::~websocket_buffer_pool()
+{
+    for (auto buffer : m_free)
+    {
+        delete buffer;
+    }
+}
+
+HC_WEBSOCKET_BUFFER* websocket_buffer_pool::acquire()
+{
+    HC_WEBSOCKET_BUFFER* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_free.empty())
+        {
+            buffer = m_free.back();
+            m_free.pop_back();
+        }
+    }
+
+    if (buffer == nullptr)
+    {
+        buffer = new HC_WEBSOCKET_BUFFER();
+    }
+    buffer->pool = shared_from_this();
+    return buffer;
+}
+
+void websocket_buffer_pool::retain(_In_ HC_WEBSOCKET_BUFFER* buffer)
+{
+    ++buffer->refCount;
+}
+
+void websocket_buffer_pool::release(_In_ HC_WEBSOCKET_BUFFER* buffer)
+{
+    if (--buffer->refCount > 0)
+    {
+        return;
+    }
+
+    // The buffer may hold the last reference on its pool, which must outlive the recycle
+    auto pool = std::move(buffer->pool);
+    if (pool != nullptr)
+    {
+        pool->recycle(buffer);
+    }
+    else
+    {
+        delete buffer;
+    }
+}
+
+void websocket_buffer_pool::recycle(_In_ HC_WEBSOCKET_BUFFER* buffer)
+{
+    if (buffer->bytes.capacity() <= WEBSOCKET_BUFFER_MAX_KEPT_CAPACITY)
+    {
+        buffer->bytes.clear();
+        buffer->refCount = 1;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_free.size() < WEBSOCKET_BUFFER_MAX_FREE)
+        {
+            m_free.push_back(buffer);
+            return;
+        }
+    }
+    delete buffer;
+}
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
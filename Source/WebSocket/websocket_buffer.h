@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#pragma once
+#include "pch.h"
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+class websocket_buffer_pool;
+NAMESPACE_XBOX_HTTP_CLIENT_END
+
+// A received message.  The bytes are followed by a NUL that isn't counted in size(), so a text
+// message can be passed to the app as a string.  The receive path holds a reference while it fills
+// the buffer and passes the message to the app, which can take its own with
+// HCWebSocketRetainMessageBuffer().  The last release puts the buffer back on the free list of the
+// connection it came from.
+struct HC_WEBSOCKET_BUFFER
+{
+    HC_WEBSOCKET_BUFFER() :
+        refCount(1)
+    {
+    }
+
+    uint32_t size() const { return static_cast<uint32_t>(bytes.size() - 1); }
+
+    std::atomic<int> refCount;
+    http_internal_vector<uint8_t> bytes;
+    std::shared_ptr<xbox::httpclient::websocket_buffer_pool> pool;  // null while the buffer is on the free list
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_BEGIN
+
+// Buffers that grew larger than this are freed rather than kept, so one big message doesn't hold
+// on to its memory for the life of the connection
+const size_t WEBSOCKET_BUFFER_MAX_KEPT_CAPACITY = 256 * 1024;
+
+// The free buffers a connection keeps, enough to cover messages the app retains for a short while
+const size_t WEBSOCKET_BUFFER_MAX_FREE = 8;
+
+// The free list of one connection's message buffers.  A connection that delivers a steady stream
+// of messages takes a buffer from it only when the app retained the last one, and otherwise reuses
+// its buffer, so receiving allocates nothing once the buffers have grown to the message size.
+class websocket_buffer_pool : public std::enable_shared_from_this<websocket_buffer_pool>
+{
+public:
+    websocket_buffer_pool();
+    ~websocket_buffer_pool();
+
+    // Returns an empty buffer holding one reference
+    HC_WEBSOCKET_BUFFER* acquire();
+
+    // Takes another reference on the buffer
+    static void retain(_In_ HC_WEBSOCKET_BUFFER* buffer);
+
+    // Drops a reference.  The last one returns the buffer to its pool, or frees it if the pool is
+    // full or already gone.
+    static void release(_In_ HC_WEBSOCKET_BUFFER* buffer);
+
+private:
+    void recycle(_In_ HC_WEBSOCKET_BUFFER* buffer);
+
+    std::mutex m_lock;
+    http_internal_vector<HC_WEBSOCKET_BUFFER*> m_free;
+};
+
+NAMESPACE_XBOX_HTTP_CLIENT_END
@@ -7,6 +7,11 @@
 #include "DefineTestMacros.h"
 #include "Utils.h"
 #include "../global/global.h"
+#include "../HTTP/compression.h"
+#include "../HTTP/dns_resolver.h"
+#include "../HTTP/http_socket.h"
+#include "../HTTP/Http2/hpack.h"
+#include <chrono>
 
 using namespace xbox::httpclient;
 
@@ -23,6 +28,24 @@ NAMESPACE_XBOX_HTTP_CLIENT_TEST_BEGIN
             VERIFY_ARE_EQUAL(hr, hrVerify); \
         }
 
+// "libHttpClient libHttpClient libHttpClient compressed response body" compressed with gzip and zlib
+static const BYTE s_gzipBody[] =
+{
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xcb, 0xc9, 0x4c, 0xf2, 0x28, 0x29,
+    0x29, 0x70, 0xce, 0xc9, 0x4c, 0xcd, 0x2b, 0x51, 0xc8, 0xc1, 0xc3, 0x4b, 0xce, 0xcf, 0x2d, 0x28,
+    0x4a, 0x2d, 0x2e, 0x4e, 0x4d, 0x51, 0x00, 0x52, 0x05, 0xf9, 0x79, 0xc5, 0xa9, 0x0a, 0x49, 0xf9,
+    0x29, 0x95, 0x00, 0x60, 0xfa, 0xe1, 0x30, 0x42, 0x00, 0x00, 0x00,
+};
+
+static const BYTE s_deflateBody[] =
+{
+    0x78, 0xda, 0xcb, 0xc9, 0x4c, 0xf2, 0x28, 0x29, 0x29, 0x70, 0xce, 0xc9, 0x4c, 0xcd, 0x2b, 0x51,
+    0xc8, 0xc1, 0xc3, 0x4b, 0xce, 0xcf, 0x2d, 0x28, 0x4a, 0x2d, 0x2e, 0x4e, 0x4d, 0x51, 0x00, 0x52,
+    0x05, 0xf9, 0x79, 0xc5, 0xa9, 0x0a, 0x49, 0xf9, 0x29, 0x95, 0x00, 0x56, 0x08, 0x19, 0x95,
+};
+
+static const CHAR* s_decompressedBody = "libHttpClient libHttpClient libHttpClient compressed response body";
+
 bool g_memAllocCalled = false;
 bool g_memFreeCalled = false;
 
@@ -54,6 +77,136 @@ static void HC_CALLING_CONV PerformCallback(
 }
 
 
+// Acts as a server that supports conditional requests for the response cache tests.  A request
+// with an Accept-Language header gets a body in that language and a response that varies on it.
+// A non-zero g_cacheServerStatus is sent instead of the response.  With g_cacheServerHold set the
+// task is left for the test to complete.
+static uint32_t g_cacheServerRequests = 0;
+static uint32_t g_cacheServerNotModified = 0;
+static uint32_t g_cacheServerStatus = 0;
+static const CHAR* g_cacheServerCacheControl = nullptr;
+static bool g_cacheServerHold = false;
+static HC_TASK_HANDLE g_cacheServerTask = 0;
+static void HC_CALLING_CONV CacheServerPerformCallback(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+{
+    g_cacheServerRequests++;
+
+    const CHAR* ifNoneMatch = nullptr;
+    const CHAR* language = nullptr;
+    HCHttpCallRequestGetHeader(call, "If-None-Match", &ifNoneMatch);
+    HCHttpCallRequestGetHeader(call, "Accept-Language", &language);
+    if (g_cacheServerStatus != 0)
+    {
+        HCHttpCallResponseSetStatusCode(call, g_cacheServerStatus);
+    }
+    else if (ifNoneMatch != nullptr && strcmp(ifNoneMatch, "\"v1\"") == 0)
+    {
+        g_cacheServerNotModified++;
+        HCHttpCallResponseSetStatusCode(call, 304);
+    }
+    else
+    {
+        HCHttpCallResponseSetStatusCode(call, 200);
+        HCHttpCallResponseSetHeader(call, "ETag", "\"v1\"");
+        if (language != nullptr)
+        {
+            HCHttpCallResponseSetHeader(call, "Vary", "Accept-Language");
+            HCHttpCallResponseSetResponseString(call, (std::string("catalog-") + language).c_str());
+        }
+        else
+        {
+            HCHttpCallResponseSetResponseString(call, "catalog");
+        }
+    }
+    HCHttpCallResponseSetHeader(call, "Cache-Control", g_cacheServerCacheControl);
+    g_cacheServerTask = taskHandle;
+    if (!g_cacheServerHold)
+    {
+        HCTaskSetCompleted(taskHandle);
+    }
+}
+
+
+// Responds to each request but leaves the task for the test to complete
+static uint32_t g_coalescingServerRequests = 0;
+static HC_TASK_HANDLE g_coalescingServerTask = 0;
+static void HC_CALLING_CONV CoalescingServerPerformCallback(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+{
+    g_coalescingServerRequests++;
+    g_coalescingServerTask = taskHandle;
+    HCHttpCallResponseSetStatusCode(call, 200);
+    HCHttpCallResponseSetResponseString(call, "leaderboard");
+}
+
+static std::vector<std::string> g_batchPerformUrls;
+static void HC_CALLING_CONV BatchPerformCallback(
+    _In_ HC_CALL_HANDLE call,
+    _In_ HC_TASK_HANDLE taskHandle
+    )
+{
+    UNREFERENCED_PARAMETER(taskHandle);
+    const CHAR* method = nullptr;
+    const CHAR* url = nullptr;
+    HCHttpCallRequestGetUrl(call, &method, &url);
+    g_batchPerformUrls.push_back(url);
+}
+
+// Fake resolver table so the DNS tests never touch the network
+static std::atomic<uint32_t> g_fakeDnsLookups(0);
+static HC_RESULT FakeDnsLookup(
+    _In_z_ PCSTR hostName,
+    _Inout_ http_internal_vector<http_internal_string>& addresses,
+    _Out_ uint32_t* ttlSeconds
+    )
+{
+    g_fakeDnsLookups++;
+    *ttlSeconds = 0;
+    if (strcmp(hostName, "game.example.com") == 0)
+    {
+        addresses.push_back("203.0.113.7");
+        addresses.push_back("2001:db8::7");
+        return HC_OK;
+    }
+    return HC_E_FAIL;
+}
+
+struct DnsResult
+{
+    std::atomic<bool> done;
+    HC_RESULT result;
+    uint32_t addressCount;
+    std::string firstAddress;
+};
+
+static void HC_CALLING_CONV DnsResolveCallback(
+    _In_opt_ void* context,
+    _In_ HC_RESULT result,
+    _In_ uint32_t addressCount,
+    _In_reads_(addressCount) PCSTR* addresses
+    )
+{
+    DnsResult* dnsResult = static_cast<DnsResult*>(context);
+    dnsResult->result = result;
+    dnsResult->addressCount = addressCount;
+    dnsResult->firstAddress = (addressCount > 0) ? addresses[0] : "";
+    dnsResult->done = true;
+}
+
+static void WaitForDnsResult(DnsResult& dnsResult)
+{
+    for (uint32_t i = 0; i < 500 && !dnsResult.done; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+
 DEFINE_TEST_CLASS(HttpTests)
 {
 public:
@@ -100,6 +253,35 @@ public:
         VERIFY_ARE_EQUAL(false, g_memFreeCalled);
     }
 
+    DEFINE_TEST_CASE(TestArena)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestArena);
+        g_memAllocCalled = false;
+        g_memFreeCalled = false;
+
+        VERIFY_ARE_EQUAL(HC_OK, HCMemSetFunctions(&MemAlloc, &MemFree));
+
+        {
+            http_arena arena(1024);
+            http_arena_vector<int> v(&arena);
+            v.reserve(16);
+
+            VERIFY_ARE_EQUAL(true, g_memAllocCalled);
+            g_memAllocCalled = false;
+
+            // Later allocations are carved out of the existing block
+            http_arena_string s("a string that does not fit in the small string buffer", &arena);
+            v.reserve(32);
+            VERIFY_ARE_EQUAL(false, g_memAllocCalled);
+            VERIFY_ARE_EQUAL(false, g_memFreeCalled);
+            VERIFY_IS_TRUE(arena.bytes_used() > 0);
+        }
+        VERIFY_ARE_EQUAL(false, g_memAllocCalled);
+        VERIFY_ARE_EQUAL(true, g_memFreeCalled);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCMemSetFunctions(nullptr, nullptr));
+    }
+
     DEFINE_TEST_CASE(TestGlobalInit)
     {
         DEFINE_TEST_CASE_PROPERTIES_FOCUS(TestGlobalInit);
@@ -193,6 +375,71 @@ public:
         HCGlobalCleanup();
     }
 
+    DEFINE_TEST_CASE(TestCallResetAndClone)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestCallResetAndClone);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&PerformCallback);
+        HC_CALL_HANDLE call = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "POST", "https://www.bing.com"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(call, "testHeader", "testValue"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetRequestBodyString(call, "body"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetTimeout(call, 100));
+
+        HC_TASK_HANDLE taskHandle = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, &taskHandle, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_PERFORMALREADYCALLED, HCHttpCallReset(call));
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetStatusCode(call, 200));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetResponseString(call, "response"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "responseHeader", "responseValue"));
+        VERIFY_ARE_EQUAL(HC_E_PERFORMALREADYCALLED, HCHttpCallRequestSetRequestBodyString(call, "body2"));
+
+        HC_CALL_HANDLE clone = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallClone(call, &clone));
+        VERIFY_IS_NOT_NULL(clone);
+        const CHAR* method = nullptr;
+        const CHAR* url = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetUrl(clone, &method, &url));
+        VERIFY_ARE_EQUAL_STR("POST", method);
+        VERIFY_ARE_EQUAL_STR("https://www.bing.com", url);
+        const CHAR* headerValue = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(clone, "testHeader", &headerValue));
+        VERIFY_ARE_EQUAL_STR("testValue", headerValue);
+        const CHAR* body = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetRequestBodyString(clone, &body));
+        VERIFY_ARE_EQUAL_STR("body", body);
+        uint32_t timeout = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetTimeout(clone, &timeout));
+        VERIFY_ARE_EQUAL(100, timeout);
+        uint32_t statusCode = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(clone, &statusCode));
+        VERIFY_ARE_EQUAL(0, statusCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetRequestBodyString(clone, "body2"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(clone));
+
+        // The call can be reset once its task is completed
+        VERIFY_ARE_EQUAL(HC_E_PERFORMALREADYCALLED, HCHttpCallReset(call));
+        HCTaskSetCompleted(taskHandle);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallReset(call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(call, &statusCode));
+        VERIFY_ARE_EQUAL(0, statusCode);
+        const CHAR* responseString = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL_STR("", responseString);
+        uint32_t numHeaders = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetNumHeaders(call, &numHeaders));
+        VERIFY_ARE_EQUAL(0, numHeaders);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(call, "testHeader", &headerValue));
+        VERIFY_ARE_EQUAL_STR("testValue", headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetRequestBodyString(call, "body2"));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        HCGlobalCleanup();
+    }
+
     DEFINE_TEST_CASE(TestRequest)
     {
         DEFINE_TEST_CASE_PROPERTIES(TestRequest);
@@ -290,6 +537,39 @@ public:
         HCGlobalCleanup();
     }
 
+    DEFINE_TEST_CASE(TestWellKnownRequestHeaders)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestWellKnownRequestHeaders);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HC_CALL_HANDLE call = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(call, "content-type", "text/plain"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(call, "Content-Type", "application/json"));
+        uint32_t numHeaders = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetNumHeaders(call, &numHeaders));
+        VERIFY_ARE_EQUAL(1, numHeaders);
+
+        const CHAR* t1 = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(call, "CONTENT-TYPE", &t1));
+        VERIFY_ARE_EQUAL_STR("application/json", t1);
+
+        const CHAR* hn0 = nullptr;
+        const CHAR* hv0 = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeaderAtIndex(call, 0, &hn0, &hv0));
+        VERIFY_ARE_EQUAL_STR("Content-Type", hn0);
+        VERIFY_ARE_EQUAL_STR("application/json", hv0);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "DELETE", "https://www.bing.com"));
+        const CHAR* method = nullptr;
+        const CHAR* url = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetUrl(call, &method, &url));
+        VERIFY_ARE_EQUAL_STR("DELETE", method);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        HCGlobalCleanup();
+    }
+
     DEFINE_TEST_CASE(TestResponse)
     {
         DEFINE_TEST_CASE_PROPERTIES(TestResponse);
@@ -320,6 +600,863 @@ public:
         HCGlobalCleanup();
     }
 
+    DEFINE_TEST_CASE(TestResponseDecompression)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestResponseDecompression);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        bool enabled = false;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetResponseDecompression(nullptr, &enabled));
+        VERIFY_IS_TRUE(enabled);
+
+        // gzip fed a byte at a time as a slow network would
+        HC_CALL_HANDLE call = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "content-encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Length", std::to_string(ARRAYSIZE(s_gzipBody)).c_str()));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Type", "text/plain"));
+        for (uint32_t i = 0; i < ARRAYSIZE(s_gzipBody); i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseAppendResponseBodyBytes(call, &s_gzipBody[i], 1));
+        }
+        const CHAR* responseString = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL_STR(s_decompressedBody, responseString);
+
+        // The headers that described the compressed body are gone
+        const CHAR* headerValue = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetHeader(call, "Content-Encoding", &headerValue));
+        VERIFY_IS_NULL(headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetHeader(call, "Content-Length", &headerValue));
+        VERIFY_IS_NULL(headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetHeader(call, "Content-Type", &headerValue));
+        VERIFY_ARE_EQUAL_STR("text/plain", headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // zlib wrapped deflate in a single chunk
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Encoding", "deflate"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseAppendResponseBodyBytes(call, s_deflateBody, ARRAYSIZE(s_deflateBody)));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL_STR(s_decompressedBody, responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // A corrupt checksum fails the call
+        BYTE corruptBody[ARRAYSIZE(s_gzipBody)];
+        memcpy(corruptBody, s_gzipBody, sizeof(corruptBody));
+        corruptBody[ARRAYSIZE(corruptBody) - 8] ^= 0xFF;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_E_FAIL, HCHttpCallResponseAppendResponseBodyBytes(call, corruptBody, ARRAYSIZE(corruptBody)));
+        HC_RESULT networkErrorCode = HC_OK;
+        uint32_t platformNetworkErrorCode = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetNetworkErrorCode(call, &networkErrorCode, &platformNetworkErrorCode));
+        VERIFY_ARE_EQUAL(HC_E_FAIL, networkErrorCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // So does a body that decompresses to well over the limit, and nothing more is decoded.  This
+        // one is a fixed Huffman block of a zero byte then copies of 258 bytes from 1 back, 13 bits each.
+        std::vector<uint8_t> bomb = { 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff };
+        uint32_t bitBuffer = 0;
+        uint32_t bitCount = 0;
+        auto writeBits = [&](uint32_t value, uint32_t count)
+        {
+            bitBuffer |= value << bitCount;
+            for (bitCount += count; bitCount >= 8; bitCount -= 8)
+            {
+                bomb.push_back(static_cast<uint8_t>(bitBuffer));
+                bitBuffer >>= 8;
+            }
+        };
+        writeBits(3, 3);        // final block, fixed codes
+        writeBits(0x0c, 8);     // literal 0, whose code 00110000 goes most significant bit first
+        for (size_t size = 1; size <= HTTP_MAX_DECOMPRESSED_BODY_SIZE + 1024 * 1024; size += 258)
+        {
+            writeBits(0xa3, 8); // length 258, code 11000101
+            writeBits(0, 5);    // distance 1
+        }
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_E_BUFFERTOOSMALL, HCHttpCallResponseAppendResponseBodyBytes(call, bomb.data(), static_cast<uint32_t>(bomb.size())));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetNetworkErrorCode(call, &networkErrorCode, &platformNetworkErrorCode));
+        VERIFY_ARE_EQUAL(HC_E_BUFFERTOOSMALL, networkErrorCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        size_t decodedSize = strlen(responseString);
+        VERIFY_IS_TRUE(decodedSize <= HTTP_MAX_DECOMPRESSED_BODY_SIZE + 2 * 1024 * 1024);
+        VERIFY_ARE_EQUAL(HC_E_BUFFERTOOSMALL, HCHttpCallResponseAppendResponseBodyBytes(call, bomb.data(), static_cast<uint32_t>(bomb.size())));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL(decodedSize, strlen(responseString));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // The body is left alone when the caller negotiated the encoding itself
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(call, "Accept-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseAppendResponseBodyBytes(call, s_gzipBody, 2));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL_STR("\x1f\x8b", responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetHeader(call, "Content-Encoding", &headerValue));
+        VERIFY_ARE_EQUAL_STR("gzip", headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // Or when decompression is turned off
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetResponseDecompression(nullptr, false));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetResponseDecompression(call, &enabled));
+        VERIFY_IS_TRUE(!enabled);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(call, "Content-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseAppendResponseBodyBytes(call, s_gzipBody, 2));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL_STR("\x1f\x8b", responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestRequestCompression)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestRequestCompression);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&PerformCallback);
+
+        std::string body;
+        while (body.size() < 4096)
+        {
+            body += "{\"event\":\"telemetry\",\"value\":" + std::to_string(body.size()) + "},";
+        }
+
+        HC_CALL_HANDLE call = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "POST", "https://www.bing.com"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetRequestBodyString(call, body.c_str()));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetCompression(call, HC_COMPRESSION_LEVEL_MEDIUM));
+        HC_COMPRESSION_LEVEL level = HC_COMPRESSION_LEVEL_NONE;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetCompression(call, &level));
+        VERIFY_ARE_EQUAL(HC_COMPRESSION_LEVEL_MEDIUM, level);
+        HC_TASK_HANDLE taskHandle = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, &taskHandle, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+
+        const CHAR* headerValue = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(call, "Content-Encoding", &headerValue));
+        VERIFY_ARE_EQUAL_STR("gzip", headerValue);
+        const BYTE* compressedBody = nullptr;
+        uint32_t compressedSize = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetRequestBodyBytes(call, &compressedBody, &compressedSize));
+        VERIFY_IS_TRUE(compressedSize < body.size() / 4);
+
+        // Round trip through response decompression
+        HC_CALL_HANDLE response = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&response));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseSetHeader(response, "Content-Encoding", "gzip"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseAppendResponseBodyBytes(response, compressedBody, compressedSize));
+        const CHAR* responseString = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(response, &responseString));
+        VERIFY_ARE_EQUAL_STR(body.c_str(), responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(response));
+
+        // Bytes past 0x7f take the 9 bit codes of a fixed Huffman block.  The expected output was
+        // checked with Python's gzip module, and the second vector is from zlib itself.
+        const char utf8[] = "caf\xc3\xa9 \xe2\x82\xac\xff\x90\x80 caf\xc3\xa9";
+        const uint8_t expectedGzip[] =
+        {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x4b, 0x4e, 0x4c, 0x3b, 0xbc, 0x52,
+            0xe1, 0x51, 0xd3, 0x9a, 0xff, 0x13, 0x1a, 0x14, 0xc0, 0x1c, 0x00, 0xc1, 0x79, 0x46, 0xbd, 0x12,
+            0x00, 0x00, 0x00
+        };
+        const uint8_t zlibGzip[] =
+        {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x4b, 0x4e, 0x4c, 0x3b, 0xbc, 0x52,
+            0xe1, 0x51, 0xd3, 0x9a, 0xff, 0x13, 0x1a, 0x14, 0x92, 0x41, 0x1c, 0x00, 0xc1, 0x79, 0x46, 0xbd,
+            0x12, 0x00, 0x00, 0x00
+        };
+        http_internal_vector<uint8_t> compressed;
+        http_deflater deflater(HC_COMPRESSION_LEVEL_MEDIUM);
+        VERIFY_ARE_EQUAL(HC_OK, deflater.compress(reinterpret_cast<const uint8_t*>(utf8), sizeof(utf8) - 1, compressed));
+        VERIFY_ARE_EQUAL(sizeof(expectedGzip), compressed.size());
+        VERIFY_IS_TRUE(memcmp(expectedGzip, compressed.data(), compressed.size()) == 0);
+        http_arena_string decompressed;
+        http_inflater inflater(http_content_encoding::gzip);
+        VERIFY_ARE_EQUAL(HC_OK, inflater.write(zlibGzip, sizeof(zlibGzip), decompressed));
+        VERIFY_IS_TRUE(inflater.is_done());
+        VERIFY_ARE_EQUAL(sizeof(utf8) - 1, decompressed.size());
+        VERIFY_IS_TRUE(memcmp(utf8, decompressed.data(), decompressed.size()) == 0);
+
+        // A new body after a reset drops the Content-Encoding added for the old one
+        HCTaskSetCompleted(taskHandle);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallReset(call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetRequestBodyString(call, "small"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, nullptr, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(call, "Content-Encoding", &headerValue));
+        VERIFY_IS_NULL(headerValue);
+        const CHAR* requestBody = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetRequestBodyString(call, &requestBody));
+        VERIFY_ARE_EQUAL_STR("small", requestBody);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestRequestCompressionBenchmark)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestRequestCompressionBenchmark);
+
+        // Representative uploads: JSON telemetry, a save game with repeated records and
+        // noise that is already compressed
+        std::string telemetry;
+        while (telemetry.size() < 256 * 1024)
+        {
+            telemetry += "{\"name\":\"MatchEnd\",\"player\":\"" + std::to_string(telemetry.size() % 977) +
+                "\",\"score\":" + std::to_string(telemetry.size() % 10007) + ",\"map\":\"harbor\"},";
+        }
+        std::string saveGame;
+        uint32_t seed = 1;
+        while (saveGame.size() < 256 * 1024)
+        {
+            seed = seed * 1103515245 + 12345;
+            saveGame.append("ENTITY\0\0\0\x01", 10);
+            saveGame.append(reinterpret_cast<const char*>(&seed), sizeof(seed));
+        }
+        std::string noise;
+        while (noise.size() < 256 * 1024)
+        {
+            seed = seed * 1103515245 + 12345;
+            noise.push_back(static_cast<char>(seed >> 24));
+        }
+
+        const std::pair<const wchar_t*, const std::string*> payloads[] =
+        {
+            { L"telemetry", &telemetry },
+            { L"save game", &saveGame },
+            { L"noise", &noise }
+        };
+        const HC_COMPRESSION_LEVEL levels[] = { HC_COMPRESSION_LEVEL_LOW, HC_COMPRESSION_LEVEL_MEDIUM, HC_COMPRESSION_LEVEL_HIGH };
+
+        for (const auto& payload : payloads)
+        {
+            for (HC_COMPRESSION_LEVEL level : levels)
+            {
+                http_internal_vector<uint8_t> compressed;
+                http_deflater deflater(level);
+                auto start = std::chrono::high_resolution_clock::now();
+                VERIFY_ARE_EQUAL(HC_OK, deflater.compress(reinterpret_cast<const uint8_t*>(payload.second->data()), payload.second->size(), compressed));
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+                http_arena_string decompressed;
+                http_inflater inflater(http_content_encoding::gzip);
+                VERIFY_ARE_EQUAL(HC_OK, inflater.write(compressed.data(), compressed.size(), decompressed));
+                VERIFY_IS_TRUE(inflater.is_done());
+                VERIFY_IS_TRUE(decompressed.size() == payload.second->size());
+                VERIFY_IS_TRUE(memcmp(payload.second->data(), decompressed.data(), decompressed.size()) == 0);
+
+                wchar_t message[256];
+                swprintf_s(message, L"%s level %d: %u -> %u bytes (%.1f%% saved) in %lld us",
+                    payload.first, level,
+                    static_cast<uint32_t>(payload.second->size()), static_cast<uint32_t>(compressed.size()),
+                    100.0 * (1.0 - static_cast<double>(compressed.size()) / payload.second->size()),
+                    static_cast<long long>(elapsed));
+                TEST_LOG(message);
+            }
+        }
+    }
+
+    DEFINE_TEST_CASE(TestResponseCache)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestResponseCache);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&CacheServerPerformCallback);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheSize(64 * 1024));
+        g_cacheServerRequests = 0;
+
+        auto performGet = [](const CHAR* url, uint32_t* statusCode, const CHAR** responseString, const CHAR* language = nullptr)
+        {
+            HC_CALL_HANDLE call = nullptr;
+            HC_TASK_HANDLE taskHandle = 0;
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "GET", url));
+            if (language != nullptr)
+            {
+                VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(call, "Accept-Language", language));
+            }
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, &taskHandle, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+            VERIFY_IS_TRUE(HCTaskIsCompleted(taskHandle));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(call, statusCode));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, responseString));
+            return call;
+        };
+
+        // A fresh entry completes without reaching the network
+        g_cacheServerCacheControl = "max-age=3600";
+        uint32_t statusCode = 0;
+        const CHAR* responseString = nullptr;
+        HC_CALL_HANDLE call = performGet("https://example.com/config", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(1, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        call = performGet("https://example.com/config", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(1, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(200, statusCode);
+        VERIFY_ARE_EQUAL_STR("catalog", responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // A stale entry is revalidated and a 304 completes from the cache
+        g_cacheServerCacheControl = "no-cache";
+        call = performGet("https://example.com/catalog", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(2, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        call = performGet("https://example.com/catalog", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(3, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(200, statusCode);
+        VERIFY_ARE_EQUAL_STR("catalog", responseString);
+        const CHAR* headerValue = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetHeader(call, "If-None-Match", &headerValue));
+        VERIFY_IS_NULL(headerValue);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // The entry is pinned while it is revalidated, so a 304 still completes from it after
+        // the cache was emptied, and puts it back
+        g_cacheServerHold = true;
+        HC_TASK_HANDLE taskHandle = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "GET", "https://example.com/catalog"));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, &taskHandle, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        VERIFY_ARE_EQUAL(4, g_cacheServerRequests);
+        uint64_t maxSize = 0;
+        uint64_t usedSize = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheSize(0));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheSize(64 * 1024));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetResponseCacheSize(&maxSize, &usedSize));
+        VERIFY_ARE_EQUAL(0, usedSize);
+        HCTaskSetCompleted(g_cacheServerTask);
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+        VERIFY_IS_TRUE(HCTaskIsCompleted(taskHandle));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(call, &statusCode));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+        VERIFY_ARE_EQUAL(200, statusCode);
+        VERIFY_ARE_EQUAL_STR("catalog", responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        g_cacheServerHold = false;
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetResponseCacheSize(&maxSize, &usedSize));
+        VERIFY_ARE_EQUAL(64 * 1024, maxSize);
+        VERIFY_IS_TRUE(usedSize > 0);
+
+        // Disabling the cache empties it
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheSize(0));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetResponseCacheSize(&maxSize, &usedSize));
+        VERIFY_ARE_EQUAL(0, usedSize);
+        g_cacheServerCacheControl = "max-age=3600";
+        call = performGet("https://example.com/config", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(5, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        // Each Vary variant is kept, so requests that alternate between them keep hitting
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheSize(64 * 1024));
+        const CHAR* languages[] = { "en", "fr", "en", "fr" };
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            call = performGet("https://example.com/news", &statusCode, &responseString, languages[i]);
+            VERIFY_ARE_EQUAL(i < 2 ? 6 + i : 7, g_cacheServerRequests);
+            VERIFY_ARE_EQUAL(200, statusCode);
+            VERIFY_ARE_EQUAL_STR((std::string("catalog-") + languages[i]).c_str(), responseString);
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        }
+
+        // A server error leaves a stale entry to be revalidated next time, but a 404 evicts it
+        g_cacheServerCacheControl = "no-cache";
+        call = performGet("https://example.com/store", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        g_cacheServerStatus = 503;
+        call = performGet("https://example.com/store", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(503, statusCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        g_cacheServerStatus = 0;
+        uint32_t notModified = g_cacheServerNotModified;
+        call = performGet("https://example.com/store", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(notModified + 1, g_cacheServerNotModified);
+        VERIFY_ARE_EQUAL(200, statusCode);
+        VERIFY_ARE_EQUAL_STR("catalog", responseString);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        g_cacheServerStatus = 404;
+        call = performGet("https://example.com/store", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(404, statusCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        g_cacheServerStatus = 0;
+        call = performGet("https://example.com/store", &statusCode, &responseString);
+        VERIFY_ARE_EQUAL(notModified + 1, g_cacheServerNotModified);
+        VERIFY_ARE_EQUAL(200, statusCode);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestResponseCacheFile)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestResponseCacheFile);
+
+        const CHAR* cacheFile = "hc_response_cache_test.bin";
+        remove(cacheFile);
+        g_cacheServerRequests = 0;
+        g_cacheServerCacheControl = "max-age=3600";
+
+        auto performGet = []()
+        {
+            HC_CALL_HANDLE call = nullptr;
+            HC_TASK_HANDLE taskHandle = 0;
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&call));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(call, "GET", "https://example.com/catalog"));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(call, &taskHandle, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+
+            uint32_t statusCode = 0;
+            const CHAR* responseString = nullptr;
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(call, &statusCode));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(call, &responseString));
+            VERIFY_ARE_EQUAL(200, statusCode);
+            VERIFY_ARE_EQUAL_STR("catalog", responseString);
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(call));
+        };
+
+        // Only the file is enabled, so a hit must come from disk
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&CacheServerPerformCallback);
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCGlobalSetResponseCacheFile(cacheFile, 16));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheFile(cacheFile, 64 * 1024));
+        performGet();
+        VERIFY_ARE_EQUAL(1, g_cacheServerRequests);
+        performGet();
+        VERIFY_ARE_EQUAL(1, g_cacheServerRequests);
+        HCGlobalCleanup();
+
+        // The response survives a restart
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&CacheServerPerformCallback);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheFile(cacheFile, 64 * 1024));
+        performGet();
+        VERIFY_ARE_EQUAL(1, g_cacheServerRequests);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetResponseCacheFile(nullptr, 0));
+        performGet();
+        VERIFY_ARE_EQUAL(2, g_cacheServerRequests);
+        HCGlobalCleanup();
+
+        remove(cacheFile);
+    }
+
+    DEFINE_TEST_CASE(TestRequestCoalescing)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestRequestCoalescing);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&CoalescingServerPerformCallback);
+        g_coalescingServerRequests = 0;
+
+        bool enabled = true;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetCoalescing(nullptr, &enabled));
+        VERIFY_ARE_EQUAL(false, enabled);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetCoalescing(nullptr, true));
+
+        // Three identical calls and one with a different header
+        const uint32_t callCount = 4;
+        HC_CALL_HANDLE calls[callCount] = {};
+        HC_TASK_HANDLE taskHandles[callCount] = {};
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&calls[i]));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestGetCoalescing(calls[i], &enabled));
+            VERIFY_ARE_EQUAL(true, enabled);
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(calls[i], "GET", "https://example.com/leaderboard"));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetHeader(calls[i], "X-Page", i == callCount - 1 ? "2" : "1"));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(calls[i], &taskHandles[i], HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        }
+        VERIFY_ARE_EQUAL(2, g_coalescingServerRequests);
+        HCTaskSetCompleted(taskHandles[callCount - 1]);
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+
+        // Writing the leader's results completes the calls attached to it
+        VERIFY_IS_TRUE(!HCTaskIsCompleted(taskHandles[1]));
+        HCTaskSetCompleted(taskHandles[0]);
+        for (uint32_t i = 0; i < callCount - 1; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+        }
+
+        const CHAR* leaderResponse = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(calls[0], &leaderResponse));
+        VERIFY_ARE_EQUAL_STR("leaderboard", leaderResponse);
+        for (uint32_t i = 1; i < callCount - 1; i++)
+        {
+            VERIFY_IS_TRUE(HCTaskIsCompleted(taskHandles[i]));
+            uint32_t statusCode = 0;
+            const CHAR* responseString = nullptr;
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetStatusCode(calls[i], &statusCode));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallResponseGetResponseString(calls[i], &responseString));
+            VERIFY_ARE_EQUAL(200, statusCode);
+            VERIFY_IS_TRUE(responseString == leaderResponse);
+        }
+
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[i]));
+        }
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestBatchPerform)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestBatchPerform);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&BatchPerformCallback);
+        g_batchPerformUrls.clear();
+
+        const uint32_t callCount = 4;
+        const CHAR* urls[callCount] = {
+            "https://a.example.com/1",
+            "https://b.example.com/1",
+            "https://A.example.com:443/2",
+            "https://b.example.com/2"
+        };
+        HC_CALL_HANDLE calls[callCount] = {};
+        HC_TASK_HANDLE taskHandles[callCount] = {};
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&calls[i]));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(calls[i], "GET", urls[i]));
+        }
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpCallBatchPerform(nullptr, callCount, taskHandles, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpCallBatchPerform(calls, 0, taskHandles, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        HC_CALL_HANDLE withNull[] = { calls[0], nullptr };
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpCallBatchPerform(withNull, 2, nullptr, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        HC_CALL_HANDLE listedTwice[] = { calls[0], calls[1], calls[0] };
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpCallBatchPerform(listedTwice, 3, nullptr, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(0, HCTaskGetPendingTaskQueueSize(HC_SUBSYSTEM_ID_GAME));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallBatchPerform(calls, callCount, taskHandles, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(callCount, HCTaskGetPendingTaskQueueSize(HC_SUBSYSTEM_ID_GAME));
+
+        // A batch with a call that was already performed queues nothing, not even its other calls
+        HC_CALL_HANDLE fresh = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&fresh));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(fresh, "GET", "https://c.example.com/1"));
+        HC_CALL_HANDLE performed[] = { fresh, calls[1] };
+        VERIFY_ARE_EQUAL(HC_E_PERFORMALREADYCALLED, HCHttpCallBatchPerform(performed, 2, nullptr, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(callCount, HCTaskGetPendingTaskQueueSize(HC_SUBSYSTEM_ID_GAME));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(fresh));
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        }
+
+        // Grouped by origin, in the given order within each origin
+        VERIFY_ARE_EQUAL(callCount, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL_STR(urls[0], g_batchPerformUrls[0].c_str());
+        VERIFY_ARE_EQUAL_STR(urls[2], g_batchPerformUrls[1].c_str());
+        VERIFY_ARE_EQUAL_STR(urls[1], g_batchPerformUrls[2].c_str());
+        VERIFY_ARE_EQUAL_STR(urls[3], g_batchPerformUrls[3].c_str());
+
+        // Task handles come back in the caller's order
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_IS_TRUE(!HCTaskIsCompleted(taskHandles[i]));
+            HCTaskSetCompleted(taskHandles[i]);
+            VERIFY_IS_TRUE(HCTaskIsCompleted(taskHandles[i]));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[i]));
+        }
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestHostCallLimit)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestHostCallLimit);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HCGlobalSetHttpCallPerformFunction(&BatchPerformCallback);
+        g_batchPerformUrls.clear();
+
+        uint32_t maxCallsPerHost = 0;
+        uint32_t inFlight = 0;
+        uint32_t queued = 0;
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCGlobalGetHostCallStats(nullptr, nullptr, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats(nullptr, &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(0, maxCallsPerHost);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetMaxCallsPerHost(2));
+
+        // Four calls to one host and one to another
+        const uint32_t callCount = 5;
+        HC_CALL_HANDLE calls[callCount] = {};
+        HC_TASK_HANDLE taskHandles[callCount] = {};
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&calls[i]));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(calls[i], "GET", i == callCount - 1 ? "https://other.example.com/" : "https://example.com/"));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(calls[i], &taskHandles[i], HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        }
+        VERIFY_ARE_EQUAL(3, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats("Example.com", &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(2, maxCallsPerHost);
+        VERIFY_ARE_EQUAL(2, inFlight);
+        VERIFY_ARE_EQUAL(2, queued);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats(nullptr, &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(3, inFlight);
+        VERIFY_ARE_EQUAL(2, queued);
+
+        // Completing a call sends the oldest waiting call to the same host
+        HCTaskSetCompleted(taskHandles[0]);
+        VERIFY_ARE_EQUAL(4, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats("example.com", &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(2, inFlight);
+        VERIFY_ARE_EQUAL(1, queued);
+
+        // Removing the limit sends the rest
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetMaxCallsPerHost(0));
+        VERIFY_ARE_EQUAL(5, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats("example.com", &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(3, inFlight);
+        VERIFY_ARE_EQUAL(0, queued);
+
+        for (uint32_t i = 1; i < callCount; i++)
+        {
+            HCTaskSetCompleted(taskHandles[i]);
+        }
+        for (uint32_t i = 0; i < callCount; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[i]));
+        }
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats(nullptr, &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(0, inFlight);
+        VERIFY_ARE_EQUAL(0, queued);
+
+        // Waiting calls stay alive after the app closes them: one is sent when a slot frees up and
+        // the other is released at cleanup
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetMaxCallsPerHost(1));
+        g_batchPerformUrls.clear();
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCreate(&calls[i]));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallRequestSetUrl(calls[i], "GET", i == 1 ? "https://example.com/waiting" : "https://example.com/"));
+            VERIFY_ARE_EQUAL(HC_OK, HCHttpCallPerform(calls[i], &taskHandles[i], HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+            VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME));
+        }
+        VERIFY_ARE_EQUAL(1, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[1]));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[2]));
+
+        HCTaskSetCompleted(taskHandles[0]);
+        VERIFY_ARE_EQUAL(2, (uint32_t)g_batchPerformUrls.size());
+        VERIFY_ARE_EQUAL_STR("https://example.com/waiting", g_batchPerformUrls[1].c_str());
+        VERIFY_ARE_EQUAL(HC_OK, HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpCallCloseHandle(calls[0]));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetHostCallStats("example.com", &maxCallsPerHost, &inFlight, &queued));
+        VERIFY_ARE_EQUAL(1, inFlight);
+        VERIFY_ARE_EQUAL(1, queued);
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestDnsResolver)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestDnsResolver);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        get_http_singleton(true)->m_dnsResolver->set_lookup_function(FakeDnsLookup);
+        g_fakeDnsLookups = 0;
+
+        // A cold lookup completes on a resolver thread
+        DnsResult first = {};
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpResolveHost("Game.Example.com", &first, DnsResolveCallback));
+        WaitForDnsResult(first);
+        VERIFY_IS_TRUE(first.done);
+        VERIFY_ARE_EQUAL(HC_OK, first.result);
+        VERIFY_ARE_EQUAL(2, first.addressCount);
+        VERIFY_ARE_EQUAL_STR("203.0.113.7", first.firstAddress.c_str());
+
+        // A cached lookup completes before returning
+        DnsResult cached = {};
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpResolveHost("game.example.com", &cached, DnsResolveCallback));
+        VERIFY_IS_TRUE(cached.done);
+        VERIFY_ARE_EQUAL_STR("203.0.113.7", cached.firstAddress.c_str());
+        VERIFY_ARE_EQUAL(1, g_fakeDnsLookups);
+
+        // Failures are cached too
+        DnsResult missing = {};
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpResolveHost("missing.example.com", &missing, DnsResolveCallback));
+        WaitForDnsResult(missing);
+        VERIFY_ARE_EQUAL(HC_E_FAIL, missing.result);
+        VERIFY_ARE_EQUAL(0, missing.addressCount);
+        DnsResult missingCached = {};
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpResolveHost("missing.example.com", &missingCached, DnsResolveCallback));
+        VERIFY_IS_TRUE(missingCached.done);
+        VERIFY_ARE_EQUAL(HC_E_FAIL, missingCached.result);
+        VERIFY_ARE_EQUAL(2, g_fakeDnsLookups);
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpResolveHost("", &missing, DnsResolveCallback));
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestPrewarmConnection)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestPrewarmConnection);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        get_http_singleton(true)->m_dnsResolver->set_lookup_function(FakeDnsLookup);
+        g_fakeDnsLookups = 0;
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpPrewarmConnection(nullptr, 1));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpPrewarmConnection("https://game.example.com/", 0));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpPrewarmConnection("not a url", 1));
+
+        // The platform owns its connections and its lookups, so prewarming isn't supported and
+        // nothing is started on its behalf
+        VERIFY_ARE_EQUAL(HC_E_NOTSUPPORTED, HCHttpPrewarmConnection("https://Game.Example.com/match", 2));
+        VERIFY_ARE_EQUAL(0, g_fakeDnsLookups);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetConnectionIdleTimeout(5));
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestConnectAddresses)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestConnectAddresses);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetConnectionAttemptDelay(100));
+        VERIFY_IS_TRUE(http_socket_startup());
+
+        // Listen on IPv4 loopback only
+        http_socket listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        VERIFY_IS_TRUE(listener != HTTP_INVALID_SOCKET);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        VERIFY_ARE_EQUAL(0, bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+        VERIFY_ARE_EQUAL(0, listen(listener, 4));
+        socklen_t addressLength = sizeof(address);
+        VERIFY_ARE_EQUAL(0, getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength));
+        uint16_t port = ntohs(address.sin_port);
+
+        // The IPv6 attempt is refused and the IPv4 attempt wins
+        PCSTR addresses[] = { "::1", "127.0.0.1" };
+        uint64_t connected = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpConnectAddresses(addresses, 2, port, 5000, &connected));
+        http_socket_close(static_cast<http_socket>(connected));
+
+        // Once nothing is listening every attempt is refused, well before the timeout
+        http_socket_close(listener);
+        auto start = std::chrono::steady_clock::now();
+        VERIFY_ARE_EQUAL(HC_E_FAIL, HCHttpConnectAddresses(addresses, 2, port, 5000, &connected));
+        VERIFY_IS_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(4));
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpConnectAddresses(addresses, 0, port, 5000, &connected));
+        http_socket_cleanup();
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestTlsSessionCache)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestTlsSessionCache);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        uint8_t buffer[16] = {};
+        uint32_t size = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        // Nothing to resume on the first connection
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpGetTlsSession("example.com:443", sizeof(buffer), buffer, &size));
+        VERIFY_ARE_EQUAL(0, size);
+
+        const uint8_t firstTicket[] = { 1, 2, 3 };
+        const uint8_t secondTicket[] = { 4, 5, 6, 7 };
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpSetTlsSession("example.com:443", firstTicket, sizeof(firstTicket), 0));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpSetTlsSession("Example.com:443", secondTicket, sizeof(secondTicket), 3600));
+
+        // A small buffer reports the size and leaves the session in place
+        VERIFY_ARE_EQUAL(HC_E_BUFFERTOOSMALL, HCHttpGetTlsSession("example.com:443", 0, nullptr, &size));
+        VERIFY_ARE_EQUAL(4, size);
+
+        // Newest first, and each session is only handed out once
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpGetTlsSession("example.com:443", sizeof(buffer), buffer, &size));
+        VERIFY_ARE_EQUAL(4, size);
+        VERIFY_ARE_EQUAL(4, buffer[0]);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpGetTlsSession("example.com:443", sizeof(buffer), buffer, &size));
+        VERIFY_ARE_EQUAL(3, size);
+        VERIFY_ARE_EQUAL(1, buffer[0]);
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpGetTlsSession("example.com:443", sizeof(buffer), buffer, &size));
+        VERIFY_ARE_EQUAL(0, size);
+
+        // Sessions are kept per origin
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpSetTlsSession("example.com:8443", firstTicket, sizeof(firstTicket), 0));
+        VERIFY_ARE_EQUAL(HC_OK, HCHttpGetTlsSession("example.com:443", sizeof(buffer), buffer, &size));
+        VERIFY_ARE_EQUAL(0, size);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetTlsSessionCacheStats(&hits, &misses));
+        VERIFY_ARE_EQUAL(2, hits);
+        VERIFY_ARE_EQUAL(3, misses);
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCHttpSetTlsSession("example.com:443", firstTicket, 0, 0));
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestHpack)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestHpack);
+
+        // RFC 7541 C.4: three requests on one connection, with Huffman coding
+        http_internal_vector<hpack_header> first = {
+            { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" } };
+        http_internal_vector<hpack_header> second = first;
+        second.push_back({ "cache-control", "no-cache" });
+
+        hpack_encoder encoder;
+        hpack_decoder decoder;
+        http_internal_vector<uint8_t> block;
+        encoder.encode(first, block);
+        const uint8_t expectedFirst[] = { 0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2, 0x3a, 0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff };
+        VERIFY_ARE_EQUAL(sizeof(expectedFirst), block.size());
+        VERIFY_IS_TRUE(memcmp(expectedFirst, block.data(), block.size()) == 0);
+
+        http_internal_vector<hpack_header> decoded;
+        VERIFY_IS_TRUE(decoder.decode(block.data(), block.size(), decoded));
+        VERIFY_ARE_EQUAL(4, decoded.size());
+        VERIFY_ARE_EQUAL_STR("www.example.com", decoded[3].value.c_str());
+
+        // The authority is now in the dynamic table
+        block.clear();
+        encoder.encode(second, block);
+        const uint8_t expectedSecond[] = { 0x82, 0x86, 0x84, 0xbe, 0x58, 0x86, 0xa8, 0xeb, 0x10, 0x64, 0x9c, 0xbf };
+        VERIFY_ARE_EQUAL(sizeof(expectedSecond), block.size());
+        VERIFY_IS_TRUE(memcmp(expectedSecond, block.data(), block.size()) == 0);
+        decoded.clear();
+        VERIFY_IS_TRUE(decoder.decode(block.data(), block.size(), decoded));
+        VERIFY_ARE_EQUAL_STR("no-cache", decoded[4].value.c_str());
+
+        // Credentials are never indexed, so they are sent in full every time
+        http_internal_vector<hpack_header> credentials = { { "authorization", "Bearer token" } };
+        block.clear();
+        encoder.encode(credentials, block);
+        VERIFY_ARE_EQUAL(0x1f, block[0]);
+        size_t firstSize = block.size();
+        block.clear();
+        encoder.encode(credentials, block);
+        VERIFY_ARE_EQUAL(firstSize, block.size());
+
+        // An index past the end of the tables is a compression error
+        const uint8_t badIndex[] = { 0xff, 0x00 };
+        decoded.clear();
+        VERIFY_IS_FALSE(decoder.decode(badIndex, sizeof(badIndex), decoded));
+    }
+
     DEFINE_TEST_CASE(TestResponseHeaders)
     {
         DEFINE_TEST_CASE_PROPERTIES(TestResponseHeaders);
@@ -7,6 +7,12 @@
 #include "DefineTestMacros.h"
 #include "Utils.h"
 #include "../global/global.h"
+#include "../WebSocket/hcwebsocket.h"
+#include "../WebSocket/Native/websocket_frame.h"
+#include "../WebSocket/Native/websocket_deflate.h"
+#include "../WebSocket/Native/websocket_connection.h"
+#include "../HTTP/http_socket.h"
+#include <chrono>
 
 using namespace xbox::httpclient;
 
@@ -101,6 +107,78 @@ HC_RESULT Test_Internal_HCWebSocketSendMessage(
     return HC_OK;
 }
 
+http_internal_vector<uint8_t> g_HCWebSocketSendBinaryMessage_Payload;
+HC_RESULT Test_Internal_HCWebSocketSendBinaryMessage(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize,
+    _In_ HC_SUBSYSTEM_ID taskSubsystemId,
+    _In_ uint64_t taskGroupId,
+    _In_opt_ void* completionRoutineContext,
+    _In_opt_ HCWebSocketCompletionRoutine completionRoutine
+    )
+{
+    g_HCWebSocketSendBinaryMessage_Payload.assign(payloadBytes, payloadBytes + payloadSize);
+    return HC_OK;
+}
+
+void HC_CALLING_CONV PerformBinaryMessageCallback(
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    )
+{
+}
+
+struct handle_function_calls
+{
+    int messages;
+    int binaryMessages;
+    int closes;
+    uint32_t lastSize;
+};
+
+void HC_CALLING_CONV PerformHandleMessageCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR incomingBodyString,
+    _In_ uint32_t incomingBodySize
+    )
+{
+    static_cast<handle_function_calls*>(context)->messages++;
+    static_cast<handle_function_calls*>(context)->lastSize = incomingBodySize;
+}
+
+void HC_CALLING_CONV PerformHandleBinaryMessageCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    )
+{
+    static_cast<handle_function_calls*>(context)->binaryMessages++;
+    static_cast<handle_function_calls*>(context)->lastSize = payloadSize;
+}
+
+void HC_CALLING_CONV PerformHandleCloseCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    )
+{
+    static_cast<handle_function_calls*>(context)->closes++;
+}
+
+void HC_CALLING_CONV PerformRetainMessageCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR incomingBodyString,
+    _In_ uint32_t incomingBodySize
+    )
+{
+    VERIFY_ARE_EQUAL(HC_OK, HCWebSocketRetainMessageBuffer(websocket, static_cast<HC_WEBSOCKET_BUFFER_HANDLE*>(context)));
+}
+
 bool g_HCWebSocketDisconnect_Called = false;
 HC_RESULT Test_Internal_HCWebSocketDisconnect(
     _In_ HC_WEBSOCKET_HANDLE websocket,
@@ -111,6 +189,420 @@ HC_RESULT Test_Internal_HCWebSocketDisconnect(
     return HC_OK;
 }
 
+// A WebSocket server on the loopback interface for testing the native connection end to end.
+// Each connection is served on a thread of its own: the opening handshake is answered, then text
+// and binary messages are echoed back unmasked, pings are answered and a close is answered before
+// the socket is closed.  Unmasked client frames fail the connection (RFC 6455 5.1).  Set
+// answerPings to false before start() for a server that has gone quiet.  drop_connections() closes
+// the open connections without a close frame, as a server that restarts would, and holdHandshakes
+// keeps new connections waiting for their handshake until it is cleared.  A non-empty greeting is
+// sent as a text message in the same write as the 101.
+class loopback_websocket_server
+{
+public:
+    loopback_websocket_server() :
+        m_listener(HTTP_INVALID_SOCKET),
+        m_port(0),
+        m_stopping(false),
+        m_drops(0),
+        answerPings(true),
+        pongDelayInMilliseconds(0),
+        holdHandshakes(false),
+        connections(0),
+        messages(0),
+        pings(0),
+        closes(0),
+        lastCloseStatus(0)
+    {
+    }
+
+    ~loopback_websocket_server()
+    {
+        stop();
+    }
+
+    bool start()
+    {
+        if (!http_socket_startup())
+        {
+            return false;
+        }
+
+        m_listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressLength = sizeof(address);
+        if (m_listener == HTTP_INVALID_SOCKET ||
+            bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(m_listener, 8) != 0 ||
+            getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+        {
+            return false;
+        }
+
+        m_port = ntohs(address.sin_port);
+        m_acceptThread = std::thread([this] { accept_connections(); });
+        return true;
+    }
+
+    void stop()
+    {
+        if (m_listener == HTTP_INVALID_SOCKET)
+        {
+            return;
+        }
+
+        m_stopping = true;
+        m_acceptThread.join();
+        for (auto& thread : m_connectionThreads)
+        {
+            thread.join();
+        }
+        m_connectionThreads.clear();
+        http_socket_close(m_listener);
+        m_listener = HTTP_INVALID_SOCKET;
+        http_socket_cleanup();
+    }
+
+    void drop_connections()
+    {
+        m_drops++;
+    }
+
+    std::string uri() const
+    {
+        return "ws://127.0.0.1:" + std::to_string(m_port) + "/";
+    }
+
+    // The payloads of the data messages received on one connection, counting from 0
+    std::vector<std::vector<uint8_t>> received_messages(_In_ uint32_t connection)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return connection < m_receivedMessages.size() ? m_receivedMessages[connection] : std::vector<std::vector<uint8_t>>();
+    }
+
+    bool answerPings;
+    uint32_t pongDelayInMilliseconds;
+    std::atomic<bool> holdHandshakes;
+    std::string greeting;
+
+    std::atomic<uint32_t> connections;
+    std::atomic<uint32_t> messages;
+    std::atomic<uint32_t> pings;
+    std::atomic<uint32_t> closes;
+    std::atomic<uint32_t> lastCloseStatus;
+
+private:
+    void accept_connections()
+    {
+        while (!m_stopping)
+        {
+            if (http_socket_wait_readable(m_listener, 10) != 1)
+            {
+                continue;
+            }
+
+            http_socket socket = accept(m_listener, nullptr, nullptr);
+            if (socket == HTTP_INVALID_SOCKET)
+            {
+                continue;
+            }
+
+            uint32_t connection = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                connection = static_cast<uint32_t>(m_receivedMessages.size());
+                m_receivedMessages.emplace_back();
+            }
+            connections++;
+            uint32_t drops = m_drops;
+            m_connectionThreads.emplace_back([this, socket, connection, drops] { serve(socket, connection, drops); });
+        }
+    }
+
+    // Returns false once the socket is closed, the connection is dropped or the server is stopping
+    bool receive(_In_ http_socket socket, _In_ uint32_t drops, _Inout_ std::vector<uint8_t>& buffer)
+    {
+        while (!m_stopping && m_drops == drops)
+        {
+            int ready = http_socket_wait_readable(socket, 10);
+            if (ready == 0)
+            {
+                continue;
+            }
+
+            uint8_t data[4096];
+            int count = ready > 0 ? http_socket_receive(socket, data, sizeof(data)) : -1;
+            if (count <= 0)
+            {
+                return false;
+            }
+            buffer.insert(buffer.end(), data, data + count);
+            return true;
+        }
+        return false;
+    }
+
+    static bool send_frame(_In_ http_socket socket, _In_ websocket_opcode opcode, _In_reads_bytes_(size) const uint8_t* payload, _In_ size_t size)
+    {
+        http_internal_vector<uint8_t> frame;
+        websocket_write_frame(opcode, true, 0, payload, size, nullptr, frame);
+        return http_socket_send_all(socket, frame.data(), frame.size());
+    }
+
+    bool handshake(_In_ http_socket socket, _In_ uint32_t drops, _Inout_ std::vector<uint8_t>& buffer)
+    {
+        static const char headEnd[] = "\r\n\r\n";
+        std::vector<uint8_t>::iterator end;
+        while ((end = std::search(buffer.begin(), buffer.end(), headEnd, headEnd + 4)) == buffer.end())
+        {
+            if (!receive(socket, drops, buffer))
+            {
+                return false;
+            }
+        }
+        while (holdHandshakes && !m_stopping)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        std::string head(buffer.begin(), end);
+        buffer.erase(buffer.begin(), end + 4);
+        std::string lowerHead = head;
+        std::transform(lowerHead.begin(), lowerHead.end(), lowerHead.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+        size_t keyStart = lowerHead.find("sec-websocket-key:");
+        if (keyStart == std::string::npos)
+        {
+            return false;
+        }
+        keyStart = head.find_first_not_of(' ', keyStart + 18);
+        http_internal_string key(head.substr(keyStart, head.find("\r\n", keyStart) - keyStart).c_str());
+
+        std::string response =
+            "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + std::string(websocket_accept_key(key).c_str()) + "\r\n\r\n";
+        http_internal_vector<uint8_t> bytes(response.begin(), response.end());
+        if (!greeting.empty())
+        {
+            websocket_write_frame(websocket_opcode::text, true, 0, reinterpret_cast<const uint8_t*>(greeting.data()), greeting.size(), nullptr, bytes);
+        }
+        return http_socket_send_all(socket, bytes.data(), bytes.size());
+    }
+
+    void serve(_In_ http_socket socket, _In_ uint32_t connection, _In_ uint32_t drops)
+    {
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> message;
+        websocket_opcode messageOpcode = websocket_opcode::text;
+        bool open = handshake(socket, drops, buffer);
+        while (open)
+        {
+            websocket_frame_header header;
+            websocket_parse_result result = websocket_parse_frame_header(buffer.data(), buffer.size(), &header);
+            if (result == websocket_parse_result::invalid || (result == websocket_parse_result::complete && !header.masked))
+            {
+                break;
+            }
+            if (result == websocket_parse_result::incomplete || buffer.size() < header.headerSize + header.payloadLength)
+            {
+                open = receive(socket, drops, buffer);
+                continue;
+            }
+
+            std::vector<uint8_t> payload(buffer.begin() + header.headerSize, buffer.begin() + header.headerSize + static_cast<size_t>(header.payloadLength));
+            buffer.erase(buffer.begin(), buffer.begin() + header.headerSize + static_cast<size_t>(header.payloadLength));
+            websocket_mask(payload.data(), payload.size(), header.maskKey, 0);
+
+            switch (header.opcode)
+            {
+            case websocket_opcode::text:
+            case websocket_opcode::binary:
+            case websocket_opcode::continuation:
+                if (header.opcode != websocket_opcode::continuation)
+                {
+                    messageOpcode = header.opcode;
+                    message.clear();
+                }
+                message.insert(message.end(), payload.begin(), payload.end());
+                if (header.fin)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_lock);
+                        m_receivedMessages[connection].push_back(message);
+                    }
+                    messages++;
+                    open = send_frame(socket, messageOpcode, message.data(), message.size());
+                }
+                break;
+
+            case websocket_opcode::ping:
+                pings++;
+                if (answerPings)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(pongDelayInMilliseconds));
+                    open = send_frame(socket, websocket_opcode::pong, payload.data(), payload.size());
+                }
+                break;
+
+            case websocket_opcode::close:
+                lastCloseStatus = payload.size() >= 2 ? static_cast<uint32_t>((payload[0] << 8) | payload[1]) : 0;
+                closes++;
+                send_frame(socket, websocket_opcode::close, payload.data(), payload.size());
+                open = false;
+                break;
+
+            default:
+                break;
+            }
+        }
+        http_socket_close(socket);
+    }
+
+    http_socket m_listener;
+    uint16_t m_port;
+    std::atomic<bool> m_stopping;
+    std::atomic<uint32_t> m_drops;        // connections accepted before the last drop_connections() close
+    std::thread m_acceptThread;
+    std::vector<std::thread> m_connectionThreads;  // only touched by the accept thread until stop()
+    std::mutex m_lock;
+    std::vector<std::vector<std::vector<uint8_t>>> m_receivedMessages;
+};
+
+// What a WebSocket connected to a loopback_websocket_server has seen
+struct loopback_websocket_events
+{
+    loopback_websocket_events() : completions(0), lastResult(HC_E_FAIL), messages(0), closes(0), lastCloseStatus(HC_WEBSOCKET_CLOSE_NORMAL)
+    {
+    }
+
+    std::atomic<uint32_t> completions;
+    std::atomic<HC_RESULT> lastResult;
+    std::atomic<uint32_t> messages;
+    std::atomic<uint32_t> closes;
+    std::atomic<HC_WEBSOCKET_CLOSE_STATUS> lastCloseStatus;
+    std::mutex lock;
+    std::vector<std::vector<uint8_t>> received;
+    std::vector<bool> receivedBinary;
+};
+
+void LoopbackCompletionRoutine(
+    _In_opt_ void* completionRoutineContext,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_RESULT errorCode,
+    _In_ uint32_t platformErrorCode
+    )
+{
+    auto events = static_cast<loopback_websocket_events*>(completionRoutineContext);
+    events->lastResult = errorCode;
+    events->completions++;
+}
+
+void HC_CALLING_CONV LoopbackMessageCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_z_ PCSTR incomingBodyString,
+    _In_ uint32_t incomingBodySize
+    )
+{
+    auto events = static_cast<loopback_websocket_events*>(context);
+    {
+        std::lock_guard<std::mutex> lock(events->lock);
+        events->received.emplace_back(incomingBodyString, incomingBodyString + incomingBodySize);
+        events->receivedBinary.push_back(false);
+    }
+    events->messages++;
+}
+
+void HC_CALLING_CONV LoopbackBinaryMessageCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_reads_bytes_(payloadSize) const uint8_t* payloadBytes,
+    _In_ uint32_t payloadSize
+    )
+{
+    auto events = static_cast<loopback_websocket_events*>(context);
+    {
+        std::lock_guard<std::mutex> lock(events->lock);
+        events->received.emplace_back(payloadBytes, payloadBytes + payloadSize);
+        events->receivedBinary.push_back(true);
+    }
+    events->messages++;
+}
+
+void HC_CALLING_CONV LoopbackCloseCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_CLOSE_STATUS closeStatus
+    )
+{
+    auto events = static_cast<loopback_websocket_events*>(context);
+    events->lastCloseStatus = closeStatus;
+    events->closes++;
+}
+
+// What a WebSocket with a reconnect policy has reported
+struct loopback_reconnect_events
+{
+    loopback_reconnect_events() : scheduled(0), succeeded(0), lastAttempt(0)
+    {
+    }
+
+    std::atomic<uint32_t> scheduled;
+    std::atomic<uint32_t> succeeded;
+    std::atomic<uint32_t> lastAttempt;
+};
+
+void HC_CALLING_CONV LoopbackReconnectCallback(
+    _In_opt_ void* context,
+    _In_ HC_WEBSOCKET_HANDLE websocket,
+    _In_ HC_WEBSOCKET_RECONNECT_EVENT reconnectEvent,
+    _In_ uint32_t attempt,
+    _In_ uint32_t delayInMilliseconds
+    )
+{
+    auto events = static_cast<loopback_reconnect_events*>(context);
+    events->lastAttempt = attempt;
+    if (reconnectEvent == HC_WEBSOCKET_RECONNECT_SCHEDULED)
+    {
+        events->scheduled++;
+    }
+    else
+    {
+        events->succeeded++;
+    }
+}
+
+// Runs tasks until count reaches expected, for up to five seconds
+static void WaitForLoopbackCount(std::atomic<uint32_t>& count, uint32_t expected)
+{
+    for (uint32_t i = 0; i < 500 && count < expected; i++)
+    {
+        HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME);
+        HCTaskProcessNextCompletedTask(HC_SUBSYSTEM_ID_GAME, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// Routes WebSockets to the native implementation and connects one to the server
+static HC_WEBSOCKET_HANDLE ConnectToLoopbackServer(loopback_websocket_server& server, loopback_websocket_events& events)
+{
+    VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(HCWebSocketNativeConnect, HCWebSocketNativeSendMessage, HCWebSocketNativeDisconnect));
+    VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketSendBinaryMessageFunction(HCWebSocketNativeSendBinaryMessage));
+
+    HC_WEBSOCKET_HANDLE websocket = nullptr;
+    VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+    VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(websocket, LoopbackMessageCallback, LoopbackBinaryMessageCallback, LoopbackCloseCallback, &events));
+    uint32_t completions = events.completions;
+    VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect(server.uri().c_str(), "", websocket, HC_SUBSYSTEM_ID_GAME, 0, &events, LoopbackCompletionRoutine));
+    WaitForLoopbackCount(events.completions, completions + 1);
+    VERIFY_ARE_EQUAL(completions + 1, events.completions);
+    VERIFY_ARE_EQUAL(HC_OK, events.lastResult);
+    return websocket;
+}
+
 DEFINE_TEST_CLASS(WebsocketTests)
 {
 public:
@@ -203,6 +695,245 @@ public:
     }
 
 
+    DEFINE_TEST_CASE(TestBinaryMessages)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestBinaryMessages);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+
+        HC_WEBSOCKET_BINARY_MESSAGE_FUNC binaryMessageFunc = PerformBinaryMessageCallback;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetBinaryMessageFunction(&binaryMessageFunc));
+        VERIFY_IS_NULL(binaryMessageFunc);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetBinaryMessageFunction(PerformBinaryMessageCallback));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetBinaryMessageFunction(&binaryMessageFunc));
+        VERIFY_IS_TRUE(binaryMessageFunc == PerformBinaryMessageCallback);
+
+        HC_WEBSOCKET_SEND_BINARY_MESSAGE_FUNC sendBinaryMessageFunc = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetWebSocketSendBinaryMessageFunction(&sendBinaryMessageFunc));
+        VERIFY_IS_NOT_NULL(sendBinaryMessageFunc);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketSendBinaryMessageFunction(Test_Internal_HCWebSocketSendBinaryMessage));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalGetWebSocketSendBinaryMessageFunction(&sendBinaryMessageFunc));
+        VERIFY_IS_TRUE(sendBinaryMessageFunc == Test_Internal_HCWebSocketSendBinaryMessage);
+
+        HC_WEBSOCKET_HANDLE websocket;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+
+        // Embedded NULs make it through
+        const uint8_t payload[] = { 0x01, 0x00, 0xff, 0x00, 0x7f };
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendBinaryMessage(websocket, payload, sizeof(payload), HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(sizeof(payload), g_HCWebSocketSendBinaryMessage_Payload.size());
+        VERIFY_IS_TRUE(memcmp(payload, g_HCWebSocketSendBinaryMessage_Payload.data(), sizeof(payload)) == 0);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendBinaryMessage(websocket, nullptr, 0, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(0, g_HCWebSocketSendBinaryMessage_Payload.size());
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketSendBinaryMessage(websocket, nullptr, 1, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestHandleFunctions)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestHandleFunctions);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(Test_Internal_HCWebSocketConnect, Test_Internal_HCWebSocketSendMessage, Test_Internal_HCWebSocketDisconnect));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetFunctions(PerformMessageCallback, PerformCloseCallback));
+
+        HC_WEBSOCKET_HANDLE owned;
+        HC_WEBSOCKET_HANDLE shared;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&owned));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&shared));
+
+        handle_function_calls calls = {};
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(owned, PerformHandleMessageCallback, nullptr, PerformHandleCloseCallback, &calls));
+        HC_WEBSOCKET_HANDLE_MESSAGE_FUNC messageFunc = nullptr;
+        HC_WEBSOCKET_HANDLE_BINARY_MESSAGE_FUNC binaryMessageFunc = PerformHandleBinaryMessageCallback;
+        void* context = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetHandleFunctions(owned, &messageFunc, &binaryMessageFunc, nullptr, &context));
+        VERIFY_IS_TRUE(messageFunc == PerformHandleMessageCallback);
+        VERIFY_IS_NULL(binaryMessageFunc);
+        VERIFY_IS_TRUE(context == &calls);
+
+        // Without a binary message function, binary messages go to the message function with their size
+        const uint8_t payload[] = { 'a', 0x00, 'b', 0x00 };
+        HC_WEBSOCKET_BUFFER* text = owned->bufferPool->acquire();
+        HC_WEBSOCKET_BUFFER* binary = owned->bufferPool->acquire();
+        text->bytes.assign(payload, payload + 2);
+        binary->bytes.assign(payload, payload + 4);
+        g_PerformMessageCallbackCalled = false;
+        Internal_HCWebSocketRaiseMessage(owned, false, text);
+        Internal_HCWebSocketRaiseMessage(owned, true, binary);
+        VERIFY_ARE_EQUAL(2, calls.messages);
+        VERIFY_ARE_EQUAL(3, calls.lastSize);
+        VERIFY_IS_FALSE(g_PerformMessageCallbackCalled);
+        Internal_HCWebSocketRaiseMessage(shared, false, text);
+        VERIFY_IS_TRUE(g_PerformMessageCallbackCalled);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(owned, PerformHandleMessageCallback, PerformHandleBinaryMessageCallback, PerformHandleCloseCallback, &calls));
+        Internal_HCWebSocketRaiseMessage(owned, true, binary);
+        VERIFY_ARE_EQUAL(1, calls.binaryMessages);
+        websocket_buffer_pool::release(text);
+        websocket_buffer_pool::release(binary);
+
+        g_PerformCloseCallbackCalled = false;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect("test", "", owned, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_CONNECTALREADYCALLED, HCWebSocketSetHandleFunctions(owned, nullptr, nullptr, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(owned));
+        VERIFY_ARE_EQUAL(1, calls.closes);
+        VERIFY_IS_FALSE(g_PerformCloseCallbackCalled);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(shared));
+        VERIFY_IS_TRUE(g_PerformCloseCallbackCalled);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(owned));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(shared));
+        HCGlobalCleanup();
+    }
+
+
+    DEFINE_TEST_CASE(TestMessageBuffers)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestMessageBuffers);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        HC_WEBSOCKET_HANDLE websocket;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+
+        HC_WEBSOCKET_BUFFER_HANDLE retained = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(websocket, PerformRetainMessageCallback, nullptr, nullptr, &retained));
+
+        // Retaining only works while a message is being passed to a message function
+        HC_WEBSOCKET_BUFFER_HANDLE buffer = nullptr;
+        VERIFY_ARE_EQUAL(HC_E_FAIL, HCWebSocketRetainMessageBuffer(websocket, &buffer));
+
+        HC_WEBSOCKET_BUFFER* received = websocket->bufferPool->acquire();
+        const char message[] = "retained";
+        received->bytes.assign(message, message + sizeof(message));
+        Internal_HCWebSocketRaiseMessage(websocket, false, received);
+        VERIFY_IS_TRUE(retained == received);
+        websocket_buffer_pool::release(received);
+
+        // The retained message outlives the receive path's reference and the handle
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        const uint8_t* bytes = nullptr;
+        uint32_t size = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetMessageBufferBytes(retained, &bytes, &size));
+        VERIFY_ARE_EQUAL(sizeof(message) - 1, size);
+        VERIFY_IS_TRUE(memcmp(message, bytes, sizeof(message)) == 0);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketReleaseMessageBuffer(retained));
+
+        // Released buffers are reused
+        auto pool = http_allocate_shared<websocket_buffer_pool>();
+        HC_WEBSOCKET_BUFFER* first = pool->acquire();
+        first->bytes.assign(100, 'x');
+        websocket_buffer_pool::release(first);
+        HC_WEBSOCKET_BUFFER* second = pool->acquire();
+        VERIFY_IS_TRUE(first == second);
+        VERIFY_ARE_EQUAL(0, second->bytes.size());
+        VERIFY_IS_TRUE(second->bytes.capacity() >= 100);
+        websocket_buffer_pool::release(second);
+
+        HCGlobalCleanup();
+    }
+
+
+    DEFINE_TEST_CASE(TestKeepAlive)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestKeepAlive);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(Test_Internal_HCWebSocketConnect, Test_Internal_HCWebSocketSendMessage, Test_Internal_HCWebSocketDisconnect));
+        HC_WEBSOCKET_HANDLE websocket;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketSetKeepAlive(nullptr, 15, 10));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetKeepAlive(websocket, 15, 10));
+        VERIFY_ARE_EQUAL(15, websocket->pingIntervalInSeconds);
+        VERIFY_ARE_EQUAL(10, websocket->pongTimeoutInSeconds);
+
+        // Nothing is measured before the first pong
+        uint32_t roundTripTime = 1;
+        uint32_t smoothed = 1;
+        uint32_t minimum = 1;
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketGetRoundTripTime(websocket, &roundTripTime, nullptr, &minimum));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetRoundTripTime(websocket, &roundTripTime, &smoothed, &minimum));
+        VERIFY_ARE_EQUAL(0, roundTripTime);
+        VERIFY_ARE_EQUAL(0, smoothed);
+        VERIFY_ARE_EQUAL(0, minimum);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect("test", "", websocket, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_CONNECTALREADYCALLED, HCWebSocketSetKeepAlive(websocket, 0, 0));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        HCGlobalCleanup();
+    }
+
+
+    DEFINE_TEST_CASE(TestReconnectPolicy)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestReconnectPolicy);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(Test_Internal_HCWebSocketConnect, Test_Internal_HCWebSocketSendMessage, Test_Internal_HCWebSocketDisconnect));
+        HC_WEBSOCKET_HANDLE websocket;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketSetReconnectPolicy(nullptr, 5, 500, 30000, true, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketSetReconnectPolicy(websocket, 5, 0, 30000, true, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketSetReconnectPolicy(websocket, 5, 500, 400, true, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetReconnectPolicy(websocket, 0, 0, 0, false, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetReconnectPolicy(websocket, 5, 500, 30000, true, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(5, websocket->reconnectMaxAttempts);
+        VERIFY_ARE_EQUAL(500, websocket->reconnectInitialDelayInMilliseconds);
+        VERIFY_ARE_EQUAL(30000, websocket->reconnectMaxDelayInMilliseconds);
+        VERIFY_IS_TRUE(websocket->reconnectReplay);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect("test", "", websocket, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_E_CONNECTALREADYCALLED, HCWebSocketSetReconnectPolicy(websocket, 0, 0, 0, false, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+
+        // The longest delay doubles with each attempt up to the cap, and any delay below it can be picked
+        VERIFY_ARE_EQUAL(500, websocket_reconnect_delay(1, 500, 30000, 500));
+        VERIFY_ARE_EQUAL(0, websocket_reconnect_delay(1, 500, 30000, 501));
+        VERIFY_ARE_EQUAL(2000, websocket_reconnect_delay(3, 500, 30000, 2000));
+        VERIFY_ARE_EQUAL(30000, websocket_reconnect_delay(10, 500, 30000, 30000));
+        VERIFY_ARE_EQUAL(0, websocket_reconnect_delay(10, 500, 30000, 30001));
+        VERIFY_ARE_EQUAL(0, websocket_reconnect_delay(4, 500, 30000, 0));
+        for (uint32_t attempt = 1; attempt < 40; attempt++)
+        {
+            VERIFY_IS_TRUE(websocket_reconnect_delay(attempt, 500, 30000, 0xffffffff) <= 30000);
+        }
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        HCGlobalCleanup();
+    }
+
+
+    DEFINE_TEST_CASE(TestBroadcast)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestBroadcast);
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(Test_Internal_HCWebSocketConnect, Test_Internal_HCWebSocketSendMessage, Test_Internal_HCWebSocketDisconnect));
+        HC_WEBSOCKET_HANDLE websockets[2];
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websockets[0]));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websockets[1]));
+
+        const uint8_t payload[] = { 1, 2, 3 };
+        const HC_WEBSOCKET_HANDLE withNull[] = { websockets[0], nullptr };
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketBroadcast(nullptr, 2, payload, sizeof(payload), nullptr));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketBroadcast(websockets, 2, nullptr, sizeof(payload), nullptr));
+        VERIFY_ARE_EQUAL(HC_E_INVALIDARG, HCWebSocketBroadcast(withNull, 2, payload, sizeof(payload), nullptr));
+
+        // WebSockets that aren't open native connections are skipped
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect("test", "", websockets[0], HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        uint32_t queuedCount = 1;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketBroadcast(websockets, 2, payload, sizeof(payload), &queuedCount));
+        VERIFY_ARE_EQUAL(0, queuedCount);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketBroadcast(websockets, 0, nullptr, 0, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websockets[0]));
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websockets[0]));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websockets[1]));
+        HCGlobalCleanup();
+    }
+
+
     DEFINE_TEST_CASE(TestRequestHeaders)
     {
         DEFINE_TEST_CASE_PROPERTIES(TestRequestHeaders);
@@ -250,6 +981,568 @@ public:
         HCGlobalCleanup();
     }
 
+
+    DEFINE_TEST_CASE(TestFrameCodec)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestFrameCodec);
+
+        // RFC 6455 1.3
+        VERIFY_ARE_EQUAL_STR("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", websocket_accept_key("dGhlIHNhbXBsZSBub25jZQ==").c_str());
+
+        // RFC 6455 5.7: a masked "Hello" from a client
+        const uint8_t maskKey[] = { 0x37, 0xfa, 0x21, 0x3d };
+        const uint8_t expected[] = { 0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58 };
+        http_internal_vector<uint8_t> frame;
+        websocket_write_frame(websocket_opcode::text, true, 0, reinterpret_cast<const uint8_t*>("Hello"), 5, maskKey, frame);
+        VERIFY_ARE_EQUAL(sizeof(expected), frame.size());
+        VERIFY_IS_TRUE(memcmp(expected, frame.data(), frame.size()) == 0);
+
+        websocket_frame_header header;
+        VERIFY_IS_TRUE(websocket_parse_frame_header(frame.data(), 5, &header) == websocket_parse_result::incomplete);
+        VERIFY_IS_TRUE(websocket_parse_frame_header(frame.data(), frame.size(), &header) == websocket_parse_result::complete);
+        VERIFY_IS_TRUE(header.fin);
+        VERIFY_IS_TRUE(header.masked);
+        VERIFY_ARE_EQUAL(5, header.payloadLength);
+        VERIFY_ARE_EQUAL(6, header.headerSize);
+        websocket_mask(frame.data() + header.headerSize, 5, header.maskKey, 0);
+        VERIFY_IS_TRUE(memcmp("Hello", frame.data() + header.headerSize, 5) == 0);
+
+        // 64 bit lengths
+        http_internal_vector<uint8_t> payload(70000, 'x');
+        frame.clear();
+        websocket_write_frame(websocket_opcode::binary, false, 0, payload.data(), payload.size(), nullptr, frame);
+        VERIFY_IS_TRUE(websocket_parse_frame_header(frame.data(), frame.size(), &header) == websocket_parse_result::complete);
+        VERIFY_IS_FALSE(header.fin);
+        VERIFY_ARE_EQUAL(70000, header.payloadLength);
+        VERIFY_ARE_EQUAL(10, header.headerSize);
+
+        // Control frames can't be fragmented or longer than 125 bytes, and opcode 3 is reserved
+        const uint8_t fragmentedPing[] = { 0x09, 0x00 };
+        const uint8_t longClose[] = { 0x88, 0x7e, 0x00, 0x7e };
+        const uint8_t reserved[] = { 0x83, 0x00 };
+        VERIFY_IS_TRUE(websocket_parse_frame_header(fragmentedPing, sizeof(fragmentedPing), &header) == websocket_parse_result::invalid);
+        VERIFY_IS_TRUE(websocket_parse_frame_header(longClose, sizeof(longClose), &header) == websocket_parse_result::invalid);
+        VERIFY_IS_TRUE(websocket_parse_frame_header(reserved, sizeof(reserved), &header) == websocket_parse_result::invalid);
+
+        const uint8_t valid[] = { 'a', 0xc3, 0xa9, 0xe2, 0x82, 0xac, 0xf0, 0x9f, 0x98, 0x80 };
+        const uint8_t overlong[] = { 0xc0, 0xaf };
+        const uint8_t surrogate[] = { 0xed, 0xa0, 0x80 };
+        const uint8_t truncated[] = { 0xe2, 0x82 };
+        VERIFY_IS_TRUE(websocket_is_valid_utf8(valid, sizeof(valid)));
+        VERIFY_IS_FALSE(websocket_is_valid_utf8(overlong, sizeof(overlong)));
+        VERIFY_IS_FALSE(websocket_is_valid_utf8(surrogate, sizeof(surrogate)));
+        VERIFY_IS_FALSE(websocket_is_valid_utf8(truncated, sizeof(truncated)));
+    }
+
+
+    DEFINE_TEST_CASE(TestGatheredSend)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestGatheredSend);
+
+        VERIFY_IS_TRUE(http_socket_startup());
+        http_socket listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        VERIFY_IS_TRUE(listener != HTTP_INVALID_SOCKET);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        VERIFY_ARE_EQUAL(0, bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+        VERIFY_ARE_EQUAL(0, listen(listener, 1));
+        socklen_t addressLength = sizeof(address);
+        VERIFY_ARE_EQUAL(0, getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength));
+        http_socket client = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        VERIFY_ARE_EQUAL(0, connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+        http_socket server = accept(listener, nullptr, nullptr);
+        VERIFY_IS_TRUE(server != HTTP_INVALID_SOCKET);
+
+        // Frames whose payloads are masked in place and gathered with their headers arrive the
+        // same as frames written out whole
+        const uint8_t maskKey[] = { 0x37, 0xfa, 0x21, 0x3d };
+        PCSTR messages[] = { "Hello", "", "a somewhat longer message" };
+        http_internal_vector<uint8_t> expected;
+        http_internal_vector<uint8_t> payloads[3];
+        uint8_t headers[3][WEBSOCKET_MAX_FRAME_HEADER_SIZE];
+        http_socket_buffer buffers[6];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            size_t size = strlen(messages[i]);
+            websocket_write_frame(websocket_opcode::text, true, 0, reinterpret_cast<const uint8_t*>(messages[i]), size, maskKey, expected);
+
+            payloads[i].assign(messages[i], messages[i] + size);
+            websocket_mask(payloads[i].data(), size, maskKey, 0);
+            buffers[i * 2].data = headers[i];
+            buffers[i * 2].size = websocket_write_frame_header(websocket_opcode::text, true, 0, size, maskKey, headers[i]);
+            buffers[i * 2 + 1].data = payloads[i].data();
+            buffers[i * 2 + 1].size = size;
+        }
+        VERIFY_ARE_EQUAL(static_cast<int>(expected.size()), http_socket_send_buffers(client, buffers, 6));
+
+        http_internal_vector<uint8_t> received(expected.size());
+        size_t receivedSize = 0;
+        while (receivedSize < received.size())
+        {
+            int count = http_socket_receive(server, received.data() + receivedSize, received.size() - receivedSize);
+            VERIFY_IS_TRUE(count > 0);
+            receivedSize += static_cast<size_t>(count);
+        }
+        VERIFY_IS_TRUE(received == expected);
+
+        http_socket_close(server);
+        http_socket_close(client);
+        http_socket_close(listener);
+        http_socket_cleanup();
+    }
+
+    DEFINE_TEST_CASE(TestNativeEcho)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestNativeEcho);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        loopback_websocket_server server;
+        VERIFY_IS_TRUE(server.start());
+        loopback_websocket_events events;
+        HC_WEBSOCKET_HANDLE websocket = ConnectToLoopbackServer(server, events);
+        VERIFY_ARE_EQUAL(1, server.connections);
+
+        // The server echoes each message back with the same type
+        const char text[] = "Hello, caf\xc3\xa9";
+        const uint8_t binary[] = { 0x00, 0xff, 0x80, 0x7f, 0x00, 0x01 };
+        std::vector<uint8_t> large(70000);
+        for (size_t i = 0; i < large.size(); ++i)
+        {
+            large[i] = static_cast<uint8_t>(i * 31);
+        }
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendMessage(websocket, text, HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendBinaryMessage(websocket, binary, sizeof(binary), HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendBinaryMessage(websocket, large.data(), static_cast<uint32_t>(large.size()), HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        WaitForLoopbackCount(events.messages, 3);
+        VERIFY_ARE_EQUAL(3, events.messages);
+        {
+            std::lock_guard<std::mutex> lock(events.lock);
+            VERIFY_IS_TRUE(events.received[0] == std::vector<uint8_t>(text, text + sizeof(text) - 1));
+            VERIFY_IS_FALSE(events.receivedBinary[0]);
+            VERIFY_IS_TRUE(events.received[1] == std::vector<uint8_t>(binary, binary + sizeof(binary)));
+            VERIFY_IS_TRUE(events.receivedBinary[1]);
+            VERIFY_IS_TRUE(events.received[2] == large);
+            VERIFY_IS_TRUE(events.receivedBinary[2]);
+        }
+
+        // Disconnecting sends a close frame that the server answers
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+        VERIFY_ARE_EQUAL(1, events.closes);
+        VERIFY_ARE_EQUAL(HC_WEBSOCKET_CLOSE_NORMAL, events.lastCloseStatus);
+        WaitForLoopbackCount(server.closes, 1);
+        VERIFY_ARE_EQUAL(1, server.closes);
+        VERIFY_ARE_EQUAL(HC_WEBSOCKET_CLOSE_NORMAL, server.lastCloseStatus);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        server.stop();
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestNativeGreeting)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestNativeGreeting);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        loopback_websocket_server server;
+        server.greeting = "Welcome";
+        VERIFY_IS_TRUE(server.start());
+
+        // The greeting arrives with the 101 and the server then waits, so the socket never becomes
+        // readable again.  It has to be parsed from what the handshake read.
+        loopback_websocket_events events;
+        HC_WEBSOCKET_HANDLE websocket = ConnectToLoopbackServer(server, events);
+        WaitForLoopbackCount(events.messages, 1);
+        VERIFY_ARE_EQUAL(1, events.messages);
+        {
+            std::lock_guard<std::mutex> lock(events.lock);
+            VERIFY_IS_TRUE(events.received[0] == std::vector<uint8_t>(server.greeting.begin(), server.greeting.end()));
+            VERIFY_IS_FALSE(events.receivedBinary[0]);
+        }
+
+        // The connection carries on from there
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendMessage(websocket, "ready", HC_SUBSYSTEM_ID_GAME, 0, nullptr, nullptr));
+        WaitForLoopbackCount(events.messages, 2);
+        VERIFY_ARE_EQUAL(2, events.messages);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+        WaitForLoopbackCount(server.closes, 1);
+        VERIFY_ARE_EQUAL(1, server.closes);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        server.stop();
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestNativeKeepAlive)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestNativeKeepAlive);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(HCWebSocketNativeConnect, HCWebSocketNativeSendMessage, HCWebSocketNativeDisconnect));
+
+        // A server that answers is pinged every second and its round trip time measured
+        loopback_websocket_server server;
+        server.pongDelayInMilliseconds = 50;
+        VERIFY_IS_TRUE(server.start());
+        loopback_websocket_events events;
+        HC_WEBSOCKET_HANDLE websocket = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetKeepAlive(websocket, 1, 1));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(websocket, LoopbackMessageCallback, LoopbackBinaryMessageCallback, LoopbackCloseCallback, &events));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect(server.uri().c_str(), "", websocket, HC_SUBSYSTEM_ID_GAME, 0, &events, LoopbackCompletionRoutine));
+        WaitForLoopbackCount(events.completions, 1);
+        VERIFY_ARE_EQUAL(HC_OK, events.lastResult);
+
+        uint32_t roundTripTime = 0;
+        uint32_t smoothed = 0;
+        uint32_t minimum = 0;
+        for (uint32_t i = 0; i < 500 && roundTripTime == 0; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetRoundTripTime(websocket, &roundTripTime, &smoothed, &minimum));
+        }
+        VERIFY_IS_TRUE(server.pings >= 1);
+        VERIFY_IS_TRUE(roundTripTime >= 50 && roundTripTime < 1000);
+        VERIFY_ARE_EQUAL(roundTripTime, smoothed);
+        VERIFY_ARE_EQUAL(roundTripTime, minimum);
+
+        // It stays open past the pong timeout
+        WaitForLoopbackCount(server.pings, 2);
+        VERIFY_IS_TRUE(server.pings >= 2);
+        VERIFY_ARE_EQUAL(0, events.closes);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        server.stop();
+
+        // A server that goes quiet is closed once the pong timeout passes after a ping
+        loopback_websocket_server silentServer;
+        silentServer.answerPings = false;
+        VERIFY_IS_TRUE(silentServer.start());
+        loopback_websocket_events silentEvents;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetKeepAlive(websocket, 1, 1));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(websocket, LoopbackMessageCallback, LoopbackBinaryMessageCallback, LoopbackCloseCallback, &silentEvents));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect(silentServer.uri().c_str(), "", websocket, HC_SUBSYSTEM_ID_GAME, 0, &silentEvents, LoopbackCompletionRoutine));
+        WaitForLoopbackCount(silentEvents.completions, 1);
+        VERIFY_ARE_EQUAL(HC_OK, silentEvents.lastResult);
+
+        WaitForLoopbackCount(silentEvents.closes, 1);
+        VERIFY_ARE_EQUAL(1, silentEvents.closes);
+        VERIFY_ARE_EQUAL(HC_WEBSOCKET_CLOSE_ABNORMAL_CLOSE, silentEvents.lastCloseStatus);
+        VERIFY_ARE_EQUAL(1, silentServer.pings);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketGetRoundTripTime(websocket, &roundTripTime, &smoothed, &minimum));
+        VERIFY_ARE_EQUAL(0, roundTripTime);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        silentServer.stop();
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestNativeReconnect)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestNativeReconnect);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketFunctions(HCWebSocketNativeConnect, HCWebSocketNativeSendMessage, HCWebSocketNativeDisconnect));
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalSetWebSocketSendBinaryMessageFunction(HCWebSocketNativeSendBinaryMessage));
+        loopback_websocket_server server;
+        VERIFY_IS_TRUE(server.start());
+
+        loopback_websocket_events events;
+        loopback_reconnect_events reconnectEvents;
+        HC_WEBSOCKET_HANDLE websocket = nullptr;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websocket));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetReconnectPolicy(websocket, 3, 100, 100, true, LoopbackReconnectCallback, &reconnectEvents));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSetHandleFunctions(websocket, LoopbackMessageCallback, LoopbackBinaryMessageCallback, LoopbackCloseCallback, &events));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketConnect(server.uri().c_str(), "", websocket, HC_SUBSYSTEM_ID_GAME, 0, &events, LoopbackCompletionRoutine));
+        WaitForLoopbackCount(events.completions, 1);
+        VERIFY_ARE_EQUAL(HC_OK, events.lastResult);
+
+        // The server drops the connection and holds the reconnect's handshake, so messages sent
+        // meanwhile wait for the new connection
+        server.holdHandshakes = true;
+        server.drop_connections();
+        WaitForLoopbackCount(reconnectEvents.scheduled, 1);
+        VERIFY_ARE_EQUAL(1, reconnectEvents.scheduled);
+        VERIFY_ARE_EQUAL(1, reconnectEvents.lastAttempt);
+        VERIFY_ARE_EQUAL(0, events.closes);
+
+        const char text[] = "sent while reconnecting";
+        const uint8_t binary[] = { 0x00, 0xff, 0x80, 0x7f };
+        loopback_websocket_events sendEvents;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendMessage(websocket, text, HC_SUBSYSTEM_ID_GAME, 0, &sendEvents, LoopbackCompletionRoutine));
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketSendBinaryMessage(websocket, binary, sizeof(binary), HC_SUBSYSTEM_ID_GAME, 0, &sendEvents, LoopbackCompletionRoutine));
+        HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME);
+        HCTaskProcessNextPendingTask(HC_SUBSYSTEM_ID_GAME);
+        WaitForLoopbackCount(server.connections, 2);
+        VERIFY_ARE_EQUAL(2, server.connections);
+        VERIFY_ARE_EQUAL(0, reconnectEvents.succeeded);
+        VERIFY_ARE_EQUAL(0, sendEvents.completions);
+
+        // Once the handshake is answered both are replayed in order, and each echo comes back
+        server.holdHandshakes = false;
+        WaitForLoopbackCount(reconnectEvents.succeeded, 1);
+        VERIFY_ARE_EQUAL(1, reconnectEvents.succeeded);
+        VERIFY_ARE_EQUAL(1, reconnectEvents.lastAttempt);
+        WaitForLoopbackCount(sendEvents.completions, 2);
+        VERIFY_ARE_EQUAL(2, sendEvents.completions);
+        VERIFY_ARE_EQUAL(HC_OK, sendEvents.lastResult);
+        WaitForLoopbackCount(events.messages, 2);
+        VERIFY_ARE_EQUAL(2, events.messages);
+
+        VERIFY_IS_TRUE(server.received_messages(0).empty());
+        auto replayed = server.received_messages(1);
+        VERIFY_ARE_EQUAL(2, replayed.size());
+        VERIFY_IS_TRUE(replayed[0] == std::vector<uint8_t>(text, text + sizeof(text) - 1));
+        VERIFY_IS_TRUE(replayed[1] == std::vector<uint8_t>(binary, binary + sizeof(binary)));
+        {
+            std::lock_guard<std::mutex> lock(events.lock);
+            VERIFY_IS_FALSE(events.receivedBinary[0]);
+            VERIFY_IS_TRUE(events.receivedBinary[1]);
+        }
+
+        // Only the app's own disconnect raises the close event
+        VERIFY_ARE_EQUAL(0, events.closes);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websocket));
+        VERIFY_ARE_EQUAL(1, events.closes);
+        VERIFY_ARE_EQUAL(HC_WEBSOCKET_CLOSE_NORMAL, events.lastCloseStatus);
+        VERIFY_ARE_EQUAL(1, reconnectEvents.scheduled);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        server.stop();
+        HCGlobalCleanup();
+    }
+
+    DEFINE_TEST_CASE(TestNativeBroadcast)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestNativeBroadcast);
+
+        VERIFY_ARE_EQUAL(HC_OK, HCGlobalInitialize());
+        loopback_websocket_server server;
+        VERIFY_IS_TRUE(server.start());
+        loopback_websocket_events events[2];
+        HC_WEBSOCKET_HANDLE websockets[3];
+        websockets[0] = ConnectToLoopbackServer(server, events[0]);
+        websockets[1] = ConnectToLoopbackServer(server, events[1]);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCreate(&websockets[2]));
+        VERIFY_ARE_EQUAL(2, server.connections);
+
+        // Both connections write the one masked frame, which the server unmasks to the same
+        // payload on each; the WebSocket that never connected is skipped
+        const uint8_t small[] = { 0x00, 0xff, 0x80, 0x7f, 0x01 };
+        std::vector<uint8_t> large(70000);
+        for (size_t i = 0; i < large.size(); ++i)
+        {
+            large[i] = static_cast<uint8_t>(i * 31);
+        }
+        uint32_t queuedCount = 0;
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketBroadcast(websockets, 3, small, sizeof(small), &queuedCount));
+        VERIFY_ARE_EQUAL(2, queuedCount);
+        VERIFY_ARE_EQUAL(HC_OK, HCWebSocketBroadcast(websockets, 3, large.data(), static_cast<uint32_t>(large.size()), &queuedCount));
+        VERIFY_ARE_EQUAL(2, queuedCount);
+        WaitForLoopbackCount(server.messages, 4);
+        VERIFY_ARE_EQUAL(4, server.messages);
+        for (uint32_t connection = 0; connection < 2; ++connection)
+        {
+            auto received = server.received_messages(connection);
+            VERIFY_ARE_EQUAL(2, received.size());
+            VERIFY_IS_TRUE(received[0] == std::vector<uint8_t>(small, small + sizeof(small)));
+            VERIFY_IS_TRUE(received[1] == large);
+        }
+
+        // And each gets its echoes back as binary messages
+        for (auto& connectionEvents : events)
+        {
+            WaitForLoopbackCount(connectionEvents.messages, 2);
+            VERIFY_ARE_EQUAL(2, connectionEvents.messages);
+            std::lock_guard<std::mutex> lock(connectionEvents.lock);
+            VERIFY_IS_TRUE(connectionEvents.receivedBinary[0]);
+            VERIFY_IS_TRUE(connectionEvents.received[1] == large);
+        }
+
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCWebSocketDisconnect(websockets[i]));
+        }
+        WaitForLoopbackCount(server.closes, 2);
+        VERIFY_ARE_EQUAL(2, server.closes);
+        for (auto websocket : websockets)
+        {
+            VERIFY_ARE_EQUAL(HC_OK, HCWebSocketCloseHandle(websocket));
+        }
+        server.stop();
+        HCGlobalCleanup();
+    }
+
+
+    DEFINE_TEST_CASE(TestPermessageDeflate)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestPermessageDeflate);
+
+        websocket_deflate_params offer = { 15, 15, false, false };
+        websocket_deflate_params accepted;
+        VERIFY_IS_TRUE(websocket_deflate_parse_response("permessage-deflate", offer, &accepted));
+        VERIFY_IS_TRUE(websocket_deflate_parse_response("Permessage-Deflate; server_max_window_bits=\"10\"; client_no_context_takeover", offer, &accepted));
+        VERIFY_ARE_EQUAL(10, accepted.serverMaxWindowBits);
+        VERIFY_IS_TRUE(accepted.clientNoContextTakeover);
+        VERIFY_IS_FALSE(websocket_deflate_parse_response("permessage-deflate; server_max_window_bits=16", offer, &accepted));
+        VERIFY_IS_FALSE(websocket_deflate_parse_response("permessage-deflate; server_no_context_takeover; server_no_context_takeover", offer, &accepted));
+        VERIFY_IS_FALSE(websocket_deflate_parse_response("permessage-deflate; unknown", offer, &accepted));
+        VERIFY_IS_FALSE(websocket_deflate_parse_response("x-webkit-deflate-frame", offer, &accepted));
+        offer.clientMaxWindowBits = 12;
+        VERIFY_IS_FALSE(websocket_deflate_parse_response("permessage-deflate; client_max_window_bits=15", offer, &accepted));
+        VERIFY_IS_TRUE(websocket_deflate_parse_response("permessage-deflate; client_max_window_bits=9", offer, &accepted));
+        VERIFY_ARE_EQUAL(9, accepted.clientMaxWindowBits);
+
+        uint32_t windowBits = 0;
+        VERIFY_IS_TRUE(websocket_deflate_fit_window(15, 0, &windowBits));
+        VERIFY_ARE_EQUAL(15, windowBits);
+        VERIFY_IS_TRUE(websocket_deflate_fit_window(15, 64 * 1024, &windowBits));
+        VERIFY_IS_TRUE(websocket_deflate_memory_size(windowBits) <= 64 * 1024);
+        VERIFY_IS_FALSE(websocket_deflate_fit_window(15, 1024, &windowBits));
+
+        // RFC 7692 7.2.3.2: "Hello" twice with context takeover, the second as a back reference
+        websocket_deflate_params params = { 15, 15, false, false };
+        websocket_deflate deflate(params, HC_COMPRESSION_LEVEL_MEDIUM);
+        const uint8_t hello1[] = { 0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00 };
+        const uint8_t hello2[] = { 0xf2, 0x00, 0x11, 0x00, 0x00 };
+        http_internal_vector<uint8_t> message;
+        VERIFY_ARE_EQUAL(HC_OK, deflate.decompress(hello1, sizeof(hello1), true, 1024, message));
+        VERIFY_ARE_EQUAL(5, message.size());
+        VERIFY_IS_TRUE(memcmp("Hello", message.data(), 5) == 0);
+        message.clear();
+        VERIFY_ARE_EQUAL(HC_OK, deflate.decompress(hello2, sizeof(hello2), true, 1024, message));
+        VERIFY_ARE_EQUAL(5, message.size());
+        VERIFY_IS_TRUE(memcmp("Hello", message.data(), 5) == 0);
+
+        // And what we send matches: "Hello" as in RFC 7692 7.2.3.1, then a message with bytes past
+        // 0x7f, whose literals take 9 bit codes, checked with zlib
+        websocket_deflate encoder(params, HC_COMPRESSION_LEVEL_MEDIUM);
+        const uint8_t utf8Hello[] = { 0xca, 0x38, 0xbc, 0x12, 0x48, 0x02, 0x00 };
+        message.assign({ 'H', 'e', 'l', 'l', 'o' });
+        VERIFY_ARE_EQUAL(HC_OK, encoder.compress(message));
+        VERIFY_ARE_EQUAL(sizeof(hello1), message.size());
+        VERIFY_IS_TRUE(memcmp(hello1, message.data(), message.size()) == 0);
+        message.assign({ 'h', 0xc3, 0xa9, 'l', 'l', 'o' });
+        VERIFY_ARE_EQUAL(HC_OK, encoder.compress(message));
+        VERIFY_ARE_EQUAL(sizeof(utf8Hello), message.size());
+        VERIFY_IS_TRUE(memcmp(utf8Hello, message.data(), message.size()) == 0);
+
+        // What we send decompresses back, split across frames, and later messages get smaller
+        websocket_deflate sender(params, HC_COMPRESSION_LEVEL_MEDIUM);
+        websocket_deflate receiver(params, HC_COMPRESSION_LEVEL_MEDIUM);
+        const char json[] = "{\"presence\":{\"userId\":\"2814639011617876\",\"state\":\"online\",\"title\":\"Game\"}}";
+        size_t firstSize = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            http_internal_vector<uint8_t> payload(json, json + sizeof(json) - 1);
+            VERIFY_ARE_EQUAL(HC_OK, sender.compress(payload));
+            if (i == 0)
+            {
+                firstSize = payload.size();
+            }
+            else
+            {
+                VERIFY_IS_TRUE(payload.size() < firstSize / 4);
+            }
+
+            message.clear();
+            size_t half = payload.size() / 2;
+            VERIFY_ARE_EQUAL(HC_OK, receiver.decompress(payload.data(), half, false, 1024, message));
+            VERIFY_ARE_EQUAL(HC_OK, receiver.decompress(payload.data() + half, payload.size() - half, true, 1024, message));
+            VERIFY_ARE_EQUAL(sizeof(json) - 1, message.size());
+            VERIFY_IS_TRUE(memcmp(json, message.data(), message.size()) == 0);
+        }
+
+        // A message that decompresses past the limit is stopped
+        http_internal_vector<uint8_t> zeros(100000, 0);
+        VERIFY_ARE_EQUAL(HC_OK, sender.compress(zeros));
+        message.clear();
+        VERIFY_ARE_EQUAL(HC_E_BUFFERTOOSMALL, receiver.decompress(zeros.data(), zeros.size(), true, 4096, message));
+    }
+
+
+    DEFINE_TEST_CASE(TestFrameKernelBenchmark)
+    {
+        DEFINE_TEST_CASE_PROPERTIES(TestFrameKernelBenchmark);
+
+        // Chat-like text: mostly ASCII with the odd accented letter and emoji
+        std::string text;
+        while (text.size() < 1024 * 1024)
+        {
+            text += "player ";
+            text += std::to_string(text.size() % 977);
+            text += text.size() % 5 == 0 ? " caf\xc3\xa9 \xf0\x9f\x98\x80 " : " joined the lobby, ";
+        }
+        text.resize(1024 * 1024);
+        while ((static_cast<uint8_t>(text.back()) & 0x80) != 0)
+        {
+            text.back() = ' ';
+        }
+
+        const uint8_t maskKey[] = { 0x37, 0xfa, 0x21, 0x3d };
+        const size_t sizes[] = { 64, 4 * 1024, 1024 * 1024 };
+        const std::pair<const wchar_t*, websocket_simd_level> levels[] =
+        {
+            { L"scalar", websocket_simd_level::scalar },
+            { L"SSE2", websocket_simd_level::sse2 },
+            { L"AVX2", websocket_simd_level::avx2 },
+            { L"NEON", websocket_simd_level::neon }
+        };
+        websocket_simd_level detected = websocket_get_simd_level();
+
+        http_internal_vector<uint8_t> expected(text.begin(), text.end());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            expected[i] ^= maskKey[(i + 1) & 3];
+        }
+
+        for (const auto& level : levels)
+        {
+            if (!websocket_set_simd_level(level.second))
+            {
+                continue;
+            }
+
+            for (size_t size : sizes)
+            {
+                http_internal_vector<uint8_t> payload(text.begin(), text.begin() + size);
+                websocket_mask(payload.data(), size, maskKey, 1);
+                VERIFY_IS_TRUE(memcmp(expected.data(), payload.data(), size) == 0);
+                websocket_mask(payload.data(), size, maskKey, 1);
+                VERIFY_IS_TRUE(websocket_is_valid_utf8(payload.data(), size));
+
+                // Enough passes for each size to take a measurable time
+                const size_t passes = (64 * 1024 * 1024) / size;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t pass = 0; pass < passes; pass++)
+                {
+                    websocket_mask(payload.data(), size, maskKey, 0);
+                }
+                auto maskElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+                start = std::chrono::high_resolution_clock::now();
+                bool valid = true;
+                for (size_t pass = 0; pass < passes; pass++)
+                {
+                    valid &= websocket_is_valid_utf8(reinterpret_cast<const uint8_t*>(text.data()), size);
+                }
+                auto utf8Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+                VERIFY_IS_TRUE(valid);
+
+                double megabytes = static_cast<double>(size) * passes / (1024 * 1024);
+                wchar_t message[256];
+                swprintf_s(message, L"%s %u bytes: mask %.0f MB/s, UTF-8 %.0f MB/s",
+                    level.first, static_cast<uint32_t>(size),
+                    megabytes * 1000000 / (maskElapsed > 0 ? maskElapsed : 1),
+                    megabytes * 1000000 / (utf8Elapsed > 0 ? utf8Elapsed : 1));
+                TEST_LOG(message);
+            }
+        }
+
+        websocket_set_simd_level(detected);
+    }
+
 };
 
 NAMESPACE_XBOX_HTTP_CLIENT_TEST_END